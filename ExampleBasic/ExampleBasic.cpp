@@ -26,16 +26,87 @@ constexpr wchar_t TargetWindowClass[] = L"ExampleClassName";
 constexpr bool    TestCaptureMonitor = true;
 constexpr bool    TestFreeThreaded = true;
 
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <map>
+#include <mutex>
 #include <opencv2/opencv.hpp>
 #include <Windows.h>
 #include <WGC/WGC.h>
+#include <WGC/Recorder.h>
+#include <WGC/DeltaCodec.h>
+#include <WGC/SharedRing.h>
+#include <WGC/FrameServer.h>
+#include <WGC/TemplateMatcher.h>
+#include <WGC/FrameGraph.h>
+#include <WGC/TilePool.h>
+#include <WGC/FrameMemory.h>
+#include <WGC/Preroll.h>
+#include <WGC/CApi.h>
+#include <WGC/LatencyProbe.h>
+#include <WGC/FramePyramid.h>
 
 int TestNormal();
 int TestCallback();
+int TestRecord();
+int TestReplay();
+int TestCodec();
+int TestSharedRing();
+int TestFrameServer();
+int TestMatcher();
+int TestProbe();
+int TestStats();
+int TestGraph();
+int TestTiles();
+int TestThreads();
+int TestMemory();
+int TestBudget();
+int TestAdaptive();
+int TestMotion();
+int TestPreroll();
+int TestCApi();
+int TestStartup();
+int TestLatency();
+int TestWatch();
+int TestPyramid();
+int TestViews();
 
-int main() { // You can switch the function.
+int RingReaderProcess();
+
+int main(int argc, char* argv[]) { // You can switch the function.
+	// "--ring-reader" is the reader process started by TestSharedRing().
+	if (argc > 1 && std::strcmp(argv[1], "--ring-reader") == 0)
+		return RingReaderProcess();
 	return TestNormal();
 	//return TestCallback();
+	//return TestRecord();
+	//return TestReplay();
+	//return TestCodec();
+	//return TestSharedRing();
+	//return TestFrameServer();
+	//return TestMatcher();
+	//return TestProbe();
+	//return TestStats();
+	//return TestGraph();
+	//return TestTiles();
+	//return TestThreads();
+	//return TestMemory();
+	//return TestBudget();
+	//return TestAdaptive();
+	//return TestMotion();
+	//return TestPreroll();
+	//return TestCApi();
+	//return TestStartup();
+	//return TestLatency();
+	//return TestWatch();
+	//return TestPyramid();
+	//return TestViews();
 }
 
 size_t cnt = 0;
@@ -183,3 +254,1291 @@ int TestCallback() {
 	//wgc::ICapture::drop();
 	return 0;
 }
+
+int TestRecord() {
+	// Initialization.
+	auto factory = wgc::IFactory::createInstance(false);
+	auto capture1 = factory->createCapturer().lock();
+	auto recorder = wgc::IRecorder::createInstance(L"test.wgcrec");
+	if (recorder == nullptr) {
+		return 1;
+	}
+	// Find Monitor.
+	HWND hwnd = FindWindowW(TargetWindowClass, TargetWindowName);
+	HMONITOR hmonitor = MonitorFromWindow(hwnd, MONITOR_DEFAULTTOPRIMARY);
+	if (hmonitor == NULL) {
+		return 2;
+	}
+
+	// The callback only copies the frame, the disk is written on the recorder's thread.
+	auto cb = [&capture1, &recorder](const cv::Mat& mat) {
+		recorder->push(mat, capture1->getFrameInfo());
+	};
+	if (!capture1->startCaptureMonitorWithCallback(hmonitor, cb)) {
+		return 3;
+	}
+
+	Sleep(10000); // Record about 10 seconds.
+
+	capture1->stopCapture();
+	recorder->close();
+	std::cout << "Written: " << recorder->getWrittenCount() << std::endl;
+	std::cout << "Dropped: " << recorder->getDroppedCount() << std::endl;
+	return 0;
+}
+
+int TestReplay() {
+	// Initialization. Replay the file of TestRecord() at double speed.
+	auto factory = wgc::IFactory::createInstance(false);
+	wgc::ReplayOptions options;
+	options.speed = 2.0;
+	auto capture1 = factory->createReplayCapturer(L"test.wgcrec", options).lock();
+
+	// The target is ignored, the consumer code is the same as TestNormal().
+	if (!capture1->startCaptureMonitor(NULL, TestFreeThreaded)) {
+		return 3;
+	}
+	capture1->askForRefresh(); // Ask for the first.
+	while (capture1->isCapturing()) {
+		if (capture1->isRefreshed()) {
+			cv::Mat mat;
+			capture1->copyMatTo(mat, true);
+			Test(mat);
+			capture1->askForRefresh(); // Ask for next one.
+		}
+		cv::waitKey(1);
+	}
+	return 0;
+}
+
+constexpr int CodecScenes = 4;
+constexpr int CodecSceneFrames = 120;
+
+// Draw the next frame of a codec test scene over the previous one. The same rng seed gives the same frames.
+void DrawCodecScene(int scene, int index, cv::RNG& rng, cv::Mat& text, cv::Mat& frame) {
+	const cv::Size full(1920, 1080);
+	switch (scene) {
+	case 0: // Solid fills: the whole frame every 30 frames, and a panel every frame.
+		if (index % 30 == 0) {
+			frame.create(full, CV_8UC4);
+			frame.setTo(cv::Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256), 255));
+		}
+		frame(cv::Rect(rng.uniform(0, full.width - 200), rng.uniform(0, full.height - 100), 200, 100))
+			.setTo(cv::Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256), 255));
+		break;
+	case 1: // Tiles of noise on a flat background.
+		if (index == 0) {
+			frame.create(full, CV_8UC4);
+			frame.setTo(cv::Scalar(64, 64, 64, 255));
+		}
+		for (int n = 0; n < 16; ++n) {
+			cv::Mat tile = frame(cv::Rect(rng.uniform(0, full.width / 64) * 64, rng.uniform(0, full.height / 64) * 64, 64, 64));
+			rng.fill(tile, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+		}
+		break;
+	case 2: // Text scrolling up by 4 pixels per frame.
+		if (index == 0) {
+			text.create(full.height * 2, full.width, CV_8UC4);
+			text.setTo(cv::Scalar(255, 255, 255, 255));
+			for (int y = 32; y < text.rows; y += 32) {
+				cv::putText(
+					text, "Line " + std::to_string(y / 32) + ": " + std::to_string(rng.next()) + " The quick brown fox jumps over the lazy dog.",
+					cv::Point(16, y), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 0, 255), 1, cv::LINE_AA
+				);
+			}
+		}
+		text(cv::Rect(0, (index * 4) % full.height, full.width, full.height)).copyTo(frame);
+		break;
+	default: // Size and type change every 20 frames, with panels on a flat background.
+	{
+		const struct {
+			cv::Size size;
+			int type;
+		} formats[] = {
+			{ full, CV_8UC4 }, { cv::Size(1280, 720), CV_8UC3 }, { cv::Size(1366, 768), CV_8UC4 }, { cv::Size(800, 600), CV_8UC1 }
+		};
+		if (index % 20 == 0) {
+			frame.create(formats[(index / 20) % 4].size, formats[(index / 20) % 4].type);
+			frame.setTo(cv::Scalar::all(96));
+		}
+		frame(cv::Rect(rng.uniform(0, frame.cols - 100), rng.uniform(0, frame.rows - 100), 100, 100)).setTo(cv::Scalar::all(rng.uniform(0, 256)));
+		break;
+	}
+	}
+}
+
+int TestCodec() {
+	// Encode, decode and compare generated scenes: solid fills, tiles of noise, scrolling text and size changes.
+	// Keep each keyframe and the delta after it, to fuzz the decoder later.
+	struct Pass {
+		double rawBytes = 0.0;
+		double encodedBytes = 0.0;
+		double encodeSeconds = 0.0;
+	};
+	std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>> corpus;
+	auto runScenes = [&corpus](bool check, Pass& pass) -> bool {
+		for (int scene = 0; scene < CodecScenes; ++scene) {
+			auto encoder = wgc::IDeltaEncoder::createInstance();
+			auto decoder = wgc::IDeltaDecoder::createInstance();
+			cv::RNG rng(scene + 1);
+			cv::Mat text, frame, decoded;
+			std::vector<uint8_t> encoded, keyframe;
+			for (int index = 0; index < CodecSceneFrames; ++index) {
+				DrawCodecScene(scene, index, rng, text, frame);
+				const int64 t0 = cv::getTickCount();
+				if (!encoder->encode(frame, encoded))
+					return false;
+				pass.encodeSeconds += (cv::getTickCount() - t0) / cv::getTickFrequency();
+				pass.rawBytes += static_cast<double>(frame.total() * frame.elemSize());
+				pass.encodedBytes += static_cast<double>(encoded.size());
+				if (!check)
+					continue;
+
+				if (!decoder->decode(encoded.data(), encoded.size(), decoded) ||
+					decoded.size() != frame.size() || decoded.type() != frame.type() || cv::norm(frame, decoded, cv::NORM_INF) != 0.0)
+					return false;
+				if (wgc::IDeltaDecoder::isKeyframe(encoded.data(), encoded.size())) {
+					keyframe = encoded;
+				}
+				else if (!keyframe.empty()) {
+					corpus.emplace_back(std::move(keyframe), encoded);
+					keyframe.clear();
+				}
+			}
+		}
+		return true;
+	};
+
+	// The bands are encoded in parallel, so measure once with all threads and once with one for the rate per core.
+	Pass parallel, single;
+	const int threads = cv::getNumThreads();
+	if (!runScenes(true, parallel)) {
+		std::cout << "Round trip failed." << std::endl;
+		return 4;
+	}
+	cv::setNumThreads(1);
+	const bool singleRes = runScenes(false, single);
+	cv::setNumThreads(threads);
+	if (!singleRes) {
+		return 4;
+	}
+	constexpr double TargetPerCore = 1000.0; // MB/s, of a release build.
+	const double singleRate = single.rawBytes / single.encodeSeconds / 1e6;
+	std::cout << "Ratio:  " << parallel.rawBytes / parallel.encodedBytes << std::endl;
+	std::cout << "Encode: " << singleRate << " MB/s on 1 thread, "
+		<< parallel.rawBytes / parallel.encodeSeconds / 1e6 << " MB/s on " << threads << " threads" << std::endl;
+	if (singleRate < TargetPerCore)
+		std::cout << "Below the target of " << TargetPerCore << " MB/s per core." << std::endl;
+
+	// Feed mutated streams to the decoder. It must reject them or return a valid frame, and never crash.
+	if (corpus.empty()) {
+		return 5;
+	}
+	auto decoder = wgc::IDeltaDecoder::createInstance();
+	cv::Mat decoded;
+	std::mt19937 rng(20240601);
+	size_t rejected = 0, accepted = 0;
+	for (int i = 0; i < 2000; ++i) {
+		const auto& entry = corpus[rng() % corpus.size()];
+		const bool delta = (rng() & 1) != 0;
+		std::vector<uint8_t> stream = delta ? entry.second : entry.first;
+		switch (rng() % 3) {
+		case 0: // Truncate.
+			stream.resize(rng() % stream.size());
+			break;
+		case 1: // Flip bits anywhere.
+			for (int n = 1 + rng() % 8; n > 0; --n)
+				stream[rng() % stream.size()] ^= static_cast<uint8_t>(1u << (rng() % 8));
+			break;
+		default: // Overwrite bytes of the frame header and the band table.
+			for (int n = 1 + rng() % 4; n > 0; --n)
+				stream[rng() % std::min<size_t>(stream.size(), 64)] = static_cast<uint8_t>(rng());
+			break;
+		}
+		// A delta is decoded after its keyframe.
+		if (delta && !decoder->decode(entry.first.data(), entry.first.size(), decoded)) {
+			std::cout << "Keyframe rejected." << std::endl;
+			return 5;
+		}
+		if (!decoder->decode(stream.data(), stream.size(), decoded)) {
+			++rejected;
+			continue;
+		}
+		if (decoded.empty() || decoded.depth() != CV_8U || decoded.channels() > 4) {
+			std::cout << "Invalid frame accepted." << std::endl;
+			return 6;
+		}
+		cv::sum(decoded); // Read every pixel.
+		++accepted;
+	}
+	std::cout << "Fuzz:   " << rejected << " rejected, " << accepted << " accepted, from " << corpus.size() << " stream pairs" << std::endl;
+	return singleRate < TargetPerCore ? 7 : 0;
+}
+
+int TestSharedRing() {
+	// Initialization. Frames are generated and stamped by the library, so the reader can check them without a display.
+	auto factory = wgc::IFactory::createInstance(false);
+	auto capture1 = factory->createSyntheticCapturer().lock();
+	auto publisher = wgc::IFramePublisher::createInstance(L"Local\\WGCTestRing");
+	if (publisher == nullptr) {
+		return 1;
+	}
+
+	// The callback copies each frame into the shared memory once, for any count of readers.
+	auto cb = [&capture1, &publisher](const cv::Mat& mat) {
+		publisher->push(mat, capture1->getFrameInfo());
+	};
+	if (!capture1->startCaptureMonitorWithCallback(NULL, cb)) {
+		return 3;
+	}
+
+	// The reader runs in another process, this executable started with "--ring-reader" (see RingReaderProcess()).
+	wchar_t path[MAX_PATH];
+	if (GetModuleFileNameW(NULL, path, MAX_PATH) == 0) {
+		return 4;
+	}
+	std::wstring commandLine = L"\"" + std::wstring(path) + L"\" --ring-reader";
+	STARTUPINFOW startup = { sizeof(startup) };
+	PROCESS_INFORMATION process = {};
+	if (!CreateProcessW(path, commandLine.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup, &process)) {
+		return 4;
+	}
+	CloseHandle(process.hThread);
+	const bool finished = WaitForSingleObject(process.hProcess, 30000) == WAIT_OBJECT_0;
+	DWORD exitCode = 0;
+	if (!finished)
+		TerminateProcess(process.hProcess, 1);
+	else
+		GetExitCodeProcess(process.hProcess, &exitCode);
+	CloseHandle(process.hProcess);
+
+	capture1->stopCapture();
+	std::cout << "Published: " << publisher->getPublishedCount() << std::endl;
+	if (!finished) {
+		std::cout << "The reader did not finish." << std::endl;
+		return 5;
+	}
+	return exitCode == 0 ? 0 : 6;
+}
+
+int RingReaderProcess() {
+	// Read 600 frames of TestSharedRing() without copying. Each must carry the stamp drawn when it was generated,
+	// and come later than the one before. The reader does not need a factory.
+	auto reader = wgc::IFrameRingReader::createInstance(L"Local\\WGCTestRing");
+	auto codec = wgc::ILatencyStampCodec::createInstance(); // The default layout, as in wgc::SyntheticOptions.
+	if (reader == nullptr || codec == nullptr) {
+		return 1;
+	}
+	cv::Mat view;
+	wgc::FrameInfo info;
+	wgc::LatencyStamp stamp;
+	uint64_t last = 0;
+	size_t testCnt = 600, overwritten = 0;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+	while (testCnt > 0) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			std::cout << "Reader: timed out, " << testCnt << " frame(s) missing." << std::endl;
+			return 2;
+		}
+		if (!reader->waitForFrame(1000) || !reader->acquireLatest(view, info))
+			continue;
+		// Zero-copy, the view is used right away, and counts only if it was not overwritten meanwhile.
+		const bool stamped = codec->decode(view, info.scale, stamp);
+		if (!reader->isViewValid()) {
+			++overwritten;
+			continue;
+		}
+		if (!stamped || stamp.counter != static_cast<uint32_t>(info.sequence) || stamp.timestamp != info.timestamp) {
+			std::cout << "Reader: frame " << info.sequence << " does not match its stamp." << std::endl;
+			return 3;
+		}
+		if (testCnt < 600 && info.sequence <= last) {
+			std::cout << "Reader: frame " << info.sequence << " came after " << last << "." << std::endl;
+			return 4;
+		}
+		last = info.sequence;
+		--testCnt;
+	}
+	std::cout << "Reader: skipped " << reader->getSkippedCount() << ", overwritten " << overwritten << std::endl;
+	return 0;
+}
+
+int TestFrameServer() {
+	// Initialization. Frames are generated by the library at a fixed rate, so the numbers are reproducible without a display.
+	auto factory = wgc::IFactory::createInstance(false);
+	wgc::SyntheticOptions options;
+	options.width = 1280;
+	options.height = 720;
+	options.fps = 120.0;
+	auto capture1 = factory->createSyntheticCapturer(options).lock();
+	auto server = wgc::IFrameServer::createInstance(L"wgc_test.sock");
+	if (server == nullptr) {
+		return 1;
+	}
+
+	// Keep the latest generated frames in BGR, to check what the full-size BGR clients decode.
+	constexpr size_t KeptFrames = 16;
+	std::mutex mutex;
+	std::map<uint64_t, cv::Mat> generated;
+	auto cb = [&capture1, &server, &mutex, &generated](const cv::Mat& mat) {
+		const wgc::FrameInfo info = capture1->getFrameInfo();
+		cv::Mat bgr;
+		cv::cvtColor(mat, bgr, cv::COLOR_BGRA2BGR);
+		{
+			std::lock_guard lock(mutex);
+			generated[info.sequence] = bgr;
+			if (generated.size() > KeptFrames)
+				generated.erase(generated.begin());
+		}
+		server->push(mat, info);
+	};
+	if (!capture1->startCaptureMonitorWithCallback(NULL, cb)) {
+		return 3;
+	}
+
+	// Clients with different subscriptions, receiving for 5 seconds each round.
+	// Timestamps of generated frames are taken by wgc::ILatencyStampCodec::now(), so the latency is from generation to the decoded frame.
+	bool mismatched = false;
+	for (size_t clientCnt : { 1, 2, 4, 8 }) {
+		std::vector<std::thread> clients;
+		std::vector<double> fps(clientCnt), latency(clientCnt);
+		std::vector<size_t> checked(clientCnt);
+		for (size_t i = 0; i < clientCnt; ++i) {
+			clients.emplace_back([&, i]() {
+				wgc::StreamRequest request;
+				request.format = (i % 2 == 0) ? wgc::StreamFormat::BGR : wgc::StreamFormat::Gray;
+				request.scale = (i % 4 < 2) ? 1.0f : 0.5f;
+				const bool check = request.format == wgc::StreamFormat::BGR && request.scale == 1.0f;
+				auto client = wgc::IFrameClient::createInstance(L"wgc_test.sock", request);
+				if (client == nullptr)
+					return;
+				cv::Mat frame;
+				wgc::FrameInfo info;
+				size_t frames = 0;
+				double latencySum = 0.0;
+				const int64 t0 = cv::getTickCount();
+				while ((cv::getTickCount() - t0) / cv::getTickFrequency() < 5.0 && client->receive(frame, info)) {
+					latencySum += (wgc::ILatencyStampCodec::now() - info.timestamp) / 1e4;
+					++frames;
+					if (!check)
+						continue;
+					// The codec is lossless, so the frame must equal the generated one, if it is still kept.
+					std::lock_guard lock(mutex);
+					auto it = generated.find(info.sequence);
+					if (it == generated.end())
+						continue;
+					if (it->second.size() != frame.size() || it->second.type() != frame.type() || cv::norm(it->second, frame, cv::NORM_INF) != 0.0)
+						mismatched = true;
+					++checked[i];
+				}
+				fps[i] = frames / ((cv::getTickCount() - t0) / cv::getTickFrequency());
+				latency[i] = frames > 0 ? latencySum / frames : 0.0;
+			});
+		}
+		for (auto& client : clients)
+			client.join();
+		std::cout << clientCnt << " client(s), " << options.fps << " fps generated:" << std::endl;
+		for (size_t i = 0; i < clientCnt; ++i) {
+			std::cout << "  #" << i << ": " << fps[i] << " fps, " << latency[i] << " ms";
+			if (i % 4 == 0)
+				std::cout << ", " << checked[i] << " frame(s) checked";
+			std::cout << std::endl;
+		}
+		if (checked[0] == 0) {
+			std::cout << "No frame was checked." << std::endl;
+			mismatched = true;
+		}
+	}
+
+	capture1->stopCapture();
+	server->close();
+	if (mismatched) {
+		std::cout << "Decoded frames differ from the generated ones." << std::endl;
+		return 4;
+	}
+	return 0;
+}
+
+int TestMatcher() {
+	// Initialization. Replay the file of TestRecord() as fast as possible, so both sides see the same frames.
+	auto factory = wgc::IFactory::createInstance(false);
+	wgc::ReplayOptions options;
+	options.speed = 0.0;
+	auto capture1 = factory->createReplayCapturer(L"test.wgcrec", options).lock();
+	auto matcher = wgc::ITemplateMatcher::createInstance();
+	if (matcher == nullptr) {
+		return 1;
+	}
+	if (!capture1->startCaptureMonitor(NULL, TestFreeThreaded)) {
+		return 3;
+	}
+
+	// Cut 8 templates from the first frame.
+	cv::Mat mat, gray;
+	std::vector<cv::Mat> templates;
+	capture1->askForRefresh();
+	while (capture1->isCapturing() && !capture1->isRefreshed())
+		Sleep(1);
+	capture1->copyMatTo(mat);
+	for (int i = 0; i < 8; ++i) {
+		const cv::Rect rect(mat.cols * (i % 4) / 4 + 16, mat.rows * (i / 4) / 2 + 16, 96, 48);
+		templates.push_back(mat(rect).clone());
+		matcher->addTemplate(templates.back());
+	}
+
+	// Naive: cv::matchTemplate over each full frame. Engine: the matcher.
+	double naiveSeconds = 0.0, engineSeconds = 0.0;
+	size_t frames = 0, differences = 0;
+	cv::Mat result;
+	capture1->askForRefresh();
+	while (capture1->isCapturing()) {
+		if (!capture1->isRefreshed())
+			continue;
+		capture1->copyMatTo(mat);
+		capture1->askForRefresh();
+
+		int64 t0 = cv::getTickCount();
+		std::vector<cv::Point> naive;
+		cv::cvtColor(mat, gray, cv::ColorConversionCodes::COLOR_BGRA2GRAY);
+		for (const cv::Mat& templ : templates) {
+			cv::Mat templGray;
+			cv::cvtColor(templ, templGray, cv::ColorConversionCodes::COLOR_BGRA2GRAY);
+			cv::matchTemplate(gray, templGray, result, cv::TemplateMatchModes::TM_CCOEFF_NORMED);
+			double maxVal;
+			cv::Point maxLoc;
+			cv::minMaxLoc(result, nullptr, &maxVal, nullptr, &maxLoc);
+			naive.push_back(maxVal >= 0.9 ? maxLoc : cv::Point(-1, -1));
+		}
+		int64 t1 = cv::getTickCount();
+		const auto& results = matcher->match(mat);
+		int64 t2 = cv::getTickCount();
+
+		naiveSeconds += (t1 - t0) / cv::getTickFrequency();
+		engineSeconds += (t2 - t1) / cv::getTickFrequency();
+		for (size_t i = 0; i < results.size(); ++i) {
+			if (naive[i] != (results[i].found ? results[i].rect.tl() : cv::Point(-1, -1)))
+				++differences;
+		}
+		++frames;
+	}
+	std::cout << "Frames:      " << frames << std::endl;
+	std::cout << "Naive:       " << naiveSeconds * 1000.0 / frames << " ms/frame" << std::endl;
+	std::cout << "Matcher:     " << engineSeconds * 1000.0 / frames << " ms/frame" << std::endl;
+	std::cout << "Differences: " << differences << std::endl;
+	return 0;
+}
+
+int TestProbe() {
+	// Initialization.
+	auto factory = wgc::IFactory::createInstance(false);
+	auto capture1 = factory->createCapturer().lock();
+	HWND hwnd = FindWindowW(TargetWindowClass, TargetWindowName);
+	if (hwnd == NULL) {
+		return 1;
+	}
+	if (!IsWindow(hwnd) || IsIconic(hwnd)) { // Requirements for capture window.
+		return 4;
+	}
+
+	// A pixel and some 3x3 patches. No frame is ever requested, so only these areas are read back.
+	capture1->setClipToClientArea(true);
+	capture1->addProbe(cv::Point(8, 8));
+	for (int i = 0; i < 16; ++i)
+		capture1->addProbe(cv::Rect(32 + i * 24, 64, 3, 3));
+
+	std::atomic<size_t> notifications = 0, changes = 0;
+	uint64_t lastSequence = 0;
+	capture1->setProbeCallback(
+		[&](const std::vector<wgc::ProbeValue>& values, const wgc::FrameInfo& info) -> void {
+			++notifications;
+			changes += values.size();
+			lastSequence = info.sequence;
+			for (const wgc::ProbeValue& value : values) {
+				std::cout << info.sequence << ": probe " << value.id << (value.valid ? " = " : " (outside) ") << value.color << std::endl;
+			}
+		}
+	);
+	if (!capture1->startCaptureWindow(hwnd, TestFreeThreaded)) {
+		return 5;
+	}
+
+	Sleep(10000);
+	capture1->stopCapture();
+	std::cout << "Frames:        " << lastSequence + 1 << std::endl;
+	std::cout << "Notifications: " << notifications << std::endl;
+	std::cout << "Changes:       " << changes << std::endl;
+	return 0;
+}
+
+int TestStats() {
+	// Initialization. Replay the file of TestRecord() as fast as possible.
+	auto factory = wgc::IFactory::createInstance(false);
+	wgc::ReplayOptions options;
+	options.speed = 0.0;
+	auto capture1 = factory->createReplayCapturer(L"test.wgcrec", options).lock();
+	if (!capture1->startCaptureMonitor(NULL, TestFreeThreaded)) {
+		return 3;
+	}
+
+	// A grid of 4x4 regions of 128x128.
+	std::vector<cv::Rect> rects;
+	for (int i = 0; i < 16; ++i) {
+		rects.emplace_back(64 + (i % 4) * 160, 64 + (i / 4) * 160, 128, 128);
+		capture1->addStatRegion(rects.back());
+	}
+
+	// Fused: stats in the copy. Naive: copy, then passes for mean, min/max and histograms.
+	double naiveSeconds = 0.0, fusedSeconds = 0.0;
+	size_t frames = 0, differences = 0;
+	cv::Mat mat, naiveMat, hist;
+	const int channels[] = { 0 };
+	const int histSize[] = { 32 };
+	const float range[] = { 0.0f, 256.0f };
+	const float* ranges[] = { range };
+	capture1->askForRefresh();
+	while (capture1->isCapturing()) {
+		if (!capture1->isRefreshed())
+			continue;
+
+		int64 t0 = cv::getTickCount();
+		capture1->copyMatTo(mat, true);
+		const std::vector<wgc::RegionStats> stats = capture1->getRegionStats();
+		int64 t1 = cv::getTickCount();
+		capture1->copyMatTo(naiveMat, true); // Statistics of this frame are ready, so this is a plain copy.
+		std::vector<cv::Scalar> means;
+		for (const cv::Rect& rect : rects) {
+			const cv::Mat area = naiveMat(rect);
+			means.push_back(cv::mean(area));
+			std::vector<cv::Mat> planes;
+			cv::split(area, planes);
+			for (const cv::Mat& plane : planes) {
+				double minVal, maxVal;
+				cv::minMaxLoc(plane, &minVal, &maxVal);
+				cv::calcHist(&plane, 1, channels, cv::noArray(), hist, 1, histSize, ranges);
+			}
+		}
+		int64 t2 = cv::getTickCount();
+		capture1->askForRefresh(); // Ask for next one.
+
+		fusedSeconds += (t1 - t0) / cv::getTickFrequency();
+		naiveSeconds += (t2 - t1) / cv::getTickFrequency();
+		for (size_t i = 0; i < stats.size(); ++i) {
+			for (int c = 0; c < 3; ++c) { // The naive copy is BGR, so skip alpha.
+				if (!stats[i].valid || std::abs(stats[i].mean[c] - means[i][c]) > 1e-6)
+					++differences;
+			}
+		}
+		++frames;
+	}
+	std::cout << "Frames:      " << frames << std::endl;
+	std::cout << "Naive:       " << naiveSeconds * 1000.0 / frames << " ms/frame" << std::endl;
+	std::cout << "Fused:       " << fusedSeconds * 1000.0 / frames << " ms/frame" << std::endl;
+	std::cout << "Differences: " << differences << std::endl;
+	return 0;
+}
+
+int TestGraph() {
+	// Initialization. Replay the file of TestRecord() as fast as possible.
+	auto factory = wgc::IFactory::createInstance(false);
+	wgc::ReplayOptions options;
+	options.speed = 0.0;
+	auto capture1 = factory->createReplayCapturer(L"test.wgcrec", options).lock();
+	if (!capture1->startCaptureMonitor(NULL, TestFreeThreaded)) {
+		return 3;
+	}
+
+	// crop -> resize -> gray -> threshold, and the crop also to HSV.
+	const cv::Rect area(0, 0, 1280, 720);
+	auto graph = wgc::IFrameGraph::createInstance();
+	const int cropped = graph->crop(wgc::IFrameGraph::Input, area);
+	const int half = graph->resize(cropped, cv::Size(), 0.5, 0.5, cv::InterpolationFlags::INTER_LINEAR);
+	const int gray = graph->cvtColor(half, cv::ColorConversionCodes::COLOR_BGRA2GRAY);
+	graph->addOutput(graph->threshold(gray, 128.0, 255.0, cv::ThresholdTypes::THRESH_BINARY));
+	const int bgr = graph->cvtColor(cropped, cv::ColorConversionCodes::COLOR_BGRA2BGR);
+	graph->addOutput(graph->cvtColor(bgr, cv::ColorConversionCodes::COLOR_BGR2HSV));
+
+	// Naive: the same calls, each into a full cv::Mat.
+	double naiveSeconds = 0.0, graphSeconds = 0.0;
+	size_t frames = 0, differences = 0;
+	cv::Mat mat, tmp, naiveMask, naiveHsv;
+	std::vector<cv::Mat> outputs;
+	capture1->askForRefresh();
+	while (capture1->isCapturing()) {
+		if (!capture1->isRefreshed())
+			continue;
+
+		int64 t0 = cv::getTickCount();
+		capture1->copyMatTo(mat);
+		cv::resize(mat(area), tmp, cv::Size(), 0.5, 0.5, cv::InterpolationFlags::INTER_LINEAR);
+		cv::cvtColor(tmp, tmp, cv::ColorConversionCodes::COLOR_BGRA2GRAY);
+		cv::threshold(tmp, naiveMask, 128.0, 255.0, cv::ThresholdTypes::THRESH_BINARY);
+		cv::cvtColor(mat(area), tmp, cv::ColorConversionCodes::COLOR_BGRA2BGR);
+		cv::cvtColor(tmp, naiveHsv, cv::ColorConversionCodes::COLOR_BGR2HSV);
+		int64 t1 = cv::getTickCount();
+		if (!capture1->runGraph(*graph, outputs))
+			return 6;
+		int64 t2 = cv::getTickCount();
+		capture1->askForRefresh(); // Ask for next one.
+
+		naiveSeconds += (t1 - t0) / cv::getTickFrequency();
+		graphSeconds += (t2 - t1) / cv::getTickFrequency();
+		differences += static_cast<size_t>(cv::norm(naiveMask, outputs[0], cv::NormTypes::NORM_L1) / 255.0); // Pixels on the other side of the threshold.
+		differences += cv::norm(naiveHsv, outputs[1], cv::NormTypes::NORM_INF) > 0.0 ? 1 : 0;
+		++frames;
+	}
+	std::cout << "Frames:      " << frames << std::endl;
+	std::cout << "Naive:       " << naiveSeconds * 1000.0 / frames << " ms/frame" << std::endl;
+	std::cout << "Graph:       " << graphSeconds * 1000.0 / frames << " ms/frame" << std::endl;
+	std::cout << "Differences: " << differences << std::endl;
+	return 0;
+}
+
+int TestTiles() {
+	// Scaling from 1 to N workers on synthetic 4K and 8K frames.
+	auto pool = wgc::ITilePool::createInstance();
+	if (pool == nullptr) {
+		return 1;
+	}
+	const int rounds = 20;
+	for (const cv::Size& size : { cv::Size(3840, 2160), cv::Size(7680, 4320) }) {
+		cv::Mat frame(size, CV_8UC4);
+		cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+		const cv::Size tileSize = pool->getDefaultTileSize(frame.elemSize());
+		std::cout << size.width << "x" << size.height << ", tiles of " << tileSize.width << "x" << tileSize.height << ":" << std::endl;
+
+		double single = 0.0;
+		for (int threads = 1; threads <= pool->getThreadCount(); ++threads) {
+			// Count bright pixels: per-tile grayscale and threshold, then sum in tile order.
+			int64 count = 0;
+			int64 t0 = cv::getTickCount();
+			for (int i = 0; i < rounds; ++i) {
+				count = pool->parallelReduce(
+					frame, tileSize, int64(0),
+					[](const cv::Mat& tile, const cv::Rect&) -> int64 {
+						cv::Mat gray;
+						cv::cvtColor(tile, gray, cv::ColorConversionCodes::COLOR_BGRA2GRAY);
+						cv::threshold(gray, gray, 128.0, 255.0, cv::ThresholdTypes::THRESH_BINARY);
+						return cv::countNonZero(gray);
+					},
+					[](int64 a, int64 b) -> int64 { return a + b; },
+					threads
+				);
+			}
+			int64 t1 = cv::getTickCount();
+			const double ms = (t1 - t0) * 1000.0 / cv::getTickFrequency() / rounds;
+			if (threads == 1)
+				single = ms;
+			std::cout << "  " << threads << " threads: " << ms << " ms, x" << single / ms << " (" << count << ")" << std::endl;
+		}
+	}
+	return 0;
+}
+
+int TestThreads() {
+	// Initialization. Read frames back on CPU 0 at a high priority, and run the callback on other CPUs.
+	auto factory = wgc::IFactory::createInstance(false);
+	wgc::ThreadingPolicy policy;
+	policy.dedicatedDelivery = true;
+	policy.captureAffinity = 0x1;
+	policy.capturePriority = THREAD_PRIORITY_HIGHEST;
+	policy.deliveryAffinity = ~0x1ull & ((1ull << std::min(std::thread::hardware_concurrency(), 64u)) - 1);
+	if (!factory->setThreadingPolicy(policy)) {
+		return 1;
+	}
+	auto capture1 = factory->createCapturer().lock();
+	// Find Monitor.
+	HWND hwnd = FindWindowW(TargetWindowClass, TargetWindowName);
+	HMONITOR hmonitor = MonitorFromWindow(hwnd, MONITOR_DEFAULTTOPRIMARY);
+	if (hmonitor == NULL) {
+		return 2;
+	}
+
+	// A slow callback, like inference. It no longer holds up the readback.
+	auto cb = [](const cv::Mat& mat) {
+		cv::Mat blurred;
+		cv::GaussianBlur(mat, blurred, cv::Size(31, 31), 0.0);
+	};
+	if (!capture1->startCaptureMonitorWithCallback(hmonitor, cb)) {
+		return 3;
+	}
+
+	Sleep(10000);
+
+	capture1->stopCapture();
+	for (const wgc::ThreadTimes& times : capture1->getThreadTimes()) {
+		std::cout << (times.role == wgc::ThreadRole::Capture ? "Capture  " : "Delivery ") << times.threadId
+			<< ": user " << times.userSeconds << " s, kernel " << times.kernelSeconds << " s, frames " << times.frames;
+		if (times.role == wgc::ThreadRole::Delivery)
+			std::cout << ", dropped " << times.dropped;
+		std::cout << std::endl;
+	}
+	return 0;
+}
+
+int TestMemory() {
+	// Conversion throughput of frames from OpenCV's allocation, aligned rows, and aligned rows on large pages.
+	// 1366 pixels of BGR is not a multiple of 64 bytes, so only the aligned provider keeps its rows aligned.
+	wgc::FrameMemoryOptions alignedOptions;
+	alignedOptions.stridePadding = 64;
+	wgc::FrameMemoryOptions largeOptions = alignedOptions;
+	largeOptions.largePages = true;
+	auto aligned = wgc::IFrameMemory::createInstance(alignedOptions);
+	auto large = wgc::IFrameMemory::createInstance(largeOptions);
+	if (aligned == nullptr || large == nullptr) {
+		return 1;
+	}
+	if (!large->isLargePageEnabled()) {
+		std::cout << "Large pages are not available, grant \"Lock pages in memory\" to use them." << std::endl;
+	}
+
+	const int rounds = 100;
+	for (const cv::Size& size : { cv::Size(3840, 2160), cv::Size(1366, 768) }) {
+		cv::Mat source(size, CV_8UC4);
+		cv::randu(source, cv::Scalar::all(0), cv::Scalar::all(256));
+		std::cout << size.width << "x" << size.height << ":" << std::endl;
+
+		const std::pair<const char*, std::shared_ptr<wgc::IFrameMemory>> providers[] = {
+			{ "OpenCV     ", nullptr }, { "Aligned    ", aligned }, { "Large pages", large }
+		};
+		for (const auto& provider : providers) {
+			cv::Mat frame, bgr, gray;
+			if (provider.second) {
+				frame = provider.second->allocate(size, CV_8UC4);
+				provider.second->create(bgr, size, CV_8UC3);
+				provider.second->create(gray, size, CV_8UC1);
+			}
+			source.copyTo(frame);
+
+			int64 t0 = cv::getTickCount();
+			for (int i = 0; i < rounds; ++i) {
+				cv::cvtColor(frame, bgr, cv::ColorConversionCodes::COLOR_BGRA2BGR);
+				cv::cvtColor(bgr, gray, cv::ColorConversionCodes::COLOR_BGR2GRAY);
+			}
+			int64 t1 = cv::getTickCount();
+			const double seconds = (t1 - t0) / cv::getTickFrequency();
+			const double bytes = static_cast<double>(size.area()) * 4.0 * rounds;
+			std::cout << "  " << provider.first << ": " << seconds * 1000.0 / rounds << " ms, " << bytes / seconds / 1e9 << " GB/s of BGRA" << std::endl;
+		}
+	}
+	return 0;
+}
+
+int TestBudget() {
+	// Initialization. Capture every visible window under a budget of 256 MB.
+	auto factory = wgc::IFactory::createInstance(false);
+	wgc::MemoryBudget budget;
+	budget.bytes = 256ull << 20;
+	budget.downscaleOutputs = true;
+	factory->setMemoryBudget(budget);
+
+	std::vector<HWND> windows;
+	EnumWindows(
+		[](HWND hwnd, LPARAM lParam) -> BOOL {
+			if (IsWindowVisible(hwnd) && !IsIconic(hwnd) && GetWindowTextLengthW(hwnd) > 0)
+				reinterpret_cast<std::vector<HWND>*>(lParam)->push_back(hwnd);
+			return TRUE;
+		},
+		reinterpret_cast<LPARAM>(&windows)
+	);
+
+	std::vector<std::shared_ptr<wgc::ICapturer>> capturers;
+	size_t refused = 0;
+	for (HWND hwnd : windows) {
+		auto capture = factory->createCapturer().lock();
+		if (capture == nullptr) {
+			++refused;
+			continue;
+		}
+		if (capture->startCaptureWindow(hwnd))
+			capturers.push_back(capture);
+		Sleep(50); // Let it report its first frame.
+	}
+	std::cout << "Windows: " << windows.size() << ", capturing: " << capturers.size() << ", refused: " << refused << std::endl;
+
+	for (int i = 0; i < 5; ++i) {
+		for (auto& capture : capturers)
+			capture->askForRefresh();
+		Sleep(1000);
+		const wgc::MemoryUsage usage = factory->getMemoryUsage();
+		std::cout << "Total: " << (usage.totalBytes >> 20) << " MB of " << (usage.budgetBytes >> 20) << " MB"
+			<< (usage.overBudget ? ", over budget" : "") << std::endl;
+	}
+	for (const wgc::CapturerMemory& memory : factory->getMemoryUsage().capturers) {
+		std::cout << "  " << memory.id << ": staging " << (memory.stagingBytes >> 10) << " KB, buffers " << (memory.bufferBytes >> 10)
+			<< " KB, cache " << (memory.cacheBytes >> 10) << " KB" << (memory.degraded ? ", degraded" : "") << std::endl;
+	}
+	for (auto& capture : capturers)
+		capture->stopCapture();
+	return 0;
+}
+
+int TestAdaptive() {
+	// Initialization. Replay the file of TestRecord() into a callback that is too slow for full-size frames.
+	auto factory = wgc::IFactory::createInstance(false);
+	auto capture1 = factory->createReplayCapturer(L"test.wgcrec").lock();
+	wgc::ThreadingPolicy policy;
+	policy.dedicatedDelivery = true;
+	capture1->setThreadingPolicy(policy);
+	wgc::AdaptiveScaleOptions options;
+	options.enabled = true;
+	options.callbackBudget = 1.0 / 30.0;
+	capture1->setAdaptiveScale(options);
+
+	// Its cost grows with the area, like a detector running on every pixel.
+	double lastScale = 0.0;
+	auto cb = [&capture1, &lastScale](const cv::Mat& mat) {
+		const wgc::FrameInfo info = capture1->getFrameInfo();
+		if (info.scale != lastScale) {
+			std::cout << "Frame " << info.sequence << ": scale " << info.scale << ", " << info.width << "x" << info.height << std::endl;
+			lastScale = info.scale;
+		}
+		cv::Mat blurred;
+		cv::GaussianBlur(mat, blurred, cv::Size(61, 61), 0.0);
+	};
+	if (!capture1->startCaptureMonitorWithCallback(NULL, cb)) {
+		return 3;
+	}
+	while (capture1->isCapturing()) {
+		Sleep(100);
+	}
+	capture1->stopCapture();
+	for (const wgc::ThreadTimes& times : capture1->getThreadTimes()) {
+		if (times.role == wgc::ThreadRole::Delivery)
+			std::cout << "Delivered: " << times.frames << ", dropped: " << times.dropped << std::endl;
+	}
+	return 0;
+}
+
+int TestMotion() {
+	// Initialization. Replay the file of TestRecord() with a 16x16 motion map and vectors within +-8 pixels.
+	auto factory = wgc::IFactory::createInstance(false);
+	auto capture1 = factory->createReplayCapturer(L"test.wgcrec").lock();
+	wgc::MotionOptions options;
+	options.enabled = true;
+	options.blockSize = 16;
+	options.searchRange = 8;
+	if (!capture1->setMotionMap(options)) {
+		return 1;
+	}
+
+	// Report how many blocks changed, and where the moving ones went on average.
+	constexpr int threshold = 16 * 16 * 3 * 8; // About 8 levels per channel.
+	auto cb = [&capture1, threshold](const cv::Mat& mat) {
+		const wgc::MotionMap motion = capture1->getMotionMap();
+		if (!motion.valid)
+			return;
+		int active = 0, moved = 0;
+		cv::Point2d sum(0.0, 0.0);
+		for (int y = 0; y < motion.sad.rows; ++y) {
+			for (int x = 0; x < motion.sad.cols; ++x) {
+				if (motion.sad.at<int32_t>(y, x) < threshold)
+					continue;
+				++active;
+				const cv::Vec<schar, 2> v = motion.vectors.at<cv::Vec<schar, 2>>(y, x);
+				if ((v[0] != 0 || v[1] != 0) && motion.residual.at<int32_t>(y, x) < threshold) {
+					++moved;
+					sum += cv::Point2d(-v[0], -v[1]);
+				}
+			}
+		}
+		if (active > 0) {
+			std::cout << "Frame " << capture1->getFrameInfo().sequence << ": " << active << " active blocks";
+			if (moved > 0)
+				std::cout << ", " << moved << " moved by (" << sum.x / moved << ", " << sum.y / moved << ")";
+			std::cout << std::endl;
+		}
+	};
+	if (!capture1->startCaptureMonitorWithCallback(NULL, cb)) {
+		return 3;
+	}
+	while (capture1->isCapturing()) {
+		Sleep(100);
+	}
+	capture1->stopCapture();
+	return 0;
+}
+
+int TestPreroll() {
+	// Initialization. Keep the last 10 seconds of the monitor in 256 MiB.
+	auto factory = wgc::IFactory::createInstance(false);
+	auto capture1 = factory->createCapturer().lock();
+	wgc::PrerollOptions options;
+	options.enabled = true;
+	options.seconds = 10.0;
+	options.arenaBytes = 256ull << 20;
+	if (!capture1->setPreroll(options)) {
+		return 1;
+	}
+	// Find Monitor.
+	HWND hwnd = FindWindowW(TargetWindowClass, TargetWindowName);
+	HMONITOR hmonitor = MonitorFromWindow(hwnd, MONITOR_DEFAULTTOPRIMARY);
+	if (hmonitor == NULL) {
+		return 2;
+	}
+	if (!capture1->startCaptureMonitor(hmonitor, TestFreeThreaded)) {
+		return 3;
+	}
+
+	// Let it fill, then dump while capturing goes on.
+	Sleep(15000);
+	const wgc::PrerollStatus status = capture1->getPrerollStatus();
+	std::cout << status.frames << " frames, " << status.seconds << " s, "
+		<< (status.usedBytes >> 20) << " MiB, dropped " << status.dropped << std::endl;
+	std::future<bool> dumped = capture1->dumpPreroll(L"test.wgcpre");
+	Sleep(1000);
+	capture1->stopCapture();
+	if (!dumped.get()) {
+		return 4;
+	}
+
+	// Read the file back and decode every frame.
+	std::ifstream file("test.wgcpre", std::ios::binary);
+	wgc::PrerollFileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || std::memcmp(header.magic, wgc::PrerollFileMagic, sizeof(header.magic)) != 0) {
+		return 5;
+	}
+	auto decoder = wgc::IDeltaDecoder::createInstance();
+	std::vector<uint8_t> data;
+	cv::Mat frame;
+	for (uint64_t i = 0; i < header.frameCount; ++i) {
+		wgc::PrerollRecord record;
+		file.read(reinterpret_cast<char*>(&record), sizeof(record));
+		data.resize(static_cast<size_t>(record.size));
+		file.read(reinterpret_cast<char*>(data.data()), data.size());
+		if (!file || !decoder->decode(data.data(), data.size(), frame)) {
+			return 6;
+		}
+	}
+	std::cout << "Decoded " << header.frameCount << " frames, the last is " << frame.cols << "x" << frame.rows << std::endl;
+	cv::imshow("Last frame of the pre-roll", frame);
+	cv::waitKey(0);
+	return 0;
+}
+
+int TestCApi() {
+	// Only the C interface is used here, as a C program or an FFI binding would.
+	wgc_factory factory = NULL;
+	wgc_capturer capturer = NULL;
+	if (wgc_factory_create(0, &factory) != WGC_OK) {
+		std::cout << wgc_get_last_error() << std::endl;
+		return 1;
+	}
+	if (wgc_capturer_create(factory, &capturer) != WGC_OK) {
+		std::cout << wgc_get_last_error() << std::endl;
+		wgc_factory_destroy(factory);
+		return 2;
+	}
+	if (wgc_capturer_start_monitor(capturer, NULL, 1) != WGC_OK) {
+		std::cout << wgc_get_last_error() << std::endl;
+		wgc_capturer_destroy(capturer);
+		wgc_factory_destroy(factory);
+		return 3;
+	}
+
+	// The caller owns the memory. Frames are converted to BGR straight into it.
+	// It starts empty and grows when the frame is bigger, as the info is filled even then.
+	std::vector<uint8_t> memory;
+	wgc_buffer buffer = {};
+	buffer.format = WGC_FORMAT_BGR8;
+	wgc_frame_info info;
+	int result = 0;
+	for (size_t testCnt = 600; testCnt > 0; --testCnt) {
+		wgc_result res = wgc_capturer_read(capturer, &buffer, 1000, &info);
+		if (res == WGC_ERROR_BUFFER_TOO_SMALL) {
+			buffer.width = info.width;
+			buffer.height = info.height;
+			buffer.stride = (info.width * 3 + 63) / 64 * 64;
+			memory.resize(static_cast<size_t>(buffer.stride) * buffer.height);
+			buffer.data = memory.data();
+			res = wgc_capturer_copy_frame(capturer, &buffer, &info);
+		}
+		if (res != WGC_OK) {
+			std::cout << wgc_result_string(res) << ": " << wgc_get_last_error() << std::endl;
+			result = 4;
+			break;
+		}
+		// Wrap the memory only to show it.
+		Test(cv::Mat(info.height, info.width, CV_8UC3, buffer.data, static_cast<size_t>(buffer.stride)));
+	}
+
+	wgc_capturer_destroy(capturer);
+	wgc_factory_destroy(factory);
+	return result;
+}
+
+int TestStartup() {
+	// Time to the first frame of a short capture job, for each way to create the factory.
+	// With a file of TestRecord(), replay stands in for the capture, so it also runs without a display.
+	constexpr bool OnReplay = false;
+	constexpr int Runs = 10;
+	const wgc::FactoryInit inits[] = { wgc::FactoryInit::Immediate, wgc::FactoryInit::Background, wgc::FactoryInit::Lazy };
+	const char* names[] = { "Immediate", "Background", "Lazy" };
+
+	HWND hwnd = FindWindowW(TargetWindowClass, TargetWindowName);
+	HMONITOR hmonitor = MonitorFromWindow(hwnd, MONITOR_DEFAULTTOPRIMARY);
+	if (hmonitor == NULL) {
+		return 2;
+	}
+	for (int i = 0; i < 3; ++i) {
+		std::vector<double> totals;
+		wgc::StartupTimes sumFactory = {};
+		wgc::CaptureStartTimes sumStart = {};
+		for (int run = 0; run < Runs; ++run) {
+			const auto begin = std::chrono::steady_clock::now();
+			auto factory = wgc::IFactory::createInstance(false, inits[i]);
+			auto capture1 = OnReplay ?
+				factory->createReplayCapturer(L"test.wgcrec", { 0.0, false }).lock() :
+				factory->createCapturer().lock();
+			// A real job would load its own resources here, while Background creates the device.
+			if (!capture1->startCaptureMonitor(hmonitor, true)) {
+				return 3;
+			}
+			while (!capture1->isRefreshed()) {
+				Sleep(0);
+			}
+			totals.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+
+			const wgc::StartupTimes factoryTimes = factory->getStartupTimes();
+			const wgc::CaptureStartTimes startTimes = capture1->getStartTimes();
+			sumFactory.apartmentSeconds += factoryTimes.apartmentSeconds;
+			sumFactory.deviceSeconds += factoryTimes.deviceSeconds;
+			sumFactory.interopSeconds += factoryTimes.interopSeconds;
+			sumStart.waitSeconds += startTimes.waitSeconds;
+			sumStart.startSeconds += startTimes.startSeconds;
+			sumStart.firstFrameSeconds += startTimes.firstFrameSeconds;
+			capture1->stopCapture();
+			factory->destroyCapturer(capture1);
+		}
+		std::sort(totals.begin(), totals.end());
+		std::cout << names[i] << ": time to first frame, ms: min " << totals.front() * 1000.0
+			<< ", median " << totals[totals.size() / 2] * 1000.0 << ", max " << totals.back() * 1000.0 << std::endl;
+		std::cout << "  average ms: apartment " << sumFactory.apartmentSeconds * 1000.0 / Runs
+			<< ", device " << sumFactory.deviceSeconds * 1000.0 / Runs
+			<< ", interop " << sumFactory.interopSeconds * 1000.0 / Runs
+			<< ", waited in start " << sumStart.waitSeconds * 1000.0 / Runs
+			<< ", start " << sumStart.startSeconds * 1000.0 / Runs
+			<< ", start to first frame " << sumStart.firstFrameSeconds * 1000.0 / Runs << std::endl;
+	}
+	return 0;
+}
+
+int TestLatency() {
+	// Latency from the source to the consumer. The stamp window draws a new stamp after every composition,
+	// and the capturer decodes it when the frame reaches the consumer.
+	// With OnSynthetic, frames are generated and stamped by the library itself, so it also runs without a display.
+	constexpr bool OnSynthetic = false;
+	auto factory = wgc::IFactory::createInstance(false);
+	std::shared_ptr<wgc::ILatencyStampWindow> window;
+	std::shared_ptr<wgc::ICapturer> capture1;
+	wgc::LatencyProbeOptions probe;
+	probe.enabled = true;
+	if (OnSynthetic) {
+		capture1 = factory->createSyntheticCapturer().lock();
+	}
+	else {
+		window = wgc::ILatencyStampWindow::createInstance();
+		if (window == nullptr) {
+			return 1;
+		}
+		capture1 = factory->createCapturer().lock();
+		probe.layout = window->getLayout(false);
+	}
+	HWND hwnd = OnSynthetic ? NULL : window->getWindow();
+
+	// Each preset is one configuration under test, measured in every delivery mode.
+	const struct {
+		const char* name;
+		int priority;
+	} presets[] = {
+		{ "normal", THREAD_PRIORITY_NORMAL },
+		{ "highest", THREAD_PRIORITY_HIGHEST }
+	};
+	for (const auto& preset : presets) {
+		probe.preset = preset.name;
+		capture1->setLatencyProbe(probe);
+		wgc::ThreadingPolicy policy;
+		policy.capturePriority = preset.priority;
+		policy.deliveryPriority = preset.priority;
+
+		// Polling.
+		capture1->setThreadingPolicy(policy);
+		if (!capture1->startCaptureWindow(hwnd, true)) {
+			return 3;
+		}
+		cv::Mat mat;
+		for (auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5); std::chrono::steady_clock::now() < end;) {
+			if (capture1->isRefreshed()) {
+				capture1->copyMatTo(mat);
+				capture1->askForRefresh();
+			}
+			Sleep(1);
+		}
+		capture1->stopCapture();
+
+		// Callback on the capture thread, then on the delivery thread.
+		for (bool dedicated : { false, true }) {
+			policy.dedicatedDelivery = dedicated;
+			capture1->setThreadingPolicy(policy);
+			if (!capture1->startCaptureWindowWithCallback(hwnd, [](const cv::Mat&) {})) {
+				return 3;
+			}
+			Sleep(5000);
+			capture1->stopCapture();
+		}
+	}
+
+	const char* modes[] = { "polling", "callback", "queued" };
+	for (const wgc::LatencyStats& stats : capture1->getLatencyStats()) {
+		std::cout << stats.preset << " / " << modes[static_cast<int>(stats.mode)] << ": " << stats.count << " frames ("
+			<< stats.undecoded << " undecoded), ms: min " << stats.minMs << ", p50 " << stats.p50Ms
+			<< ", p90 " << stats.p90Ms << ", p99 " << stats.p99Ms << ", max " << stats.maxMs << std::endl;
+	}
+	return 0;
+}
+
+int TestWatch() {
+	// Initialization. Replay the file of TestRecord() and watch a grid of 16x12 regions, each with its own callback.
+	auto factory = wgc::IFactory::createInstance(false);
+	auto capture1 = factory->createReplayCapturer(L"test.wgcrec").lock();
+	constexpr int Columns = 16, Rows = 12;
+	constexpr double Threshold = 4.0; // Sum of the differences of all channels, per pixel.
+	std::vector<int> counts(Columns * Rows, 0);
+	for (int y = 0; y < Rows; ++y) {
+		for (int x = 0; x < Columns; ++x) {
+			int& count = counts[y * Columns + x];
+			const int id = capture1->watchRegion(
+				cv::Rect(x * 120, y * 90, 120, 90), Threshold,
+				[&count](const wgc::RegionChange& change, const wgc::FrameInfo& info) {
+					if (count++ == 0) {
+						std::cout << "Frame " << info.sequence << ": region " << change.id << " at " << change.rect
+							<< " changed by " << change.change << std::endl;
+					}
+				}
+			);
+			if (id < 0) {
+				return 1;
+			}
+		}
+	}
+
+	// The regions are checked on every frame, even if no frame is requested.
+	if (!capture1->startCaptureMonitor(NULL)) {
+		return 3;
+	}
+	while (capture1->isCapturing()) {
+		Sleep(100);
+	}
+	capture1->stopCapture();
+
+	// Times each region changed.
+	for (int y = 0; y < Rows; ++y) {
+		for (int x = 0; x < Columns; ++x) {
+			std::cout << counts[y * Columns + x] << '\t';
+		}
+		std::cout << std::endl;
+	}
+	return 0;
+}
+
+int TestPyramid() {
+	// Three consumers want each frame at 1/2, 1/4 and 1/8 of its size.
+	// They share the pyramid of the frame, so level 1 is computed once, by whoever asks first.
+	auto factory = wgc::IFactory::createInstance(false);
+	auto capture1 = factory->createCapturer().lock();
+	if (!capture1->startCaptureMonitor(NULL)) {
+		return 3;
+	}
+	capture1->askForRefresh();
+	for (int frames = 0; frames < 100;) {
+		if (!capture1->isRefreshed()) {
+			Sleep(1);
+			continue;
+		}
+		std::shared_ptr<wgc::IFramePyramid> pyramid = capture1->getPyramid();
+		if (pyramid == nullptr) {
+			return 1;
+		}
+		const auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> consumers;
+		std::vector<double> means(3, 0.0);
+		for (int level = 1; level <= 3; ++level) {
+			consumers.emplace_back([pyramid, level, &means]() {
+				const cv::Mat mat = pyramid->getLevel(level);
+				if (!mat.empty())
+					means[level - 1] = cv::mean(mat)[1];
+			});
+		}
+		for (std::thread& consumer : consumers) {
+			consumer.join();
+		}
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (frames % 10 == 0) {
+			std::cout << "Frame " << pyramid->getInfo().sequence << ": " << pyramid->getLevelCount() << " levels, "
+				<< pyramid->getLevel(3).cols << "x" << pyramid->getLevel(3).rows << " at 1/8, green "
+				<< means[0] << " / " << means[1] << " / " << means[2] << ", " << ms << " ms" << std::endl;
+		}
+		capture1->askForRefresh();
+		++frames;
+	}
+	capture1->stopCapture();
+	return 0;
+}
+
+int TestViews() {
+	// Seven consumers of one capturer: BGR, gray at half size (twice), two overlapping HSV crops
+	// and two overlapping gray crops at half size.
+	// The two gray views share one result, and the two HSV crops are converted as one area.
+	// The half-size crops are resized separately, so each is exactly lround(roi * scale).
+	auto factory = wgc::IFactory::createInstance(false);
+	auto capture1 = factory->createCapturer().lock();
+	struct Consumer {
+		const char* name;
+		wgc::ViewOptions options;
+		std::atomic<int> frames;
+		cv::Size size;
+	};
+	Consumer consumers[7] = {
+		{ "bgr", { cv::Rect(), 1.0, cv::COLOR_BGRA2BGR } },
+		{ "gray/2", { cv::Rect(), 0.5, cv::COLOR_BGRA2GRAY } },
+		{ "gray/2 again", { cv::Rect(), 0.5, cv::COLOR_BGRA2GRAY } },
+		{ "hsv crop", { cv::Rect(100, 100, 400, 300), 1.0, cv::COLOR_BGR2HSV } },
+		{ "hsv crop 2", { cv::Rect(300, 200, 400, 300), 1.0, cv::COLOR_BGR2HSV } },
+		{ "gray crop/2", { cv::Rect(100, 100, 400, 300), 0.5, cv::COLOR_BGRA2GRAY } },
+		{ "gray crop/2 2", { cv::Rect(301, 201, 401, 301), 0.5, cv::COLOR_BGRA2GRAY } }
+	};
+	for (Consumer& consumer : consumers) {
+		consumer.frames = 0;
+		const int id = capture1->subscribeView(
+			consumer.options,
+			[&consumer](const cv::Mat& view, const wgc::FrameInfo&) {
+				consumer.size = view.size();
+				++consumer.frames;
+			}
+		);
+		if (id < 0) {
+			return 1;
+		}
+	}
+
+	// The views are computed on every frame, even if no frame is requested.
+	if (!capture1->startCaptureMonitor(NULL)) {
+		return 3;
+	}
+	Sleep(5000);
+	capture1->stopCapture();
+
+	for (const Consumer& consumer : consumers) {
+		std::cout << consumer.name << ": " << consumer.frames << " frames of " << consumer.size.width << "x" << consumer.size.height << std::endl;
+		// The crops are inside the monitor.
+		const cv::Rect& roi = consumer.options.roi;
+		const double scale = consumer.options.scale;
+		const cv::Size expected(static_cast<int>(std::lround(roi.width * scale)), static_cast<int>(std::lround(roi.height * scale)));
+		if (roi != cv::Rect() && consumer.frames > 0 && consumer.size != expected) {
+			std::cout << "Wrong size." << std::endl;
+			return 4;
+		}
+	}
+	std::cout << "Cache of the capturer, with the views: " << capture1->getMemoryUsage().cacheBytes << " bytes" << std::endl;
+	return 0;
+}
@@ -61,6 +61,8 @@ bool ohms::MainWindow::create(int nShowCmd) noexcept {
 		return false;
 	SetWindowTextW(m_hwnd, L"CaptureWithOpenCV");
 
+	m_registry.start();
+
 	//SetTimer(hMain, 1, 300, NULL);
 	SetTimer(m_hwnd, 1, 60, NULL);
 
@@ -242,13 +244,15 @@ LRESULT MainWindow::procedure(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
 			stopCapture(true);
 
-			HWND dst = m_windows.at(index).getHWnd();
+			HWND dst = ohms::ToHWnd(m_windows.at(index).getHandle());
 
 			if (IsWindow(dst)) {
 				if (!IsIconic(dst)) {
 					if (r_capture->startCaptureWindow(dst)) {
 						r_capture->setClipToClientArea(isClient);
 						r_capture->askForRefresh();
+						Button_Enable(hButtonSave, TRUE);
+						Button_Enable(hButtonSaveC3, TRUE);
 						//ohms::global::g_app->setDecimationMode(isSample);
 						//ohms::global::g_app->setShowScale(scale);
 
@@ -306,9 +310,7 @@ LRESULT MainWindow::procedure(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 					MessageBoxW(hwnd, L"Please choose a window before save image.", L"ERROR", MB_ICONERROR);
 				}
 				else {
-					//if (!ohms::global::g_app->saveNow(false, saveCount++)) {
-					//	MessageBoxW(hwnd, L"Failed saving.", L"ERROR", MB_ICONERROR);
-					//}
+					saveFrame(false);
 				}
 			}
 			else if ((HWND)lParam == hButtonSaveC3) {
@@ -316,9 +318,7 @@ LRESULT MainWindow::procedure(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 					MessageBoxW(hwnd, L"Please choose a window before save image.", L"ERROR", MB_ICONERROR);
 				}
 				else {
-					//if (!ohms::global::g_app->saveNow(true, saveCount++)) {
-					//	MessageBoxW(hwnd, L"Failed saving.", L"ERROR", MB_ICONERROR);
-					//}
+					saveFrame(true);
 				}
 			}
 			else if ((HWND)lParam == hButtonSwitchClient) {
@@ -341,6 +341,16 @@ LRESULT MainWindow::procedure(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 			r_capture->copyMatTo(m_mat, false); // 不要求转换为BGR
 			cv::imshow("test", m_mat);
 		}
+		for (auto i = m_saving.begin(); i != m_saving.end();) { // 编码在后台进行，这里只检查结果
+			if (i->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				++i;
+				continue;
+			}
+			const bool res = i->get();
+			i = m_saving.erase(i);
+			if (!res)
+				MessageBoxW(hwnd, L"Failed saving.", L"ERROR", MB_ICONERROR);
+		}
 		break;
 
 	case WM_OHMS_REFRESH_COMBOX:
@@ -360,17 +370,15 @@ LRESULT MainWindow::procedure(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
 void MainWindow::refreshCombox() {
 	m_windows.clear();
-	ohms::EnumerateWindows(m_windows);
+	if (!m_registry.isRunning())
+		m_registry.rescan(); // 没有钩子时，每次刷新都重新扫描。
+	for (const ohms::WindowInfo& window : *m_registry.snapshot()) {
+		if (ohms::ToHWnd(window.getHandle()) != m_hwnd)
+			m_windows.push_back(window);
+	}
 
 	SendMessageW(hComboBoxHwnd, CB_RESETCONTENT, 0, 0);
 
-	for (std::vector<ohms::WindowInfo>::iterator i = m_windows.begin(), n = m_windows.end(); i != n; ++i) {
-		if (i->getHWnd() == m_hwnd) {
-			m_windows.erase(i);
-			break;
-		}
-	}
-
 	// Populate combo box
 	for (const ohms::WindowInfo& window : m_windows) {
 		SendMessageW(hComboBoxHwnd, CB_ADDSTRING, 0, (LPARAM)window.getTitle().c_str());
@@ -381,6 +389,9 @@ void MainWindow::stopCapture(bool special) {
 	nowPlay = -1;
 	r_capture->stopCapture();
 
+	Button_Enable(hButtonSave, FALSE);
+	Button_Enable(hButtonSaveC3, FALSE);
+
 	if (!special)
 		SendMessageW(hComboBoxHwnd, CB_SETCURSEL, -1, 0);
 
@@ -390,4 +401,13 @@ void MainWindow::stopCapture(bool special) {
 		InvalidateRect(m_hwnd, NULL, true);
 }
 
+void MainWindow::saveFrame(bool convertToBGR) {
+	wgc::SaveOptions options;
+	options.convertToBGR = convertToBGR;
+	m_saving.push_back(r_capture->saveFrameAsync(
+		L"save_" + std::to_wstring(saveCount++) + L".png",
+		wgc::ImageFormat::PNG, options
+	));
+}
+
 } // namespace ohms
@@ -22,6 +22,7 @@
 
 #include "Window.h"
 #include "WndEnumeration.h"
+#include "WindowRegistry.h"
 
 #include <vector>
 #include <WGC/WGC.h>
@@ -48,6 +49,7 @@ protected:
 
 	void refreshCombox();
 	void stopCapture(bool special = false);
+	void saveFrame(bool convertToBGR);
 
 protected:
 	std::shared_ptr<wgc::IFactory> r_factory;
@@ -63,6 +65,7 @@ protected:
 	HWND hButtonSave;
 	HWND hButtonSaveC3;
 	HWND hButtonSwitchClient;
+	ohms::WindowRegistry m_registry;
 	std::vector<ohms::WindowInfo> m_windows;
 
 	bool isSample = false;
@@ -70,6 +73,7 @@ protected:
 	int scale = 100;
 	LONG_PTR nowPlay = -1;
 	size_t saveCount = 0;
+	std::vector<std::future<bool>> m_saving;
 };
 
 } // namespace ohms
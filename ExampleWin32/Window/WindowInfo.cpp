@@ -0,0 +1,46 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "WindowInfo.h"
+
+namespace ohms {
+
+WindowInfo::WindowInfo() noexcept :
+	m_handle(0) {}
+
+WindowInfo::WindowInfo(WindowHandle handle, std::wstring const& title, std::wstring const& className) noexcept {
+	m_handle = handle;
+	m_title = title;
+	m_className = className;
+}
+
+WindowHandle WindowInfo::getHandle() const noexcept {
+	return m_handle;
+}
+
+std::wstring const& WindowInfo::getTitle() const noexcept {
+	return m_title;
+}
+
+std::wstring const& WindowInfo::getClassName() const noexcept {
+	return m_className;
+}
+
+} // namespace ohms
@@ -0,0 +1,49 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace ohms {
+
+/**
+ * @brief 窗口句柄的值。不依赖Win32，与HWND的转换见 WndEnumeration.h。
+*/
+typedef uintptr_t WindowHandle;
+
+struct WindowInfo final {
+public:
+	WindowInfo() noexcept;
+	WindowInfo(WindowHandle handle, std::wstring const& title, std::wstring const& className) noexcept;
+	~WindowInfo() = default;
+
+	WindowHandle getHandle() const noexcept;
+	std::wstring const& getTitle() const noexcept;
+	std::wstring const& getClassName() const noexcept;
+
+protected:
+	WindowHandle m_handle;
+	std::wstring m_title;
+	std::wstring m_className;
+}; // sturct WindowInfo
+
+} // namespace ohms
@@ -0,0 +1,115 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "WindowRegistry.h"
+
+namespace {
+
+class Win32WindowSource final :
+	public ohms::IWindowSource {
+public:
+	virtual bool query(ohms::WindowHandle handle, ohms::WindowInfo& info) override {
+		return ohms::QueryWindowInfo(ohms::ToHWnd(handle), info);
+	}
+
+	virtual void enumerate(std::vector<ohms::WindowHandle>& handles) override {
+		EnumWindows(
+			[](HWND hwnd, LPARAM lParam) -> BOOL {
+				reinterpret_cast<std::vector<ohms::WindowHandle>*>(lParam)->push_back(ohms::ToWindowHandle(hwnd));
+				return TRUE;
+			},
+			reinterpret_cast<LPARAM>(&handles)
+		);
+	}
+};
+
+ohms::WindowRegistry* g_registry = nullptr; // 钩子的回调没有用户数据。
+
+} // namespace
+
+namespace ohms {
+
+WindowRegistry::WindowRegistry() :
+	WindowRegistryCore(std::make_unique<Win32WindowSource>()) {}
+
+WindowRegistry::~WindowRegistry() {
+	stop();
+}
+
+bool WindowRegistry::start() noexcept {
+	if (g_registry != nullptr)
+		return g_registry == this;
+	g_registry = this;
+
+	// 分开注册，避开频繁的 EVENT_OBJECT_LOCATIONCHANGE 等事件。
+	const std::pair<DWORD, DWORD> ranges[] = {
+		{ EVENT_OBJECT_CREATE, EVENT_OBJECT_HIDE },
+		{ EVENT_OBJECT_NAMECHANGE, EVENT_OBJECT_NAMECHANGE },
+		{ EVENT_OBJECT_CLOAKED, EVENT_OBJECT_UNCLOAKED }
+	};
+	for (auto const& range : ranges) {
+		HWINEVENTHOOK hook = SetWinEventHook(
+			range.first, range.second, NULL,
+			&WindowRegistry::WinEventProc, 0, 0, WINEVENT_OUTOFCONTEXT
+		);
+		if (hook == NULL) {
+			stop();
+			return false;
+		}
+		m_hooks.push_back(hook);
+	}
+
+	rescan();
+	return true;
+}
+
+void WindowRegistry::stop() noexcept {
+	for (HWINEVENTHOOK hook : m_hooks)
+		UnhookWinEvent(hook);
+	m_hooks.clear();
+	if (g_registry == this)
+		g_registry = nullptr;
+}
+
+bool WindowRegistry::isRunning() const noexcept {
+	return !m_hooks.empty();
+}
+
+void CALLBACK WindowRegistry::WinEventProc(
+	HWINEVENTHOOK, DWORD event, HWND hwnd,
+	LONG idObject, LONG idChild, DWORD, DWORD
+) {
+	if (g_registry == nullptr || hwnd == NULL || idObject != OBJID_WINDOW || idChild != CHILDID_SELF)
+		return;
+
+	switch (event) {
+	case EVENT_OBJECT_CREATE:
+		g_registry->onEvent(WindowEvent::Created, ToWindowHandle(hwnd));
+		break;
+	case EVENT_OBJECT_DESTROY:
+		g_registry->onEvent(WindowEvent::Destroyed, ToWindowHandle(hwnd));
+		break;
+	default:
+		g_registry->onEvent(WindowEvent::Changed, ToWindowHandle(hwnd));
+		break;
+	}
+}
+
+} // namespace ohms
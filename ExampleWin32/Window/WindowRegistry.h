@@ -0,0 +1,57 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "../framework.h"
+#include "WindowRegistryCore.h"
+#include "WndEnumeration.h"
+
+namespace ohms {
+
+/**
+ * @brief 由 SetWinEventHook 的事件驱动的窗口登记表，不必每次都 EnumerateWindows。
+ * @brief 事件在调用 start 的线程的消息循环中处理。同一时间只能有一个在运行。
+*/
+class WindowRegistry final :
+	public WindowRegistryCore {
+public:
+	WindowRegistry();
+	virtual ~WindowRegistry() override;
+
+public:
+	/**
+	 * @brief 安装钩子并扫描一次。调用线程必须有消息循环。
+	*/
+	bool start() noexcept;
+	void stop() noexcept;
+	bool isRunning() const noexcept;
+
+protected:
+	static void CALLBACK WinEventProc(
+		HWINEVENTHOOK hook, DWORD event, HWND hwnd,
+		LONG idObject, LONG idChild, DWORD idEventThread, DWORD dwmsEventTime
+	);
+
+protected:
+	std::vector<HWINEVENTHOOK> m_hooks;
+};
+
+} // namespace ohms
@@ -0,0 +1,161 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "WindowRegistryCore.h"
+
+#include <unordered_set>
+
+namespace ohms {
+
+WindowRegistryCore::WindowRegistryCore(std::unique_ptr<IWindowSource> source) :
+	m_source(std::move(source)),
+	m_nextOrder(0),
+	m_version(0) {}
+
+void WindowRegistryCore::rescan() {
+	std::vector<WindowHandle> handles;
+	m_source->enumerate(handles);
+
+	std::lock_guard lock(m_mutex);
+	bool changed = false;
+
+	const std::unordered_set<WindowHandle> alive(handles.begin(), handles.end());
+	for (auto i = m_orders.begin(); i != m_orders.end();) {
+		if (alive.count(i->first) == 0) {
+			m_windows.erase(i->second);
+			i = m_orders.erase(i);
+			changed = true;
+		}
+		else {
+			++i;
+		}
+	}
+	for (WindowHandle handle : handles)
+		changed |= Update(handle);
+
+	if (changed)
+		MarkChanged();
+}
+
+void WindowRegistryCore::onEvent(WindowEvent event, WindowHandle handle) {
+	std::lock_guard lock(m_mutex);
+	bool changed = false;
+	switch (event) {
+	case WindowEvent::Destroyed:
+		changed = Remove(handle);
+		break;
+	case WindowEvent::Created:
+	case WindowEvent::Changed:
+		changed = Update(handle);
+		break;
+	}
+	if (changed)
+		MarkChanged();
+}
+
+std::shared_ptr<const std::vector<WindowInfo>> WindowRegistryCore::snapshot() {
+	std::lock_guard lock(m_mutex);
+	if (m_snapshot == nullptr) {
+		auto windows = std::make_shared<std::vector<WindowInfo>>();
+		windows->reserve(m_windows.size());
+		for (auto const& window : m_windows)
+			windows->push_back(window.second);
+		m_snapshot = std::move(windows);
+	}
+	return m_snapshot;
+}
+
+uint64_t WindowRegistryCore::getVersion() {
+	std::lock_guard lock(m_mutex);
+	return m_version;
+}
+
+std::vector<WindowInfo> WindowRegistryCore::find(std::wstring const& classPattern, std::wstring const& titlePattern) {
+	std::vector<WindowInfo> res;
+	for (WindowInfo const& window : *snapshot()) {
+		if (MatchPattern(classPattern, window.getClassName()) && MatchPattern(titlePattern, window.getTitle()))
+			res.push_back(window);
+	}
+	return res;
+}
+
+bool WindowRegistryCore::MatchPattern(std::wstring const& pattern, std::wstring const& text) noexcept {
+	if (pattern.empty())
+		return true;
+
+	// Greedy wildcard matching, backtracking only to the last '*'.
+	size_t p = 0, t = 0;
+	size_t starP = std::wstring::npos, starT = 0;
+	while (t < text.size()) {
+		if (p < pattern.size() && (pattern[p] == L'?' || pattern[p] == text[t])) {
+			++p;
+			++t;
+		}
+		else if (p < pattern.size() && pattern[p] == L'*') {
+			starP = p++;
+			starT = t;
+		}
+		else if (starP != std::wstring::npos) {
+			p = starP + 1;
+			t = ++starT;
+		}
+		else {
+			return false;
+		}
+	}
+	while (p < pattern.size() && pattern[p] == L'*')
+		++p;
+	return p == pattern.size();
+}
+
+bool WindowRegistryCore::Update(WindowHandle handle) {
+	WindowInfo info;
+	if (!m_source->query(handle, info))
+		return Remove(handle);
+
+	auto it = m_orders.find(handle);
+	if (it == m_orders.end()) {
+		const uint64_t order = m_nextOrder++;
+		m_orders.emplace(handle, order);
+		m_windows.emplace(order, std::move(info));
+		return true;
+	}
+	WindowInfo& old = m_windows[it->second];
+	if (old.getTitle() == info.getTitle() && old.getClassName() == info.getClassName())
+		return false;
+	old = std::move(info);
+	return true;
+}
+
+bool WindowRegistryCore::Remove(WindowHandle handle) {
+	auto it = m_orders.find(handle);
+	if (it == m_orders.end())
+		return false;
+	m_windows.erase(it->second);
+	m_orders.erase(it);
+	return true;
+}
+
+void WindowRegistryCore::MarkChanged() {
+	++m_version;
+	m_snapshot.reset();
+}
+
+} // namespace ohms
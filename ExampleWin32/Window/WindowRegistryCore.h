@@ -0,0 +1,112 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "WindowInfo.h"
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+namespace ohms {
+
+/**
+ * @brief 窗口信息的来源。WindowRegistryCore 只通过它访问系统，所以可以用假的来源驱动。
+*/
+class IWindowSource {
+public:
+	virtual ~IWindowSource() = default;
+
+	/**
+	 * @brief 读取窗口信息。
+	 * @return 该窗口是否应该列出。
+	*/
+	virtual bool query(WindowHandle handle, WindowInfo& info) = 0;
+	/**
+	 * @brief 列出所有顶层窗口（不必筛选）。
+	*/
+	virtual void enumerate(std::vector<WindowHandle>& handles) = 0;
+};
+
+enum class WindowEvent {
+	Created,
+	Destroyed,
+	Changed // 标题、可见性或cloak改变。
+};
+
+/**
+ * @brief 窗口登记表的核心：根据事件增量地维护窗口列表，不直接调用系统，也不依赖Win32。
+ * @brief 窗口按第一次出现的顺序排列。线程安全。
+*/
+class WindowRegistryCore {
+public:
+	WindowRegistryCore(std::unique_ptr<IWindowSource> source);
+	virtual ~WindowRegistryCore() = default;
+
+public:
+	/**
+	 * @brief 完整地重新扫描一次，用于开始时和错过事件后。
+	*/
+	void rescan();
+	/**
+	 * @brief 处理一个事件。只查询事件涉及的窗口。
+	*/
+	void onEvent(WindowEvent event, WindowHandle handle);
+
+	/**
+	 * @brief 当前的窗口列表。列表不变时返回同一个对象，不复制。
+	*/
+	std::shared_ptr<const std::vector<WindowInfo>> snapshot();
+	/**
+	 * @brief 列表每次改变都会增加。
+	*/
+	uint64_t getVersion();
+
+	/**
+	 * @brief 按类名和标题查找窗口。模式支持'*'和'?'，空模式匹配任何字符串。
+	*/
+	std::vector<WindowInfo> find(std::wstring const& classPattern, std::wstring const& titlePattern);
+
+	static bool MatchPattern(std::wstring const& pattern, std::wstring const& text) noexcept;
+
+protected:
+	/**
+	 * @brief 查询窗口并更新登记。需要持有锁。
+	 * @return 列表是否改变。
+	*/
+	bool Update(WindowHandle handle);
+	bool Remove(WindowHandle handle);
+	void MarkChanged();
+
+protected:
+	std::unique_ptr<IWindowSource> m_source;
+
+	std::mutex m_mutex;
+	std::unordered_map<WindowHandle, uint64_t> m_orders; // 窗口 -> 出现顺序。
+	std::map<uint64_t, WindowInfo> m_windows;    // 出现顺序 -> 窗口。
+	uint64_t m_nextOrder;
+	uint64_t m_version;
+	std::shared_ptr<const std::vector<WindowInfo>> m_snapshot; // 列表改变后才重建。
+};
+
+} // namespace ohms
@@ -0,0 +1,137 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "WindowRegistryCore.h"
+
+namespace {
+
+/**
+ * @brief 假的窗口来源：窗口由测试直接增删，事件也由测试发出。
+*/
+class FakeWindowSource final :
+	public ohms::IWindowSource {
+public:
+	struct Window {
+		bool listed; // 是否应该列出（可见、有标题、没有cloak）。
+		std::wstring title;
+		std::wstring className;
+	};
+
+	FakeWindowSource(std::map<ohms::WindowHandle, Window>& windows) :
+		r_windows(windows) {}
+
+public:
+	virtual bool query(ohms::WindowHandle handle, ohms::WindowInfo& info) override {
+		auto it = r_windows.find(handle);
+		if (it == r_windows.end() || !it->second.listed)
+			return false;
+		info = ohms::WindowInfo(handle, it->second.title, it->second.className);
+		return true;
+	}
+
+	virtual void enumerate(std::vector<ohms::WindowHandle>& handles) override {
+		for (auto const& window : r_windows)
+			handles.push_back(window.first);
+	}
+
+protected:
+	std::map<ohms::WindowHandle, Window>& r_windows;
+};
+
+bool ListIs(ohms::WindowRegistryCore& registry, std::vector<ohms::WindowHandle> const& handles) {
+	auto windows = registry.snapshot();
+	if (windows->size() != handles.size())
+		return false;
+	for (size_t i = 0; i < handles.size(); ++i) {
+		if ((*windows)[i].getHandle() != handles[i])
+			return false;
+	}
+	return true;
+}
+
+} // namespace
+
+/**
+ * @brief 用假的来源驱动 WindowRegistryCore：创建、销毁、改变和重新扫描。
+ * @return 0表示通过，否则是失败的步骤。
+*/
+int TestWindowRegistryCore() {
+	using ohms::WindowEvent;
+	std::map<ohms::WindowHandle, FakeWindowSource::Window> windows;
+	ohms::WindowRegistryCore registry(std::make_unique<FakeWindowSource>(windows));
+
+	// The first scan lists only the windows that should be listed.
+	windows[10] = { true, L"Editor", L"EditorClass" };
+	windows[20] = { false, L"", L"ToolClass" };
+	windows[30] = { true, L"Player", L"PlayerClass" };
+	registry.rescan();
+	if (!ListIs(registry, { 10, 30 }))
+		return 1;
+
+	// A created window is appended.
+	windows[40] = { true, L"Browser", L"BrowserClass" };
+	registry.onEvent(WindowEvent::Created, 40);
+	if (!ListIs(registry, { 10, 30, 40 }))
+		return 2;
+
+	// A changed title keeps the order.
+	windows[10].title = L"Editor - file.txt";
+	registry.onEvent(WindowEvent::Changed, 10);
+	if (!ListIs(registry, { 10, 30, 40 }) || registry.snapshot()->front().getTitle() != L"Editor - file.txt")
+		return 3;
+
+	// An event that changes nothing keeps the version and the snapshot.
+	const uint64_t version = registry.getVersion();
+	const auto snapshot = registry.snapshot();
+	registry.onEvent(WindowEvent::Changed, 30);
+	registry.onEvent(WindowEvent::Destroyed, 99);
+	if (registry.getVersion() != version || registry.snapshot() != snapshot)
+		return 4;
+
+	// A window that becomes listed is appended, and removed when it is hidden again.
+	windows[20] = { true, L"Tool", L"ToolClass" };
+	registry.onEvent(WindowEvent::Changed, 20);
+	if (!ListIs(registry, { 10, 30, 40, 20 }))
+		return 5;
+	windows[20].listed = false;
+	registry.onEvent(WindowEvent::Changed, 20);
+	if (!ListIs(registry, { 10, 30, 40 }))
+		return 6;
+
+	// A destroyed window is removed.
+	windows.erase(30);
+	registry.onEvent(WindowEvent::Destroyed, 30);
+	if (!ListIs(registry, { 10, 40 }))
+		return 7;
+
+	// Rescan catches up with missed events.
+	windows.erase(10);
+	windows[50] = { true, L"Terminal", L"TerminalClass" };
+	windows[40].title = L"Browser - page";
+	registry.rescan();
+	if (!ListIs(registry, { 40, 50 }) || registry.snapshot()->front().getTitle() != L"Browser - page")
+		return 8;
+
+	// Find by patterns.
+	auto found = registry.find(L"*Class", L"Term?nal");
+	if (found.size() != 1 || found.front().getHandle() != 50 || registry.find(L"", L"").size() != 2)
+		return 9;
+	return 0;
+}
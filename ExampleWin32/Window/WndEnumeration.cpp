@@ -23,39 +23,35 @@
 namespace {
 
 std::wstring myGetClassName(HWND hwnd) {
-	std::array<WCHAR, 1024> className;
+	WCHAR className[256]; // 类名最长256个字符。
 
-	::GetClassNameW(hwnd, className.data(), static_cast<int>(className.size()));
+	const int len = ::GetClassNameW(hwnd, className, static_cast<int>(std::size(className)));
 
-	std::wstring title(className.data());
-	return title;
+	return std::wstring(className, len > 0 ? len : 0);
 }
 
 
 std::wstring myGetWindowText(HWND hwnd) {
-	std::array<WCHAR, 1024> windowText;
-
-	::GetWindowTextW(hwnd, windowText.data(), static_cast<int>(windowText.size()));
-
-	std::wstring title(windowText.data());
+	std::wstring title;
+
+	const int len = ::GetWindowTextLengthW(hwnd);
+	if (len <= 0)
+		return title;
+	title.resize(static_cast<size_t>(len) + 1);
+	const int res = ::GetWindowTextW(hwnd, title.data(), len + 1);
+	title.resize(res > 0 ? res : 0);
 	return title;
 }
 
 
-bool isAltTabWindow(ohms::WindowInfo const& window) noexcept {
-	HWND hwnd = window.getHWnd();
-
-	std::wstring title = window.getTitle();
-	std::wstring className = window.getClassName();
-
+/**
+ * @brief 不需要标题的检查，先做便宜的。
+*/
+bool isAltTabCandidate(HWND hwnd) noexcept {
 	if (hwnd == GetShellWindow()) {
 		return false;
 	}
 
-	if (title.length() == 0) {
-		return false;
-	}
-
 	if (!IsWindowVisible(hwnd)) {
 		return false;
 	}
@@ -68,30 +64,28 @@ bool isAltTabWindow(ohms::WindowInfo const& window) noexcept {
 	if (!((style & WS_DISABLED) != WS_DISABLED)) {
 		return false;
 	}
+	return true;
+}
 
+
+bool isCloakedByShell(HWND hwnd) noexcept {
 	DWORD cloaked = FALSE;
 	const HRESULT hrTemp = DwmGetWindowAttribute(hwnd, DWMWA_CLOAKED, &cloaked, sizeof(cloaked));
 
-	if (SUCCEEDED(hrTemp) && cloaked == DWM_CLOAKED_SHELL) {
-		return false;
-	}
-	return true;
+	return SUCCEEDED(hrTemp) && cloaked == DWM_CLOAKED_SHELL;
 }
 
 
 BOOL CALLBACK myEnumWindowsProc(HWND hwnd, LPARAM lParam) {
-	std::wstring class_name = myGetClassName(hwnd);
-	std::wstring title = myGetWindowText(hwnd);
-
-	ohms::WindowInfo window = ohms::WindowInfo(hwnd, title, class_name);
+	ohms::WindowInfo window;
 
-	if (!isAltTabWindow(window)) {
+	if (!ohms::QueryWindowInfo(hwnd, window)) {
 		return TRUE;
 	}
 
 	std::vector<ohms::WindowInfo>& windows =
 		*reinterpret_cast<std::vector<ohms::WindowInfo>*>(lParam);
-	windows.push_back(window);
+	windows.push_back(std::move(window));
 
 	return TRUE;
 }
@@ -100,25 +94,22 @@ BOOL CALLBACK myEnumWindowsProc(HWND hwnd, LPARAM lParam) {
 
 namespace ohms {
 
-WindowInfo::WindowInfo() noexcept :
-	m_hwnd(NULL) {}
-
-WindowInfo::WindowInfo(HWND hwnd, std::wstring const& title, std::wstring& className) noexcept {
-	m_hwnd = hwnd;
-	m_title = title;
-	m_className = className;
-}
+bool QueryWindowInfo(HWND hwnd, WindowInfo& info) noexcept {
+	if (!isAltTabCandidate(hwnd)) {
+		return false;
+	}
 
-HWND WindowInfo::getHWnd() const noexcept {
-	return m_hwnd;
-}
+	std::wstring title = myGetWindowText(hwnd);
+	if (title.length() == 0) {
+		return false;
+	}
 
-std::wstring WindowInfo::getTitle() const {
-	return m_title;
-}
+	if (isCloakedByShell(hwnd)) {
+		return false;
+	}
 
-std::wstring WindowInfo::getClassName() const {
-	return m_className;
+	info = WindowInfo(ToWindowHandle(hwnd), title, myGetClassName(hwnd));
+	return true;
 }
 
 void EnumerateWindows(std::vector<WindowInfo>& windows) noexcept {
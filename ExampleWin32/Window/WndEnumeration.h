@@ -21,27 +21,26 @@
 #pragma once
 
 #include <dwmapi.h>
-#include <array>
 #include <vector>
 #include <string>
 
+#include "WindowInfo.h"
+
 namespace ohms {
 
-struct WindowInfo final {
-public:
-	WindowInfo() noexcept;
-	WindowInfo(HWND hwnd, std::wstring const& title, std::wstring& className) noexcept;
-	~WindowInfo() = default;
-
-	HWND getHWnd() const noexcept;
-	std::wstring getTitle() const;
-	std::wstring getClassName() const;
-
-protected:
-	HWND m_hwnd;
-	std::wstring m_title;
-	std::wstring m_className;
-}; // sturct WindowInfo
+inline HWND ToHWnd(WindowHandle handle) noexcept {
+	return reinterpret_cast<HWND>(handle);
+}
+
+inline WindowHandle ToWindowHandle(HWND hwnd) noexcept {
+	return reinterpret_cast<WindowHandle>(hwnd);
+}
+
+/**
+ * @brief 读取窗口的标题和类名。
+ * @return 该窗口是否应该列出（即出现在Alt+Tab中）。不列出时，info不一定被填写。
+*/
+bool QueryWindowInfo(HWND hwnd, WindowInfo& info) noexcept;
 
 void EnumerateWindows(std::vector<WindowInfo>& windows) noexcept;
 
@@ -23,12 +23,18 @@
 #include "framework.h"
 #include "Window/MainWindow.h"
 
+int TestWindowRegistryCore();
+
 int CALLBACK wWinMain(
 	_In_ HINSTANCE hInstance,
 	_In_opt_ HINSTANCE hPrevInstance,
 	_In_ LPWSTR lpCmdLine,
 	_In_ int nShowCmd
 ) {
+	// "--test-registry" runs the window registry test instead, its result is the exit code.
+	if (lpCmdLine != nullptr && wcscmp(lpCmdLine, L"--test-registry") == 0)
+		return TestWindowRegistryCore();
+
 	// Run
 	{
 		SetProcessDPIAware();
@@ -0,0 +1,69 @@
+#    WGC-Capture-with-OpenCV
+#
+#     Copyright 2023-2025  Tyler Parret True
+#
+#    Licensed under the Apache License, Version 2.0 (the "License");
+#    you may not use this file except in compliance with the License.
+#    You may obtain a copy of the License at
+#
+#        http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS,
+#    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#    See the License for the specific language governing permissions and
+#    limitations under the License.
+#
+# @Authors
+#    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+
+"""Examples of the Python bindings. Run TestRecord() of ExampleBasic first for test.wgcrec."""
+import asyncio
+import time
+
+import numpy
+
+import wgc
+
+
+def test_polling():
+	factory = wgc.Factory()
+	capturer = factory.create_capturer()
+	capturer.start_monitor(bgr=True)
+	for _ in range(60):
+		with capturer.get(timeout=1.0) as frame:
+			image = numpy.asarray(frame)  # No copy: refers to the pooled buffer.
+			print(frame.sequence, image.shape, image.mean())
+			del image  # Release the array before the frame goes back to the pool.
+	capturer.stop()
+
+
+def test_callback():
+	factory = wgc.Factory()
+	capturer = factory.create_replay_capturer("test.wgcrec")
+	means = []
+	capturer.start_monitor(mode="callback", callback=lambda frame: means.append(numpy.asarray(frame).mean()))
+	while capturer.is_capturing():
+		time.sleep(0.1)  # The GIL is free meanwhile, so the callback runs.
+	capturer.stop()
+	print(len(means), "frames")
+
+
+async def test_asyncio():
+	factory = wgc.Factory()
+	capturer = factory.create_replay_capturer("test.wgcrec", speed=0.0)
+	capturer.start_monitor(mode="queue", queue_size=4)
+	count = 0
+	async for frame in wgc.frames(capturer):
+		image = numpy.asarray(frame)
+		count += 1
+		del image
+		frame.release()
+	capturer.stop()
+	print(count, "frames,", capturer.dropped(), "dropped")
+
+
+if __name__ == "__main__":
+	test_polling()
+	#test_callback()
+	#asyncio.run(test_asyncio())
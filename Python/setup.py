@@ -0,0 +1,97 @@
+#    WGC-Capture-with-OpenCV
+#
+#     Copyright 2023-2025  Tyler Parret True
+#
+#    Licensed under the Apache License, Version 2.0 (the "License");
+#    you may not use this file except in compliance with the License.
+#    You may obtain a copy of the License at
+#
+#        http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS,
+#    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#    See the License for the specific language governing permissions and
+#    limitations under the License.
+#
+# @Authors
+#    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+
+r"""
+Build the Python bindings of WGC-Capture-with-OpenCV.
+
+Build the solution first (Release|x64), then run `pip install .` in this directory.
+OpenCV is found under %OHMS_LIB_DIR%\opencv\4.10.0\build, the same as the projects.
+The DLLs (wgc-capture.dll, opencv_world4100.dll) must be on PATH, or listed in WGC_DLL_DIRS, when importing.
+
+To test the bindings without the library, set WGC_BACKEND=mock before `pip install .`.
+Then tests/mock/MockBackend.cpp is built into the module in place of wgc-capture, and its capturers generate
+frames like the synthetic capturer. It builds on any platform: off Windows, tests/mock/Windows.h stands in for
+the Windows SDK, and OpenCV is found by `pkg-config opencv4` (only opencv_core is needed).
+
+Test with `python -m unittest discover tests` in this directory.
+"""
+import os
+import shlex
+import subprocess
+import sys
+from setuptools import setup, Extension
+
+here = os.path.dirname(os.path.abspath(__file__))
+root = os.path.dirname(here)
+mock = os.environ.get("WGC_BACKEND", "") == "mock"
+windows = sys.platform == "win32"
+
+sources = [os.path.join(here, "wgcmodule.cpp")]
+include_dirs = [os.path.join(root, "WGC-Capture-with-OpenCV", "include")]
+library_dirs = []
+libraries = []
+define_macros = []
+extra_compile_args = []
+extra_link_args = []
+
+if mock:
+	sources.append(os.path.join(here, "tests", "mock", "MockBackend.cpp"))
+	# WGC.h declares the factory dllimport otherwise, which the mock defines.
+	define_macros.append(("WGCCAPTUREWITHOPENCV_EXPORTS", None))
+	if not windows:
+		include_dirs.append(os.path.join(here, "tests", "mock"))
+elif windows:
+	library_dirs.append(os.environ.get("WGC_OUT_DIR", os.path.join(root, "x64", "Release")))
+	libraries.append("wgc-capture")
+else:
+	sys.exit("The library is Windows only. Set WGC_BACKEND=mock to build the bindings with the mock backend.")
+
+if windows:
+	opencv = os.path.join(os.environ.get("OHMS_LIB_DIR", ""), "opencv", "4.10.0", "build")
+	include_dirs.append(os.path.join(opencv, "include"))
+	library_dirs.append(os.path.join(opencv, "x64", "vc17", "lib"))
+	libraries += ["opencv_world4100", "user32"]
+	extra_compile_args += ["/std:c++17", "/EHsc", "/utf-8"]
+else:
+	def pkg_config(option):
+		return shlex.split(subprocess.check_output(["pkg-config", option, "opencv4"], text=True))
+	extra_compile_args += ["-std=c++17"] + pkg_config("--cflags")
+	extra_link_args += pkg_config("--libs")
+
+module = Extension(
+	"wgc._wgc",
+	sources=sources,
+	include_dirs=include_dirs,
+	library_dirs=library_dirs,
+	libraries=libraries,
+	define_macros=define_macros,
+	extra_compile_args=extra_compile_args,
+	extra_link_args=extra_link_args,
+	language="c++",
+)
+
+setup(
+	name="wgc",
+	version="1.0.0",
+	description="Capture windows and monitors with WGC into NumPy arrays without copying.",
+	license="Apache-2.0",
+	packages=["wgc"],
+	ext_modules=[module],
+	python_requires=">=3.9",
+)
@@ -0,0 +1,428 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+/**
+ * @brief A backend of IFactory and ICapturer for testing the bindings without the library, on any platform.
+ * @brief Every capturer generates frames on its own thread like SyntheticCapturer: a bar moving across a flat
+ * @brief background, paced by SyntheticOptions::fps. The start functions ignore the target, so createCapturer()
+ * @brief works without a display. Replay and the analysis features are not supported.
+ * @brief Only opencv_core is used. Build it into the module with WGC_BACKEND=mock, see setup.py.
+*/
+#include <WGC/WGC.h>
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+constexpr int MaxMockSide = 16384;  // The same limit as SyntheticCapturer.
+constexpr size_t PoolBuffers = 8;   // Buffers of acquireFrame() per capturer.
+
+template<typename T>
+std::future<T> ReadyFuture(T value) {
+	std::promise<T> promise;
+	promise.set_value(value);
+	return promise.get_future();
+}
+
+/**
+ * @brief A pooled buffer is free when only the pool refers to it, like in FramePool.
+*/
+bool IsFree(const cv::Mat& buffer) {
+	return buffer.u == nullptr || CV_XADD(&buffer.u->refcount, 0) == 1;
+}
+
+class MockCapturer final : public wgc::ICapturer {
+public:
+	MockCapturer(const wgc::SyntheticOptions& options, size_t id) :
+		m_options(options),
+		m_id(id),
+		m_stop(true),
+		m_capturing(false),
+		m_window(false),
+		m_needRefresh(false),
+		m_refreshed(false),
+		m_info() {
+		if (options.width <= 0 || options.height <= 0 || options.width > MaxMockSide || options.height > MaxMockSide || options.fps < 0.0)
+			throw std::invalid_argument("MockCapturer: invalid options.");
+	}
+
+	virtual ~MockCapturer() override {
+		stopCapture();
+	}
+
+public:
+	virtual bool startCaptureWindow(HWND, bool) override {
+		return Start(true, nullptr);
+	}
+	virtual bool startCaptureMonitor(HMONITOR, bool) override {
+		return Start(false, nullptr);
+	}
+	virtual bool startCaptureWindowWithCallback(HWND, std::function<void(const cv::Mat&)> callback) override {
+		return callback ? Start(true, std::move(callback)) : false;
+	}
+	virtual bool startCaptureMonitorWithCallback(HMONITOR, std::function<void(const cv::Mat&)> callback) override {
+		return callback ? Start(false, std::move(callback)) : false;
+	}
+
+	virtual void stopCapture() override {
+		{
+			std::lock_guard lock(m_mutex);
+			m_stop = true;
+		}
+		m_cond.notify_all();
+		if (m_thread.get_id() == std::this_thread::get_id())
+			return; // From the callback. The loop ends when it returns, and is joined by the next start or the destructor.
+		if (m_thread.joinable())
+			m_thread.join();
+		m_capturing = false;
+	}
+
+	virtual void setClipToClientArea(bool) override {}
+	virtual bool isClipToClientArea() override {
+		return false;
+	}
+	virtual bool isCapturing() override {
+		return m_capturing;
+	}
+	virtual bool isCaptureWindow() override {
+		return m_capturing && m_window;
+	}
+	virtual bool isCaptureMonitor() override {
+		return m_capturing && !m_window;
+	}
+
+	virtual void askForRefresh() override {
+		{
+			std::lock_guard lock(m_mutex);
+			m_needRefresh = true;
+			m_refreshed = false;
+		}
+		m_cond.notify_all();
+	}
+	virtual bool isRefreshed() override {
+		std::lock_guard lock(m_mutex);
+		return m_refreshed;
+	}
+
+	virtual void copyMatTo(cv::Mat& target, bool convertToBGR) override {
+		std::lock_guard lock(m_mutex);
+		if (m_frame.empty())
+			return;
+		if (convertToBGR)
+			DropAlpha(m_frame, target);
+		else
+			m_frame.copyTo(target);
+	}
+	virtual bool runGraph(wgc::IFrameGraph&, std::vector<cv::Mat>&) override {
+		return false;
+	}
+	virtual wgc::FrameInfo getFrameInfo() override {
+		std::lock_guard lock(m_mutex);
+		return m_info;
+	}
+
+	virtual bool acquireFrame(cv::Mat& frame, wgc::FrameInfo* info, bool convertToBGR) override {
+		std::lock_guard lock(m_mutex);
+		if (m_frame.empty())
+			return false;
+		auto buffer = std::find_if(m_pool.begin(), m_pool.end(), IsFree);
+		if (buffer == m_pool.end()) {
+			if (m_pool.size() >= PoolBuffers)
+				return false;
+			buffer = m_pool.emplace(m_pool.end());
+		}
+		if (convertToBGR)
+			DropAlpha(m_frame, *buffer);
+		else
+			m_frame.copyTo(*buffer);
+		frame = *buffer;
+		if (info != nullptr)
+			*info = m_info;
+		return true;
+	}
+
+	virtual std::future<bool> saveFrameAsync(const std::wstring&, wgc::ImageFormat, const wgc::SaveOptions&) override {
+		return ReadyFuture(false);
+	}
+	virtual bool startBurstSave(const std::wstring&, double, wgc::ImageFormat, const wgc::SaveOptions&) override {
+		return false;
+	}
+	virtual void stopBurstSave() override {}
+	virtual wgc::BurstStatus getBurstStatus() override {
+		return {};
+	}
+
+	virtual int addProbe(const cv::Point&) override {
+		return -1;
+	}
+	virtual int addProbe(const cv::Rect&) override {
+		return -1;
+	}
+	virtual bool removeProbe(int) override {
+		return false;
+	}
+	virtual void setProbeCallback(wgc::ProbeCallback, bool) override {}
+	virtual std::vector<wgc::ProbeValue> getProbeValues() override {
+		return {};
+	}
+
+	virtual int addStatRegion(const cv::Rect&) override {
+		return -1;
+	}
+	virtual bool removeStatRegion(int) override {
+		return false;
+	}
+	virtual std::vector<wgc::RegionStats> getRegionStats() override {
+		return {};
+	}
+
+	virtual bool setThreadingPolicy(const wgc::ThreadingPolicy&) override {
+		return true;
+	}
+	virtual std::vector<wgc::ThreadTimes> getThreadTimes() override {
+		return {};
+	}
+
+	virtual void setFrameMemory(std::shared_ptr<wgc::IFrameMemory>) override {}
+	virtual wgc::CapturerMemory getMemoryUsage() override {
+		return {};
+	}
+
+	virtual void setAdaptiveScale(const wgc::AdaptiveScaleOptions&) override {}
+	virtual bool setMotionMap(const wgc::MotionOptions&) override {
+		return false;
+	}
+	virtual wgc::MotionMap getMotionMap() override {
+		return {};
+	}
+
+	virtual bool setPreroll(const wgc::PrerollOptions&) override {
+		return false;
+	}
+	virtual std::future<bool> dumpPreroll(const std::wstring&) override {
+		return ReadyFuture(false);
+	}
+	virtual wgc::PrerollStatus getPrerollStatus() override {
+		return {};
+	}
+
+	virtual wgc::CaptureStartTimes getStartTimes() override {
+		return {};
+	}
+
+	virtual bool setLatencyProbe(const wgc::LatencyProbeOptions&) override {
+		return false;
+	}
+	virtual std::vector<wgc::LatencyStats> getLatencyStats() override {
+		return {};
+	}
+	virtual void resetLatencyStats() override {}
+
+	virtual int watchRegion(const cv::Rect&, double, wgc::RegionCallback) override {
+		return -1;
+	}
+	virtual bool unwatchRegion(int) override {
+		return false;
+	}
+
+	virtual std::shared_ptr<wgc::IFramePyramid> getPyramid() override {
+		return nullptr;
+	}
+
+	virtual int subscribeView(const wgc::ViewOptions&, wgc::ViewCallback) override {
+		return -1;
+	}
+	virtual bool unsubscribeView(int) override {
+		return false;
+	}
+
+	virtual size_t getId() const override {
+		return m_id;
+	}
+
+protected:
+	bool Start(bool window, std::function<void(const cv::Mat&)> callback) {
+		stopCapture();
+		{
+			std::lock_guard lock(m_mutex);
+			m_stop = false;
+			m_needRefresh = false;
+			m_refreshed = false;
+			m_frame.release();
+		}
+		m_window = window;
+		m_capturing = true;
+		m_thread = std::thread(&MockCapturer::GenerateLoop, this, std::move(callback));
+		return true;
+	}
+
+	void GenerateLoop(std::function<void(const cv::Mat&)> callback) {
+		using Clock = std::chrono::steady_clock;
+		const bool unlimited = !(m_options.fps > 0.0);
+		const Clock::duration interval = unlimited ? Clock::duration::zero() :
+			std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_options.fps));
+		Clock::time_point deadline = Clock::now();
+
+		for (uint64_t index = 0; ; ++index) {
+			std::unique_lock lock(m_mutex);
+			const auto stopped = [this]() -> bool { return m_stop; };
+			if (!unlimited) {
+				if (m_cond.wait_until(lock, deadline, stopped))
+					break;
+				deadline += interval;
+			}
+			else if (!callback) {
+				m_cond.wait(lock, [this]() -> bool { return m_stop || m_needRefresh; });
+			}
+			if (m_stop)
+				break;
+			if (!callback && !m_needRefresh)
+				continue; // Nobody asked for it, dropped like by the real capturers.
+
+			// Drawn under the lock, so acquireFrame() on other threads never sees half a frame.
+			m_frame.create(m_options.height, m_options.width, CV_8UC4);
+			Draw(m_frame, index);
+			m_info.sequence = index;
+			m_info.timestamp = std::chrono::duration_cast<std::chrono::duration<int64_t, std::ratio<1, 10000000>>>(
+				Clock::now().time_since_epoch()).count();
+			m_info.width = m_frame.cols;
+			m_info.height = m_frame.rows;
+			m_info.scale = 1.0;
+			if (callback) {
+				lock.unlock();
+				callback(m_frame); // Only this thread writes the frame, so it is stable during the callback.
+			}
+			else {
+				m_needRefresh = false;
+				m_refreshed = true;
+			}
+		}
+		m_capturing = false;
+	}
+
+	static void Draw(cv::Mat& frame, uint64_t index) {
+		const int barWidth = std::max(1, frame.cols / 32);
+		const int x = static_cast<int>((index * barWidth) % static_cast<uint64_t>(frame.cols));
+		frame.setTo(cv::Scalar(64, 64, 64, 255));
+		frame(cv::Rect(x, 0, std::min(barWidth, frame.cols - x), frame.rows)).setTo(cv::Scalar(200, 160, 96, 255));
+	}
+
+	/**
+	 * @brief BGRA to BGR with opencv_core only, in place of cv::cvtColor().
+	*/
+	static void DropAlpha(const cv::Mat& bgra, cv::Mat& bgr) {
+		static const int fromTo[] = { 0, 0, 1, 1, 2, 2 };
+		bgr.create(bgra.rows, bgra.cols, CV_8UC3);
+		cv::mixChannels(&bgra, 1, &bgr, 1, fromTo, 3);
+	}
+
+protected:
+	const wgc::SyntheticOptions m_options;
+	const size_t m_id;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::thread m_thread;
+	bool m_stop;
+	std::atomic<bool> m_capturing;
+	std::atomic<bool> m_window;
+
+	bool m_needRefresh;
+	bool m_refreshed;
+	cv::Mat m_frame;
+	wgc::FrameInfo m_info;
+	std::vector<cv::Mat> m_pool;
+};
+
+class MockFactory final : public wgc::IFactory {
+public:
+	MockFactory() :
+		m_nextId(0) {}
+
+public:
+	virtual std::weak_ptr<wgc::ICapturer> createCapturer() override {
+		return Add(wgc::SyntheticOptions());
+	}
+	virtual std::weak_ptr<wgc::ICapturer> createReplayCapturer(const std::wstring&, const wgc::ReplayOptions&) override {
+		throw std::runtime_error("MockFactory: replay is not supported by the mock backend.");
+	}
+	virtual std::weak_ptr<wgc::ICapturer> createSyntheticCapturer(const wgc::SyntheticOptions& options) override {
+		return Add(options);
+	}
+	virtual void destroyCapturer(std::weak_ptr<wgc::ICapturer> instance) override {
+		std::shared_ptr<wgc::ICapturer> capturer = instance.lock();
+		std::lock_guard lock(m_mutex);
+		m_capturers.erase(std::remove(m_capturers.begin(), m_capturers.end(), capturer), m_capturers.end());
+	}
+
+	virtual bool setThreadingPolicy(const wgc::ThreadingPolicy&, DWORD) override {
+		return true;
+	}
+	virtual void setMemoryBudget(const wgc::MemoryBudget&) override {}
+	virtual wgc::MemoryUsage getMemoryUsage() override {
+		return {};
+	}
+
+	virtual std::shared_future<bool> whenReady() override {
+		return ReadyFuture(true).share();
+	}
+	virtual wgc::StartupTimes getStartupTimes() override {
+		wgc::StartupTimes times = {};
+		times.ready = true;
+		return times;
+	}
+
+protected:
+	std::weak_ptr<wgc::ICapturer> Add(const wgc::SyntheticOptions& options) {
+		std::lock_guard lock(m_mutex);
+		m_capturers.push_back(std::make_shared<MockCapturer>(options, ++m_nextId));
+		return m_capturers.back();
+	}
+
+protected:
+	std::mutex m_mutex;
+	size_t m_nextId;
+	std::vector<std::shared_ptr<wgc::ICapturer>> m_capturers;
+};
+
+} // namespace
+
+namespace wgc {
+
+std::shared_ptr<IFactory> IFactory::createInstance(bool, FactoryInit) {
+	return std::make_shared<MockFactory>();
+}
+
+std::shared_ptr<IFactory> IFactory::createInstanceNoThrow(bool, FactoryInit) noexcept {
+	try {
+		return std::make_shared<MockFactory>();
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+} // namespace wgc
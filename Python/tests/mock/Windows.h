@@ -0,0 +1,65 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+/**
+ * @brief A stand-in for <Windows.h> off Windows, with only what WGC.h and wgcmodule.cpp use.
+ * @brief Used with MockBackend.cpp, so the bindings build and their tests run without the Windows SDK.
+ * @brief There are no windows or monitors: find_window() gives 0, and the primary monitor is NULL.
+*/
+#pragma once
+
+#ifdef _WIN32
+#error "Use the Windows SDK on Windows."
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#define __declspec(x)
+
+typedef unsigned long DWORD;
+typedef long LONG;
+typedef int BOOL;
+typedef const wchar_t* LPCWSTR;
+
+typedef struct HWND__* HWND;
+typedef struct HMONITOR__* HMONITOR;
+
+typedef struct tagPOINT {
+	LONG x;
+	LONG y;
+} POINT;
+
+#define THREAD_PRIORITY_NORMAL 0
+#define MONITOR_DEFAULTTONULL 0x00000000
+#define MONITOR_DEFAULTTOPRIMARY 0x00000001
+
+inline void Sleep(DWORD milliseconds) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+inline HMONITOR MonitorFromPoint(POINT, DWORD) {
+	return nullptr;
+}
+
+inline HWND FindWindowW(LPCWSTR, LPCWSTR) {
+	return nullptr;
+}
@@ -0,0 +1,282 @@
+#    WGC-Capture-with-OpenCV
+#
+#     Copyright 2023-2025  Tyler Parret True
+#
+#    Licensed under the Apache License, Version 2.0 (the "License");
+#    you may not use this file except in compliance with the License.
+#    You may obtain a copy of the License at
+#
+#        http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS,
+#    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#    See the License for the specific language governing permissions and
+#    limitations under the License.
+#
+# @Authors
+#    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+
+"""
+Tests of the Python bindings against the synthetic capturer, so no display is needed.
+Build and install the bindings first, then run `python -m unittest discover tests` in the Python directory.
+Built with WGC_BACKEND=mock (see setup.py), the capturers are the ones of tests/mock/MockBackend.cpp.
+"""
+import asyncio
+import gc
+import sys
+import threading
+import time
+import unittest
+
+import wgc
+
+try:
+	import numpy
+except ImportError:
+	numpy = None
+
+WIDTH = 64
+HEIGHT = 48
+
+
+class SyntheticTestCase(unittest.TestCase):
+	def setUp(self):
+		self.factory = wgc.Factory()
+		self.capturer = self.factory.create_synthetic_capturer(width=WIDTH, height=HEIGHT, fps=240.0, stamp=False)
+
+	def tearDown(self):
+		self.capturer.stop()
+		del self.capturer
+		gc.collect()
+
+	def wait_until(self, predicate, timeout=5.0):
+		deadline = time.monotonic() + timeout
+		while not predicate():
+			self.assertLess(time.monotonic(), deadline, "Timed out.")
+			time.sleep(0.01)
+
+
+class TestModes(SyntheticTestCase):
+	def test_polling(self):
+		self.capturer.start_monitor()
+		sequences = []
+		for _ in range(5):
+			with self.capturer.get(timeout=2.0) as frame:
+				self.assertEqual(memoryview(frame).shape, (HEIGHT, WIDTH, 4))
+				self.assertEqual((frame.width, frame.height), (WIDTH, HEIGHT))
+				sequences.append(frame.sequence)
+		self.assertEqual(sequences, sorted(set(sequences)))
+
+	def test_polling_bgr(self):
+		self.capturer.start_monitor(bgr=True)
+		with self.capturer.get(timeout=2.0) as frame:
+			self.assertEqual(memoryview(frame).shape, (HEIGHT, WIDTH, 3))
+
+	def test_queue(self):
+		self.capturer.start_monitor(mode="queue", queue_size=3)
+		sequences = []
+		for _ in range(10):
+			frame = self.capturer.get(timeout=2.0)
+			self.assertIsNotNone(frame)
+			sequences.append(frame.sequence)
+			frame.release()
+			self.assertLessEqual(self.capturer.queued(), 3)
+		self.assertEqual(sequences, sorted(set(sequences)))
+
+		# After stop(), get() gives the frames still queued, then None like when capturing ends by itself.
+		self.capturer.stop()
+		for _ in range(4):
+			frame = self.capturer.get(timeout=0)
+			if frame is None:
+				break
+			frame.release()
+		self.assertIsNone(frame)
+
+	def test_callback(self):
+		sequences = []
+		firstBytes = []
+
+		def callback(frame):
+			sequences.append(frame.sequence)
+			firstBytes.append(memoryview(frame)[0, 0, 0])
+
+		self.capturer.start_monitor(mode="callback", callback=callback)
+		self.wait_until(lambda: len(sequences) >= 10)  # The GIL is free while sleeping, so the callback runs.
+		self.capturer.stop()
+		count = len(sequences)
+		time.sleep(0.1)
+		self.assertEqual(len(sequences), count, "Called after stop().")
+		self.assertEqual(sequences, sorted(set(sequences)))
+		self.assertEqual(len(firstBytes), count)
+
+	def test_callback_exception(self):
+		errors = []
+		calls = []
+
+		def callback(frame):
+			calls.append(frame.sequence)
+			raise ValueError("test")
+
+		hook = sys.unraisablehook
+		sys.unraisablehook = errors.append
+		try:
+			self.capturer.start_monitor(mode="callback", callback=callback)
+			self.wait_until(lambda: len(calls) >= 5)  # Capturing goes on after the exception.
+			self.capturer.stop()
+		finally:
+			sys.unraisablehook = hook
+		self.assertEqual(len(errors), len(calls))
+
+	def test_invalid_arguments(self):
+		for kwargs in (dict(mode="nope"), dict(mode="callback"), dict(queue_size=0)):
+			with self.assertRaises((ValueError, TypeError)):
+				self.capturer.start_monitor(**kwargs)
+		with self.assertRaises(RuntimeError):
+			self.capturer.get(timeout=0)  # Not started.
+		with self.assertRaises(ValueError):
+			self.factory.create_synthetic_capturer(width=0)
+
+	def test_get_releases_gil(self):
+		self.capturer.stop()
+		self.capturer = self.factory.create_synthetic_capturer(width=WIDTH, height=HEIGHT, fps=4.0, stamp=False)
+		self.capturer.start_monitor()
+		self.capturer.get(timeout=2.0).release()
+		ticks = []
+		done = threading.Event()
+
+		def tick():
+			while not done.is_set():
+				ticks.append(time.monotonic())
+				time.sleep(0.005)
+
+		thread = threading.Thread(target=tick)
+		thread.start()
+		start = time.monotonic()
+		try:
+			frame = self.capturer.get(timeout=2.0)  # Waits about 0.25s for the next frame.
+		finally:
+			end = time.monotonic()
+			done.set()
+			thread.join()
+		self.assertIsNotNone(frame)
+		frame.release()
+		# The other thread ran Python code while get() was waiting.
+		self.assertTrue(any(start + 0.03 < t < end - 0.03 for t in ticks))
+
+
+class TestAsyncio(SyntheticTestCase):
+	def test_frames(self):
+		async def collect():
+			self.capturer.start_monitor(mode="queue", queue_size=4)
+			sequences = []
+			async for frame in wgc.frames(self.capturer):
+				sequences.append(frame.sequence)
+				frame.release()
+				if len(sequences) == 10:
+					break
+			return sequences
+
+		sequences = asyncio.run(collect())
+		self.assertEqual(len(sequences), 10)
+		self.assertEqual(sequences, sorted(set(sequences)))
+
+	def test_frames_end(self):
+		async def collect():
+			self.capturer.start_monitor(mode="queue", queue_size=4)
+			asyncio.get_running_loop().call_later(0.2, self.capturer.stop)
+			count = 0
+			async for frame in wgc.frames(self.capturer):
+				count += 1
+				frame.release()
+			return count
+
+		self.assertGreater(asyncio.run(collect()), 0)  # Ends by itself when capturing stops.
+
+	def test_get_async(self):
+		async def get():
+			self.capturer.start_monitor()
+			return await wgc.get_async(self.capturer, 2.0)
+
+		frame = asyncio.run(get())
+		self.assertIsNotNone(frame)
+		frame.release()
+
+
+class TestBuffers(SyntheticTestCase):
+	def test_zero_copy(self):
+		self.capturer.start_monitor()
+		frame = self.capturer.get(timeout=2.0)
+		first = memoryview(frame)
+		second = memoryview(frame)
+		self.assertFalse(first.readonly)
+		self.assertEqual(first.strides[1:], (4, 1))
+		self.assertGreaterEqual(first.strides[0], WIDTH * 4)
+		first[0, 0, 0] = first[0, 0, 0] ^ 0xFF
+		self.assertEqual(second[0, 0, 0], first[0, 0, 0])  # Both refer to the same buffer.
+		first.release()
+		second.release()
+		frame.release()
+
+	@unittest.skipIf(numpy is None, "NumPy is not installed.")
+	def test_zero_copy_numpy(self):
+		self.capturer.start_monitor()
+		frame = self.capturer.get(timeout=2.0)
+		first = numpy.asarray(frame)
+		second = numpy.asarray(frame)
+		self.assertEqual(first.shape, (HEIGHT, WIDTH, 4))
+		self.assertEqual(first.dtype, numpy.uint8)
+		self.assertEqual(first.ctypes.data, second.ctypes.data)
+		first[0, 0, 0] ^= 0xFF
+		self.assertEqual(second[0, 0, 0], first[0, 0, 0])
+		del first, second
+		frame.release()
+
+	def test_release(self):
+		self.capturer.start_monitor()
+		frame = self.capturer.get(timeout=2.0)
+		view = memoryview(frame)
+		with self.assertRaises(BufferError):
+			frame.release()  # Still referred to.
+		self.assertFalse(frame.released)
+		view.release()
+		frame.release()
+		self.assertTrue(frame.released)
+		with self.assertRaises(BufferError):
+			memoryview(frame)
+		frame.release()  # Releasing twice is fine.
+
+		with self.capturer.get(timeout=2.0) as frame:
+			pass
+		self.assertTrue(frame.released)
+
+	def test_pool_exhaustion(self):
+		self.capturer.start_monitor()
+		held = []
+		with self.assertRaises(BufferError):
+			for _ in range(64):
+				held.append(self.capturer.get(timeout=2.0))
+		self.assertGreater(len(held), 0)
+		held.pop().release()  # A buffer back to the pool can be taken again.
+		frame = self.capturer.get(timeout=2.0)
+		self.assertIsNotNone(frame)
+		frame.release()
+		for frame in held:
+			frame.release()
+
+	def test_frame_outlives_capturer(self):
+		self.capturer.start_monitor(bgr=True)
+		frame = self.capturer.get(timeout=2.0)
+		view = memoryview(frame)
+		expected = view.tobytes()
+		self.capturer.stop()
+		del self.capturer
+		gc.collect()
+		self.assertEqual(view.tobytes(), expected)  # The pooled buffer lives as long as the frame.
+		view.release()
+		frame.release()
+		self.capturer = self.factory.create_synthetic_capturer()
+
+
+if __name__ == "__main__":
+	unittest.main()
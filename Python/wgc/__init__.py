@@ -0,0 +1,74 @@
+#    WGC-Capture-with-OpenCV
+#
+#     Copyright 2023-2025  Tyler Parret True
+#
+#    Licensed under the Apache License, Version 2.0 (the "License");
+#    you may not use this file except in compliance with the License.
+#    You may obtain a copy of the License at
+#
+#        http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS,
+#    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#    See the License for the specific language governing permissions and
+#    limitations under the License.
+#
+# @Authors
+#    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+
+"""
+Capture windows and monitors with WGC.
+
+Frames are pooled buffers of the capturer. numpy.asarray(frame) refers to them without copying,
+and the buffer goes back to the pool when the frame and all arrays of it are released.
+A capturer has a few pooled buffers, so do not keep many frames at once.
+
+    import numpy, wgc
+    factory = wgc.Factory()
+    capturer = factory.create_capturer()
+    capturer.start_monitor()
+    with capturer.get(timeout=1.0) as frame:
+        image = numpy.asarray(frame)  # (height, width, 4) uint8, BGRA.
+"""
+import asyncio
+import os
+
+for _dir in filter(None, os.environ.get("WGC_DLL_DIRS", "").split(os.pathsep)):
+	os.add_dll_directory(_dir)
+
+from ._wgc import Capturer, Factory, Frame, find_window
+
+__all__ = ["Capturer", "Factory", "Frame", "find_window", "get_async", "frames"]
+
+
+async def get_async(capturer, timeout=None):
+	"""Wait for the next frame on an executor thread. Works in the polling and the queue modes."""
+	loop = asyncio.get_running_loop()
+	return await loop.run_in_executor(None, capturer.get, timeout)
+
+
+async def frames(capturer, poll=0.5):
+	"""
+	Yield frames of a capturer started in the queue mode, without blocking the event loop.
+	The capture thread wakes the loop through set_notify(). Ends when capturing ends.
+	"""
+	loop = asyncio.get_running_loop()
+	ready = asyncio.Event()
+	capturer.set_notify(lambda: loop.call_soon_threadsafe(ready.set))
+	try:
+		while True:
+			ready.clear()
+			frame = capturer.get(timeout=0)
+			if frame is not None:
+				yield frame
+				continue
+			if not capturer.is_capturing():
+				return
+			try:
+				# Woken by the next frame. The timeout notices the end of capturing.
+				await asyncio.wait_for(ready.wait(), poll)
+			except asyncio.TimeoutError:
+				pass
+	finally:
+		capturer.set_notify(None)
@@ -0,0 +1,807 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+/**
+ * @brief Python bindings of IFactory and ICapturer, written against the raw CPython API.
+ * @brief Frames are pooled buffers of the capturer (ICapturer::acquireFrame()) exported by the buffer protocol,
+ * @brief so numpy.asarray(frame) refers to them without copying. Every wait releases the GIL.
+*/
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <opencv2/core.hpp>
+#include <WGC/WGC.h>
+
+namespace {
+
+constexpr auto WaitSlice = std::chrono::milliseconds(50); // Waits wake up this often to check signals and the capture.
+constexpr size_t DefaultQueueSize = 2;
+
+bool IsFinalizing() {
+#if PY_VERSION_HEX >= 0x030D0000
+	return Py_IsFinalizing();
+#else
+	return _Py_IsFinalizing();
+#endif
+}
+
+/******** Frame ********/
+
+struct FrameObject {
+	PyObject_HEAD
+	cv::Mat* mat;        // The pooled buffer. Released with the object or by release().
+	wgc::FrameInfo info;
+	Py_ssize_t shape[3];
+	Py_ssize_t strides[3];
+	Py_ssize_t exports;  // Buffers exported and not released yet.
+};
+
+PyTypeObject FrameType = { PyVarObject_HEAD_INIT(nullptr, 0) };
+
+/**
+ * @brief Wrap a pooled buffer. The GIL must be held.
+*/
+PyObject* NewFrame(cv::Mat&& mat, const wgc::FrameInfo& info) {
+	FrameObject* self = PyObject_New(FrameObject, &FrameType);
+	if (self == nullptr)
+		return nullptr;
+	self->mat = new (std::nothrow) cv::Mat(std::move(mat));
+	if (self->mat == nullptr) {
+		Py_DECREF(self);
+		return PyErr_NoMemory();
+	}
+	self->info = info;
+	self->shape[0] = self->mat->rows;
+	self->shape[1] = self->mat->cols;
+	self->shape[2] = self->mat->channels();
+	self->strides[0] = static_cast<Py_ssize_t>(self->mat->step[0]);
+	self->strides[1] = static_cast<Py_ssize_t>(self->mat->elemSize());
+	self->strides[2] = 1;
+	self->exports = 0;
+	return reinterpret_cast<PyObject*>(self);
+}
+
+void Frame_dealloc(FrameObject* self) {
+	delete self->mat;
+	PyObject_Free(self);
+}
+
+int Frame_getbuffer(FrameObject* self, Py_buffer* view, int flags) {
+	view->obj = nullptr;
+	if (self->mat == nullptr) {
+		PyErr_SetString(PyExc_BufferError, "The frame is released.");
+		return -1;
+	}
+	const bool contiguous = self->mat->isContinuous();
+	if ((flags & PyBUF_STRIDES) != PyBUF_STRIDES && !contiguous) {
+		PyErr_SetString(PyExc_BufferError, "The rows of the frame are padded, strides are required.");
+		return -1;
+	}
+	if (((flags & PyBUF_F_CONTIGUOUS) == PyBUF_F_CONTIGUOUS || (flags & PyBUF_ANY_CONTIGUOUS) == PyBUF_ANY_CONTIGUOUS ||
+		(flags & PyBUF_C_CONTIGUOUS) == PyBUF_C_CONTIGUOUS) && !contiguous) {
+		PyErr_SetString(PyExc_BufferError, "The frame is not contiguous.");
+		return -1;
+	}
+	view->buf = self->mat->data;
+	view->obj = reinterpret_cast<PyObject*>(self);
+	Py_INCREF(self);
+	view->len = self->shape[0] * self->shape[1] * self->shape[2];
+	view->readonly = 0; // The buffer belongs to this frame until it is released.
+	view->itemsize = 1;
+	view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>("B") : nullptr;
+	view->ndim = 3;
+	view->shape = (flags & PyBUF_ND) == PyBUF_ND ? self->shape : nullptr;
+	view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : nullptr;
+	view->suboffsets = nullptr;
+	view->internal = nullptr;
+	if (view->shape == nullptr)
+		view->ndim = 1;
+	++self->exports;
+	return 0;
+}
+
+void Frame_releasebuffer(FrameObject* self, Py_buffer*) {
+	--self->exports;
+}
+
+PyObject* Frame_release(FrameObject* self, PyObject*) {
+	if (self->exports > 0) {
+		PyErr_SetString(PyExc_BufferError, "The frame is still referred to by arrays or memoryviews.");
+		return nullptr;
+	}
+	delete self->mat;
+	self->mat = nullptr;
+	Py_RETURN_NONE;
+}
+
+PyObject* Frame_enter(PyObject* self, PyObject*) {
+	Py_INCREF(self);
+	return self;
+}
+
+PyObject* Frame_exit(FrameObject* self, PyObject*) {
+	return Frame_release(self, nullptr);
+}
+
+PyObject* Frame_getReleased(FrameObject* self, void*) {
+	return PyBool_FromLong(self->mat == nullptr);
+}
+
+PyBufferProcs FrameBuffer = {
+	reinterpret_cast<getbufferproc>(Frame_getbuffer),
+	reinterpret_cast<releasebufferproc>(Frame_releasebuffer)
+};
+
+PyMethodDef FrameMethods[] = {
+	{ "release", reinterpret_cast<PyCFunction>(Frame_release), METH_NOARGS,
+		"Return the buffer to the pool of the capturer. Fails while arrays still refer to it." },
+	{ "__enter__", Frame_enter, METH_NOARGS, nullptr },
+	{ "__exit__", reinterpret_cast<PyCFunction>(Frame_exit), METH_VARARGS, nullptr },
+	{ nullptr }
+};
+
+PyMemberDef FrameMembers[] = {
+	{ "sequence", T_ULONGLONG, offsetof(FrameObject, info) + offsetof(wgc::FrameInfo, sequence), READONLY,
+		"Index of the frame since capture started." },
+	{ "timestamp", T_LONGLONG, offsetof(FrameObject, info) + offsetof(wgc::FrameInfo, timestamp), READONLY,
+		"SystemRelativeTime of the frame, in 100ns units." },
+	{ "width", T_INT, offsetof(FrameObject, info) + offsetof(wgc::FrameInfo, width), READONLY, nullptr },
+	{ "height", T_INT, offsetof(FrameObject, info) + offsetof(wgc::FrameInfo, height), READONLY, nullptr },
+	{ "scale", T_DOUBLE, offsetof(FrameObject, info) + offsetof(wgc::FrameInfo, scale), READONLY,
+		"Size of the frame relative to the captured one." },
+	{ nullptr }
+};
+
+PyGetSetDef FrameGetSet[] = {
+	{ "released", reinterpret_cast<getter>(Frame_getReleased), nullptr, "Whether release() was called.", nullptr },
+	{ nullptr }
+};
+
+/******** Factory ********/
+
+struct FactoryObject {
+	PyObject_HEAD
+	std::shared_ptr<wgc::IFactory>* factory;
+};
+
+PyTypeObject FactoryType = { PyVarObject_HEAD_INIT(nullptr, 0) };
+
+int Factory_init(FactoryObject* self, PyObject* args, PyObject* kwds) {
+	static const char* keywords[] = { nullptr };
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, ":Factory", const_cast<char**>(keywords)))
+		return -1;
+	std::shared_ptr<wgc::IFactory> factory;
+	Py_BEGIN_ALLOW_THREADS
+	factory = wgc::IFactory::createInstanceNoThrow(false);
+	Py_END_ALLOW_THREADS
+	if (!factory) {
+		PyErr_SetString(PyExc_RuntimeError, "Failed to create the factory.");
+		return -1;
+	}
+	delete self->factory;
+	self->factory = new std::shared_ptr<wgc::IFactory>(std::move(factory));
+	return 0;
+}
+
+void Factory_dealloc(FactoryObject* self) {
+	if (self->factory != nullptr) {
+		Py_BEGIN_ALLOW_THREADS
+		delete self->factory; // Stops its capturers, which may wait for callbacks that need the GIL.
+		Py_END_ALLOW_THREADS
+	}
+	Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+}
+
+PyObject* NewCapturer(PyObject* factory, std::shared_ptr<wgc::ICapturer> capturer);
+
+PyObject* Factory_createCapturer(FactoryObject* self, PyObject*) {
+	if (self->factory == nullptr) {
+		PyErr_SetString(PyExc_RuntimeError, "The factory is not initialized.");
+		return nullptr;
+	}
+	std::shared_ptr<wgc::ICapturer> capturer;
+	try {
+		capturer = (*self->factory)->createCapturer().lock();
+	}
+	catch (const std::exception& e) {
+		PyErr_SetString(PyExc_RuntimeError, e.what());
+		return nullptr;
+	}
+	if (!capturer) {
+		PyErr_SetString(PyExc_MemoryError, "The capturer is refused by the memory budget.");
+		return nullptr;
+	}
+	return NewCapturer(reinterpret_cast<PyObject*>(self), std::move(capturer));
+}
+
+PyObject* Factory_createReplayCapturer(FactoryObject* self, PyObject* args, PyObject* kwds) {
+	static const char* keywords[] = { "path", "speed", "loop", nullptr };
+	PyObject* path = nullptr;
+	wgc::ReplayOptions options;
+	int loop = options.loop;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "U|dp:create_replay_capturer", const_cast<char**>(keywords),
+		&path, &options.speed, &loop))
+		return nullptr;
+	if (self->factory == nullptr) {
+		PyErr_SetString(PyExc_RuntimeError, "The factory is not initialized.");
+		return nullptr;
+	}
+	options.loop = loop != 0;
+	wchar_t* wpath = PyUnicode_AsWideCharString(path, nullptr);
+	if (wpath == nullptr)
+		return nullptr;
+	const std::wstring filename(wpath);
+	PyMem_Free(wpath);
+
+	std::shared_ptr<wgc::ICapturer> capturer;
+	try {
+		capturer = (*self->factory)->createReplayCapturer(filename, options).lock();
+	}
+	catch (const std::exception& e) {
+		PyErr_SetString(PyExc_RuntimeError, e.what());
+		return nullptr;
+	}
+	if (!capturer) {
+		PyErr_SetString(PyExc_MemoryError, "The capturer is refused by the memory budget.");
+		return nullptr;
+	}
+	return NewCapturer(reinterpret_cast<PyObject*>(self), std::move(capturer));
+}
+
+PyObject* Factory_createSyntheticCapturer(FactoryObject* self, PyObject* args, PyObject* kwds) {
+	static const char* keywords[] = { "width", "height", "fps", "stamp", nullptr };
+	wgc::SyntheticOptions options;
+	int stamp = options.stamp;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|iidp:create_synthetic_capturer", const_cast<char**>(keywords),
+		&options.width, &options.height, &options.fps, &stamp))
+		return nullptr;
+	if (self->factory == nullptr) {
+		PyErr_SetString(PyExc_RuntimeError, "The factory is not initialized.");
+		return nullptr;
+	}
+	if (options.width <= 0 || options.height <= 0 || options.fps < 0.0) {
+		PyErr_SetString(PyExc_ValueError, "width and height must be positive, fps non-negative.");
+		return nullptr;
+	}
+	options.stamp = stamp != 0;
+
+	std::shared_ptr<wgc::ICapturer> capturer;
+	try {
+		capturer = (*self->factory)->createSyntheticCapturer(options).lock();
+	}
+	catch (const std::exception& e) {
+		PyErr_SetString(PyExc_RuntimeError, e.what());
+		return nullptr;
+	}
+	if (!capturer) {
+		PyErr_SetString(PyExc_MemoryError, "The capturer is refused by the memory budget.");
+		return nullptr;
+	}
+	return NewCapturer(reinterpret_cast<PyObject*>(self), std::move(capturer));
+}
+
+PyMethodDef FactoryMethods[] = {
+	{ "create_capturer", reinterpret_cast<PyCFunction>(Factory_createCapturer), METH_NOARGS,
+		"Create a capturer of windows and monitors." },
+	{ "create_replay_capturer", reinterpret_cast<PyCFunction>(Factory_createReplayCapturer), METH_VARARGS | METH_KEYWORDS,
+		"create_replay_capturer(path, speed=1.0, loop=False)\n"
+		"Create a capturer that replays a recorded file. Its start functions ignore the target." },
+	{ "create_synthetic_capturer", reinterpret_cast<PyCFunction>(Factory_createSyntheticCapturer), METH_VARARGS | METH_KEYWORDS,
+		"create_synthetic_capturer(width=1920, height=1080, fps=60.0, stamp=True)\n"
+		"Create a capturer that generates frames itself, e.g. for tests without a display. fps=0 means as fast as taken.\n"
+		"Its start functions ignore the target." },
+	{ nullptr }
+};
+
+/******** Capturer ********/
+
+enum class Mode {
+	Stopped,  // Not started, or failed to start.
+	Polling,  // get() asks for a frame and waits for it.
+	Queue,    // The callback queues frames for get().
+	Callback  // The callback calls a Python function.
+};
+
+/**
+ * @brief Shared by the capturer object and the C++ callback, which runs on the capture or delivery thread.
+ * @brief Python objects in it are only touched with the GIL held.
+*/
+struct Delivery {
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::deque<std::pair<cv::Mat, wgc::FrameInfo>> queue;
+	size_t maxQueued = DefaultQueueSize;
+	size_t dropped = 0;
+	bool bgr = false;
+
+	PyObject* callback = nullptr;
+	PyObject* notify = nullptr;
+};
+
+struct CapturerObject {
+	PyObject_HEAD
+	PyObject* factory;                            // Keeps the factory alive.
+	std::shared_ptr<wgc::ICapturer>* capturer;
+	std::shared_ptr<Delivery>* delivery;
+	Mode mode;
+};
+
+PyTypeObject CapturerType = { PyVarObject_HEAD_INIT(nullptr, 0) };
+
+PyObject* NewCapturer(PyObject* factory, std::shared_ptr<wgc::ICapturer> capturer) {
+	CapturerObject* self = PyObject_GC_New(CapturerObject, &CapturerType);
+	if (self == nullptr)
+		return nullptr;
+	Py_INCREF(factory);
+	self->factory = factory;
+	self->capturer = new (std::nothrow) std::shared_ptr<wgc::ICapturer>(std::move(capturer));
+	self->delivery = new (std::nothrow) std::shared_ptr<Delivery>(std::make_shared<Delivery>());
+	self->mode = Mode::Stopped;
+	PyObject_GC_Track(self);
+	if (self->capturer == nullptr || self->delivery == nullptr) {
+		Py_DECREF(self);
+		return PyErr_NoMemory();
+	}
+	return reinterpret_cast<PyObject*>(self);
+}
+
+/**
+ * @brief Stop capturing without the GIL, because stopping waits for the callback in progress.
+ * @brief The mode is kept, so get() drains the queue and then returns None like when capturing ends by itself.
+*/
+void StopCapturer(CapturerObject* self) {
+	if (self->capturer == nullptr || !*self->capturer)
+		return;
+	wgc::ICapturer* capturer = self->capturer->get();
+	Py_BEGIN_ALLOW_THREADS
+	capturer->stopCapture();
+	Py_END_ALLOW_THREADS
+}
+
+int Capturer_traverse(CapturerObject* self, visitproc visit, void* arg) {
+	Py_VISIT(self->factory);
+	if (self->delivery != nullptr) {
+		Py_VISIT((*self->delivery)->callback);
+		Py_VISIT((*self->delivery)->notify);
+	}
+	return 0;
+}
+
+int Capturer_clear(CapturerObject* self) {
+	StopCapturer(self);
+	if (self->delivery != nullptr) {
+		Py_CLEAR((*self->delivery)->callback);
+		Py_CLEAR((*self->delivery)->notify);
+	}
+	return 0;
+}
+
+void Capturer_dealloc(CapturerObject* self) {
+	PyObject_GC_UnTrack(self);
+	Capturer_clear(self);
+	if (self->capturer != nullptr && *self->capturer) {
+		std::weak_ptr<wgc::ICapturer> weak = *self->capturer;
+		self->capturer->reset();
+		FactoryObject* factory = reinterpret_cast<FactoryObject*>(self->factory);
+		if (factory->factory != nullptr) {
+			try {
+				(*factory->factory)->destroyCapturer(weak);
+			}
+			catch (...) {}
+		}
+	}
+	delete self->capturer;
+	delete self->delivery;
+	Py_CLEAR(self->factory);
+	PyObject_GC_Del(self);
+}
+
+bool CheckCapturer(CapturerObject* self) {
+	if (self->capturer == nullptr || !*self->capturer) {
+		PyErr_SetString(PyExc_RuntimeError, "The capturer is destroyed.");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief The callback of the queue mode. Frames are copied into pooled buffers, the oldest is dropped when full.
+*/
+void QueueFrame(wgc::ICapturer* capturer, const std::shared_ptr<Delivery>& delivery) {
+	cv::Mat frame;
+	wgc::FrameInfo info;
+	const bool acquired = capturer->acquireFrame(frame, &info, delivery->bgr);
+	{
+		std::lock_guard lock(delivery->mutex);
+		if (!acquired) {
+			++delivery->dropped;
+			return;
+		}
+		if (delivery->queue.size() >= delivery->maxQueued) {
+			delivery->queue.pop_front();
+			++delivery->dropped;
+		}
+		delivery->queue.emplace_back(std::move(frame), info);
+	}
+	delivery->cond.notify_all();
+
+	if (IsFinalizing())
+		return;
+	PyGILState_STATE gil = PyGILState_Ensure();
+	if (delivery->notify != nullptr) {
+		PyObject* notify = delivery->notify;
+		Py_INCREF(notify);
+		PyObject* res = PyObject_CallNoArgs(notify);
+		if (res == nullptr)
+			PyErr_WriteUnraisable(notify);
+		Py_XDECREF(res);
+		Py_DECREF(notify);
+	}
+	PyGILState_Release(gil);
+}
+
+/**
+ * @brief The callback of the callback mode.
+*/
+void CallFrame(wgc::ICapturer* capturer, const std::shared_ptr<Delivery>& delivery) {
+	cv::Mat frame;
+	wgc::FrameInfo info;
+	if (!capturer->acquireFrame(frame, &info, delivery->bgr)) {
+		std::lock_guard lock(delivery->mutex);
+		++delivery->dropped;
+		return;
+	}
+	if (IsFinalizing())
+		return;
+	PyGILState_STATE gil = PyGILState_Ensure();
+	if (delivery->callback != nullptr) {
+		PyObject* callback = delivery->callback;
+		Py_INCREF(callback);
+		PyObject* obj = NewFrame(std::move(frame), info);
+		PyObject* res = obj ? PyObject_CallOneArg(callback, obj) : nullptr;
+		if (res == nullptr)
+			PyErr_WriteUnraisable(callback);
+		Py_XDECREF(res);
+		Py_XDECREF(obj);
+		Py_DECREF(callback);
+	}
+	PyGILState_Release(gil);
+}
+
+HMONITOR MonitorOf(unsigned long long handle) {
+	if (handle != 0)
+		return reinterpret_cast<HMONITOR>(static_cast<uintptr_t>(handle));
+	const POINT origin = { 0, 0 };
+	return MonitorFromPoint(origin, MONITOR_DEFAULTTOPRIMARY);
+}
+
+/**
+ * @brief Common part of the start functions.
+ * @param window: Capture a window, or a monitor.
+*/
+PyObject* Start(CapturerObject* self, PyObject* args, PyObject* kwds, bool window) {
+	static const char* keywords[] = { "target", "mode", "callback", "queue_size", "bgr", "free_threaded", nullptr };
+	unsigned long long target = 0;
+	const char* modeName = "polling";
+	PyObject* callback = Py_None;
+	Py_ssize_t queueSize = static_cast<Py_ssize_t>(DefaultQueueSize);
+	int bgr = 0;
+	int freeThreaded = 1;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, window ? "K|sOnpp:start_window" : "|KsOnpp:start_monitor",
+		const_cast<char**>(keywords), &target, &modeName, &callback, &queueSize, &bgr, &freeThreaded))
+		return nullptr;
+	if (!CheckCapturer(self))
+		return nullptr;
+
+	Mode mode;
+	const std::string name(modeName);
+	if (name == "polling")
+		mode = Mode::Polling;
+	else if (name == "queue")
+		mode = Mode::Queue;
+	else if (name == "callback")
+		mode = Mode::Callback;
+	else {
+		PyErr_SetString(PyExc_ValueError, "mode must be 'polling', 'queue' or 'callback'.");
+		return nullptr;
+	}
+	if (mode == Mode::Callback && !PyCallable_Check(callback)) {
+		PyErr_SetString(PyExc_TypeError, "callback must be callable in the callback mode.");
+		return nullptr;
+	}
+	if (queueSize <= 0) {
+		PyErr_SetString(PyExc_ValueError, "queue_size must be positive.");
+		return nullptr;
+	}
+
+	StopCapturer(self);
+	self->mode = Mode::Stopped;
+	std::shared_ptr<Delivery> delivery = *self->delivery;
+	{
+		std::lock_guard lock(delivery->mutex);
+		delivery->queue.clear();
+		delivery->maxQueued = static_cast<size_t>(queueSize);
+		delivery->dropped = 0;
+		delivery->bgr = bgr != 0;
+	}
+	Py_CLEAR(delivery->callback);
+	if (mode == Mode::Callback) {
+		Py_INCREF(callback);
+		delivery->callback = callback;
+	}
+
+	wgc::ICapturer* capturer = self->capturer->get();
+	std::function<void(const cv::Mat&)> cb;
+	if (mode == Mode::Queue)
+		cb = [capturer, delivery](const cv::Mat&) -> void { QueueFrame(capturer, delivery); };
+	else if (mode == Mode::Callback)
+		cb = [capturer, delivery](const cv::Mat&) -> void { CallFrame(capturer, delivery); };
+
+	bool started = false;
+	Py_BEGIN_ALLOW_THREADS
+	if (window) {
+		HWND hwnd = reinterpret_cast<HWND>(static_cast<uintptr_t>(target));
+		started = cb ? capturer->startCaptureWindowWithCallback(hwnd, cb) : capturer->startCaptureWindow(hwnd, freeThreaded != 0);
+	}
+	else {
+		HMONITOR hmonitor = MonitorOf(target);
+		started = cb ? capturer->startCaptureMonitorWithCallback(hmonitor, cb) : capturer->startCaptureMonitor(hmonitor, freeThreaded != 0);
+	}
+	Py_END_ALLOW_THREADS
+	if (!started) {
+		PyErr_SetString(PyExc_RuntimeError, "Failed to start capturing.");
+		return nullptr;
+	}
+	self->mode = mode;
+	if (mode == Mode::Polling)
+		capturer->askForRefresh();
+	Py_RETURN_NONE;
+}
+
+PyObject* Capturer_startMonitor(CapturerObject* self, PyObject* args, PyObject* kwds) {
+	return Start(self, args, kwds, false);
+}
+
+PyObject* Capturer_startWindow(CapturerObject* self, PyObject* args, PyObject* kwds) {
+	return Start(self, args, kwds, true);
+}
+
+PyObject* Capturer_stop(CapturerObject* self, PyObject*) {
+	StopCapturer(self);
+	Py_RETURN_NONE;
+}
+
+PyObject* Capturer_isCapturing(CapturerObject* self, PyObject*) {
+	if (!CheckCapturer(self))
+		return nullptr;
+	return PyBool_FromLong((*self->capturer)->isCapturing());
+}
+
+PyObject* Capturer_get(CapturerObject* self, PyObject* args, PyObject* kwds) {
+	static const char* keywords[] = { "timeout", nullptr };
+	PyObject* timeoutObj = Py_None;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O:get", const_cast<char**>(keywords), &timeoutObj))
+		return nullptr;
+	if (!CheckCapturer(self))
+		return nullptr;
+	double timeout = -1.0;
+	if (timeoutObj != Py_None) {
+		timeout = PyFloat_AsDouble(timeoutObj);
+		if (timeout == -1.0 && PyErr_Occurred())
+			return nullptr;
+		if (timeout < 0.0) {
+			PyErr_SetString(PyExc_ValueError, "timeout must be non-negative or None.");
+			return nullptr;
+		}
+	}
+	if (self->mode != Mode::Polling && self->mode != Mode::Queue) {
+		PyErr_SetString(PyExc_RuntimeError, "get() needs the polling or the queue mode.");
+		return nullptr;
+	}
+
+	wgc::ICapturer* capturer = self->capturer->get();
+	std::shared_ptr<Delivery> delivery = *self->delivery;
+	const Mode mode = self->mode;
+	const auto deadline = std::chrono::steady_clock::now() +
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout < 0.0 ? 0.0 : timeout));
+	while (true) {
+		bool ready = false;
+		cv::Mat frame;
+		wgc::FrameInfo info = {};
+		Py_BEGIN_ALLOW_THREADS
+		const auto until = (timeout < 0.0) ?
+			std::chrono::steady_clock::now() + WaitSlice :
+			std::min(deadline, std::chrono::steady_clock::now() + WaitSlice);
+		if (mode == Mode::Queue) {
+			std::unique_lock lock(delivery->mutex);
+			if (delivery->cond.wait_until(lock, until, [&delivery]() -> bool { return !delivery->queue.empty(); })) {
+				frame = std::move(delivery->queue.front().first);
+				info = delivery->queue.front().second;
+				delivery->queue.pop_front();
+				ready = true;
+			}
+		}
+		else {
+			while (!(ready = capturer->isRefreshed()) && std::chrono::steady_clock::now() < until)
+				Sleep(1);
+			if (ready && !capturer->acquireFrame(frame, &info, delivery->bgr))
+				frame.release();
+			if (ready)
+				capturer->askForRefresh(); // Ask for the next one early, so it may be ready at the next call.
+		}
+		Py_END_ALLOW_THREADS
+
+		if (ready) {
+			if (frame.empty()) {
+				PyErr_SetString(PyExc_BufferError, "All pooled buffers are in use. Release some frames first.");
+				return nullptr;
+			}
+			return NewFrame(std::move(frame), info);
+		}
+		if (PyErr_CheckSignals() < 0)
+			return nullptr;
+		if ((timeout >= 0.0 && std::chrono::steady_clock::now() >= deadline) || !capturer->isCapturing())
+			Py_RETURN_NONE;
+	}
+}
+
+PyObject* Capturer_setNotify(CapturerObject* self, PyObject* notify) {
+	if (notify != Py_None && !PyCallable_Check(notify)) {
+		PyErr_SetString(PyExc_TypeError, "notify must be callable or None.");
+		return nullptr;
+	}
+	std::shared_ptr<Delivery>& delivery = *self->delivery;
+	PyObject* old = delivery->notify;
+	if (notify != Py_None) {
+		Py_INCREF(notify);
+		delivery->notify = notify;
+	}
+	else {
+		delivery->notify = nullptr;
+	}
+	Py_XDECREF(old);
+	Py_RETURN_NONE;
+}
+
+PyObject* Capturer_getQueued(CapturerObject* self, PyObject*) {
+	std::shared_ptr<Delivery>& delivery = *self->delivery;
+	std::lock_guard lock(delivery->mutex);
+	return PyLong_FromSize_t(delivery->queue.size());
+}
+
+PyObject* Capturer_getDropped(CapturerObject* self, PyObject*) {
+	std::shared_ptr<Delivery>& delivery = *self->delivery;
+	std::lock_guard lock(delivery->mutex);
+	return PyLong_FromSize_t(delivery->dropped);
+}
+
+PyMethodDef CapturerMethods[] = {
+	{ "start_monitor", reinterpret_cast<PyCFunction>(Capturer_startMonitor), METH_VARARGS | METH_KEYWORDS,
+		"start_monitor(target=0, mode='polling', callback=None, queue_size=2, bgr=False, free_threaded=True)\n"
+		"Capture a monitor by its HMONITOR, or the primary one if 0.\n"
+		"mode: 'polling' to get() one frame at a time, 'queue' to queue every frame for get(),\n"
+		"or 'callback' to call callback(frame) on the capture thread." },
+	{ "start_window", reinterpret_cast<PyCFunction>(Capturer_startWindow), METH_VARARGS | METH_KEYWORDS,
+		"start_window(target, mode='polling', callback=None, queue_size=2, bgr=False, free_threaded=True)\n"
+		"Capture a window by its HWND. See start_monitor()." },
+	{ "stop", reinterpret_cast<PyCFunction>(Capturer_stop), METH_NOARGS,
+		"Stop capturing. Waits for the callback in progress without holding the GIL." },
+	{ "is_capturing", reinterpret_cast<PyCFunction>(Capturer_isCapturing), METH_NOARGS, nullptr },
+	{ "get", reinterpret_cast<PyCFunction>(Capturer_get), METH_VARARGS | METH_KEYWORDS,
+		"get(timeout=None)\n"
+		"Wait for the next frame without holding the GIL. Returns None on timeout or when capturing ends." },
+	{ "set_notify", reinterpret_cast<PyCFunction>(Capturer_setNotify), METH_O,
+		"set_notify(notify)\n"
+		"Call notify() on the capture thread after each queued frame, e.g. to wake up an asyncio loop.\n"
+		"Give None to remove it." },
+	{ "queued", reinterpret_cast<PyCFunction>(Capturer_getQueued), METH_NOARGS, "Count of frames waiting for get()." },
+	{ "dropped", reinterpret_cast<PyCFunction>(Capturer_getDropped), METH_NOARGS,
+		"Count of frames dropped because the queue was full or no pooled buffer was free." },
+	{ nullptr }
+};
+
+/******** Module ********/
+
+PyObject* FindWindow_(PyObject*, PyObject* args, PyObject* kwds) {
+	static const char* keywords[] = { "title", "class_name", nullptr };
+	PyObject* title = Py_None;
+	PyObject* className = Py_None;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OO:find_window", const_cast<char**>(keywords), &title, &className))
+		return nullptr;
+	wchar_t* wtitle = nullptr;
+	wchar_t* wclass = nullptr;
+	if (title != Py_None && (wtitle = PyUnicode_AsWideCharString(title, nullptr)) == nullptr)
+		return nullptr;
+	if (className != Py_None && (wclass = PyUnicode_AsWideCharString(className, nullptr)) == nullptr) {
+		PyMem_Free(wtitle);
+		return nullptr;
+	}
+	HWND hwnd = FindWindowW(wclass, wtitle);
+	PyMem_Free(wtitle);
+	PyMem_Free(wclass);
+	return PyLong_FromUnsignedLongLong(static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(hwnd)));
+}
+
+PyMethodDef ModuleMethods[] = {
+	{ "find_window", reinterpret_cast<PyCFunction>(FindWindow_), METH_VARARGS | METH_KEYWORDS,
+		"find_window(title=None, class_name=None)\nFind a top-level window. Returns its HWND, or 0." },
+	{ nullptr }
+};
+
+PyModuleDef Module = {
+	PyModuleDef_HEAD_INIT, "_wgc",
+	"Capture windows and monitors with WGC. Frames support the buffer protocol.",
+	-1, ModuleMethods
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit__wgc() {
+	FrameType.tp_name = "wgc.Frame";
+	FrameType.tp_doc = "A captured frame in a pooled buffer. numpy.asarray(frame) refers to it without copying.";
+	FrameType.tp_basicsize = sizeof(FrameObject);
+	FrameType.tp_flags = Py_TPFLAGS_DEFAULT;
+	FrameType.tp_dealloc = reinterpret_cast<destructor>(Frame_dealloc);
+	FrameType.tp_as_buffer = &FrameBuffer;
+	FrameType.tp_methods = FrameMethods;
+	FrameType.tp_members = FrameMembers;
+	FrameType.tp_getset = FrameGetSet;
+
+	FactoryType.tp_name = "wgc.Factory";
+	FactoryType.tp_doc = "Factory of capturers. Capturers keep it alive.";
+	FactoryType.tp_basicsize = sizeof(FactoryObject);
+	FactoryType.tp_flags = Py_TPFLAGS_DEFAULT;
+	FactoryType.tp_new = PyType_GenericNew;
+	FactoryType.tp_init = reinterpret_cast<initproc>(Factory_init);
+	FactoryType.tp_dealloc = reinterpret_cast<destructor>(Factory_dealloc);
+	FactoryType.tp_methods = FactoryMethods;
+
+	CapturerType.tp_name = "wgc.Capturer";
+	CapturerType.tp_doc = "A capturer. Create it by Factory.create_capturer(), create_replay_capturer() or create_synthetic_capturer().";
+	CapturerType.tp_basicsize = sizeof(CapturerObject);
+	CapturerType.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC;
+	CapturerType.tp_dealloc = reinterpret_cast<destructor>(Capturer_dealloc);
+	CapturerType.tp_traverse = reinterpret_cast<traverseproc>(Capturer_traverse);
+	CapturerType.tp_clear = reinterpret_cast<inquiry>(Capturer_clear);
+	CapturerType.tp_methods = CapturerMethods;
+
+	if (PyType_Ready(&FrameType) < 0 || PyType_Ready(&FactoryType) < 0 || PyType_Ready(&CapturerType) < 0)
+		return nullptr;
+
+	PyObject* module = PyModule_Create(&Module);
+	if (module == nullptr)
+		return nullptr;
+	Py_INCREF(&FrameType);
+	Py_INCREF(&FactoryType);
+	Py_INCREF(&CapturerType);
+	if (PyModule_AddObject(module, "Frame", reinterpret_cast<PyObject*>(&FrameType)) < 0 ||
+		PyModule_AddObject(module, "Factory", reinterpret_cast<PyObject*>(&FactoryType)) < 0 ||
+		PyModule_AddObject(module, "Capturer", reinterpret_cast<PyObject*>(&CapturerType)) < 0) {
+		Py_DECREF(module);
+		return nullptr;
+	}
+	return module;
+}
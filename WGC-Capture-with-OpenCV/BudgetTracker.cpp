@@ -0,0 +1,88 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "BudgetTracker.h"
+
+namespace wgc {
+
+BudgetTracker::BudgetTracker() :
+	m_total(0),
+	m_over(false),
+	m_generation(0) {}
+
+void BudgetTracker::setBudget(const MemoryBudget& budget) {
+	std::lock_guard lock(m_mutex);
+	m_budget = budget;
+	++m_generation; // The policies may differ even if the state does not.
+	Update();
+}
+
+MemoryBudget BudgetTracker::getBudget() {
+	std::lock_guard lock(m_mutex);
+	return m_budget;
+}
+
+void BudgetTracker::report(size_t id, size_t bytes) {
+	std::lock_guard lock(m_mutex);
+	size_t& usage = m_usage[id];
+	m_total = m_total - usage + bytes;
+	usage = bytes;
+	Update();
+}
+
+void BudgetTracker::remove(size_t id) {
+	std::lock_guard lock(m_mutex);
+	const auto it = m_usage.find(id);
+	if (it == m_usage.end())
+		return;
+	m_total -= it->second;
+	m_usage.erase(it);
+	Update();
+}
+
+size_t BudgetTracker::getTotal() {
+	std::lock_guard lock(m_mutex);
+	return m_total;
+}
+
+bool BudgetTracker::isOverBudget() const {
+	return m_over;
+}
+
+uint64_t BudgetTracker::getGeneration() const {
+	return m_generation;
+}
+
+void BudgetTracker::Update() {
+	bool over = m_over;
+	if (m_budget.bytes == 0)
+		over = false;
+	else if (!over)
+		over = m_total > m_budget.bytes;
+	else
+		over = m_total >= static_cast<size_t>(m_budget.bytes * m_budget.resumeRatio);
+	if (over != m_over) {
+		m_over = over;
+		++m_generation;
+	}
+}
+
+} // namespace wgc
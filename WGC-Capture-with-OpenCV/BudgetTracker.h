@@ -0,0 +1,70 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include "include/WGC/WGC.h"
+
+namespace wgc {
+
+/**
+ * @brief 内存预算：汇总各截取器报告的用量，超出预算时进入降级，低于恢复比例时退出。
+ * @brief 工厂和它的截取器共用一个，截取器可能比工厂活得久。
+*/
+class BudgetTracker final {
+public:
+	BudgetTracker();
+
+public:
+	void setBudget(const MemoryBudget& budget);
+	MemoryBudget getBudget();
+
+	/**
+	 * @brief 更新一个截取器的用量，并重新判断是否降级。
+	*/
+	void report(size_t id, size_t bytes);
+	void remove(size_t id);
+
+	size_t getTotal();
+	bool isOverBudget() const;
+	/**
+	 * @brief 预算或降级状态每次变化时加一，截取器据此判断是否要重新应用策略。
+	*/
+	uint64_t getGeneration() const;
+
+protected:
+	void Update(); // 在锁内调用。
+
+protected:
+	std::mutex m_mutex;
+	MemoryBudget m_budget;
+	std::map<size_t, size_t> m_usage; // 各截取器的字节数。
+	size_t m_total;
+
+	std::atomic<bool> m_over;
+	std::atomic<uint64_t> m_generation;
+};
+
+} // namespace wgc
@@ -0,0 +1,412 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "include/WGC/CApi.h"
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "include/WGC/WGC.h"
+#include "include/WGC/FrameGraph.h"
+
+struct wgc_factory_t {
+	std::shared_ptr<wgc::IFactory> factory;
+};
+
+struct wgc_capturer_t {
+	std::shared_ptr<wgc::IFactory> factory; // 保持工厂存活。
+	std::weak_ptr<wgc::ICapturer> handle;   // 交给destroyCapturer()。
+	std::shared_ptr<wgc::ICapturer> capturer;
+
+	wgc_frame_callback callback = nullptr;
+	void* user = nullptr;
+
+	std::mutex mutex; // 保护以下成员。读取与回调可能在不同线程。
+	std::shared_ptr<wgc::IFrameGraph> graphs[WGC_FORMAT_GRAY8 + 1]; // 每种格式一个图，首次使用时创建。
+	std::vector<cv::Mat> outputs;
+};
+
+namespace {
+
+thread_local std::string t_lastError; // 本线程最后一次失败的信息。
+
+constexpr int FormatChannels[WGC_FORMAT_GRAY8 + 1] = { 4, 3, 4, 3, 1 };
+
+wgc_result Fail(wgc_result result, const char* message) {
+	t_lastError = message;
+	return result;
+}
+
+/**
+ * @brief 把异常转为错误码，并记录信息。在catch块中调用。
+*/
+wgc_result FailFromException() {
+	try {
+		throw;
+	}
+	catch (const std::bad_alloc&) {
+		return Fail(WGC_ERROR_OUT_OF_MEMORY, "Out of memory.");
+	}
+	catch (const std::exception& ex) {
+		return Fail(WGC_ERROR_FAILED, ex.what());
+	}
+	catch (...) {
+		return Fail(WGC_ERROR_FAILED, "Unknown exception.");
+	}
+}
+
+/**
+ * @brief 创建把BGRA帧写为format的图。只有一个输出。
+*/
+std::shared_ptr<wgc::IFrameGraph> CreateGraph(wgc_format format) {
+	std::shared_ptr<wgc::IFrameGraph> graph = wgc::IFrameGraph::createInstance();
+	if (graph == nullptr)
+		throw std::bad_alloc();
+	switch (format) {
+	case WGC_FORMAT_BGRA8:
+		graph->addOutput(wgc::IFrameGraph::Input);
+		break;
+	case WGC_FORMAT_BGR8:
+		graph->addOutput(graph->cvtColor(wgc::IFrameGraph::Input, cv::COLOR_BGRA2BGR));
+		break;
+	case WGC_FORMAT_RGBA8:
+		graph->addOutput(graph->cvtColor(wgc::IFrameGraph::Input, cv::COLOR_BGRA2RGBA));
+		break;
+	case WGC_FORMAT_RGB8:
+		graph->addOutput(graph->cvtColor(wgc::IFrameGraph::Input, cv::COLOR_BGRA2RGB));
+		break;
+	case WGC_FORMAT_GRAY8:
+		graph->addOutput(graph->cvtColor(wgc::IFrameGraph::Input, cv::COLOR_BGRA2GRAY));
+		break;
+	}
+	return graph;
+}
+
+void FillInfo(const wgc::FrameInfo& src, wgc_frame_info* info) {
+	if (info == nullptr)
+		return;
+	info->sequence = src.sequence;
+	info->timestamp = src.timestamp;
+	info->width = src.width;
+	info->height = src.height;
+	info->scale = src.scale;
+}
+
+bool IsValidBuffer(const wgc_buffer* buffer) {
+	if (buffer == nullptr || buffer->format < WGC_FORMAT_BGRA8 || buffer->format > WGC_FORMAT_GRAY8)
+		return false;
+	if (buffer->data == nullptr)
+		return buffer->width == 0 && buffer->height == 0; // Only the information.
+	return buffer->width >= 0 && buffer->height >= 0 &&
+		buffer->stride >= static_cast<int64_t>(buffer->width) * FormatChannels[buffer->format];
+}
+
+/**
+ * @brief 把截取器当前的帧转换并写入buffer。不复制到中间缓冲：图的输出直接包装buffer。
+*/
+wgc_result WriteFrame(wgc_capturer capturer, const wgc_buffer* buffer, wgc_frame_info* info) {
+	const wgc::FrameInfo frameInfo = capturer->capturer->getFrameInfo();
+	FillInfo(frameInfo, info);
+	if (frameInfo.width <= 0 || frameInfo.height <= 0)
+		return Fail(WGC_ERROR_NO_FRAME, "No frame is captured.");
+	if (frameInfo.width > buffer->width || frameInfo.height > buffer->height)
+		return Fail(WGC_ERROR_BUFFER_TOO_SMALL, "The buffer is smaller than the frame.");
+
+	std::lock_guard lock(capturer->mutex);
+	std::shared_ptr<wgc::IFrameGraph>& graph = capturer->graphs[buffer->format];
+	if (graph == nullptr)
+		graph = CreateGraph(buffer->format);
+
+	// cv::Mat::create() keeps memory of the same size and type, so the graph writes into the buffer.
+	const cv::Mat target(
+		frameInfo.height, frameInfo.width, CV_8UC(FormatChannels[buffer->format]),
+		buffer->data, static_cast<size_t>(buffer->stride)
+	);
+	capturer->outputs.resize(1);
+	capturer->outputs[0] = target;
+	const bool succeed = capturer->capturer->runGraph(*graph, capturer->outputs);
+	const bool inPlace = succeed && capturer->outputs[0].data == target.data;
+	capturer->outputs[0].release();
+	if (!succeed)
+		return Fail(WGC_ERROR_NO_FRAME, "No frame is captured.");
+	if (!inPlace) {
+		// The frame changed its size after getFrameInfo().
+		FillInfo(capturer->capturer->getFrameInfo(), info);
+		return Fail(WGC_ERROR_BUFFER_TOO_SMALL, "The frame changed its size.");
+	}
+	return WGC_OK;
+}
+
+} // namespace
+
+extern "C" {
+
+WGC_CAPI const char* WGC_CALL wgc_result_string(wgc_result result) {
+	switch (result) {
+	case WGC_OK:
+		return "OK";
+	case WGC_ERROR_INVALID_ARGUMENT:
+		return "Invalid argument";
+	case WGC_ERROR_FAILED:
+		return "Failed";
+	case WGC_ERROR_NO_FRAME:
+		return "No frame";
+	case WGC_ERROR_TIMEOUT:
+		return "Timeout";
+	case WGC_ERROR_BUFFER_TOO_SMALL:
+		return "Buffer too small";
+	case WGC_ERROR_OUT_OF_MEMORY:
+		return "Out of memory";
+	case WGC_ERROR_REFUSED:
+		return "Refused";
+	}
+	return "Unknown result";
+}
+
+WGC_CAPI const char* WGC_CALL wgc_get_last_error(void) {
+	return t_lastError.c_str();
+}
+
+WGC_CAPI wgc_result WGC_CALL wgc_factory_create(int com_initialized, wgc_factory* factory) {
+	if (factory == nullptr)
+		return Fail(WGC_ERROR_INVALID_ARGUMENT, "'factory' is NULL.");
+	*factory = nullptr;
+	try {
+		std::shared_ptr<wgc::IFactory> instance = wgc::IFactory::createInstance(com_initialized != 0);
+		*factory = new wgc_factory_t{ std::move(instance) };
+		t_lastError.clear();
+		return WGC_OK;
+	}
+	catch (...) {
+		return FailFromException();
+	}
+}
+
+WGC_CAPI void WGC_CALL wgc_factory_destroy(wgc_factory factory) {
+	delete factory;
+}
+
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_create(wgc_factory factory, wgc_capturer* capturer) {
+	if (factory == nullptr || capturer == nullptr)
+		return Fail(WGC_ERROR_INVALID_ARGUMENT, "'factory' or 'capturer' is NULL.");
+	*capturer = nullptr;
+	try {
+		std::weak_ptr<wgc::ICapturer> handle = factory->factory->createCapturer();
+		std::shared_ptr<wgc::ICapturer> instance = handle.lock();
+		if (instance == nullptr)
+			return Fail(WGC_ERROR_REFUSED, "The factory refused to create a capturer.");
+		wgc_capturer result = new wgc_capturer_t();
+		result->factory = factory->factory;
+		result->handle = handle;
+		result->capturer = std::move(instance);
+		*capturer = result;
+		t_lastError.clear();
+		return WGC_OK;
+	}
+	catch (...) {
+		return FailFromException();
+	}
+}
+
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_create_replay(wgc_factory factory, const wchar_t* path, double speed, int loop, wgc_capturer* capturer) {
+	if (factory == nullptr || path == nullptr || capturer == nullptr)
+		return Fail(WGC_ERROR_INVALID_ARGUMENT, "'factory', 'path' or 'capturer' is NULL.");
+	*capturer = nullptr;
+	try {
+		wgc::ReplayOptions options;
+		options.speed = speed;
+		options.loop = loop != 0;
+		std::weak_ptr<wgc::ICapturer> handle = factory->factory->createReplayCapturer(path, options);
+		std::shared_ptr<wgc::ICapturer> instance = handle.lock();
+		if (instance == nullptr)
+			return Fail(WGC_ERROR_REFUSED, "The factory refused to create a capturer.");
+		wgc_capturer result = new wgc_capturer_t();
+		result->factory = factory->factory;
+		result->handle = handle;
+		result->capturer = std::move(instance);
+		*capturer = result;
+		t_lastError.clear();
+		return WGC_OK;
+	}
+	catch (...) {
+		return FailFromException();
+	}
+}
+
+WGC_CAPI void WGC_CALL wgc_capturer_destroy(wgc_capturer capturer) {
+	if (capturer == nullptr)
+		return;
+	try {
+		capturer->capturer->stopCapture();
+		capturer->capturer.reset();
+		capturer->factory->destroyCapturer(capturer->handle);
+	}
+	catch (...) {
+		FailFromException();
+	}
+	delete capturer;
+}
+
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_start_monitor(wgc_capturer capturer, void* hmonitor, int free_threaded) {
+	if (capturer == nullptr)
+		return Fail(WGC_ERROR_INVALID_ARGUMENT, "'capturer' is NULL.");
+	HMONITOR monitor = static_cast<HMONITOR>(hmonitor);
+	if (monitor == NULL)
+		monitor = MonitorFromPoint(POINT{ 0, 0 }, MONITOR_DEFAULTTOPRIMARY);
+	try {
+		if (!capturer->capturer->startCaptureMonitor(monitor, free_threaded != 0))
+			return Fail(WGC_ERROR_FAILED, "Failed to start capturing the monitor.");
+		t_lastError.clear();
+		return WGC_OK;
+	}
+	catch (...) {
+		return FailFromException();
+	}
+}
+
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_start_window(wgc_capturer capturer, void* hwnd, int free_threaded) {
+	if (capturer == nullptr || hwnd == nullptr)
+		return Fail(WGC_ERROR_INVALID_ARGUMENT, "'capturer' or 'hwnd' is NULL.");
+	try {
+		if (!capturer->capturer->startCaptureWindow(static_cast<HWND>(hwnd), free_threaded != 0))
+			return Fail(WGC_ERROR_FAILED, "Failed to start capturing the window.");
+		t_lastError.clear();
+		return WGC_OK;
+	}
+	catch (...) {
+		return FailFromException();
+	}
+}
+
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_start_monitor_callback(wgc_capturer capturer, void* hmonitor, wgc_frame_callback callback, void* user) {
+	if (capturer == nullptr || callback == nullptr)
+		return Fail(WGC_ERROR_INVALID_ARGUMENT, "'capturer' or 'callback' is NULL.");
+	HMONITOR monitor = static_cast<HMONITOR>(hmonitor);
+	if (monitor == NULL)
+		monitor = MonitorFromPoint(POINT{ 0, 0 }, MONITOR_DEFAULTTOPRIMARY);
+	try {
+		capturer->capturer->stopCapture(); // The previous callback may still use 'user'.
+		capturer->callback = callback;
+		capturer->user = user;
+		const bool succeed = capturer->capturer->startCaptureMonitorWithCallback(
+			monitor,
+			[capturer](const cv::Mat&) -> void {
+				wgc_frame_info info;
+				FillInfo(capturer->capturer->getFrameInfo(), &info);
+				capturer->callback(capturer, &info, capturer->user);
+			}
+		);
+		if (!succeed)
+			return Fail(WGC_ERROR_FAILED, "Failed to start capturing the monitor.");
+		t_lastError.clear();
+		return WGC_OK;
+	}
+	catch (...) {
+		return FailFromException();
+	}
+}
+
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_start_window_callback(wgc_capturer capturer, void* hwnd, wgc_frame_callback callback, void* user) {
+	if (capturer == nullptr || hwnd == nullptr || callback == nullptr)
+		return Fail(WGC_ERROR_INVALID_ARGUMENT, "'capturer', 'hwnd' or 'callback' is NULL.");
+	try {
+		capturer->capturer->stopCapture(); // The previous callback may still use 'user'.
+		capturer->callback = callback;
+		capturer->user = user;
+		const bool succeed = capturer->capturer->startCaptureWindowWithCallback(
+			static_cast<HWND>(hwnd),
+			[capturer](const cv::Mat&) -> void {
+				wgc_frame_info info;
+				FillInfo(capturer->capturer->getFrameInfo(), &info);
+				capturer->callback(capturer, &info, capturer->user);
+			}
+		);
+		if (!succeed)
+			return Fail(WGC_ERROR_FAILED, "Failed to start capturing the window.");
+		t_lastError.clear();
+		return WGC_OK;
+	}
+	catch (...) {
+		return FailFromException();
+	}
+}
+
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_stop(wgc_capturer capturer) {
+	if (capturer == nullptr)
+		return Fail(WGC_ERROR_INVALID_ARGUMENT, "'capturer' is NULL.");
+	try {
+		capturer->capturer->stopCapture();
+		return WGC_OK;
+	}
+	catch (...) {
+		return FailFromException();
+	}
+}
+
+WGC_CAPI int WGC_CALL wgc_capturer_is_capturing(wgc_capturer capturer) {
+	if (capturer == nullptr)
+		return 0;
+	return capturer->capturer->isCapturing() ? 1 : 0;
+}
+
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_read(wgc_capturer capturer, const wgc_buffer* buffer, int32_t timeout_ms, wgc_frame_info* info) {
+	if (capturer == nullptr || !IsValidBuffer(buffer))
+		return Fail(WGC_ERROR_INVALID_ARGUMENT, "'capturer' is NULL or 'buffer' is invalid.");
+	try {
+		wgc::ICapturer& instance = *capturer->capturer;
+		if (!instance.isCapturing())
+			return Fail(WGC_ERROR_NO_FRAME, "The capturer is not capturing.");
+		const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+		instance.askForRefresh();
+		while (!instance.isRefreshed()) {
+			if (!instance.isCapturing())
+				return Fail(WGC_ERROR_NO_FRAME, "The capture stopped.");
+			if (timeout_ms >= 0 && std::chrono::steady_clock::now() >= until)
+				return Fail(WGC_ERROR_TIMEOUT, "No new frame arrived in time.");
+			Sleep(1);
+		}
+		const wgc_result result = WriteFrame(capturer, buffer, info);
+		if (result == WGC_OK)
+			t_lastError.clear();
+		return result;
+	}
+	catch (...) {
+		return FailFromException();
+	}
+}
+
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_copy_frame(wgc_capturer capturer, const wgc_buffer* buffer, wgc_frame_info* info) {
+	if (capturer == nullptr || !IsValidBuffer(buffer))
+		return Fail(WGC_ERROR_INVALID_ARGUMENT, "'capturer' is NULL or 'buffer' is invalid.");
+	try {
+		const wgc_result result = WriteFrame(capturer, buffer, info);
+		if (result == WGC_OK)
+			t_lastError.clear();
+		return result;
+	}
+	catch (...) {
+		return FailFromException();
+	}
+}
+
+} // extern "C"
@@ -22,6 +22,8 @@
 #include "Capturer.h"
 #include <windows.graphics.capture.interop.h>
 #include <dwmapi.h>
+#include <chrono>
+#include <cmath>
 
 using namespace winrt;
 using namespace winrt::Windows::Foundation;
@@ -88,26 +90,14 @@ bool get_client_box(HWND window, uint32_t width, uint32_t height, D3D11_BOX* cli
 	return client_box_available;
 }
 
-inline bool CreateCaptureItemForWindow(GraphicsCaptureItem& item, HWND hwnd) {
-	auto activation_factory = get_activation_factory<GraphicsCaptureItem>();
-	auto interop_factory = activation_factory.as<IGraphicsCaptureItemInterop>();
-	const auto res = interop_factory->CreateForWindow(hwnd, guid_of<IGraphicsCaptureItem>(), put_abi(item));
-	return res == S_OK;
-}
-
-inline bool CreateCaptureItemForMonitor(GraphicsCaptureItem& item, HMONITOR hmonitor) {
-	auto activation_factory = get_activation_factory<GraphicsCaptureItem>();
-	auto interop_factory = activation_factory.as<IGraphicsCaptureItemInterop>();
-	const auto res = interop_factory->CreateForMonitor(hmonitor, guid_of<IGraphicsCaptureItem>(), put_abi(item));
-	return res == S_OK;
-}
+constexpr int ProbeTextureWidth = 256; // 探针暂存纹理的宽度，探针逐行排列。
 
 } // namespace 
 
 namespace wgc {
 
-Capturer::Capturer(IDirect3DDevice const& device, size_t id) :
-	m_id(id),
+Capturer::Capturer(std::shared_ptr<DeviceLoader> loader, size_t id, std::shared_ptr<ImageSaver> saver, std::shared_ptr<BudgetTracker> budget) :
+	CapturerBase(id, saver, budget),
 
 	m_item(nullptr),
 	m_framePool(nullptr),
@@ -116,18 +106,32 @@ Capturer::Capturer(IDirect3DDevice const& device, size_t id) :
 	m_texture(nullptr),
 	m_lastSize(),
 	m_lastTexSize(),
-
-	r_device(device),
+	m_sinkTexture(nullptr),
+	m_sinkTexSize(),
+	m_mipTexture(nullptr),
+	m_mipView(nullptr),
+	m_mipTexSize(),
+	m_mipLevels(0),
+	m_scaledTexture(nullptr),
+	m_scaledTexSize(),
+
+	r_loader(loader),
+	r_device(nullptr),
 	m_d3dContext(nullptr),
 	r_d3dDevice(nullptr),
 
 	m_img_clientarea(false),
-	m_img_needRefresh(false),
-	m_img_updated(false),
 
 	m_client_box(),
 	m_target_window(NULL),
-	m_target_monitor(NULL) {}
+	m_target_monitor(NULL),
+
+	m_probeTexture(nullptr),
+	m_probeVersion(0),
+	m_probeTexSize(),
+
+	m_freeThreaded(true),
+	m_sequence(0) {}
 
 Capturer::~Capturer() {
 	stopCapture();
@@ -135,15 +139,20 @@ Capturer::~Capturer() {
 
 bool Capturer::startCaptureWindow(HWND hwnd, bool freeThreaded) {
 	stopCapture();
+	BeginStart();
 
+	const double waitSeconds = WaitForDevice();
+	if (r_graphics == nullptr)
+		return false;
 	GraphicsCaptureItem item = { nullptr };
-	if (!CreateCaptureItemForWindow(item, hwnd))
+	if (!r_graphics->createItemForWindow(item, hwnd))
 		return false;
 	m_item = item;
 
 	// Set up 
-	r_d3dDevice = ::GetDXGIInterfaceFromObject<ID3D11Device>(r_device);
-	r_d3dDevice->GetImmediateContext(m_d3dContext.put());
+	r_device = r_graphics->getDevice();
+	r_d3dDevice = r_graphics->getD3DDevice();
+	m_d3dContext = r_graphics->getContext();
 
 	const SizeInt32 size = m_item.Size();
 	// Create framepool, define pixel format (DXGI_FORMAT_B8G8R8A8_UNORM), and frame size. 
@@ -161,25 +170,34 @@ bool Capturer::startCaptureWindow(HWND hwnd, bool freeThreaded) {
 	m_session.IsCursorCaptureEnabled(false);
 	m_session.IsBorderRequired(false);
 
-	CreateTexture();
+	CreateTexture(m_texture, m_lastTexSize);
 
+	StartDelivery();
+	m_freeThreaded = freeThreaded;
+	m_sequence = 0;
 	m_session.StartCapture();
 	askForRefresh();
 	m_target_window = hwnd;
+	EndStart(waitSeconds);
 	return true;
 }
 
 bool Capturer::startCaptureMonitor(HMONITOR hmonitor, bool freeThreaded) {
 	stopCapture();
+	BeginStart();
 
+	const double waitSeconds = WaitForDevice();
+	if (r_graphics == nullptr)
+		return false;
 	GraphicsCaptureItem item = { nullptr };
-	if (!CreateCaptureItemForMonitor(item, hmonitor))
+	if (!r_graphics->createItemForMonitor(item, hmonitor))
 		return false;
 	m_item = item;
 
 	// Set up 
-	r_d3dDevice = ::GetDXGIInterfaceFromObject<ID3D11Device>(r_device);
-	r_d3dDevice->GetImmediateContext(m_d3dContext.put());
+	r_device = r_graphics->getDevice();
+	r_d3dDevice = r_graphics->getD3DDevice();
+	m_d3dContext = r_graphics->getContext();
 
 	const SizeInt32 size = m_item.Size();
 	// Create framepool, define pixel format (DXGI_FORMAT_B8G8R8A8_UNORM), and frame size. 
@@ -197,25 +215,34 @@ bool Capturer::startCaptureMonitor(HMONITOR hmonitor, bool freeThreaded) {
 	m_session.IsCursorCaptureEnabled(false);
 	m_session.IsBorderRequired(false);
 
-	CreateTexture();
+	CreateTexture(m_texture, m_lastTexSize);
 
+	StartDelivery();
+	m_freeThreaded = freeThreaded;
+	m_sequence = 0;
 	m_session.StartCapture();
 	askForRefresh();
 	m_target_monitor = hmonitor;
+	EndStart(waitSeconds);
 	return true;
 }
 
 bool Capturer::startCaptureWindowWithCallback(HWND hwnd, std::function<void(const cv::Mat&)> cb) {
 	stopCapture();
+	BeginStart();
 
+	const double waitSeconds = WaitForDevice();
+	if (r_graphics == nullptr)
+		return false;
 	GraphicsCaptureItem item = { nullptr };
-	if (!CreateCaptureItemForWindow(item, hwnd))
+	if (!r_graphics->createItemForWindow(item, hwnd))
 		return false;
 	m_item = item;
 
 	// Set up 
-	r_d3dDevice = ::GetDXGIInterfaceFromObject<ID3D11Device>(r_device);
-	r_d3dDevice->GetImmediateContext(m_d3dContext.put());
+	r_device = r_graphics->getDevice();
+	r_d3dDevice = r_graphics->getD3DDevice();
+	m_d3dContext = r_graphics->getContext();
 
 	const SizeInt32 size = m_item.Size();
 	// Create framepool, define pixel format (DXGI_FORMAT_B8G8R8A8_UNORM), and frame size. 
@@ -230,26 +257,35 @@ bool Capturer::startCaptureWindowWithCallback(HWND hwnd, std::function<void(cons
 	m_session.IsCursorCaptureEnabled(false);
 	m_session.IsBorderRequired(false);
 
-	CreateTexture();
+	CreateTexture(m_texture, m_lastTexSize);
 
 	m_callback = cb;
+	StartDelivery();
+	m_freeThreaded = true;
+	m_sequence = 0;
 	m_session.StartCapture();
 	askForRefresh();
 	m_target_window = hwnd;
+	EndStart(waitSeconds);
 	return true;
 }
 
 bool Capturer::startCaptureMonitorWithCallback(HMONITOR hmonitor, std::function<void(const cv::Mat&)> cb) {
 	stopCapture();
+	BeginStart();
 
+	const double waitSeconds = WaitForDevice();
+	if (r_graphics == nullptr)
+		return false;
 	GraphicsCaptureItem item = { nullptr };
-	if (!CreateCaptureItemForMonitor(item, hmonitor))
+	if (!r_graphics->createItemForMonitor(item, hmonitor))
 		return false;
 	m_item = item;
 
 	// Set up 
-	r_d3dDevice = ::GetDXGIInterfaceFromObject<ID3D11Device>(r_device);
-	r_d3dDevice->GetImmediateContext(m_d3dContext.put());
+	r_device = r_graphics->getDevice();
+	r_d3dDevice = r_graphics->getD3DDevice();
+	m_d3dContext = r_graphics->getContext();
 
 	const SizeInt32 size = m_item.Size();
 	// Create framepool, define pixel format (DXGI_FORMAT_B8G8R8A8_UNORM), and frame size. 
@@ -264,12 +300,16 @@ bool Capturer::startCaptureMonitorWithCallback(HMONITOR hmonitor, std::function<
 	m_session.IsCursorCaptureEnabled(false);
 	m_session.IsBorderRequired(false);
 
-	CreateTexture();
+	CreateTexture(m_texture, m_lastTexSize);
 
 	m_callback = cb;
+	StartDelivery();
+	m_freeThreaded = true;
+	m_sequence = 0;
 	m_session.StartCapture();
 	askForRefresh();
 	m_target_monitor = hmonitor;
+	EndStart(waitSeconds);
 	return true;
 }
 
@@ -284,19 +324,50 @@ void Capturer::stopCapture() {
 	m_frameArrived.revoke();
 	m_framePool.Close();
 	m_session.Close();
+	StopDelivery();
 
-	m_texture->Release();
-	m_texture = nullptr;
+	DetachFrame(); // It refers to m_texture or m_scaledTexture.
+	if (m_texture) {
+		m_texture->Release();
+		m_texture = nullptr;
+	}
+	if (m_sinkTexture) {
+		m_sinkTexture->Release();
+		m_sinkTexture = nullptr;
+	}
+	m_sinkTexSize = SizeInt32();
+	if (m_mipView) {
+		m_mipView->Release();
+		m_mipView = nullptr;
+	}
+	if (m_mipTexture) {
+		m_mipTexture->Release();
+		m_mipTexture = nullptr;
+	}
+	m_mipTexSize = SizeInt32();
+	m_mipLevels = 0;
+	if (m_scaledTexture) {
+		m_scaledTexture->Release();
+		m_scaledTexture = nullptr;
+	}
+	m_scaledTexSize = SizeInt32();
+	if (m_probeTexture) {
+		m_probeTexture->Release();
+		m_probeTexture = nullptr;
+	}
+	m_probeVersion = 0;
+	m_probeTexSize = cv::Size();
+	UpdateStagingBytes();
 
 	m_framePool = nullptr;
 	m_session = nullptr;
 	m_item = nullptr;
 
-	m_d3dContext->Release();
-	m_d3dContext = nullptr;
+	m_d3dContext = nullptr; // Shared by the factory, only our reference is released.
 	r_d3dDevice = nullptr;
 
 	m_img_clientarea = false;
+	ApplyMemoryBudget();
 }
 
 void Capturer::setClipToClientArea(bool enabled) {
@@ -319,76 +390,59 @@ bool Capturer::isCaptureMonitor() {
 	return m_target_monitor != NULL;
 }
 
-void Capturer::askForRefresh() {
-	m_img_updated.store(false);
-	return m_img_needRefresh.store(true);
-}
-
-bool Capturer::isRefreshed() {
-	bool expected = true;
-	if (m_img_updated.compare_exchange_weak(expected, false))
-		return true;
-	return false;
-}
-
-void Capturer::copyMatTo(cv::Mat& target, bool convertToBGR) {
-	std::lock_guard<std::mutex> lock(m_mutex_cap);
-	if (convertToBGR)
-		cv::cvtColor(m_cap, target, cv::ColorConversionCodes::COLOR_BGRA2BGR, 3);
-	else
-		m_cap.copyTo(target);
-}
-
-size_t Capturer::getId() const {
-	return m_id;
-}
-
 void Capturer::OnFrameArrived(
 	Direct3D11CaptureFramePool const& sender,
 	winrt::Windows::Foundation::IInspectable const&
 ) {
 	std::lock_guard lockProc(m_mutex_proc);
+	EnterCaptureThread(m_freeThreaded);
 
 	const Direct3D11CaptureFrame frame = sender.TryGetNextFrame();
 	const SizeInt32 frameContentSize = frame.ContentSize();
+	const uint64_t sequence = m_sequence++;
 
-	bool expected = true;
-	if (m_img_needRefresh.compare_exchange_weak(expected, false)) {
+	const bool refresh = TakeRefreshRequest();
+	if (refresh || HasFrameSinks()) {
 		com_ptr<ID3D11Texture2D> frameSurface = ::GetDXGIInterfaceFromObject<ID3D11Texture2D>(frame.Surface());
 
-		/* need GetDesc because ContentSize is not reliable */
-		D3D11_TEXTURE2D_DESC desc;
-		frameSurface->GetDesc(&desc);
-
-		bool client_clip_success = false;
-		if (m_img_clientarea && NULL != m_target_window && get_client_box(m_target_window, desc.Width, desc.Height, &m_client_box)) {
-			desc.Width = m_client_box.right - m_client_box.left;
-			desc.Height = m_client_box.bottom - m_client_box.top;
-			client_clip_success = true;
+		// The polled frame refers to m_texture, or m_scaledTexture. Frames nobody asked for go through their own texture,
+		// so the sinks never overwrite it, and it is only written after the user asked for a new one.
+		FrameInfo info;
+		info.sequence = sequence;
+		info.timestamp = frame.SystemRelativeTime().count();
+		cv::Mat mapped;
+		if (refresh) {
+			DetachFrame();
+			const double scale = GetOutputScale();
+			if (scale < 1.0 && !NeedsFullFrame())
+				mapped = ReadBackScaled(frameSurface.get(), scale, info);
+			if (mapped.empty())
+				mapped = ReadBack(frameSurface.get(), m_texture, m_lastTexSize);
+		}
+		else {
+			mapped = ReadBack(frameSurface.get(), m_sinkTexture, m_sinkTexSize);
 		}
 
-		if (m_lastTexSize.Width != desc.Width || m_lastTexSize.Height != desc.Height) {
-			m_lastTexSize.Width = desc.Width;
-			m_lastTexSize.Height = desc.Height;
-			CreateTexture();
+		if (!mapped.empty()) {
+			info.width = mapped.cols;
+			info.height = mapped.rows;
+			RunFrameSinks(mapped, info);
+			if (refresh)
+				DeliverFrame(mapped, info);
 		}
+	}
+	else if (HasProbes()) {
+		com_ptr<ID3D11Texture2D> frameSurface = ::GetDXGIInterfaceFromObject<ID3D11Texture2D>(frame.Surface());
 
-		if (client_clip_success)
-			m_d3dContext->CopySubresourceRegion(m_texture, 0, 0, 0, 0, frameSurface.get(), 0, &m_client_box);
-		else
-			m_d3dContext->CopyResource(m_texture, frameSurface.get());
+		D3D11_TEXTURE2D_DESC desc;
+		frameSurface->GetDesc(&desc);
 
-		D3D11_MAPPED_SUBRESOURCE mappedTex;
-		m_d3dContext->Map(m_texture, 0, D3D11_MAP_READ, 0, &mappedTex);
-		m_d3dContext->Unmap(m_texture, 0);
-		{
-			std::lock_guard lock(m_mutex_cap);
-			m_cap = cv::Mat(
-				m_lastTexSize.Height, m_lastTexSize.Width,
-				CV_8UC4, mappedTex.pData, mappedTex.RowPitch
-			);
-		}
-		m_img_updated.store(true);
+		FrameInfo info;
+		info.sequence = sequence;
+		info.timestamp = frame.SystemRelativeTime().count();
+		info.width = desc.Width;
+		info.height = desc.Height;
+		ReadProbes(frameSurface.get(), desc, info);
 	}
 
 	if (m_lastSize.Width != frameContentSize.Width ||
@@ -396,6 +450,7 @@ void Capturer::OnFrameArrived(
 		m_lastSize = frameContentSize;
 		m_framePool.Recreate(r_device, DirectXPixelFormat::B8G8R8A8UIntNormalized, 2, m_lastSize);
 	}
+	ApplyMemoryBudget();
 }
 
 void Capturer::OnFrameArrivedWithCallback(
@@ -403,15 +458,42 @@ void Capturer::OnFrameArrivedWithCallback(
 	winrt::Windows::Foundation::IInspectable const& args
 ) {
 	std::lock_guard lockProc(m_mutex_proc);
+	EnterCaptureThread(m_freeThreaded);
 
 	const Direct3D11CaptureFrame frame = sender.TryGetNextFrame();
 	const SizeInt32 frameContentSize = frame.ContentSize();
+	const uint64_t sequence = m_sequence++;
 
 	com_ptr<ID3D11Texture2D> frameSurface = ::GetDXGIInterfaceFromObject<ID3D11Texture2D>(frame.Surface());
+	FrameInfo info;
+	info.sequence = sequence;
+	info.timestamp = frame.SystemRelativeTime().count();
+	// Read back only the reduced frame, unless something needs the full one.
+	cv::Mat mapped;
+	const double scale = GetOutputScale();
+	if (scale < 1.0 && !NeedsFullFrame())
+		mapped = ReadBackScaled(frameSurface.get(), scale, info);
+	if (mapped.empty())
+		mapped = ReadBack(frameSurface.get(), m_texture, m_lastTexSize);
+	if (!mapped.empty()) {
+		info.width = mapped.cols;
+		info.height = mapped.rows;
+		RunFrameSinks(mapped, info);
+		DeliverFrameToCallback(mapped, info);
+	}
+
+	if (m_lastSize.Width != frameContentSize.Width ||
+		m_lastSize.Height != frameContentSize.Height) {
+		m_lastSize = frameContentSize;
+		m_framePool.Recreate(r_device, DirectXPixelFormat::B8G8R8A8UIntNormalized, 2, m_lastSize);
+	}
+	ApplyMemoryBudget();
+}
 
+cv::Mat Capturer::ReadBack(ID3D11Texture2D* surface, ID3D11Texture2D*& texture, SizeInt32& texSize) {
 	/* need GetDesc because ContentSize is not reliable */
 	D3D11_TEXTURE2D_DESC desc;
-	frameSurface->GetDesc(&desc);
+	surface->GetDesc(&desc);
 
 	bool client_clip_success = false;
 	if (m_img_clientarea && NULL != m_target_window && get_client_box(m_target_window, desc.Width, desc.Height, &m_client_box)) {
@@ -420,39 +502,200 @@ void Capturer::OnFrameArrivedWithCallback(
 		client_clip_success = true;
 	}
 
-	if (m_lastTexSize.Width != desc.Width || m_lastTexSize.Height != desc.Height) {
-		m_lastTexSize.Width = desc.Width;
-		m_lastTexSize.Height = desc.Height;
-		CreateTexture();
+	if (texture == nullptr || texSize.Width != desc.Width || texSize.Height != desc.Height) {
+		texSize.Width = desc.Width;
+		texSize.Height = desc.Height;
+		CreateTexture(texture, texSize);
+		if (texture == nullptr)
+			return cv::Mat();
 	}
 
 	if (client_clip_success)
-		m_d3dContext->CopySubresourceRegion(m_texture, 0, 0, 0, 0, frameSurface.get(), 0, &m_client_box);
+		m_d3dContext->CopySubresourceRegion(texture, 0, 0, 0, 0, surface, 0, &m_client_box);
 	else
-		m_d3dContext->CopyResource(m_texture, frameSurface.get());
+		m_d3dContext->CopyResource(texture, surface);
 
 	D3D11_MAPPED_SUBRESOURCE mappedTex;
-	m_d3dContext->Map(m_texture, 0, D3D11_MAP_READ, 0, &mappedTex);
-	m_d3dContext->Unmap(m_texture, 0);
-	m_cap = cv::Mat(
-		m_lastTexSize.Height, m_lastTexSize.Width,
-		CV_8UC4, mappedTex.pData, mappedTex.RowPitch
-	);
+	if (FAILED(m_d3dContext->Map(texture, 0, D3D11_MAP_READ, 0, &mappedTex)))
+		return cv::Mat();
+	m_d3dContext->Unmap(texture, 0);
+	return cv::Mat(texSize.Height, texSize.Width, CV_8UC4, mappedTex.pData, mappedTex.RowPitch);
+}
 
-	m_callback(m_cap);
+void Capturer::CreateTexture(ID3D11Texture2D*& texture, const SizeInt32& size) {
+	if (texture) {
+		texture->Release();
+		texture = nullptr;
+	}
 
-	if (m_lastSize.Width != frameContentSize.Width ||
-		m_lastSize.Height != frameContentSize.Height) {
-		m_lastSize = frameContentSize;
-		m_framePool.Recreate(r_device, DirectXPixelFormat::B8G8R8A8UIntNormalized, 2, m_lastSize);
+	D3D11_TEXTURE2D_DESC desc = { 0 };
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	desc.SampleDesc = { 1,0 };
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	desc.MiscFlags = 0;
+	desc.Width = size.Width;
+	desc.Height = size.Height;
+
+	r_d3dDevice.get()->CreateTexture2D(&desc, nullptr, &texture);
+	UpdateStagingBytes();
+}
+
+cv::Mat Capturer::ReadBackScaled(ID3D11Texture2D* surface, double scale, FrameInfo& info) {
+	D3D11_TEXTURE2D_DESC desc;
+	surface->GetDesc(&desc);
+
+	bool client_clip_success = false;
+	if (m_img_clientarea && NULL != m_target_window && get_client_box(m_target_window, desc.Width, desc.Height, &m_client_box)) {
+		desc.Width = m_client_box.right - m_client_box.left;
+		desc.Height = m_client_box.bottom - m_client_box.top;
+		client_clip_success = true;
+	}
+
+	// Each mip level halves the size, level L is at scale 2^-L.
+	UINT level = 0;
+	while (std::ldexp(1.0, -static_cast<int>(level + 1)) >= scale)
+		++level;
+	const SizeInt32 scaledSize = { static_cast<int32_t>(desc.Width >> level), static_cast<int32_t>(desc.Height >> level) };
+	if (level == 0 || scaledSize.Width == 0 || scaledSize.Height == 0)
+		return cv::Mat();
+
+	if (m_mipLevels != level + 1 || m_mipTexSize.Width != desc.Width || m_mipTexSize.Height != desc.Height)
+		CreateMipTexture({ static_cast<int32_t>(desc.Width), static_cast<int32_t>(desc.Height) }, level + 1);
+	if (m_mipTexture == nullptr)
+		return cv::Mat(); // Read back at full size instead. Not retried until the size or scale changes.
+	if (m_scaledTexture == nullptr || m_scaledTexSize.Width != scaledSize.Width || m_scaledTexSize.Height != scaledSize.Height) {
+		m_scaledTexSize = scaledSize;
+		CreateTexture(m_scaledTexture, m_scaledTexSize);
+		if (m_scaledTexture == nullptr)
+			return cv::Mat();
 	}
+
+	m_d3dContext->CopySubresourceRegion(m_mipTexture, 0, 0, 0, 0, surface, 0, client_clip_success ? &m_client_box : nullptr);
+	m_d3dContext->GenerateMips(m_mipView);
+	m_d3dContext->CopySubresourceRegion(m_scaledTexture, 0, 0, 0, 0, m_mipTexture, level, nullptr);
+
+	D3D11_MAPPED_SUBRESOURCE mappedTex;
+	if (FAILED(m_d3dContext->Map(m_scaledTexture, 0, D3D11_MAP_READ, 0, &mappedTex)))
+		return cv::Mat();
+	m_d3dContext->Unmap(m_scaledTexture, 0);
+	info.width = scaledSize.Width;
+	info.height = scaledSize.Height;
+	info.scale = std::ldexp(1.0, -static_cast<int>(level));
+	return cv::Mat(scaledSize.Height, scaledSize.Width, CV_8UC4, mappedTex.pData, mappedTex.RowPitch);
 }
 
-inline void Capturer::CreateTexture() {
-	if (m_texture) {
-		m_texture->Release();
-		m_texture = nullptr;
+void Capturer::CreateMipTexture(const SizeInt32& size, UINT levels) {
+	if (m_mipView) {
+		m_mipView->Release();
+		m_mipView = nullptr;
+	}
+	if (m_mipTexture) {
+		m_mipTexture->Release();
+		m_mipTexture = nullptr;
+	}
+
+	D3D11_TEXTURE2D_DESC desc = { 0 };
+	desc.MipLevels = levels;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	desc.SampleDesc = { 1,0 };
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET; // Required by GenerateMips().
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+	desc.Width = size.Width;
+	desc.Height = size.Height;
+
+	if (SUCCEEDED(r_d3dDevice.get()->CreateTexture2D(&desc, nullptr, &m_mipTexture)) &&
+		FAILED(r_d3dDevice.get()->CreateShaderResourceView(m_mipTexture, nullptr, &m_mipView))) {
+		m_mipTexture->Release();
+		m_mipTexture = nullptr;
+	}
+	m_mipTexSize = size;
+	m_mipLevels = levels;
+	UpdateStagingBytes();
+}
+
+void Capturer::ReadProbes(ID3D11Texture2D* surface, const D3D11_TEXTURE2D_DESC& desc, const FrameInfo& frameInfo) {
+	FrameInfo info = frameInfo;
+	D3D11_BOX origin = { 0, 0, 0, desc.Width, desc.Height, 1 };
+	if (m_img_clientarea && NULL != m_target_window && get_client_box(m_target_window, desc.Width, desc.Height, &m_client_box)) {
+		origin = m_client_box;
+		info.width = m_client_box.right - m_client_box.left;
+		info.height = m_client_box.bottom - m_client_box.top;
+	}
+
+	UpdateProbeTexture();
+	if (m_probeTexture == nullptr) {
+		m_probeVersion = 0; // Try again on the next frame.
+		return;
+	}
+
+	const cv::Rect bounds(0, 0, info.width, info.height);
+	bool any = false;
+	for (size_t i = 0; i < m_probeValues.size(); ++i) {
+		ProbeValue& value = m_probeValues[i];
+		value.valid = (value.rect & bounds) == value.rect;
+		if (!value.valid)
+			continue;
+		D3D11_BOX box;
+		box.left = origin.left + value.rect.x;
+		box.top = origin.top + value.rect.y;
+		box.front = 0;
+		box.right = box.left + value.rect.width;
+		box.bottom = box.top + value.rect.height;
+		box.back = 1;
+		m_d3dContext->CopySubresourceRegion(m_probeTexture, 0, m_probeSlots[i].x, m_probeSlots[i].y, 0, surface, 0, &box);
+		any = true;
+	}
+
+	if (any) {
+		D3D11_MAPPED_SUBRESOURCE mappedTex;
+		if (FAILED(m_d3dContext->Map(m_probeTexture, 0, D3D11_MAP_READ, 0, &mappedTex)))
+			return;
+		const cv::Mat mapped(m_probeTexSize, CV_8UC4, mappedTex.pData, mappedTex.RowPitch);
+		for (size_t i = 0; i < m_probeValues.size(); ++i) {
+			ProbeValue& value = m_probeValues[i];
+			if (value.valid)
+				value.color = MeanColor(mapped(cv::Rect(m_probeSlots[i], value.rect.size())));
+		}
+		m_d3dContext->Unmap(m_probeTexture, 0);
+	}
+	DeliverProbes(m_probeValues, info);
+}
+
+void Capturer::UpdateProbeTexture() {
+	if (!UpdateProbeList(m_probeVersion, m_probeValues))
+		return;
+
+	// Pack the probes into rows, each as high as its highest probe.
+	m_probeSlots.resize(m_probeValues.size());
+	cv::Point cursor(0, 0);
+	int rowHeight = 0;
+	for (size_t i = 0; i < m_probeValues.size(); ++i) {
+		const cv::Size size = m_probeValues[i].rect.size();
+		if (cursor.x + size.width > ProbeTextureWidth) {
+			cursor.x = 0;
+			cursor.y += rowHeight;
+			rowHeight = 0;
+		}
+		m_probeSlots[i] = cursor;
+		cursor.x += size.width;
+		rowHeight = std::max(rowHeight, size.height);
 	}
+	const cv::Size size(ProbeTextureWidth, std::max(cursor.y + rowHeight, 1));
+	if (m_probeTexture && size.height <= m_probeTexSize.height)
+		return;
+
+	if (m_probeTexture) {
+		m_probeTexture->Release();
+		m_probeTexture = nullptr;
+	}
+	m_probeTexSize = size;
 
 	D3D11_TEXTURE2D_DESC desc = { 0 };
 	desc.MipLevels = 1;
@@ -463,10 +706,34 @@ inline void Capturer::CreateTexture() {
 	desc.BindFlags = 0;
 	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
 	desc.MiscFlags = 0;
-	desc.Width = m_lastTexSize.Width;
-	desc.Height = m_lastTexSize.Height;
+	desc.Width = m_probeTexSize.width;
+	desc.Height = m_probeTexSize.height;
+
+	r_d3dDevice.get()->CreateTexture2D(&desc, nullptr, &m_probeTexture);
+	UpdateStagingBytes();
+}
+
+void Capturer::UpdateStagingBytes() {
+	size_t bytes = 0;
+	if (m_texture)
+		bytes += static_cast<size_t>(m_lastTexSize.Width) * m_lastTexSize.Height * 4;
+	if (m_sinkTexture)
+		bytes += static_cast<size_t>(m_sinkTexSize.Width) * m_sinkTexSize.Height * 4;
+	if (m_mipTexture)
+		bytes += static_cast<size_t>(m_mipTexSize.Width) * m_mipTexSize.Height * 4 * 4 / 3; // The levels add up to a third more.
+	if (m_scaledTexture)
+		bytes += static_cast<size_t>(m_scaledTexSize.Width) * m_scaledTexSize.Height * 4;
+	if (m_probeTexture)
+		bytes += static_cast<size_t>(m_probeTexSize.area()) * 4;
+	m_staging_bytes = bytes;
+}
 
-	r_d3dDevice.get()->CreateTexture2D(&desc, nullptr, &m_texture);
+double Capturer::WaitForDevice() {
+	if (r_graphics != nullptr)
+		return 0.0;
+	const auto start = std::chrono::steady_clock::now();
+	r_graphics = r_loader->get();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 }
 
 } // namespace wgc
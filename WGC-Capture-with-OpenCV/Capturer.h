@@ -24,8 +24,10 @@
 
 #include <mutex>
 #include <atomic>
+#include <vector>
 #include <functional>
-#include "include/WGC/WGC.h"
+#include "CapturerBase.h"
+#include "DeviceLoader.h"
 
 namespace wgc {
 
@@ -33,9 +35,9 @@ namespace wgc {
  * @brief 截取器。
 */
 class Capturer final :
-	public ICapturer {
+	public CapturerBase {
 public:
-	Capturer(winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice const& device, size_t id);
+	Capturer(std::shared_ptr<DeviceLoader> loader, size_t id, std::shared_ptr<ImageSaver> saver, std::shared_ptr<BudgetTracker> budget);
 
 	~Capturer();
 
@@ -55,13 +57,6 @@ public:
 	virtual bool isCaptureWindow() override;
 	virtual bool isCaptureMonitor() override;
 
-	virtual void askForRefresh() override;
-	virtual bool isRefreshed() override;
-
-	virtual void copyMatTo(cv::Mat& target, bool convertToBGR = false) override;
-
-	virtual size_t getId() const override;
-
 protected:
 	void OnFrameArrived(
 		winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool const& sender,
@@ -71,15 +66,43 @@ protected:
 		winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool const& sender,
 		winrt::Windows::Foundation::IInspectable const& args
 	); // 注意这个方法不锁mat，不管needUpdate，也不设置updated。
-	void CreateTexture();
+	/**
+	 * @brief 把帧（裁剪时只取客户区）复制到暂存纹理并映射。尺寸变化时重建纹理。失败时返回空的cv::Mat。
+	*/
+	cv::Mat ReadBack(ID3D11Texture2D* surface, ID3D11Texture2D*& texture, winrt::Windows::Graphics::SizeInt32& texSize);
+	void CreateTexture(ID3D11Texture2D*& texture, const winrt::Windows::Graphics::SizeInt32& size);
+	/**
+	 * @brief 输出缩小且没有功能需要原尺寸的帧时代替ReadBack()：在GPU上生成mip，只把比例对应的一级复制到暂存纹理并映射。
+	 * @brief 成功时设置info的尺寸和比例，失败时返回空的cv::Mat且不改info。
+	 * @param scale: 2的幂，小于1。
+	*/
+	cv::Mat ReadBackScaled(ID3D11Texture2D* surface, double scale, FrameInfo& info);
+	void CreateMipTexture(const winrt::Windows::Graphics::SizeInt32& size, UINT levels);
+	/**
+	 * @brief 只把探针区域复制到小的暂存纹理并读回，不读整帧。
+	*/
+	void ReadProbes(ID3D11Texture2D* surface, const D3D11_TEXTURE2D_DESC& desc, const FrameInfo& info);
+	/**
+	 * @brief 探针列表变化时，把探针排进暂存纹理，必要时重建它。
+	*/
+	void UpdateProbeTexture();
+	/**
+	 * @brief 纹理重建后，更新读回纹理的字节数。
+	*/
+	void UpdateStagingBytes();
+	/**
+	 * @brief 第一次开始截取时取得工厂的设备，可能要等后台创建完。失败时r_graphics为nullptr。
+	 * @return 等待的秒数。
+	 */
+	double WaitForDevice();
 
 protected:
-	size_t m_id;
-
 	winrt::Windows::Graphics::Capture::GraphicsCaptureItem m_item;
 	winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool m_framePool;
 	winrt::Windows::Graphics::Capture::GraphicsCaptureSession m_session;
 
+	std::shared_ptr<DeviceLoader> r_loader;
+	std::shared_ptr<GraphicsDevice> r_graphics; // 析构先于r_loader。
 	winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice r_device;
 	winrt::com_ptr<ID3D11Device> r_d3dDevice; // D3D11 Device relies on D3D Device.
 	winrt::com_ptr<ID3D11DeviceContext> m_d3dContext;
@@ -88,18 +111,29 @@ protected:
 	ID3D11Texture2D* m_texture;
 	winrt::Windows::Graphics::SizeInt32 m_lastSize;
 	winrt::Windows::Graphics::SizeInt32 m_lastTexSize;
+	ID3D11Texture2D* m_sinkTexture; // 没有请求时给帧的功能读回用，轮询的帧引用m_texture，不能改写。
+	winrt::Windows::Graphics::SizeInt32 m_sinkTexSize;
+	ID3D11Texture2D* m_mipTexture; // 缩小输出时生成mip用，在显存中。
+	ID3D11ShaderResourceView* m_mipView;
+	winrt::Windows::Graphics::SizeInt32 m_mipTexSize; // 第0级的尺寸。
+	UINT m_mipLevels;
+	ID3D11Texture2D* m_scaledTexture; // 读回缩小的一级。轮询的帧也可能引用它。
+	winrt::Windows::Graphics::SizeInt32 m_scaledTexSize;
 
 	std::atomic<bool> m_img_clientarea; // 应当由Capture确保 在截取显示器时 不会为true。
-	std::atomic<bool> m_img_needRefresh;
-	std::atomic<bool> m_img_updated;
-	std::function<void(const cv::Mat&)> m_callback;
 
 	D3D11_BOX m_client_box;
 	HWND m_target_window;
 	HMONITOR m_target_monitor;
 
-	cv::Mat m_cap;
-	std::mutex m_mutex_cap;
+	ID3D11Texture2D* m_probeTexture;
+	uint64_t m_probeVersion;
+	std::vector<ProbeValue> m_probeValues;
+	std::vector<cv::Point> m_probeSlots; // 各探针在暂存纹理中的位置。
+	cv::Size m_probeTexSize;
+
+	bool m_freeThreaded; // 帧在系统的线程上到达，可以按策略设置它。
+	uint64_t m_sequence; // 本次截取收到的帧数。
 	std::mutex m_mutex_proc;
 };
 
@@ -0,0 +1,1038 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "CapturerBase.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+constexpr size_t PoolBuffers = 8; // 保存用的快照缓冲数，也是连续保存时排队帧数的上限。
+constexpr int MaxProbeSize = 64;  // 探针区域的最大边长。
+constexpr size_t MaxCaptureThreads = 64; // 记录CPU时间的读回线程数上限。
+constexpr size_t ReducedPoolBuffers = 3; // 内存紧张时池的上限。
+constexpr double AdaptiveScales[] = { 1.0, 0.5, 0.25 }; // 自适应比例的各级。都是2的幂，截取器可以在GPU上用mip缩小。
+constexpr int AdaptiveScaleCount = sizeof(AdaptiveScales) / sizeof(AdaptiveScales[0]);
+
+std::future<bool> MakeReadyFuture(bool value) {
+	std::promise<bool> promise;
+	promise.set_value(value);
+	return promise.get_future();
+}
+
+} // namespace
+
+namespace wgc {
+
+CapturerBase::CapturerBase(size_t id, std::shared_ptr<ImageSaver> saver, std::shared_ptr<BudgetTracker> budget) :
+	m_id(id),
+
+	m_img_needRefresh(false),
+	m_img_updated(false),
+
+	m_info(),
+	m_motion(),
+
+	r_saver(saver),
+	m_pool(PoolBuffers),
+
+	m_burst_running(false),
+	m_burst_format(ImageFormat::PNG),
+	m_burst_counters(std::make_shared<BurstCounters>()),
+
+	m_probe_any(false),
+	m_probe_version(0),
+	m_probe_nextId(0),
+	m_probe_changedOnly(true),
+	m_probe_frameVersion(0),
+
+	m_stats_ready(false),
+	m_stats_nextId(0),
+
+	m_thread_policyVersion(0),
+	m_delivery_policyVersion(0),
+
+	r_budget(budget),
+	m_budget_generation(UINT64_MAX),
+	m_budget_degraded(false),
+	m_budget_evict(false),
+	m_budget_half(false),
+	m_pool_maxBuffers(PoolBuffers),
+	m_staging_bytes(0),
+
+	m_scale_level(0),
+	m_scale_lagFrames(0),
+	m_scale_headroomFrames(0),
+
+	m_motion_enabled(false),
+	m_motion_bytes(0),
+
+	m_preroll_any(false),
+
+	m_start_times({ 0.0, 0.0, -1.0 }),
+	m_start_waiting(false),
+
+	m_latency_enabled(false),
+	m_latency_pending(false),
+
+	m_watch_any(false),
+	m_watch_bytes(0),
+
+	m_view_any(false),
+	m_view_bytes(0) {
+	m_graph_bgr.addOutput(m_graph_bgr.cvtColor(IFrameGraph::Input, cv::ColorConversionCodes::COLOR_BGRA2BGR));
+}
+
+CapturerBase::~CapturerBase() {
+	r_budget->remove(m_id);
+	m_delivery.reset();
+	for (CaptureThread& thread : m_thread_capture)
+		CloseHandle(thread.handle);
+}
+
+void CapturerBase::askForRefresh() {
+	m_img_updated.store(false);
+	return m_img_needRefresh.store(true);
+}
+
+bool CapturerBase::isRefreshed() {
+	bool expected = true;
+	if (m_img_updated.compare_exchange_weak(expected, false))
+		return true;
+	return false;
+}
+
+void CapturerBase::copyMatTo(cv::Mat& target, bool convertToBGR) {
+	std::lock_guard<std::mutex> lock(m_mutex_cap);
+	if (m_latency_pending)
+		RecordLatency(m_cap, m_info, LatencyMode::Polling);
+	if (m_memory && !m_cap.empty())
+		m_memory->create(target, m_cap.size(), convertToBGR ? CV_8UC3 : m_cap.type()); // Later writes keep its layout.
+	if (!m_stats_ready && !m_stats.empty() && !m_cap.empty())
+		ComputeStats(&target, convertToBGR);
+	else if (convertToBGR && !m_cap.empty())
+		m_graph_bgr.execute(m_cap, &target);
+	else
+		m_cap.copyTo(target);
+}
+
+bool CapturerBase::runGraph(IFrameGraph& graph, std::vector<cv::Mat>& outputs) {
+	std::lock_guard<std::mutex> lock(m_mutex_cap);
+	if (m_latency_pending)
+		RecordLatency(m_cap, m_info, LatencyMode::Polling);
+	return graph.run(m_cap, outputs);
+}
+
+FrameInfo CapturerBase::getFrameInfo() {
+	std::lock_guard<std::mutex> lock(m_mutex_cap);
+	return m_info;
+}
+
+bool CapturerBase::acquireFrame(cv::Mat& frame, FrameInfo* info, bool convertToBGR) {
+	std::lock_guard<std::mutex> lock(m_mutex_cap);
+	if (m_cap.empty())
+		return false;
+	if (m_latency_pending)
+		RecordLatency(m_cap, m_info, LatencyMode::Polling);
+	cv::Mat snapshot = Snapshot(m_cap, convertToBGR);
+	if (snapshot.empty())
+		return false;
+	frame = std::move(snapshot);
+	if (info != nullptr)
+		*info = m_info;
+	return true;
+}
+
+std::future<bool> CapturerBase::saveFrameAsync(const std::wstring& path, ImageFormat format, const SaveOptions& options) {
+	const bool toBGR = options.convertToBGR || format == ImageFormat::JPEG;
+	cv::Mat snapshot;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex_cap);
+		if (m_cap.empty())
+			return MakeReadyFuture(false);
+		snapshot = Snapshot(m_cap, toBGR);
+	}
+	if (snapshot.empty())
+		return MakeReadyFuture(false);
+	return r_saver->post(std::move(snapshot), path, format, options, false);
+}
+
+bool CapturerBase::startBurstSave(const std::wstring& directory, double seconds, ImageFormat format, const SaveOptions& options) {
+	if (!(seconds > 0.0))
+		return false;
+	std::lock_guard lock(m_mutex_burst);
+	m_burst_directory = directory;
+	m_burst_format = format;
+	m_burst_options = options;
+	m_burst_deadline = std::chrono::steady_clock::now() +
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+	m_burst_counters = std::make_shared<BurstCounters>(); // Jobs of the previous burst keep their own counters.
+	m_burst_running = true;
+	return true;
+}
+
+void CapturerBase::stopBurstSave() {
+	m_burst_running = false;
+}
+
+BurstStatus CapturerBase::getBurstStatus() {
+	std::shared_ptr<BurstCounters> counters;
+	BurstStatus status;
+	{
+		std::lock_guard lock(m_mutex_burst);
+		status.running = m_burst_running && std::chrono::steady_clock::now() < m_burst_deadline;
+		counters = m_burst_counters;
+	}
+	std::lock_guard lock(counters->mutex);
+	status.accepted = counters->accepted;
+	status.saved = counters->saved;
+	status.failed = counters->failed;
+	status.pending = counters->accepted - counters->saved - counters->failed;
+	status.stalls = counters->stalls;
+	status.stallSeconds = counters->stallSeconds;
+	return status;
+}
+
+int CapturerBase::addProbe(const cv::Point& point) {
+	return addProbe(cv::Rect(point, cv::Size(1, 1)));
+}
+
+int CapturerBase::addProbe(const cv::Rect& rect) {
+	if (rect.x < 0 || rect.y < 0 ||
+		rect.width <= 0 || rect.height <= 0 ||
+		rect.width > MaxProbeSize || rect.height > MaxProbeSize)
+		return -1;
+	std::lock_guard lock(m_mutex_probe);
+	Probe probe = {};
+	probe.value.id = m_probe_nextId++;
+	probe.value.rect = rect;
+	probe.delivered = false;
+	m_probes.push_back(probe);
+	++m_probe_version;
+	m_probe_any = true;
+	return probe.value.id;
+}
+
+bool CapturerBase::removeProbe(int id) {
+	std::lock_guard lock(m_mutex_probe);
+	const auto it = std::find_if(
+		m_probes.begin(), m_probes.end(),
+		[id](const Probe& probe) -> bool { return probe.value.id == id; }
+	);
+	if (it == m_probes.end())
+		return false;
+	m_probes.erase(it);
+	++m_probe_version;
+	m_probe_any = !m_probes.empty();
+	return true;
+}
+
+void CapturerBase::setProbeCallback(ProbeCallback cb, bool changedOnly) {
+	std::lock_guard lock(m_mutex_probe);
+	m_probe_callback = cb ? std::make_shared<const ProbeCallback>(std::move(cb)) : nullptr;
+	m_probe_changedOnly = changedOnly;
+}
+
+std::vector<ProbeValue> CapturerBase::getProbeValues() {
+	std::vector<ProbeValue> values;
+	std::lock_guard lock(m_mutex_probe);
+	values.reserve(m_probes.size());
+	for (const Probe& probe : m_probes)
+		values.push_back(probe.value);
+	return values;
+}
+
+int CapturerBase::addStatRegion(const cv::Rect& rect) {
+	if (rect.x < 0 || rect.y < 0 || rect.width <= 0 || rect.height <= 0)
+		return -1;
+	std::lock_guard lock(m_mutex_cap);
+	RegionStats region = {};
+	region.id = m_stats_nextId++;
+	region.rect = rect;
+	m_stats.push_back(region);
+	m_stats_ready = false;
+	return region.id;
+}
+
+bool CapturerBase::removeStatRegion(int id) {
+	std::lock_guard lock(m_mutex_cap);
+	const auto it = std::find_if(
+		m_stats.begin(), m_stats.end(),
+		[id](const RegionStats& region) -> bool { return region.id == id; }
+	);
+	if (it == m_stats.end())
+		return false;
+	m_stats.erase(it);
+	return true;
+}
+
+std::vector<RegionStats> CapturerBase::getRegionStats() {
+	std::lock_guard lock(m_mutex_cap);
+	if (!m_stats_ready && !m_stats.empty() && !m_cap.empty())
+		ComputeStats(nullptr, false);
+	return m_stats;
+}
+
+bool CapturerBase::setThreadingPolicy(const ThreadingPolicy& policy) {
+	if (!IsValidThreadingPolicy(policy))
+		return false;
+	std::lock_guard lock(m_mutex_thread);
+	m_thread_policy = policy;
+	++m_thread_policyVersion;
+	return true;
+}
+
+std::vector<ThreadTimes> CapturerBase::getThreadTimes() {
+	std::vector<ThreadTimes> res;
+	std::shared_ptr<DeliveryThread> delivery;
+	{
+		std::lock_guard lock(m_mutex_thread);
+		for (const CaptureThread& thread : m_thread_capture) {
+			ThreadTimes times = {};
+			times.role = ThreadRole::Capture;
+			times.threadId = thread.id;
+			if (QueryThreadTimes(thread.handle, times.userSeconds, times.kernelSeconds)) {
+				times.userSeconds -= thread.userBase;
+				times.kernelSeconds -= thread.kernelBase;
+			}
+			times.frames = thread.frames;
+			res.push_back(times);
+		}
+		delivery = m_delivery;
+	}
+	if (delivery)
+		res.push_back(delivery->getTimes());
+	return res;
+}
+
+void CapturerBase::setFrameMemory(std::shared_ptr<IFrameMemory> memory) {
+	m_pool.setMemory(memory);
+	std::lock_guard lock(m_mutex_cap);
+	m_memory = std::move(memory);
+}
+
+CapturerMemory CapturerBase::getMemoryUsage() {
+	CapturerMemory usage = {};
+	usage.id = m_id;
+	usage.stagingBytes = m_staging_bytes;
+	m_pool.getBytes(usage.bufferBytes, usage.cacheBytes);
+	usage.bufferBytes += m_motion_bytes;
+	usage.bufferBytes += m_watch_bytes;
+	std::shared_ptr<PrerollBuffer> preroll = GetPreroll();
+	if (preroll)
+		usage.bufferBytes += preroll->getBytes();
+	usage.cacheBytes += m_graph_bgr.getPoolBytes();
+	usage.cacheBytes += m_view_bytes;
+	usage.totalBytes = usage.stagingBytes + usage.bufferBytes + usage.cacheBytes;
+	usage.degraded = m_budget_degraded;
+	return usage;
+}
+
+void CapturerBase::setAdaptiveScale(const AdaptiveScaleOptions& options) {
+	std::lock_guard lock(m_mutex_scale);
+	m_scale_options = options;
+	if (!options.enabled)
+		m_scale_level = 0;
+}
+
+bool CapturerBase::setMotionMap(const MotionOptions& options) {
+	if (options.enabled && !MotionEstimator::IsValid(options))
+		return false;
+	{
+		std::lock_guard lock(m_mutex_motion);
+		m_motion_estimator.setOptions(options);
+		m_motion_enabled = options.enabled;
+		m_motion_bytes = 0;
+	}
+	if (!options.enabled) {
+		std::lock_guard lock(m_mutex_cap);
+		m_motion = {};
+	}
+	return true;
+}
+
+MotionMap CapturerBase::getMotionMap() {
+	std::lock_guard<std::mutex> lock(m_mutex_cap);
+	return m_motion;
+}
+
+bool CapturerBase::setPreroll(const PrerollOptions& options) {
+	std::shared_ptr<PrerollBuffer> preroll;
+	if (options.enabled) {
+		try {
+			preroll = std::make_shared<PrerollBuffer>(options);
+		}
+		catch (...) {
+			return false;
+		}
+	}
+	std::lock_guard lock(m_mutex_preroll);
+	std::swap(m_preroll, preroll);
+	m_preroll_any = m_preroll != nullptr;
+	return true; // The old one is released after unlocking, or by the capture thread if it is pushing.
+}
+
+std::future<bool> CapturerBase::dumpPreroll(const std::wstring& path) {
+	std::shared_ptr<PrerollBuffer> preroll = GetPreroll();
+	if (!preroll)
+		return MakeReadyFuture(false);
+	return preroll->dump(path);
+}
+
+PrerollStatus CapturerBase::getPrerollStatus() {
+	std::shared_ptr<PrerollBuffer> preroll = GetPreroll();
+	if (!preroll)
+		return {};
+	return preroll->getStatus();
+}
+
+bool CapturerBase::setLatencyProbe(const LatencyProbeOptions& options) {
+	if (!LatencyStampCodec::IsValid(options.layout))
+		return false;
+	std::lock_guard lock(m_mutex_latency);
+	m_latency_codec = LatencyStampCodec(options.layout);
+	m_latency_recorder.setPreset(options.preset, options.maxSamples);
+	m_latency_enabled = options.enabled;
+	return true;
+}
+
+std::vector<LatencyStats> CapturerBase::getLatencyStats() {
+	std::lock_guard lock(m_mutex_latency);
+	return m_latency_recorder.getStats();
+}
+
+void CapturerBase::resetLatencyStats() {
+	std::lock_guard lock(m_mutex_latency);
+	m_latency_recorder.reset();
+}
+
+int CapturerBase::watchRegion(const cv::Rect& rect, double threshold, RegionCallback callback) {
+	if (rect.x < 0 || rect.y < 0 || rect.width <= 0 || rect.height <= 0 || !(threshold >= 0.0) || !callback)
+		return -1;
+	std::lock_guard lock(m_mutex_watch);
+	const int id = m_watcher.add(rect, threshold, std::move(callback));
+	m_watch_any = true;
+	return id;
+}
+
+bool CapturerBase::unwatchRegion(int id) {
+	std::lock_guard lock(m_mutex_watch);
+	if (!m_watcher.remove(id))
+		return false;
+	m_watch_any = !m_watcher.empty();
+	m_watch_bytes = m_watcher.getBytes();
+	return true;
+}
+
+std::shared_ptr<IFramePyramid> CapturerBase::getPyramid() {
+	std::lock_guard lock(m_mutex_cap);
+	if (m_cap.empty())
+		return nullptr;
+	if (!m_pyramid) {
+		try {
+			m_pyramid = std::make_shared<FramePyramid>(m_cap, m_info);
+		}
+		catch (...) {
+			return nullptr;
+		}
+	}
+	return m_pyramid;
+}
+
+int CapturerBase::subscribeView(const ViewOptions& options, ViewCallback callback) {
+	if (!callback || !ViewFanout::IsValid(options))
+		return -1;
+	std::lock_guard lock(m_mutex_view);
+	const int id = m_view_fanout.add(options, std::move(callback));
+	m_view_any = true;
+	return id;
+}
+
+bool CapturerBase::unsubscribeView(int id) {
+	std::lock_guard lock(m_mutex_view);
+	if (!m_view_fanout.remove(id))
+		return false;
+	m_view_any = !m_view_fanout.empty();
+	m_view_bytes = m_view_fanout.getBytes();
+	return true;
+}
+
+CaptureStartTimes CapturerBase::getStartTimes() {
+	std::lock_guard lock(m_mutex_start);
+	return m_start_times;
+}
+
+size_t CapturerBase::getId() const {
+	return m_id;
+}
+
+void CapturerBase::ApplyMemoryBudget() {
+	std::lock_guard lock(m_mutex_budget);
+	r_budget->report(m_id, getMemoryUsage().totalBytes);
+	const uint64_t generation = r_budget->getGeneration();
+	if (generation != m_budget_generation) {
+		m_budget_generation = generation;
+		const MemoryBudget budget = r_budget->getBudget();
+		const bool over = r_budget->isOverBudget();
+		const bool reduce = over && budget.reduceQueueDepth;
+		const size_t maxBuffers = m_pool_maxBuffers;
+		m_pool.setMaxBuffers(reduce ? std::min(maxBuffers, ReducedPoolBuffers) : maxBuffers);
+		std::shared_ptr<DeliveryThread> delivery = GetDelivery();
+		if (delivery)
+			delivery->setReduced(reduce);
+		m_budget_evict = over && budget.evictCaches;
+		m_budget_half = over && budget.downscaleOutputs;
+		m_budget_degraded = over;
+	}
+	if (m_budget_evict) {
+		// Buffers in use are released once their users are done, so trim on every call.
+		m_pool.trim();
+		m_graph_bgr.trimPool();
+	}
+}
+
+bool CapturerBase::TakeRefreshRequest() {
+	bool expected = true;
+	return m_img_needRefresh.compare_exchange_weak(expected, false);
+}
+
+void CapturerBase::DeliverFrame(const cv::Mat& frame, const FrameInfo& info) {
+	MotionMap motion = RunMotion(frame);
+	FrameInfo scaledInfo = info;
+	const cv::Mat scaled = ScaleOutput(frame, scaledInfo);
+	std::shared_ptr<FramePyramid> pyramid;
+	{
+		std::lock_guard lock(m_mutex_cap);
+		pyramid = std::move(m_pyramid);
+		m_cap = scaled;
+		m_info = scaledInfo;
+		m_motion = std::move(motion);
+		m_stats_ready = false;
+		m_latency_pending = m_latency_enabled;
+	}
+	if (pyramid)
+		pyramid->release();
+	m_img_updated.store(true);
+	if (m_start_waiting)
+		MarkFirstFrame();
+}
+
+void CapturerBase::DetachFrame() {
+	std::shared_ptr<FramePyramid> pyramid;
+	{
+		std::lock_guard lock(m_mutex_cap);
+		pyramid = std::move(m_pyramid);
+		m_cap = cv::Mat();
+		m_motion = {};
+		m_stats_ready = false;
+		m_latency_pending = false;
+	}
+	if (pyramid)
+		pyramid->release();
+}
+
+void CapturerBase::DeliverFrameToCallback(const cv::Mat& frame, const FrameInfo& info) {
+	const MotionMap motion = RunMotion(frame);
+	FrameInfo scaledInfo = info;
+	const cv::Mat scaled = ScaleOutput(frame, scaledInfo);
+	std::shared_ptr<DeliveryThread> delivery = GetDelivery();
+	if (!delivery) {
+		CallCallback(scaled, scaledInfo, motion, LatencyMode::Callback);
+		return;
+	}
+	// The frame is only valid in this call, so the delivery thread gets a copy, unless it is already scaled into one.
+	cv::Mat snapshot = (scaled.data != frame.data) ? scaled : Snapshot(frame, false);
+	if (snapshot.empty()) {
+		delivery->addDropped();
+		return;
+	}
+	delivery->post(
+		[this, snapshot, scaledInfo, motion]() -> void {
+			CallCallback(snapshot, scaledInfo, motion, LatencyMode::Queued);
+		},
+		true
+	);
+}
+
+void CapturerBase::EnterCaptureThread(bool owned) {
+	const DWORD id = GetCurrentThreadId();
+	std::lock_guard lock(m_mutex_thread);
+	auto it = std::find_if(
+		m_thread_capture.begin(), m_thread_capture.end(),
+		[id](const CaptureThread& thread) -> bool { return thread.id == id; }
+	);
+	if (it == m_thread_capture.end() && m_thread_capture.size() < MaxCaptureThreads) {
+		CaptureThread thread = {};
+		thread.id = id;
+		thread.handle = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, id);
+		if (thread.handle != NULL) {
+			QueryThreadTimes(thread.handle, thread.userBase, thread.kernelBase);
+			m_thread_capture.push_back(thread);
+			it = m_thread_capture.end() - 1;
+		}
+	}
+
+	bool apply = owned && m_thread_policyVersion != 0;
+	if (it != m_thread_capture.end()) {
+		++it->frames;
+		apply = apply && it->policyVersion != m_thread_policyVersion;
+		it->policyVersion = m_thread_policyVersion;
+	}
+	if (apply)
+		ApplyThreadSettings(GetCurrentThread(), m_thread_policy.captureAffinity, m_thread_policy.capturePriority);
+}
+
+void CapturerBase::StartDelivery() {
+	{
+		std::lock_guard lock(m_mutex_motion);
+		m_motion_estimator.reset(); // The new target is not comparable.
+		m_motion_bytes = 0;
+	}
+	{
+		std::lock_guard lock(m_mutex_watch);
+		m_watcher.reset();
+		m_watch_bytes = 0;
+	}
+	std::shared_ptr<DeliveryThread> old;
+	std::lock_guard lock(m_mutex_thread);
+	if (m_delivery && m_delivery->isCurrentThread())
+		return; // Restarted from a callback, keep it.
+	if (m_delivery_policyVersion == m_thread_policyVersion && (m_delivery != nullptr) == m_thread_policy.dedicatedDelivery)
+		return;
+	old = std::move(m_delivery); // Joined after unlocking.
+	if (m_thread_policy.dedicatedDelivery) {
+		m_delivery = std::make_shared<DeliveryThread>(
+			m_thread_policy.deliveryQueueDepth,
+			m_thread_policy.deliveryAffinity,
+			m_thread_policy.deliveryPriority
+		);
+		// Every queued frame and the one in the callback hold a buffer.
+		m_pool_maxBuffers = PoolBuffers + m_thread_policy.deliveryQueueDepth + 1;
+	}
+	m_delivery_policyVersion = m_thread_policyVersion;
+	m_budget_generation = UINT64_MAX; // Limit the new thread and pool if the budget is over.
+}
+
+void CapturerBase::BeginStart() {
+	std::lock_guard lock(m_mutex_start);
+	m_start_begin = std::chrono::steady_clock::now();
+	m_start_times = { 0.0, 0.0, -1.0 };
+	m_start_waiting = true;
+}
+
+void CapturerBase::EndStart(double waitSeconds) {
+	std::lock_guard lock(m_mutex_start);
+	m_start_times.waitSeconds = waitSeconds;
+	m_start_times.startSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start_begin).count();
+}
+
+void CapturerBase::MarkFirstFrame() {
+	std::lock_guard lock(m_mutex_start);
+	if (!m_start_waiting)
+		return;
+	m_start_waiting = false;
+	m_start_times.firstFrameSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start_begin).count();
+}
+
+void CapturerBase::StopDelivery() {
+	std::shared_ptr<DeliveryThread> delivery = GetDelivery();
+	if (delivery)
+		delivery->clear();
+}
+
+cv::Mat CapturerBase::ScaleOutput(const cv::Mat& frame, FrameInfo& info) {
+	const double scale = GetOutputScale();
+	if (scale >= info.scale)
+		return frame; // Full size, or read back already scaled.
+	const double relative = scale / info.scale;
+	const cv::Size size(
+		std::max(1, cvRound(frame.cols * relative)),
+		std::max(1, cvRound(frame.rows * relative))
+	);
+	cv::Mat scaled = m_pool.acquire(size, frame.type());
+	if (scaled.empty())
+		return frame; // Keep the full frame rather than allocating more.
+	cv::resize(frame, scaled, size, 0.0, 0.0, cv::InterpolationFlags::INTER_AREA);
+	info.width = size.width;
+	info.height = size.height;
+	info.scale = scale;
+	return scaled;
+}
+
+double CapturerBase::GetOutputScale() const {
+	return AdaptiveScales[m_scale_level] * (m_budget_half ? 0.5 : 1.0);
+}
+
+bool CapturerBase::NeedsFullFrame() const {
+	return HasFrameSinks() || m_probe_any || m_motion_enabled;
+}
+
+MotionMap CapturerBase::RunMotion(const cv::Mat& frame) {
+	if (!m_motion_enabled)
+		return {};
+	std::lock_guard lock(m_mutex_motion);
+	MotionMap motion = m_motion_estimator.process(frame);
+	m_motion_bytes = m_motion_estimator.getBytes();
+	return motion;
+}
+
+bool CapturerBase::HasFrameSinks() const {
+	return m_burst_running || m_preroll_any || m_watch_any || m_view_any;
+}
+
+void CapturerBase::RunFrameSinks(const cv::Mat& frame, const FrameInfo& info) {
+	if (m_burst_running)
+		RunBurst(frame, info);
+	if (m_probe_any)
+		RunProbes(frame, info);
+	if (m_watch_any)
+		RunWatchers(frame, info);
+	if (m_view_any)
+		RunViews(frame, info);
+	if (m_preroll_any) {
+		std::shared_ptr<PrerollBuffer> preroll = GetPreroll();
+		if (preroll)
+			preroll->push(frame, info);
+	}
+}
+
+bool CapturerBase::HasProbes() const {
+	return m_probe_any;
+}
+
+bool CapturerBase::UpdateProbeList(uint64_t& version, std::vector<ProbeValue>& values) {
+	std::lock_guard lock(m_mutex_probe);
+	if (version == m_probe_version)
+		return false;
+	version = m_probe_version;
+	values.resize(m_probes.size());
+	for (size_t i = 0; i < m_probes.size(); ++i) {
+		values[i] = {};
+		values[i].id = m_probes[i].value.id;
+		values[i].rect = m_probes[i].value.rect;
+	}
+	return true;
+}
+
+void CapturerBase::DeliverProbes(std::vector<ProbeValue>& values, const FrameInfo& info) {
+	std::shared_ptr<const ProbeCallback> callback;
+	bool changedOnly = true;
+	bool anyChanged = false;
+	{
+		std::lock_guard lock(m_mutex_probe);
+		// Both lists keep the order of adding, so the search rarely moves.
+		size_t j = 0;
+		for (ProbeValue& value : values) {
+			while (j < m_probes.size() && m_probes[j].value.id != value.id)
+				++j;
+			if (j == m_probes.size()) {
+				value.changed = false; // Removed while reading.
+				j = 0;
+				continue;
+			}
+			Probe& last = m_probes[j];
+			if (!value.valid)
+				value.color = last.value.color;
+			value.changed = !last.delivered || value.valid != last.value.valid || value.color != last.value.color;
+			last.value = value;
+			last.delivered = true;
+			anyChanged |= value.changed;
+		}
+		callback = m_probe_callback;
+		changedOnly = m_probe_changedOnly;
+	}
+	if (!callback)
+		return;
+	if (changedOnly && !anyChanged)
+		return;
+	const std::vector<ProbeValue>* delivered = &values;
+	if (changedOnly) {
+		m_probe_changed.clear();
+		for (const ProbeValue& value : values) {
+			if (value.changed)
+				m_probe_changed.push_back(value);
+		}
+		delivered = &m_probe_changed;
+	}
+	std::shared_ptr<DeliveryThread> delivery = GetDelivery();
+	if (!delivery) {
+		(*callback)(*delivered, info);
+		return;
+	}
+	// Probe values are small and may be changes only, so they are never dropped.
+	delivery->post(
+		[callback, copied = *delivered, info]() -> void {
+			(*callback)(copied, info);
+		},
+		false
+	);
+}
+
+cv::Vec4b CapturerBase::MeanColor(const cv::Mat& area) {
+	const cv::Scalar mean = cv::mean(area);
+	return cv::Vec4b(
+		cv::saturate_cast<uchar>(mean[0]), cv::saturate_cast<uchar>(mean[1]),
+		cv::saturate_cast<uchar>(mean[2]), cv::saturate_cast<uchar>(mean[3])
+	);
+}
+
+cv::Mat CapturerBase::Snapshot(const cv::Mat& frame, bool convertToBGR) {
+	cv::Mat snapshot = m_pool.acquire(frame.size(), convertToBGR ? CV_8UC3 : frame.type());
+	if (snapshot.empty())
+		return snapshot;
+	if (convertToBGR && frame.channels() == 4)
+		cv::cvtColor(frame, snapshot, cv::ColorConversionCodes::COLOR_BGRA2BGR, 3);
+	else
+		frame.copyTo(snapshot);
+	return snapshot;
+}
+
+void CapturerBase::RunBurst(const cv::Mat& frame, const FrameInfo& info) {
+	std::lock_guard lock(m_mutex_burst);
+	if (!m_burst_running)
+		return;
+	if (std::chrono::steady_clock::now() >= m_burst_deadline) {
+		m_burst_running = false;
+		return;
+	}
+
+	const bool toBGR = m_burst_options.convertToBGR || m_burst_format == ImageFormat::JPEG;
+	std::shared_ptr<BurstCounters> counters = m_burst_counters;
+
+	// Never drop a frame: if every buffer is waiting for the encoders, wait for one of them.
+	double waited = 0.0;
+	cv::Mat snapshot = Snapshot(frame, toBGR);
+	if (snapshot.empty()) {
+		const auto start = std::chrono::steady_clock::now();
+		std::unique_lock lockCounters(counters->mutex);
+		// Buffers held by saveFrameAsync do not notify, so poll as well.
+		while (m_burst_running && snapshot.empty()) {
+			counters->cond.wait_for(lockCounters, std::chrono::milliseconds(10));
+			snapshot = Snapshot(frame, toBGR);
+		}
+		waited = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (snapshot.empty())
+			return; // Stopped while waiting.
+	}
+
+	const std::wstring path = m_burst_directory + L"\\" + std::to_wstring(info.sequence) + ImageSaver::GetExtension(m_burst_format);
+	double waitedQueue = 0.0;
+	{
+		std::lock_guard lockCounters(counters->mutex);
+		++counters->accepted;
+	}
+	r_saver->post(
+		std::move(snapshot), path, m_burst_format, m_burst_options, true, &waitedQueue,
+		[counters](bool res) -> void {
+			{
+				std::lock_guard lock(counters->mutex);
+				if (res)
+					++counters->saved;
+				else
+					++counters->failed;
+			}
+			counters->cond.notify_all();
+		}
+	);
+	waited += waitedQueue;
+
+	if (waited > 0.0) {
+		std::lock_guard lockCounters(counters->mutex);
+		++counters->stalls;
+		counters->stallSeconds += waited;
+	}
+}
+
+void CapturerBase::RunProbes(const cv::Mat& frame, const FrameInfo& info) {
+	UpdateProbeList(m_probe_frameVersion, m_probe_frameValues);
+	const cv::Rect bounds(0, 0, frame.cols, frame.rows);
+	for (ProbeValue& value : m_probe_frameValues) {
+		value.valid = (value.rect & bounds) == value.rect;
+		if (value.valid)
+			value.color = MeanColor(frame(value.rect));
+	}
+	DeliverProbes(m_probe_frameValues, info);
+}
+
+void CapturerBase::RunWatchers(const cv::Mat& frame, const FrameInfo& info) {
+	m_watch_fired.clear();
+	{
+		std::lock_guard lock(m_mutex_watch);
+		m_watcher.process(frame, m_watch_fired);
+		m_watch_bytes = m_watcher.getBytes();
+	}
+	if (m_watch_fired.empty())
+		return;
+	std::shared_ptr<DeliveryThread> delivery = GetDelivery();
+	if (!delivery) {
+		for (const RegionWatcher::Fired& fired : m_watch_fired)
+			(*fired.callback)(fired.change, info);
+		return;
+	}
+	// Like probe values, changes are small and never dropped.
+	delivery->post(
+		[copied = m_watch_fired, info]() -> void {
+			for (const RegionWatcher::Fired& fired : copied)
+				(*fired.callback)(fired.change, info);
+		},
+		false
+	);
+}
+
+void CapturerBase::RunViews(const cv::Mat& frame, const FrameInfo& info) {
+	std::shared_ptr<DeliveryThread> delivery = GetDelivery();
+	m_view_deliveries.clear();
+	{
+		std::lock_guard lock(m_mutex_view);
+		m_view_fanout.process(frame, delivery != nullptr, m_view_deliveries);
+		m_view_bytes = m_view_fanout.getBytes();
+	}
+	if (m_view_deliveries.empty())
+		return;
+	if (!delivery) {
+		for (const ViewFanout::Delivery& view : m_view_deliveries)
+			(*view.callback)(view.view, info);
+		return;
+	}
+	// The results are new buffers for each frame, so the delivery thread can hold them. Dropped like frames.
+	delivery->post(
+		[copied = m_view_deliveries, info]() -> void {
+			for (const ViewFanout::Delivery& view : copied)
+				(*view.callback)(view.view, info);
+		},
+		true
+	);
+}
+
+void CapturerBase::CallCallback(const cv::Mat& frame, const FrameInfo& info, const MotionMap& motion, LatencyMode mode) {
+	m_cap = frame;
+	m_info = info;
+	m_motion = motion;
+	m_stats_ready = false;
+	RecordLatency(frame, info, mode);
+	if (m_start_waiting)
+		MarkFirstFrame();
+	const int64 start = cv::getTickCount();
+	m_callback(m_cap);
+	ObserveConsumer((cv::getTickCount() - start) / cv::getTickFrequency());
+	ReleasePyramid(); // The frame is only valid in the callback.
+}
+
+void CapturerBase::RecordLatency(const cv::Mat& frame, const FrameInfo& info, LatencyMode mode) {
+	m_latency_pending = false;
+	if (!m_latency_enabled)
+		return;
+	const int64_t now = ILatencyStampCodec::now();
+	std::lock_guard lock(m_mutex_latency);
+	LatencyStamp stamp;
+	if (m_latency_codec.decode(frame, info.scale, stamp))
+		m_latency_recorder.add(mode, (now - stamp.timestamp) / 10000.0); // 100ns to ms.
+	else
+		m_latency_recorder.addUndecoded(mode);
+}
+
+std::shared_ptr<DeliveryThread> CapturerBase::GetDelivery() {
+	std::lock_guard lock(m_mutex_thread);
+	return m_delivery;
+}
+
+std::shared_ptr<PrerollBuffer> CapturerBase::GetPreroll() {
+	std::lock_guard lock(m_mutex_preroll);
+	return m_preroll;
+}
+
+void CapturerBase::ReleasePyramid() {
+	std::shared_ptr<FramePyramid> pyramid;
+	{
+		std::lock_guard lock(m_mutex_cap);
+		pyramid = std::move(m_pyramid);
+	}
+	if (pyramid)
+		pyramid->release(); // Waits for a level being computed from the old frame.
+}
+
+void CapturerBase::ObserveConsumer(double callbackSeconds) {
+	AdaptiveScaleOptions options;
+	{
+		std::lock_guard lock(m_mutex_scale);
+		options = m_scale_options;
+	}
+	if (!options.enabled) {
+		m_scale_lagFrames = 0;
+		m_scale_headroomFrames = 0;
+		return;
+	}
+	std::shared_ptr<DeliveryThread> delivery = GetDelivery();
+	const size_t queued = delivery ? delivery->getQueued() : 0;
+
+	const bool lag = callbackSeconds > options.callbackBudget || queued > options.maxQueuedFrames;
+	const bool headroom = callbackSeconds < options.callbackBudget * options.headroomRatio && queued == 0;
+	m_scale_lagFrames = lag ? m_scale_lagFrames + 1 : 0;
+	m_scale_headroomFrames = headroom ? m_scale_headroomFrames + 1 : 0;
+
+	// Between the two thresholds the scale stays, so it does not flip back and forth.
+	int level = m_scale_level;
+	if (m_scale_lagFrames >= options.stepDownFrames) {
+		if (level + 1 < AdaptiveScaleCount && AdaptiveScales[level + 1] >= options.minScale)
+			++level;
+		m_scale_lagFrames = 0;
+	}
+	else if (m_scale_headroomFrames >= options.stepUpFrames) {
+		if (level > 0)
+			--level;
+		m_scale_headroomFrames = 0;
+	}
+	m_scale_level = level;
+}
+
+void CapturerBase::ComputeStats(cv::Mat* target, bool convertToBGR) {
+	const cv::Rect bounds(0, 0, m_cap.cols, m_cap.rows);
+	const bool bgra = m_cap.type() == CV_8UC4;
+	m_stats_rects.clear();
+	for (RegionStats& region : m_stats) {
+		const cv::Rect rect = region.rect;
+		const int id = region.id;
+		region = {};
+		region.id = id;
+		region.rect = rect;
+		region.valid = bgra && (rect & bounds) == rect;
+		if (region.valid)
+			m_stats_rects.push_back(rect);
+	}
+	m_stats_accs.resize(m_stats_rects.size());
+
+	if (bgra)
+		AccumulateStats(m_cap, m_stats_rects, m_stats_accs, target, convertToBGR);
+	else if (target && convertToBGR)
+		cv::cvtColor(m_cap, *target, cv::ColorConversionCodes::COLOR_BGRA2BGR, 3);
+	else if (target)
+		m_cap.copyTo(*target);
+
+	size_t i = 0;
+	for (RegionStats& region : m_stats) {
+		if (region.valid)
+			m_stats_accs[i++].get(region);
+	}
+	m_stats_ready = true;
+}
+
+} // namespace wgc
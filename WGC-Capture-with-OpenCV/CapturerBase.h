@@ -0,0 +1,375 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include "include/WGC/WGC.h"
+#include "FramePool.h"
+#include "ImageSaver.h"
+#include "StatsAccumulator.h"
+#include "FrameGraph.h"
+#include "DeliveryThread.h"
+#include "BudgetTracker.h"
+#include "MotionEstimator.h"
+#include "PrerollBuffer.h"
+#include "LatencyStampCodec.h"
+#include "LatencyRecorder.h"
+#include "RegionWatcher.h"
+#include "FramePyramid.h"
+#include "ViewFanout.h"
+
+namespace wgc {
+
+/**
+ * @brief 截取器的公共部分：保存帧，并交给轮询或回调。
+*/
+class CapturerBase :
+	public ICapturer {
+protected:
+	CapturerBase(size_t id, std::shared_ptr<ImageSaver> saver, std::shared_ptr<BudgetTracker> budget);
+
+public:
+	virtual ~CapturerBase();
+
+public:
+	virtual void askForRefresh() override;
+	virtual bool isRefreshed() override;
+
+	virtual void copyMatTo(cv::Mat& target, bool convertToBGR = false) override;
+	virtual bool runGraph(IFrameGraph& graph, std::vector<cv::Mat>& outputs) override;
+	virtual FrameInfo getFrameInfo() override;
+	virtual bool acquireFrame(cv::Mat& frame, FrameInfo* info = nullptr, bool convertToBGR = false) override;
+
+	virtual std::future<bool> saveFrameAsync(const std::wstring& path, ImageFormat format, const SaveOptions& options = {}) override;
+	virtual bool startBurstSave(const std::wstring& directory, double seconds, ImageFormat format, const SaveOptions& options = {}) override;
+	virtual void stopBurstSave() override;
+	virtual BurstStatus getBurstStatus() override;
+
+	virtual int addProbe(const cv::Point& point) override;
+	virtual int addProbe(const cv::Rect& rect) override;
+	virtual bool removeProbe(int id) override;
+	virtual void setProbeCallback(ProbeCallback cb, bool changedOnly = true) override;
+	virtual std::vector<ProbeValue> getProbeValues() override;
+
+	virtual int addStatRegion(const cv::Rect& rect) override;
+	virtual bool removeStatRegion(int id) override;
+	virtual std::vector<RegionStats> getRegionStats() override;
+
+	virtual bool setThreadingPolicy(const ThreadingPolicy& policy) override;
+	virtual std::vector<ThreadTimes> getThreadTimes() override;
+
+	virtual void setFrameMemory(std::shared_ptr<IFrameMemory> memory) override;
+	virtual CapturerMemory getMemoryUsage() override;
+	virtual void setAdaptiveScale(const AdaptiveScaleOptions& options) override;
+
+	virtual bool setMotionMap(const MotionOptions& options) override;
+	virtual MotionMap getMotionMap() override;
+
+	virtual bool setPreroll(const PrerollOptions& options) override;
+	virtual std::future<bool> dumpPreroll(const std::wstring& path) override;
+	virtual PrerollStatus getPrerollStatus() override;
+
+	virtual CaptureStartTimes getStartTimes() override;
+
+	virtual bool setLatencyProbe(const LatencyProbeOptions& options) override;
+	virtual std::vector<LatencyStats> getLatencyStats() override;
+	virtual void resetLatencyStats() override;
+
+	virtual int watchRegion(const cv::Rect& rect, double threshold, RegionCallback callback) override;
+	virtual bool unwatchRegion(int id) override;
+
+	virtual std::shared_ptr<IFramePyramid> getPyramid() override;
+
+	virtual int subscribeView(const ViewOptions& options, ViewCallback callback) override;
+	virtual bool unsubscribeView(int id) override;
+
+	virtual size_t getId() const override;
+
+public:
+	/**
+	 * @brief 向预算报告用量，并在预算或降级状态变化后应用策略。每帧结束时调用，工厂也会调用。
+	*/
+	void ApplyMemoryBudget();
+
+protected:
+	/**
+	 * @brief 若用户请求了新帧，则清除该请求并返回true。
+	*/
+	bool TakeRefreshRequest();
+	/**
+	 * @brief 轮询模式：在锁内保存帧，并设置updated。
+	*/
+	void DeliverFrame(const cv::Mat& frame, const FrameInfo& info);
+	/**
+	 * @brief 轮询模式：读回线程改写或释放m_cap引用的内存之前调用，清空m_cap并放开其金字塔。
+	*/
+	void DetachFrame();
+	/**
+	 * @brief 回调模式：保存帧并调用回调。不锁mat，不管needRefresh，也不设置updated。
+	 * @brief 有投递线程时，把帧复制到池中的缓冲，交给投递线程。
+	*/
+	void DeliverFrameToCallback(const cv::Mat& frame, const FrameInfo& info);
+
+	/**
+	 * @brief 在读回帧的线程上、每帧开始时调用：记录该线程，并在策略变化后设置它。
+	 * @param owned: 线程是否属于系统或本截取器。用户自己的线程（非自由线程模式）不设置。
+	*/
+	void EnterCaptureThread(bool owned);
+	/**
+	 * @brief 开始截取前调用：按策略创建、重建或销毁投递线程，并忘记运动图的上一帧。
+	*/
+	void StartDelivery();
+	/**
+	 * @brief 停止截取后调用：丢弃排队的回调，并等待正在运行的回调结束。
+	*/
+	void StopDelivery();
+	/**
+	 * @brief 开始截取的函数在停止之前的截取后调用：记录开始的时间，并等待第一帧。
+	*/
+	void BeginStart();
+	/**
+	 * @brief 开始截取的函数成功返回前调用。
+	 * @param waitSeconds: 其中等待工厂创建设备的秒数。
+	*/
+	void EndStart(double waitSeconds);
+	/**
+	 * @brief 第一帧交给用户时调用。
+	*/
+	void MarkFirstFrame();
+
+	/**
+	 * @brief 预算或自适应要求缩小输出时，把帧缩小到池中的缓冲，并修改info中的尺寸和比例。否则原样返回。
+	 * @brief 已按info.scale缩小读回的帧只缩小剩下的部分。
+	*/
+	cv::Mat ScaleOutput(const cv::Mat& frame, FrameInfo& info);
+	/**
+	 * @brief 预算和自适应要求的输出比例。
+	*/
+	double GetOutputScale() const;
+	/**
+	 * @brief 是否有功能需要原尺寸的帧（帧的功能、探针、运动图）。没有时可以只读回缩小的帧。
+	*/
+	bool NeedsFullFrame() const;
+
+	/**
+	 * @brief 是否有功能需要每一帧（即使用户没有请求）。
+	*/
+	bool HasFrameSinks() const;
+	/**
+	 * @brief 把读回的每一帧交给需要它的功能。应在交给用户之前调用。
+	*/
+	void RunFrameSinks(const cv::Mat& frame, const FrameInfo& info);
+
+	/**
+	 * @brief 从池中取缓冲并复制（可同时转为BGR）。池满时返回空的cv::Mat。
+	*/
+	cv::Mat Snapshot(const cv::Mat& frame, bool convertToBGR);
+
+	/**
+	 * @brief 是否有探针。没有完整读回的帧也需要读探针。
+	*/
+	bool HasProbes() const;
+	/**
+	 * @brief 若探针列表在version之后变过，则更新version，并以id和rect填充values后返回true。
+	*/
+	bool UpdateProbeList(uint64_t& version, std::vector<ProbeValue>& values);
+	/**
+	 * @brief 与上一帧比较并保存探针的值，然后调用回调。values须由UpdateProbeList填充，并已设置color和valid。
+	*/
+	void DeliverProbes(std::vector<ProbeValue>& values, const FrameInfo& info);
+	/**
+	 * @brief 求BGRA区域的平均颜色。
+	*/
+	static cv::Vec4b MeanColor(const cv::Mat& area);
+
+protected:
+	/**
+	 * @brief 连续保存的计数，由编码线程更新，可能比截取器活得久。
+	*/
+	struct BurstCounters {
+		std::mutex mutex;
+		std::condition_variable cond;
+		size_t accepted = 0;
+		size_t saved = 0;
+		size_t failed = 0;
+		size_t stalls = 0;
+		double stallSeconds = 0.0;
+	};
+
+	void RunBurst(const cv::Mat& frame, const FrameInfo& info);
+	/**
+	 * @brief 探针及其最新的值。
+	*/
+	struct Probe {
+		ProbeValue value;
+		bool delivered; // 已有过一次值。
+	};
+
+	void RunProbes(const cv::Mat& frame, const FrameInfo& info);
+	/**
+	 * @brief 与上一帧比较监视的区域，并调用变化超过阈值的区域的回调。
+	*/
+	void RunWatchers(const cv::Mat& frame, const FrameInfo& info);
+	/**
+	 * @brief 计算订阅者的视图，并调用它们的回调。
+	*/
+	void RunViews(const cv::Mat& frame, const FrameInfo& info);
+	void CallCallback(const cv::Mat& frame, const FrameInfo& info, const MotionMap& motion, LatencyMode mode);
+	/**
+	 * @brief 帧交给用户时调用：启用延迟探针时解码戳并记录延迟。轮询模式下在m_mutex_cap内调用。
+	*/
+	void RecordLatency(const cv::Mat& frame, const FrameInfo& info, LatencyMode mode);
+	/**
+	 * @brief 交给用户前调用：启用时与上一次交出的帧比较。须用原尺寸的帧。
+	*/
+	MotionMap RunMotion(const cv::Mat& frame);
+	std::shared_ptr<DeliveryThread> GetDelivery();
+	std::shared_ptr<PrerollBuffer> GetPreroll();
+	/**
+	 * @brief m_cap被替换或失效后调用：放开旧帧的金字塔。
+	*/
+	void ReleasePyramid();
+	/**
+	 * @brief 每次回调后在回调线程上调用：按回调耗时和排队帧数调整自适应比例。
+	*/
+	void ObserveConsumer(double callbackSeconds);
+
+	/**
+	 * @brief 用过的读回线程。句柄用于查询CPU时间，析构时关闭。
+	*/
+	struct CaptureThread {
+		DWORD id;
+		HANDLE handle;
+		double userBase;   // 第一次使用时的CPU时间。
+		double kernelBase;
+		uint64_t frames;
+		uint64_t policyVersion; // 已应用的策略版本。
+	};
+	/**
+	 * @brief 在锁内调用。统计m_cap中的各区域，target不为nullptr时同时复制过去。
+	*/
+	void ComputeStats(cv::Mat* target, bool convertToBGR);
+
+protected:
+	size_t m_id;
+
+	std::atomic<bool> m_img_needRefresh;
+	std::atomic<bool> m_img_updated;
+	std::function<void(const cv::Mat&)> m_callback;
+
+	FrameInfo m_info;
+	cv::Mat m_cap;
+	MotionMap m_motion; // m_cap的运动图。
+	std::shared_ptr<FramePyramid> m_pyramid; // m_cap的金字塔，第一次请求时创建。
+	std::mutex m_mutex_cap;
+
+	std::shared_ptr<ImageSaver> r_saver;
+	FramePool m_pool;
+	FrameGraph m_graph_bgr; // copyMatTo()转为BGR的内置图，受m_mutex_cap保护。
+	std::shared_ptr<IFrameMemory> m_memory; // copyMatTo()的目标从它分配，受m_mutex_cap保护。
+
+	std::atomic<bool> m_burst_running;
+	std::mutex m_mutex_burst;
+	std::wstring m_burst_directory;
+	ImageFormat m_burst_format;
+	SaveOptions m_burst_options;
+	std::chrono::steady_clock::time_point m_burst_deadline;
+	std::shared_ptr<BurstCounters> m_burst_counters;
+
+	std::atomic<bool> m_probe_any;
+	std::mutex m_mutex_probe;
+	std::vector<Probe> m_probes; // 按添加顺序。
+	uint64_t m_probe_version;         // 探针列表每次变化时加一。
+	int m_probe_nextId;
+	std::shared_ptr<const ProbeCallback> m_probe_callback; // 复制指针后在锁外调用。
+	bool m_probe_changedOnly;
+	uint64_t m_probe_frameVersion;            // 完整帧路径用的探针列表版本。
+	std::vector<ProbeValue> m_probe_frameValues;
+	std::vector<ProbeValue> m_probe_changed; // 仅传变化值时的临时数组。
+
+	std::vector<RegionStats> m_stats; // 统计区域及m_cap的统计值，受m_mutex_cap保护。
+	std::vector<cv::Rect> m_stats_rects; // 本帧参与统计的区域。
+	std::vector<StatsAccumulator> m_stats_accs;
+	bool m_stats_ready; // m_stats已是m_cap的统计值。
+	int m_stats_nextId;
+
+	std::mutex m_mutex_thread;
+	ThreadingPolicy m_thread_policy;
+	uint64_t m_thread_policyVersion; // 每次设置策略时加一，0表示从未设置。
+	std::vector<CaptureThread> m_thread_capture;
+	std::shared_ptr<DeliveryThread> m_delivery; // 帧的读回线程也持有它，所以用shared_ptr。
+	uint64_t m_delivery_policyVersion;
+
+	std::shared_ptr<BudgetTracker> r_budget;
+	std::mutex m_mutex_budget;
+	std::atomic<uint64_t> m_budget_generation; // 已应用的预算状态，UINT64_MAX表示需要重新应用。
+	std::atomic<bool> m_budget_degraded;
+	std::atomic<bool> m_budget_evict;
+	std::atomic<bool> m_budget_half;  // 输出缩小一半。
+	std::atomic<size_t> m_pool_maxBuffers; // 不降级时池的上限。
+	std::atomic<size_t> m_staging_bytes;   // 读回用的纹理，由派生类更新。
+
+	std::mutex m_mutex_scale;
+	AdaptiveScaleOptions m_scale_options;
+	std::atomic<int> m_scale_level; // 自适应比例在AdaptiveScales中的序号。
+	int m_scale_lagFrames;          // 连续落后的帧数，仅在回调线程上使用。
+	int m_scale_headroomFrames;     // 连续有余量的帧数。
+
+	std::atomic<bool> m_motion_enabled;
+	std::mutex m_mutex_motion;
+	MotionEstimator m_motion_estimator; // 受m_mutex_motion保护。
+	std::atomic<size_t> m_motion_bytes; // 上一帧占用的字节数。
+
+	std::atomic<bool> m_preroll_any;
+	std::mutex m_mutex_preroll;
+	std::shared_ptr<PrerollBuffer> m_preroll; // 读回线程和转储也持有它，所以用shared_ptr。
+
+	std::mutex m_mutex_start;
+	CaptureStartTimes m_start_times;
+	std::chrono::steady_clock::time_point m_start_begin; // 最近一次开始截取的时间。
+	std::atomic<bool> m_start_waiting; // 还没有交给用户第一帧。
+
+	std::atomic<bool> m_latency_enabled;
+	bool m_latency_pending; // m_cap还没有记录延迟，受m_mutex_cap保护。
+	std::mutex m_mutex_latency;
+	LatencyStampCodec m_latency_codec; // 受m_mutex_latency保护。
+	LatencyRecorder m_latency_recorder;
+
+	std::atomic<bool> m_watch_any;
+	std::mutex m_mutex_watch;
+	RegionWatcher m_watcher; // 受m_mutex_watch保护。
+	std::atomic<size_t> m_watch_bytes; // 上一帧占用的字节数。
+	std::vector<RegionWatcher::Fired> m_watch_fired; // 仅在读回线程上使用。
+
+	std::atomic<bool> m_view_any;
+	std::mutex m_mutex_view;
+	ViewFanout m_view_fanout; // 受m_mutex_view保护。
+	std::atomic<size_t> m_view_bytes; // 视图的输出和中间结果占用的字节数。
+	std::vector<ViewFanout::Delivery> m_view_deliveries; // 仅在读回线程上使用。
+};
+
+} // namespace wgc
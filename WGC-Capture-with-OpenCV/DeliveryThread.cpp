@@ -0,0 +1,201 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "DeliveryThread.h"
+
+#include <stdexcept>
+
+namespace {
+
+double FileTimeToSeconds(const FILETIME& time) {
+	ULARGE_INTEGER value;
+	value.LowPart = time.dwLowDateTime;
+	value.HighPart = time.dwHighDateTime;
+	return static_cast<double>(value.QuadPart) * 1e-7; // 100ns为单位。
+}
+
+bool IsValidPriority(int priority) {
+	switch (priority) {
+	case THREAD_PRIORITY_IDLE:
+	case THREAD_PRIORITY_LOWEST:
+	case THREAD_PRIORITY_BELOW_NORMAL:
+	case THREAD_PRIORITY_NORMAL:
+	case THREAD_PRIORITY_ABOVE_NORMAL:
+	case THREAD_PRIORITY_HIGHEST:
+	case THREAD_PRIORITY_TIME_CRITICAL:
+		return true;
+	default:
+		return false;
+	}
+}
+
+} // namespace
+
+namespace wgc {
+
+bool IsValidThreadingPolicy(const ThreadingPolicy& policy) {
+	DWORD_PTR processMask = 0;
+	DWORD_PTR systemMask = 0;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+		return false;
+	const uint64_t available = static_cast<uint64_t>(processMask);
+	if (policy.deliveryQueueDepth == 0)
+		return false;
+	if ((policy.captureAffinity & ~available) != 0 || (policy.deliveryAffinity & ~available) != 0)
+		return false;
+	return IsValidPriority(policy.capturePriority) && IsValidPriority(policy.deliveryPriority);
+}
+
+void ApplyThreadSettings(HANDLE thread, uint64_t affinity, int priority) {
+	if (affinity != 0)
+		SetThreadAffinityMask(thread, static_cast<DWORD_PTR>(affinity));
+	SetThreadPriority(thread, priority);
+}
+
+bool QueryThreadTimes(HANDLE thread, double& userSeconds, double& kernelSeconds) {
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(thread, &creation, &exit, &kernel, &user))
+		return false;
+	userSeconds = FileTimeToSeconds(user);
+	kernelSeconds = FileTimeToSeconds(kernel);
+	return true;
+}
+
+DeliveryThread::DeliveryThread(size_t depth, uint64_t affinity, int priority) :
+	m_depth(depth),
+	m_depthNormal(depth),
+	m_affinity(affinity),
+	m_priority(priority),
+
+	m_droppable(0),
+	m_busy(false),
+	m_stop(false),
+	m_frames(0),
+	m_dropped(0) {
+	if (m_depth == 0)
+		throw std::invalid_argument("DeliveryThread: depth must be positive.");
+	m_thread = std::thread(&DeliveryThread::Loop, this);
+}
+
+DeliveryThread::~DeliveryThread() {
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+		m_tasks.clear();
+		m_droppable = 0;
+	}
+	m_cond_task.notify_all();
+	m_thread.join();
+}
+
+void DeliveryThread::post(std::function<void()> task, bool droppable) {
+	{
+		std::lock_guard lock(m_mutex);
+		if (droppable) {
+			for (auto it = m_tasks.begin(); m_droppable >= m_depth && it != m_tasks.end();) {
+				if (it->droppable) {
+					it = m_tasks.erase(it);
+					--m_droppable;
+					++m_dropped;
+				}
+				else {
+					++it;
+				}
+			}
+			++m_droppable;
+		}
+		m_tasks.push_back({ std::move(task), droppable });
+	}
+	m_cond_task.notify_one();
+}
+
+void DeliveryThread::clear() {
+	std::unique_lock lock(m_mutex);
+	m_tasks.clear();
+	m_droppable = 0;
+	if (isCurrentThread())
+		return;
+	m_cond_idle.wait(lock, [this]() -> bool { return !m_busy; });
+}
+
+void DeliveryThread::addDropped() {
+	std::lock_guard lock(m_mutex);
+	++m_dropped;
+}
+
+void DeliveryThread::setReduced(bool reduced) {
+	std::lock_guard lock(m_mutex);
+	m_depth = reduced ? 1 : m_depthNormal;
+}
+
+size_t DeliveryThread::getQueued() {
+	std::lock_guard lock(m_mutex);
+	return m_droppable;
+}
+
+bool DeliveryThread::isCurrentThread() const {
+	return m_thread.get_id() == std::this_thread::get_id();
+}
+
+ThreadTimes DeliveryThread::getTimes() {
+	ThreadTimes times = {};
+	times.role = ThreadRole::Delivery;
+	times.threadId = GetThreadId(m_thread.native_handle());
+	QueryThreadTimes(m_thread.native_handle(), times.userSeconds, times.kernelSeconds);
+	std::lock_guard lock(m_mutex);
+	times.frames = m_frames;
+	times.dropped = m_dropped;
+	return times;
+}
+
+void DeliveryThread::Loop() {
+	ApplyThreadSettings(GetCurrentThread(), m_affinity, m_priority);
+	while (true) {
+		Task task;
+		{
+			std::unique_lock lock(m_mutex);
+			m_cond_task.wait(lock, [this]() -> bool { return m_stop || !m_tasks.empty(); });
+			if (m_stop)
+				return;
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+			if (task.droppable)
+				--m_droppable;
+			m_busy = true;
+		}
+
+		try {
+			task.fn();
+		}
+		catch (...) {} // Nothing to report it to, like a callback on the system's thread.
+		task.fn = nullptr; // Release the frame before it counts as done.
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_busy = false;
+			if (task.droppable)
+				++m_frames;
+		}
+		m_cond_idle.notify_all();
+	}
+}
+
+} // namespace wgc
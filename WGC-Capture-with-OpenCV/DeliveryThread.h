@@ -0,0 +1,115 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+#include "include/WGC/WGC.h"
+
+namespace wgc {
+
+/**
+ * @brief 检查策略中的CPU掩码是否在进程可用的CPU之内，优先级是否有效。
+*/
+bool IsValidThreadingPolicy(const ThreadingPolicy& policy);
+/**
+ * @brief 设置线程的CPU掩码（0表示不变）和优先级。
+*/
+void ApplyThreadSettings(HANDLE thread, uint64_t affinity, int priority);
+/**
+ * @brief 查询线程的用户态和内核态CPU时间，单位秒。
+*/
+bool QueryThreadTimes(HANDLE thread, double& userSeconds, double& kernelSeconds);
+
+/**
+ * @brief 投递线程：截取器自己的线程，在上面运行用户回调，使其不占用读回帧的线程。
+*/
+class DeliveryThread final {
+public:
+	/**
+	 * @brief This function may throws.
+	 * @param depth: 可丢弃任务的排队上限，满时丢弃最早的一个。
+	*/
+	DeliveryThread(size_t depth, uint64_t affinity, int priority);
+
+	~DeliveryThread();
+
+public:
+	/**
+	 * @brief 提交一个任务。可丢弃的任务（帧）在队列满时顶掉最早的可丢弃任务；不可丢弃的（探针）总是排队。
+	*/
+	void post(std::function<void()> task, bool droppable);
+	/**
+	 * @brief 丢弃排队的任务，并等待正在运行的任务结束。在本线程上调用时不等待。
+	*/
+	void clear();
+	/**
+	 * @brief 记一帧丢弃（没有缓冲可复制时）。
+	*/
+	void addDropped();
+	/**
+	 * @brief 内存紧张时只排一帧，否则恢复构造时的上限。
+	*/
+	void setReduced(bool reduced);
+	/**
+	 * @brief 排队等待的帧数。
+	*/
+	size_t getQueued();
+
+	bool isCurrentThread() const;
+	/**
+	 * @brief 本线程的CPU时间及处理、丢弃的帧数。
+	*/
+	ThreadTimes getTimes();
+
+protected:
+	void Loop();
+
+protected:
+	struct Task {
+		std::function<void()> fn;
+		bool droppable;
+	};
+
+	size_t m_depth;
+	size_t m_depthNormal;
+	uint64_t m_affinity;
+	int m_priority;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cond_task; // 有任务或要停止。
+	std::condition_variable m_cond_idle; // 一个任务运行完。
+	std::deque<Task> m_tasks;
+	size_t m_droppable; // 队列中可丢弃任务的数量。
+	bool m_busy;
+	bool m_stop;
+	uint64_t m_frames;
+	uint64_t m_dropped;
+
+	std::thread m_thread;
+};
+
+} // namespace wgc
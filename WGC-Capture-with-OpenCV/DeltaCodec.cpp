@@ -0,0 +1,332 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "DeltaCodec.h"
+#include "FastLz.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace {
+
+constexpr int MaxTileSize = 1024;
+constexpr int MaxFrameSide = 32768;
+
+inline int DivUp(int value, int divisor) {
+	return (value + divisor - 1) / divisor;
+}
+
+inline size_t BitmapBytes(int tileCols) {
+	return (static_cast<size_t>(tileCols) + 7) / 8;
+}
+
+inline void XorRow(uint8_t* dst, const uint8_t* a, const uint8_t* b, size_t size) {
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t x, y;
+		std::memcpy(&x, a + i, 8);
+		std::memcpy(&y, b + i, 8);
+		x ^= y;
+		std::memcpy(dst + i, &x, 8);
+	}
+	for (; i < size; ++i)
+		dst[i] = a[i] ^ b[i];
+}
+
+} // namespace
+
+namespace wgc {
+
+std::shared_ptr<IDeltaEncoder> IDeltaEncoder::createInstance(const DeltaCodecOptions& options) noexcept {
+	if (options.tileSize < 8 || options.tileSize > MaxTileSize || options.keyframeInterval < 0)
+		return nullptr;
+	try {
+		return std::make_shared<DeltaEncoder>(options);
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+std::shared_ptr<IDeltaDecoder> IDeltaDecoder::createInstance() noexcept {
+	try {
+		return std::make_shared<DeltaDecoder>();
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+bool IDeltaDecoder::isKeyframe(const uint8_t* data, size_t size) noexcept {
+	if (data == nullptr || size < sizeof(DeltaFrameHeader))
+		return false;
+	DeltaFrameHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	return header.magic == DeltaFrameMagic && (header.flags & DeltaFrameKeyframe);
+}
+
+DeltaEncoder::DeltaEncoder(const DeltaCodecOptions& options) :
+	m_options(options),
+	m_sinceKeyframe(0) {}
+
+bool DeltaEncoder::encode(const cv::Mat& frame, std::vector<uint8_t>& out, bool forceKeyframe) {
+	if (frame.empty() || frame.depth() != CV_8U || frame.channels() > 4 ||
+		frame.cols > MaxFrameSide || frame.rows > MaxFrameSide)
+		return false;
+
+	const bool keyframe =
+		forceKeyframe ||
+		m_prev.empty() ||
+		m_prev.size() != frame.size() ||
+		m_prev.type() != frame.type() ||
+		(m_options.keyframeInterval > 0 && m_sinceKeyframe >= m_options.keyframeInterval);
+	if (keyframe) {
+		m_prev.create(frame.size(), frame.type());
+		m_sinceKeyframe = 0;
+	}
+	++m_sinceKeyframe;
+
+	const int tileRows = DivUp(frame.rows, m_options.tileSize);
+	m_bands.resize(tileRows);
+	cv::parallel_for_(
+		cv::Range(0, tileRows),
+		[this, &frame, keyframe](const cv::Range& range) -> void {
+			for (int band = range.start; band < range.end; ++band)
+				EncodeBand(frame, band, keyframe);
+		}
+	);
+
+	size_t total = sizeof(DeltaFrameHeader) + sizeof(DeltaBandHeader) * tileRows;
+	for (int band = 0; band < tileRows; ++band)
+		total += m_bands[band].packed.size();
+	out.resize(total);
+
+	DeltaFrameHeader header;
+	header.magic = DeltaFrameMagic;
+	header.version = DeltaFrameVersion;
+	header.flags = keyframe ? DeltaFrameKeyframe : 0;
+	header.tileSize = static_cast<uint16_t>(m_options.tileSize);
+	header.width = frame.cols;
+	header.height = frame.rows;
+	header.type = frame.type();
+	header.bandCount = static_cast<uint32_t>(tileRows);
+	std::memcpy(out.data(), &header, sizeof(header));
+
+	uint8_t* table = out.data() + sizeof(DeltaFrameHeader);
+	uint8_t* payload = table + sizeof(DeltaBandHeader) * tileRows;
+	m_changed.clear();
+	for (int band = 0; band < tileRows; ++band) {
+		const Band& b = m_bands[band];
+		DeltaBandHeader bandHeader;
+		bandHeader.rawSize = static_cast<uint32_t>(b.raw.size());
+		bandHeader.packedSize = static_cast<uint32_t>(b.packed.size());
+		std::memcpy(table + sizeof(DeltaBandHeader) * band, &bandHeader, sizeof(bandHeader));
+		std::memcpy(payload, b.packed.data(), b.packed.size());
+		payload += b.packed.size();
+		m_changed.insert(m_changed.end(), b.changed.begin(), b.changed.end());
+	}
+	return true;
+}
+
+const std::vector<cv::Rect>& DeltaEncoder::getChangedTiles() const {
+	return m_changed;
+}
+
+void DeltaEncoder::reset() {
+	m_prev.release();
+	m_sinceKeyframe = 0;
+}
+
+void DeltaEncoder::EncodeBand(const cv::Mat& frame, int band, bool keyframe) {
+	const int tileSize = m_options.tileSize;
+	const int tileCols = DivUp(frame.cols, tileSize);
+	const size_t elemSize = frame.elemSize();
+	const int y0 = band * tileSize;
+	const int th = std::min(tileSize, frame.rows - y0);
+	const size_t bitmapBytes = BitmapBytes(tileCols);
+
+	Band& b = m_bands[band];
+	b.raw.resize(bitmapBytes + static_cast<size_t>(frame.cols) * th * elemSize);
+	b.changed.clear();
+	uint8_t* bitmap = b.raw.data();
+	uint8_t* op = bitmap + bitmapBytes;
+	std::memset(bitmap, 0, bitmapBytes);
+
+	for (int tx = 0; tx < tileCols; ++tx) {
+		const int x0 = tx * tileSize;
+		const int tw = std::min(tileSize, frame.cols - x0);
+		const size_t offset = x0 * elemSize;
+		const size_t rowBytes = tw * elemSize;
+
+		bool changed = keyframe;
+		int y = y0;
+		if (!changed) {
+			for (; y < y0 + th; ++y) {
+				if (std::memcmp(frame.ptr(y) + offset, m_prev.ptr(y) + offset, rowBytes) != 0) {
+					changed = true;
+					break;
+				}
+			}
+			if (!changed)
+				continue;
+			// Rows before 'y' are equal, their residual is zero.
+			std::memset(op, 0, (y - y0) * rowBytes);
+			op += (y - y0) * rowBytes;
+		}
+
+		bitmap[tx >> 3] |= static_cast<uint8_t>(1u << (tx & 7));
+		b.changed.emplace_back(x0, y0, tw, th);
+		for (; y < y0 + th; ++y) {
+			const uint8_t* cur = frame.ptr(y) + offset;
+			uint8_t* prev = m_prev.ptr(y) + offset;
+			if (keyframe)
+				std::memcpy(op, cur, rowBytes);
+			else
+				XorRow(op, cur, prev, rowBytes);
+			std::memcpy(prev, cur, rowBytes);
+			op += rowBytes;
+		}
+	}
+
+	b.raw.resize(op - b.raw.data());
+	b.packed.resize(fastlz::Bound(b.raw.size()));
+	b.packed.resize(fastlz::Compress(b.raw.data(), b.raw.size(), b.packed.data()));
+}
+
+DeltaDecoder::DeltaDecoder() {}
+
+bool DeltaDecoder::decode(const uint8_t* data, size_t size, cv::Mat& frame) {
+	if (!DecodeFrame(data, size)) {
+		m_frame.release();
+		return false;
+	}
+	frame = m_frame;
+	return true;
+}
+
+void DeltaDecoder::reset() {
+	m_frame.release();
+}
+
+bool DeltaDecoder::DecodeFrame(const uint8_t* data, size_t size) {
+	DeltaFrameHeader header;
+	if (data == nullptr || size < sizeof(header))
+		return false;
+	std::memcpy(&header, data, sizeof(header));
+
+	if (header.magic != DeltaFrameMagic || header.version != DeltaFrameVersion ||
+		header.tileSize < 1 || header.tileSize > MaxTileSize ||
+		header.width < 1 || header.width > MaxFrameSide ||
+		header.height < 1 || header.height > MaxFrameSide ||
+		CV_MAT_CN(header.type) > 4 || header.type != CV_MAKETYPE(CV_8U, CV_MAT_CN(header.type)) ||
+		header.bandCount != static_cast<uint32_t>(DivUp(header.height, header.tileSize)))
+		return false;
+
+	const bool keyframe = (header.flags & DeltaFrameKeyframe) != 0;
+	if (!keyframe && (m_frame.empty() || m_frame.cols != header.width || m_frame.rows != header.height || m_frame.type() != header.type))
+		return false;
+
+	// Locate and check every band before allocating the frame and decoding them in parallel.
+	// So a forged header cannot make a frame larger than its data can expand to.
+	const size_t tableBytes = sizeof(DeltaBandHeader) * header.bandCount;
+	if (size - sizeof(header) < tableBytes)
+		return false;
+	std::vector<DeltaBandHeader> bands(header.bandCount);
+	std::vector<const uint8_t*> payloads(header.bandCount);
+	std::memcpy(bands.data(), data + sizeof(header), tableBytes);
+	const uint8_t* payload = data + sizeof(header) + tableBytes;
+	size_t remaining = size - sizeof(header) - tableBytes;
+	const size_t bitmapBytes = BitmapBytes(DivUp(header.width, header.tileSize));
+	const size_t elemSize = CV_ELEM_SIZE(header.type);
+	for (uint32_t band = 0; band < header.bandCount; ++band) {
+		const int th = std::min<int>(header.tileSize, header.height - band * header.tileSize);
+		const size_t fullSize = bitmapBytes + static_cast<size_t>(header.width) * th * elemSize;
+		if (bands[band].packedSize > remaining ||
+			bands[band].rawSize < bitmapBytes || bands[band].rawSize > fullSize ||
+			(keyframe && bands[band].rawSize != fullSize) ||
+			!fastlz::CanExpandTo(bands[band].packedSize, bands[band].rawSize))
+			return false;
+		payloads[band] = payload;
+		payload += bands[band].packedSize;
+		remaining -= bands[band].packedSize;
+	}
+
+	if (keyframe)
+		m_frame.create(header.height, header.width, header.type);
+	m_scratch.resize(header.bandCount);
+	std::atomic<bool> failed = false;
+	cv::parallel_for_(
+		cv::Range(0, static_cast<int>(header.bandCount)),
+		[&](const cv::Range& range) -> void {
+			for (int band = range.start; band < range.end && !failed; ++band) {
+				if (!DecodeBand(band, payloads[band], bands[band], header.tileSize, keyframe))
+					failed = true;
+			}
+		}
+	);
+	return !failed;
+}
+
+bool DeltaDecoder::DecodeBand(int band, const uint8_t* packed, const DeltaBandHeader& header, int tileSize, bool keyframe) {
+	const int tileCols = DivUp(m_frame.cols, tileSize);
+	const size_t elemSize = m_frame.elemSize();
+	const int y0 = band * tileSize;
+	const int th = std::min(tileSize, m_frame.rows - y0);
+	const size_t bitmapBytes = BitmapBytes(tileCols);
+
+	std::vector<uint8_t>& raw = m_scratch[band];
+	raw.resize(header.rawSize);
+	size_t written = 0;
+	if (!fastlz::Decompress(packed, header.packedSize, raw.data(), raw.size(), written) || written != raw.size())
+		return false;
+
+	// Check the bitmap matches the size before touching the frame.
+	const uint8_t* bitmap = raw.data();
+	size_t expected = bitmapBytes;
+	for (int tx = 0; tx < tileCols; ++tx) {
+		const bool changed = (bitmap[tx >> 3] >> (tx & 7)) & 1;
+		if (keyframe && !changed)
+			return false;
+		if (changed)
+			expected += std::min(tileSize, m_frame.cols - tx * tileSize) * elemSize * th;
+	}
+	if (expected != raw.size())
+		return false;
+
+	const uint8_t* ip = raw.data() + bitmapBytes;
+	for (int tx = 0; tx < tileCols; ++tx) {
+		if (!((bitmap[tx >> 3] >> (tx & 7)) & 1))
+			continue;
+		const int x0 = tx * tileSize;
+		const size_t offset = x0 * elemSize;
+		const size_t rowBytes = std::min(tileSize, m_frame.cols - x0) * elemSize;
+		for (int y = y0; y < y0 + th; ++y) {
+			uint8_t* dst = m_frame.ptr(y) + offset;
+			if (keyframe)
+				std::memcpy(dst, ip, rowBytes);
+			else
+				XorRow(dst, dst, ip, rowBytes);
+			ip += rowBytes;
+		}
+	}
+	return true;
+}
+
+} // namespace wgc
@@ -0,0 +1,108 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include "include/WGC/DeltaCodec.h"
+
+namespace wgc {
+
+constexpr uint32_t DeltaFrameMagic = 0x44434757; // "WGCD"
+constexpr uint8_t  DeltaFrameVersion = 1;
+constexpr uint8_t  DeltaFrameKeyframe = 0x01;
+
+#pragma pack(push, 1)
+
+/**
+ * @brief 编码帧的头。其后是bandCount个DeltaBandHeader，再其后依次是各条带的压缩数据。
+ * @brief 条带解压后：每个tile一位的位图，再依次是变化的tile（逐行，与上一帧异或，关键帧则为原数据）。
+*/
+struct DeltaFrameHeader {
+	uint32_t magic;
+	uint8_t  version;
+	uint8_t  flags;
+	uint16_t tileSize;
+	int32_t  width;
+	int32_t  height;
+	int32_t  type;
+	uint32_t bandCount;
+};
+
+struct DeltaBandHeader {
+	uint32_t rawSize;
+	uint32_t packedSize;
+};
+
+#pragma pack(pop)
+
+/**
+ * @brief 帧间差分编码器。
+*/
+class DeltaEncoder final :
+	public IDeltaEncoder {
+public:
+	DeltaEncoder(const DeltaCodecOptions& options);
+
+public:
+	virtual bool encode(const cv::Mat& frame, std::vector<uint8_t>& out, bool forceKeyframe = false) override;
+	virtual const std::vector<cv::Rect>& getChangedTiles() const override;
+	virtual void reset() override;
+
+protected:
+	struct Band {
+		std::vector<uint8_t> raw;
+		std::vector<uint8_t> packed;
+		std::vector<cv::Rect> changed;
+	};
+
+	void EncodeBand(const cv::Mat& frame, int band, bool keyframe);
+
+protected:
+	DeltaCodecOptions m_options;
+	cv::Mat m_prev;
+	int m_sinceKeyframe;
+	std::vector<Band> m_bands;
+	std::vector<cv::Rect> m_changed;
+};
+
+/**
+ * @brief 帧间差分解码器。
+*/
+class DeltaDecoder final :
+	public IDeltaDecoder {
+public:
+	DeltaDecoder();
+
+public:
+	virtual bool decode(const uint8_t* data, size_t size, cv::Mat& frame) override;
+	virtual void reset() override;
+
+protected:
+	bool DecodeFrame(const uint8_t* data, size_t size);
+	bool DecodeBand(int band, const uint8_t* packed, const DeltaBandHeader& header, int tileSize, bool keyframe);
+
+protected:
+	cv::Mat m_frame;
+	std::vector<std::vector<uint8_t>> m_scratch;
+};
+
+} // namespace wgc
@@ -0,0 +1,110 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "DeviceLoader.h"
+
+namespace wgc {
+
+DeviceLoader::DeviceLoader(FactoryInit init, double apartmentSeconds) :
+	m_created(std::chrono::steady_clock::now()),
+	m_started(false),
+	m_times(),
+	m_mtaCookie(nullptr),
+	m_ready(m_promise.get_future().share()) {
+	m_times.apartmentSeconds = apartmentSeconds;
+	switch (init) {
+	case FactoryInit::Immediate:
+		TakeStart();
+		Load();
+		if (m_error)
+			std::rethrow_exception(m_error);
+		break;
+	case FactoryInit::Background:
+		whenReady();
+		break;
+	case FactoryInit::Lazy:
+		break;
+	}
+}
+
+DeviceLoader::~DeviceLoader() {
+	if (m_thread.joinable())
+		m_thread.join();
+	m_device.reset();
+	if (m_mtaCookie != nullptr)
+		CoDecrementMTAUsage(m_mtaCookie);
+}
+
+std::shared_ptr<GraphicsDevice> DeviceLoader::get() {
+	if (TakeStart())
+		Load();
+	m_ready.wait();
+	return m_device;
+}
+
+std::shared_future<bool> DeviceLoader::whenReady() {
+	if (TakeStart()) {
+		// The thread joins the MTA, so the caller may be in any apartment.
+		if (FAILED(CoIncrementMTAUsage(&m_mtaCookie)))
+			m_mtaCookie = nullptr;
+		try {
+			m_thread = std::thread(&DeviceLoader::Load, this);
+		}
+		catch (...) {
+			Load(); // No thread, the future must still become ready.
+		}
+	}
+	return m_ready;
+}
+
+StartupTimes DeviceLoader::getTimes() {
+	std::lock_guard lock(m_mutex);
+	return m_times;
+}
+
+bool DeviceLoader::TakeStart() {
+	std::lock_guard lock(m_mutex);
+	if (m_started)
+		return false;
+	m_started = true;
+	return true;
+}
+
+void DeviceLoader::Load() {
+	StartupTimes times = {};
+	try {
+		m_device = std::make_shared<GraphicsDevice>(times);
+	}
+	catch (...) {
+		m_error = std::current_exception();
+	}
+	{
+		std::lock_guard lock(m_mutex);
+		m_times.deviceSeconds = times.deviceSeconds;
+		m_times.interopSeconds = times.interopSeconds;
+		m_times.readySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_created).count();
+		m_times.ready = m_device != nullptr;
+		m_times.failed = m_device == nullptr;
+	}
+	m_promise.set_value(m_device != nullptr);
+}
+
+} // namespace wgc
@@ -0,0 +1,82 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <mutex>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <exception>
+#include "include/WGC/WGC.h"
+#include "GraphicsDevice.h"
+
+namespace wgc {
+
+/**
+ * @brief 按FactoryInit在构造时、后台线程上或第一次使用时创建GraphicsDevice。工厂和截取器共同持有它。
+*/
+class DeviceLoader final {
+public:
+	/**
+	 * @brief FactoryInit::Immediate时在此创建设备。
+	 * @brief This function may throws.
+	 * @param apartmentSeconds: 调用者初始化COM的耗时，只用于记录。
+	 */
+	DeviceLoader(FactoryInit init, double apartmentSeconds);
+	~DeviceLoader();
+
+public:
+	/**
+	 * @brief 取得设备。尚未开始创建时在本线程创建，正在后台创建时等待它。
+	 * @return 创建失败时为nullptr。
+	 */
+	std::shared_ptr<GraphicsDevice> get();
+	/**
+	 * @brief 尚未开始创建时在后台线程上创建。
+	 */
+	std::shared_future<bool> whenReady();
+	StartupTimes getTimes();
+
+protected:
+	/**
+	 * @brief 返回true表示调用者须调用Load()或启动后台线程。
+	 */
+	bool TakeStart();
+	void Load();
+
+protected:
+	std::chrono::steady_clock::time_point m_created;
+
+	std::mutex m_mutex;
+	bool m_started;
+	StartupTimes m_times; // 受m_mutex保护。
+	std::thread m_thread; // 后台创建的线程，析构时等待。
+	CO_MTA_USAGE_COOKIE m_mtaCookie; // 后台线程创建的对象在MTA中，在析构前保持MTA。
+
+	std::promise<bool> m_promise;
+	std::shared_future<bool> m_ready;
+	std::shared_ptr<GraphicsDevice> m_device; // 在m_ready就绪前写入，之后只读。
+	std::exception_ptr m_error;
+};
+
+} // namespace wgc
@@ -21,6 +21,9 @@
 #include "pch.h"
 #include "Factory.h"
 #include "Capturer.h"
+#include "ReplayCapturer.h"
+#include "SyntheticCapturer.h"
+#include "DeliveryThread.h"
 
 using namespace winrt;
 using namespace winrt::Windows::Foundation;
@@ -28,58 +31,51 @@ using namespace winrt::Windows::Graphics::Capture;
 
 namespace {
 
-inline auto CreateD3DDevice(
-	D3D_DRIVER_TYPE const type,
-	com_ptr<ID3D11Device>& device
-) {
-	WINRT_ASSERT(!device);
-	constexpr UINT flags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
-	return D3D11CreateDevice(nullptr, type, nullptr, flags, nullptr, 0, D3D11_SDK_VERSION, device.put(), nullptr, nullptr);
-}
-
-inline auto CreateD3DDevice() {
-	com_ptr<ID3D11Device> device;
-	HRESULT hr = CreateD3DDevice(D3D_DRIVER_TYPE_HARDWARE, device);
-	if (DXGI_ERROR_UNSUPPORTED == hr)
-		hr = CreateD3DDevice(D3D_DRIVER_TYPE_WARP, device);
-	check_hresult(hr);
-	return device;
-}
-
-extern "C" {
-	HRESULT __stdcall CreateDirect3D11DeviceFromDXGIDevice(
-		IDXGIDevice* dxgiDevice,
-		::IInspectable** graphicsDevice
-	);
-}
-
-inline auto CreateDirect3DDevice(IDXGIDevice* dxgi_device) {
-	com_ptr<::IInspectable> d3d_device;
-	check_hresult(CreateDirect3D11DeviceFromDXGIDevice(dxgi_device, d3d_device.put()));
-	return d3d_device.as<Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice>();
-}
-
 size_t g_capturerCnt = 0;
 
 } // namespace 
 
 namespace wgc {
 
-Factory::Factory() :
-	m_device(nullptr) {
-	com_ptr<ID3D11Device> d3dDevice = CreateD3DDevice();
-	com_ptr<IDXGIDevice> dxgiDevice = d3dDevice.as<IDXGIDevice>();
-	m_device = CreateDirect3DDevice(dxgiDevice.get());
-}
+Factory::Factory(FactoryInit init, double apartmentSeconds) :
+	m_device(std::make_shared<DeviceLoader>(init, apartmentSeconds)),
+	m_saver(std::make_shared<ImageSaver>(0, 16)),
+	m_budget(std::make_shared<BudgetTracker>()),
+	m_policySet(false) {}
 
 Factory::~Factory() {
 	m_capturers.clear();
-	m_device.Close();
 }
 
 std::weak_ptr<ICapturer> Factory::createCapturer() {
+	if (IsRefusing())
+		return {};
+	size_t id = g_capturerCnt++;
+	auto capture = std::make_shared<Capturer>(m_device, id, m_saver, m_budget);
+	if (m_policySet)
+		capture->setThreadingPolicy(m_policy);
+	m_capturers.emplace(id, capture);
+	return capture;
+}
+
+std::weak_ptr<ICapturer> Factory::createReplayCapturer(const std::wstring& path, const ReplayOptions& options) {
+	if (IsRefusing())
+		return {};
 	size_t id = g_capturerCnt++;
-	auto capture = std::make_shared<Capturer>(m_device, id);
+	auto capture = std::make_shared<ReplayCapturer>(path, options, id, m_saver, m_budget);
+	if (m_policySet)
+		capture->setThreadingPolicy(m_policy);
+	m_capturers.emplace(id, capture);
+	return capture;
+}
+
+std::weak_ptr<ICapturer> Factory::createSyntheticCapturer(const SyntheticOptions& options) {
+	if (IsRefusing())
+		return {};
+	size_t id = g_capturerCnt++;
+	auto capture = std::make_shared<SyntheticCapturer>(options, id, m_saver, m_budget);
+	if (m_policySet)
+		capture->setThreadingPolicy(m_policy);
 	m_capturers.emplace(id, capture);
 	return capture;
 }
@@ -95,4 +91,49 @@ void Factory::destroyCapturer(std::weak_ptr<ICapturer> instance) {
 	m_capturers.erase(it);
 }
 
+bool Factory::setThreadingPolicy(const ThreadingPolicy& policy, DWORD priorityClass) {
+	if (!IsValidThreadingPolicy(policy))
+		return false;
+	if (priorityClass != 0 && !SetPriorityClass(GetCurrentProcess(), priorityClass))
+		return false;
+	m_policy = policy;
+	m_policySet = true;
+	for (auto& capturer : m_capturers)
+		capturer.second->setThreadingPolicy(policy);
+	return true;
+}
+
+void Factory::setMemoryBudget(const MemoryBudget& budget) {
+	m_budget->setBudget(budget);
+	// Idle capturers get no frame to apply it, so apply it now.
+	for (auto& capturer : m_capturers)
+		capturer.second->ApplyMemoryBudget();
+}
+
+MemoryUsage Factory::getMemoryUsage() {
+	MemoryUsage usage = {};
+	usage.budgetBytes = m_budget->getBudget().bytes;
+	for (auto& capturer : m_capturers) {
+		capturer.second->ApplyMemoryBudget();
+		usage.capturers.push_back(capturer.second->getMemoryUsage());
+		usage.totalBytes += usage.capturers.back().totalBytes;
+	}
+	usage.overBudget = m_budget->isOverBudget();
+	return usage;
+}
+
+std::shared_future<bool> Factory::whenReady() {
+	return m_device->whenReady();
+}
+
+StartupTimes Factory::getStartupTimes() {
+	return m_device->getTimes();
+}
+
+bool Factory::IsRefusing() {
+	if (!m_budget->isOverBudget())
+		return false;
+	return m_budget->getBudget().refuseNewCapturers;
+}
+
 } // namespace wgc
@@ -23,6 +23,10 @@
 #include "pch.h"
 
 #include "include/WGC/WGC.h"
+#include "ImageSaver.h"
+#include "BudgetTracker.h"
+#include "CapturerBase.h"
+#include "DeviceLoader.h"
 #include <map>
 
 namespace wgc {
@@ -30,16 +34,36 @@ namespace wgc {
 class Factory final :
 	public IFactory {
 public:
-	Factory();
+	/**
+	 * @brief This function may throws.
+	 */
+	Factory(FactoryInit init, double apartmentSeconds);
 	virtual ~Factory() override;
 
 public:
 	virtual std::weak_ptr<ICapturer> createCapturer() override;
+	virtual std::weak_ptr<ICapturer> createReplayCapturer(const std::wstring& path, const ReplayOptions& options = {}) override;
+	virtual std::weak_ptr<ICapturer> createSyntheticCapturer(const SyntheticOptions& options = {}) override;
 	virtual void destroyCapturer(std::weak_ptr<ICapturer> instance) override;
 
+	virtual bool setThreadingPolicy(const ThreadingPolicy& policy, DWORD priorityClass = 0) override;
+
+	virtual void setMemoryBudget(const MemoryBudget& budget) override;
+	virtual MemoryUsage getMemoryUsage() override;
+
+	virtual std::shared_future<bool> whenReady() override;
+	virtual StartupTimes getStartupTimes() override;
+
+protected:
+	bool IsRefusing();
+
 protected:
-	winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice m_device;
-	std::map<size_t, std::shared_ptr<ICapturer>> m_capturers;
+	std::shared_ptr<DeviceLoader> m_device; // 截取器也持有它，开始截取时取得设备。
+	std::shared_ptr<ImageSaver> m_saver; // 所有截取器共用的编码线程池。
+	std::shared_ptr<BudgetTracker> m_budget; // 所有截取器共用的内存预算。
+	std::map<size_t, std::shared_ptr<CapturerBase>> m_capturers;
+	ThreadingPolicy m_policy;
+	bool m_policySet; // 设置过策略才交给新的截取器，否则它们保持默认。
 };
 
 } // namespace wgc
@@ -0,0 +1,194 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "FastLz.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr size_t MinMatch = 4;
+constexpr size_t LastLiterals = 5;  // The last bytes are always literals.
+constexpr size_t MatchLimit = 12;   // No match starts in the last bytes.
+constexpr size_t MaxOffset = 65535;
+constexpr int HashLog = 14;
+
+inline uint32_t Read32(const uint8_t* p) {
+	uint32_t v;
+	std::memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline uint64_t Read64(const uint8_t* p) {
+	uint64_t v;
+	std::memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline uint32_t Hash(uint32_t sequence) {
+	return (sequence * 2654435761u) >> (32 - HashLog);
+}
+
+inline uint8_t* WriteLength(uint8_t* op, size_t length) {
+	while (length >= 255) {
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = static_cast<uint8_t>(length);
+	return op;
+}
+
+inline uint8_t* WriteSequence(uint8_t* op, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength) {
+	uint8_t* token = op++;
+	*token = static_cast<uint8_t>((literalLength >= 15 ? 15 : literalLength) << 4);
+	if (literalLength >= 15)
+		op = WriteLength(op, literalLength - 15);
+	if (literalLength > 0)
+		std::memcpy(op, literals, literalLength);
+	op += literalLength;
+	if (matchLength == 0)
+		return op; // The last sequence has only literals.
+
+	*op++ = static_cast<uint8_t>(offset);
+	*op++ = static_cast<uint8_t>(offset >> 8);
+	const size_t code = matchLength - MinMatch;
+	*token |= static_cast<uint8_t>(code >= 15 ? 15 : code);
+	if (code >= 15)
+		op = WriteLength(op, code - 15);
+	return op;
+}
+
+inline bool ReadLength(const uint8_t*& ip, const uint8_t* iend, size_t& length) {
+	uint8_t b;
+	do {
+		if (ip >= iend)
+			return false;
+		b = *ip++;
+		length += b;
+	} while (b == 255);
+	return true;
+}
+
+} // namespace
+
+namespace wgc::fastlz {
+
+size_t Compress(const uint8_t* src, size_t size, uint8_t* dst) {
+	const uint8_t* ip = src;
+	const uint8_t* anchor = src;
+	const uint8_t* const iend = src + size;
+	uint8_t* op = dst;
+
+	if (size > MatchLimit) {
+		uint32_t table[1 << HashLog];
+		std::memset(table, 0, sizeof(table));
+		const uint8_t* const mflimit = iend - MatchLimit;
+		const uint8_t* const matchEnd = iend - LastLiterals;
+
+		unsigned misses = 0;
+		while (ip < mflimit) {
+			const uint32_t sequence = Read32(ip);
+			const uint32_t h = Hash(sequence);
+			const uint8_t* ref = src + table[h];
+			table[h] = static_cast<uint32_t>(ip - src);
+
+			if (ref >= ip || static_cast<size_t>(ip - ref) > MaxOffset || Read32(ref) != sequence) {
+				ip += 1 + (misses++ >> 6); // Skip faster on data that does not compress.
+				continue;
+			}
+			misses = 0;
+
+			const uint8_t* mp = ip + MinMatch;
+			const uint8_t* rp = ref + MinMatch;
+			while (mp + 8 <= matchEnd && Read64(mp) == Read64(rp)) {
+				mp += 8;
+				rp += 8;
+			}
+			while (mp < matchEnd && *mp == *rp) {
+				++mp;
+				++rp;
+			}
+
+			op = WriteSequence(op, anchor, ip - anchor, ip - ref, mp - ip);
+			ip = mp;
+			anchor = ip;
+			if (ip < mflimit)
+				table[Hash(Read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - src);
+		}
+	}
+
+	op = WriteSequence(op, anchor, iend - anchor, 0, 0);
+	return op - dst;
+}
+
+bool Decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity, size_t& written) {
+	const uint8_t* ip = src;
+	const uint8_t* const iend = src + size;
+	uint8_t* op = dst;
+	uint8_t* const oend = dst + capacity;
+
+	while (ip < iend) {
+		const uint8_t token = *ip++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(ip, iend, literalLength))
+			return false;
+		if (literalLength > static_cast<size_t>(iend - ip) || literalLength > static_cast<size_t>(oend - op))
+			return false;
+		if (literalLength > 0)
+			std::memcpy(op, ip, literalLength);
+		ip += literalLength;
+		op += literalLength;
+		if (ip == iend)
+			break; // The last sequence.
+
+		if (iend - ip < 2)
+			return false;
+		const size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+		ip += 2;
+		if (offset == 0 || offset > static_cast<size_t>(op - dst))
+			return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(ip, iend, matchLength))
+			return false;
+		matchLength += MinMatch;
+		if (matchLength > static_cast<size_t>(oend - op))
+			return false;
+
+		const uint8_t* ref = op - offset;
+		if (offset == 1) {
+			std::memset(op, *ref, matchLength);
+		}
+		else if (offset >= matchLength) {
+			std::memcpy(op, ref, matchLength);
+		}
+		else {
+			for (size_t i = 0; i < matchLength; ++i)
+				op[i] = ref[i];
+		}
+		op += matchLength;
+	}
+	written = op - dst;
+	return true;
+}
+
+} // namespace wgc::fastlz
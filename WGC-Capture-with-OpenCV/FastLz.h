@@ -0,0 +1,70 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace wgc {
+
+/**
+ * @brief 简单的LZ77字节压缩（类似LZ4的块格式），用于帧数据的熵编码阶段。
+*/
+namespace fastlz {
+
+/**
+ * @brief Max size of the compressed data of 'size' bytes.
+ */
+constexpr size_t Bound(size_t size) {
+	return size + size / 255 + 16;
+}
+
+/**
+ * @brief Check if 'size' bytes of compressed data may decompress to 'rawSize' bytes.
+ * @brief Every input byte expands to at most 255 bytes.
+ */
+constexpr bool CanExpandTo(size_t size, size_t rawSize) {
+	return rawSize / 255 <= size;
+}
+
+/**
+ * @brief Compress one block.
+ * @param src: The data.
+ * @param size: Byte count of the data.
+ * @param dst: Where to write. Must have at least Bound(size) bytes.
+ * @return Byte count of the compressed data.
+ */
+size_t Compress(const uint8_t* src, size_t size, uint8_t* dst);
+
+/**
+ * @brief Decompress one block. It checks every length and offset, so any input is safe.
+ * @param src: The compressed data.
+ * @param size: Byte count of the compressed data.
+ * @param dst: Where to write.
+ * @param capacity: Byte count of 'dst'.
+ * @param written: Byte count written into 'dst'.
+ * @return 'false' if the data is malformed or does not fit.
+ */
+bool Decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity, size_t& written);
+
+} // namespace fastlz
+
+} // namespace wgc
@@ -0,0 +1,475 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "FrameGraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t BandBytes = 64 << 10; // 融合组中最宽的一行乘以带的行数不超过此值，使一带的中间结果留在L2中。
+constexpr size_t PoolBuffers = 32;     // 中间结果与带缓冲的总数上限，超出时直接分配。
+
+} // namespace
+
+namespace wgc {
+
+std::shared_ptr<IFrameGraph> IFrameGraph::createInstance() noexcept {
+	try {
+		return std::make_shared<FrameGraph>();
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+std::shared_ptr<IFrameGraph> IFrameGraph::createConvertToBGR() noexcept {
+	try {
+		auto graph = std::make_shared<FrameGraph>();
+		graph->addOutput(graph->cvtColor(Input, cv::ColorConversionCodes::COLOR_BGRA2BGR));
+		return graph;
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+FrameGraph::FrameGraph() :
+	m_compiled(false),
+	m_levels(0),
+	m_pool(PoolBuffers) {
+	Node input = {};
+	input.kind = Kind::Input;
+	input.input = -1;
+	input.output = -1;
+	m_nodes.push_back(input);
+}
+
+int FrameGraph::crop(int input, const cv::Rect& rect) {
+	if (rect.width <= 0 || rect.height <= 0)
+		return -1;
+	Node node = {};
+	node.kind = Kind::Crop;
+	node.input = input;
+	node.rect = rect;
+	node.fusable = true;
+	return AddNode(std::move(node));
+}
+
+int FrameGraph::resize(int input, const cv::Size& size, double fx, double fy, int interpolation) {
+	if (size.empty() && !(fx > 0.0 && fy > 0.0))
+		return -1;
+	Node node = {};
+	node.kind = Kind::Resize;
+	node.input = input;
+	node.size = size;
+	node.fx = fx;
+	node.fy = fy;
+	node.param = interpolation;
+	node.fusable = interpolation == cv::InterpolationFlags::INTER_NEAREST || interpolation == cv::InterpolationFlags::INTER_LINEAR;
+	return AddNode(std::move(node));
+}
+
+int FrameGraph::cvtColor(int input, int code) {
+	Node node = {};
+	node.kind = Kind::CvtColor;
+	node.input = input;
+	node.param = code;
+	node.fusable = true;
+	node.typeIn = -1;
+	return AddNode(std::move(node));
+}
+
+int FrameGraph::threshold(int input, double thresh, double maxval, int type) {
+	Node node = {};
+	node.kind = Kind::Threshold;
+	node.input = input;
+	node.thresh = thresh;
+	node.maxval = maxval;
+	node.param = type;
+	// Otsu and triangle look at the whole image first.
+	node.fusable = (type & (cv::ThresholdTypes::THRESH_OTSU | cv::ThresholdTypes::THRESH_TRIANGLE)) == 0;
+	return AddNode(std::move(node));
+}
+
+int FrameGraph::custom(int input, std::function<void(const cv::Mat& src, cv::Mat& dst)> fn) {
+	if (!fn)
+		return -1;
+	Node node = {};
+	node.kind = Kind::Custom;
+	node.input = input;
+	node.fn = std::move(fn);
+	node.fusable = false;
+	return AddNode(std::move(node));
+}
+
+int FrameGraph::addOutput(int node) {
+	if (node < 0 || node >= static_cast<int>(m_nodes.size()))
+		return -1;
+	const int index = static_cast<int>(m_outputs.size());
+	if (m_nodes[node].output < 0)
+		m_nodes[node].output = index;
+	m_outputs.push_back(node);
+	m_compiled = false;
+	return index;
+}
+
+bool FrameGraph::run(const cv::Mat& frame, std::vector<cv::Mat>& outputs) {
+	if (frame.empty())
+		return false;
+	outputs.resize(m_outputs.size());
+	try {
+		execute(frame, outputs.data());
+		return true;
+	}
+	catch (...) {}
+	m_results.clear();
+	return false;
+}
+
+void FrameGraph::execute(const cv::Mat& frame, cv::Mat* outputs) {
+	if (!m_compiled)
+		Compile();
+
+	const size_t count = m_nodes.size();
+	m_shapes.resize(count);
+	m_results.assign(count, cv::Mat());
+	m_shapes[Input].size = frame.size();
+	m_shapes[Input].type = frame.type();
+	m_results[Input] = frame;
+
+	std::vector<const Group*> level;
+	for (int l = 0; l < m_levels; ++l) {
+		level.clear();
+		for (const Group& group : m_groups) {
+			const Node& tail = m_nodes[group.stages.back()];
+			if (group.level == l && (tail.consumers > 0 || tail.output >= 0))
+				level.push_back(&group);
+		}
+		for (const Group* group : level) {
+			for (int id : group->stages) {
+				if (m_nodes[id].kind != Kind::Custom)
+					InferShape(id);
+			}
+			PrepareResult(*group, outputs);
+		}
+
+		if (level.size() == 1) {
+			RunGroup(*level[0], true);
+		}
+		else {
+			// Independent branches in parallel, each with its bands in order.
+			cv::parallel_for_(
+				cv::Range(0, static_cast<int>(level.size())),
+				[this, &level](const cv::Range& range) -> void {
+					for (int i = range.start; i < range.end; ++i)
+						RunGroup(*level[i], false);
+				}
+			);
+		}
+
+		for (const Group* group : level) {
+			const int tail = group->stages.back();
+			if (m_nodes[tail].kind == Kind::Custom) {
+				m_shapes[tail].size = m_results[tail].size();
+				m_shapes[tail].type = m_results[tail].type();
+			}
+		}
+	}
+
+	for (size_t i = 0; i < m_outputs.size(); ++i) {
+		const int id = m_outputs[i];
+		if (id == Input)
+			frame.copyTo(outputs[i]);
+		else
+			outputs[i] = m_results[id];
+	}
+	// Give the buffers back to the pool.
+	m_results.assign(count, cv::Mat());
+}
+
+size_t FrameGraph::getPoolBytes() {
+	return m_pool.getBytes();
+}
+
+void FrameGraph::trimPool() {
+	m_pool.trim();
+}
+
+int FrameGraph::AddNode(Node node) {
+	if (node.input < 0 || node.input >= static_cast<int>(m_nodes.size()))
+		return -1;
+	node.consumers = 0;
+	node.output = -1;
+	++m_nodes[node.input].consumers;
+	m_nodes.push_back(std::move(node));
+	m_compiled = false;
+	return static_cast<int>(m_nodes.size()) - 1;
+}
+
+void FrameGraph::Compile() {
+	m_groups.clear();
+	m_levels = 0;
+	std::vector<int> groupOf(m_nodes.size(), -1);
+	for (int id = 1; id < static_cast<int>(m_nodes.size()); ++id) {
+		const Node& node = m_nodes[id];
+		const Node& input = m_nodes[node.input];
+		// Extend the chain only if nothing else needs the input as a whole.
+		if (node.fusable && input.fusable && input.consumers == 1 && input.output < 0) {
+			groupOf[id] = groupOf[node.input];
+			m_groups[groupOf[id]].stages.push_back(id);
+			continue;
+		}
+		Group group;
+		group.source = node.input;
+		group.stages.push_back(id);
+		group.level = (node.input == Input) ? 0 : m_groups[groupOf[node.input]].level + 1;
+		m_levels = std::max(m_levels, group.level + 1);
+		groupOf[id] = static_cast<int>(m_groups.size());
+		m_groups.push_back(std::move(group));
+	}
+	m_compiled = true;
+}
+
+void FrameGraph::InferShape(int id) {
+	Node& node = m_nodes[id];
+	const Shape& in = m_shapes[node.input];
+	Shape& shape = m_shapes[id];
+	shape.type = in.type;
+	switch (node.kind) {
+	case Kind::Crop:
+		shape.crop = node.rect & cv::Rect(cv::Point(), in.size);
+		if (shape.crop.empty())
+			throw std::invalid_argument("FrameGraph: crop outside the input.");
+		shape.size = shape.crop.size();
+		break;
+	case Kind::Resize:
+		shape.size = node.size.empty() ?
+			cv::Size(cvRound(in.size.width * node.fx), cvRound(in.size.height * node.fy)) :
+			node.size;
+		if (shape.size.width <= 0 || shape.size.height <= 0)
+			throw std::invalid_argument("FrameGraph: resize to empty.");
+		break;
+	case Kind::CvtColor:
+		if (node.typeIn != in.type) {
+			// Convert a tiny image once to learn the output type.
+			const cv::Mat probe(2, 2, in.type, cv::Scalar::all(0));
+			cv::Mat converted;
+			cv::cvtColor(probe, converted, node.param);
+			if (converted.size() != probe.size())
+				throw std::invalid_argument("FrameGraph: cvtColor changes the size.");
+			node.typeIn = in.type;
+			node.typeOut = converted.type();
+		}
+		shape.size = in.size;
+		shape.type = node.typeOut;
+		break;
+	default:
+		shape.size = in.size;
+		break;
+	}
+}
+
+void FrameGraph::PrepareResult(const Group& group, cv::Mat* outputs) {
+	const int id = group.stages.back();
+	const Node& node = m_nodes[id];
+	if (node.kind == Kind::Custom) {
+		if (node.output >= 0)
+			m_results[id] = outputs[node.output]; // Reuse its buffer if the size is the same.
+		return;
+	}
+	const Shape& shape = m_shapes[id];
+	if (node.output >= 0) {
+		cv::Mat& output = outputs[node.output];
+		output.create(shape.size, shape.type);
+		m_results[id] = output;
+		return;
+	}
+	if (group.stages.size() == 1 && node.kind == Kind::Crop)
+		return; // Only a view of its input, see RunGroup().
+	m_results[id] = m_pool.acquire(shape.size, shape.type);
+	if (m_results[id].empty())
+		m_results[id].create(shape.size, shape.type);
+}
+
+void FrameGraph::RunGroup(const Group& group, bool parallelBands) {
+	const int tail = group.stages.back();
+	const cv::Mat& source = m_results[group.source];
+	cv::Mat& dst = m_results[tail];
+
+	if (!m_nodes[tail].fusable) {
+		ApplyWhole(tail, source, dst);
+		return;
+	}
+	if (group.stages.size() == 1 && m_nodes[tail].kind == Kind::Crop && m_nodes[tail].output < 0) {
+		dst = source(m_shapes[tail].crop);
+		return;
+	}
+
+	const int stages = static_cast<int>(group.stages.size());
+	size_t rowBytes = source.cols * source.elemSize();
+	for (int id : group.stages)
+		rowBytes = std::max(rowBytes, m_shapes[id].size.width * static_cast<size_t>(CV_ELEM_SIZE(m_shapes[id].type)));
+	const int bandRows = std::max(1, static_cast<int>(BandBytes / std::max<size_t>(rowBytes, 1)));
+	const int bands = (dst.rows + bandRows - 1) / bandRows;
+
+	// Rows of each band of each stage, so band buffers keep the same size across bands and frames.
+	std::vector<cv::Range> ranges(static_cast<size_t>(bands) * (stages + 1));
+	std::vector<int> capacity(stages, 0);
+	for (int b = 0; b < bands; ++b) {
+		cv::Range* rows = &ranges[static_cast<size_t>(b) * (stages + 1)];
+		rows[stages] = cv::Range(b * bandRows, std::min(dst.rows, (b + 1) * bandRows));
+		for (int k = stages - 1; k >= 0; --k) {
+			rows[k] = NeedRows(group.stages[k], rows[k + 1]);
+			capacity[k] = std::max(capacity[k], rows[k + 1].size());
+		}
+	}
+
+	auto body = [&](const cv::Range& range) -> void {
+		std::vector<cv::Mat> buffers(stages);
+		for (int b = range.start; b < range.end; ++b) {
+			const cv::Range* rows = &ranges[static_cast<size_t>(b) * (stages + 1)];
+			cv::Mat cur = source.rowRange(rows[0]);
+			int curRow0 = rows[0].start;
+			for (int k = 0; k < stages; ++k) {
+				const int id = group.stages[k];
+				const Shape& shape = m_shapes[id];
+				cv::Mat next;
+				if (k == stages - 1) {
+					next = dst.rowRange(rows[k + 1]);
+				}
+				else if (m_nodes[id].kind == Kind::Crop) {
+					// A crop inside a chain is only a view of the band.
+					cur = cur(cv::Rect(shape.crop.x, rows[k + 1].start + shape.crop.y - curRow0, shape.crop.width, rows[k + 1].size()));
+					curRow0 = rows[k + 1].start;
+					continue;
+				}
+				else {
+					if (buffers[k].empty()) {
+						buffers[k] = m_pool.acquire(cv::Size(shape.size.width, capacity[k]), shape.type);
+						if (buffers[k].empty())
+							buffers[k].create(capacity[k], shape.size.width, shape.type);
+					}
+					next = buffers[k].rowRange(0, rows[k + 1].size());
+				}
+				ApplyBand(id, cur, curRow0, next, rows[k + 1]);
+				cur = next;
+				curRow0 = rows[k + 1].start;
+			}
+		}
+	};
+	if (parallelBands)
+		cv::parallel_for_(cv::Range(0, bands), body);
+	else
+		body(cv::Range(0, bands));
+}
+
+cv::Range FrameGraph::NeedRows(int id, const cv::Range& rows) const {
+	const Node& node = m_nodes[id];
+	switch (node.kind) {
+	case Kind::Crop:
+		return cv::Range(rows.start + m_shapes[id].crop.y, rows.end + m_shapes[id].crop.y);
+	case Kind::Resize:
+	{
+		const int height = m_shapes[node.input].size.height;
+		const double sy = static_cast<double>(height) / m_shapes[id].size.height;
+		int start, end;
+		if (node.param == cv::InterpolationFlags::INTER_NEAREST) {
+			start = static_cast<int>(std::floor(rows.start * sy)) - 1;
+			end = static_cast<int>(std::floor((rows.end - 1) * sy)) + 2;
+		}
+		else {
+			start = static_cast<int>(std::floor((rows.start + 0.5) * sy - 0.5)) - 1;
+			end = static_cast<int>(std::floor((rows.end - 0.5) * sy - 0.5)) + 3;
+		}
+		return cv::Range(std::max(start, 0), std::min(end, height));
+	}
+	default:
+		return rows;
+	}
+}
+
+void FrameGraph::ApplyBand(int id, const cv::Mat& src, int srcRow0, cv::Mat& dst, const cv::Range& rows) const {
+	const Node& node = m_nodes[id];
+	switch (node.kind) {
+	case Kind::Crop:
+	{
+		const cv::Rect& crop = m_shapes[id].crop;
+		src(cv::Rect(crop.x, rows.start + crop.y - srcRow0, crop.width, rows.size())).copyTo(dst);
+		break;
+	}
+	case Kind::Resize:
+	{
+		// Same mapping as cv::resize() over the whole image, shifted to this band.
+		// Rows outside the band are never sampled except at the edges of the image, where they are replicated as cv::resize() does.
+		const cv::Size in = m_shapes[node.input].size;
+		const double sx = static_cast<double>(in.width) / dst.cols;
+		const double sy = static_cast<double>(in.height) / m_shapes[id].size.height;
+		cv::Mat transform(2, 3, CV_64F);
+		double* m = transform.ptr<double>();
+		m[0] = sx;
+		m[1] = 0.0;
+		m[3] = 0.0;
+		m[4] = sy;
+		if (node.param == cv::InterpolationFlags::INTER_NEAREST) {
+			// warpAffine rounds to the nearest pixel, cv::resize takes the floor.
+			m[2] = -0.5;
+			m[5] = rows.start * sy - srcRow0 - 0.5;
+		}
+		else {
+			m[2] = 0.5 * sx - 0.5;
+			m[5] = (rows.start + 0.5) * sy - 0.5 - srcRow0;
+		}
+		cv::warpAffine(
+			src, dst, transform, dst.size(),
+			node.param | cv::WarpPolynomialFlags::WARP_INVERSE_MAP, cv::BorderTypes::BORDER_REPLICATE
+		);
+		break;
+	}
+	case Kind::CvtColor:
+		cv::cvtColor(src, dst, node.param);
+		break;
+	case Kind::Threshold:
+		cv::threshold(src, dst, node.thresh, node.maxval, node.param);
+		break;
+	default:
+		break;
+	}
+}
+
+void FrameGraph::ApplyWhole(int id, const cv::Mat& src, cv::Mat& dst) const {
+	const Node& node = m_nodes[id];
+	switch (node.kind) {
+	case Kind::Resize:
+		cv::resize(src, dst, m_shapes[id].size, 0.0, 0.0, node.param);
+		break;
+	case Kind::Threshold:
+		cv::threshold(src, dst, node.thresh, node.maxval, node.param);
+		break;
+	case Kind::Custom:
+		node.fn(src, dst);
+		break;
+	default:
+		break;
+	}
+}
+
+} // namespace wgc
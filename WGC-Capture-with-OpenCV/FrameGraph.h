@@ -0,0 +1,146 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <vector>
+#include "include/WGC/FrameGraph.h"
+#include "FramePool.h"
+
+namespace wgc {
+
+/**
+ * @brief 每帧处理图。节点按添加顺序即为拓扑序。
+ * @brief 可融合的节点连成组，按带执行；组尾（被多处使用、作为输出或不可融合）的结果完整保存。
+*/
+class FrameGraph final :
+	public IFrameGraph {
+public:
+	FrameGraph();
+
+public:
+	virtual int crop(int input, const cv::Rect& rect) override;
+	virtual int resize(int input, const cv::Size& size, double fx = 0.0, double fy = 0.0, int interpolation = cv::INTER_LINEAR) override;
+	virtual int cvtColor(int input, int code) override;
+	virtual int threshold(int input, double thresh, double maxval, int type) override;
+	virtual int custom(int input, std::function<void(const cv::Mat& src, cv::Mat& dst)> fn) override;
+
+	virtual int addOutput(int node) override;
+
+	virtual bool run(const cv::Mat& frame, std::vector<cv::Mat>& outputs) override;
+
+public:
+	/**
+	 * @brief 执行图，结果写入outputs[0 ~ 输出数)。This function may throws.
+	*/
+	void execute(const cv::Mat& frame, cv::Mat* outputs);
+	/**
+	 * @brief 中间结果缓冲池的字节数。两次执行之间它们都是空闲的。
+	*/
+	size_t getPoolBytes();
+	/**
+	 * @brief 释放中间结果缓冲池中空闲的缓冲。可以在执行时从其他线程调用。
+	*/
+	void trimPool();
+
+protected:
+	enum class Kind {
+		Input,
+		Crop,
+		Resize,
+		CvtColor,
+		Threshold,
+		Custom
+	};
+
+	struct Node {
+		Kind kind;
+		int input;
+		cv::Rect rect;    // Crop。
+		cv::Size size;    // Resize，为空时用fx、fy。
+		double fx, fy;    // Resize。
+		int param;        // Resize的插值，CvtColor的code，Threshold的type。
+		double thresh, maxval;
+		std::function<void(const cv::Mat&, cv::Mat&)> fn;
+		bool fusable;     // 可以按带执行。
+		int consumers;    // 以此为输入的节点数。
+		int output;       // 第一个输出的序号，-1表示不是输出。
+		int typeIn, typeOut; // CvtColor上次推断的输入、输出类型。
+	};
+
+	struct Shape {
+		cv::Size size;
+		int type;
+		cv::Rect crop; // Crop裁剪到输入后的区域。
+	};
+
+	/**
+	 * @brief 一组依次执行的节点，source是已完整保存的节点。
+	*/
+	struct Group {
+		int source;
+		std::vector<int> stages;
+		int level; // 依赖的组都在更低的层，同层的组可以并行。
+	};
+
+	int AddNode(Node node);
+	/**
+	 * @brief 节点变化后重新分组。
+	*/
+	void Compile();
+	/**
+	 * @brief 由输入的形状推断节点的形状。失败时抛出std::invalid_argument。
+	*/
+	void InferShape(int id);
+	/**
+	 * @brief 为组尾准备完整的结果缓冲。
+	*/
+	void PrepareResult(const Group& group, cv::Mat* outputs);
+
+	void RunGroup(const Group& group, bool parallelBands);
+	/**
+	 * @brief 节点输出rows行时需要的输入行。
+	*/
+	cv::Range NeedRows(int id, const cv::Range& rows) const;
+	/**
+	 * @brief 计算节点输出的rows行。src是输入的从srcRow0开始的若干行。
+	*/
+	void ApplyBand(int id, const cv::Mat& src, int srcRow0, cv::Mat& dst, const cv::Range& rows) const;
+	/**
+	 * @brief 对整个输入执行节点。
+	*/
+	void ApplyWhole(int id, const cv::Mat& src, cv::Mat& dst) const;
+
+protected:
+	std::vector<Node> m_nodes;
+	std::vector<int> m_outputs; // 各输出对应的节点。
+
+	bool m_compiled;
+	std::vector<Group> m_groups;
+	int m_levels;
+
+	std::vector<Shape> m_shapes;
+	std::vector<cv::Mat> m_results; // 完整保存的节点结果，运行后清空，缓冲回到池中。
+	FramePool m_pool;
+};
+
+} // namespace wgc
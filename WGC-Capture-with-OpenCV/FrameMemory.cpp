@@ -0,0 +1,210 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "FrameMemory.h"
+
+#include <malloc.h>
+#include <stdexcept>
+
+namespace {
+
+inline size_t AlignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * @brief 为进程打开SeLockMemoryPrivilege，大页需要它。只尝试一次。
+*/
+bool EnableLockMemoryPrivilege() {
+	static const bool enabled = []() -> bool {
+		HANDLE token = NULL;
+		if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+			return false;
+		TOKEN_PRIVILEGES privileges = {};
+		privileges.PrivilegeCount = 1;
+		privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+		bool res = LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid) &&
+			AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+			GetLastError() == ERROR_SUCCESS; // ERROR_NOT_ALL_ASSIGNED if the user lacks the right.
+		CloseHandle(token);
+		return res;
+	}();
+	return enabled;
+}
+
+} // namespace
+
+namespace wgc {
+
+std::shared_ptr<IFrameMemory> IFrameMemory::createInstance(const FrameMemoryOptions& options) noexcept {
+	try {
+		return std::make_shared<FrameMemory>(options);
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+FrameMemory::FrameMemory(const FrameMemoryOptions& options) :
+	m_options(options),
+	m_largePage(false),
+	m_largePageSize(0),
+	m_allocator(*this),
+
+	m_buffers(0),
+	m_bytes(0),
+	m_largePageBuffers(0),
+	m_largePageBytes(0),
+	m_largePageFailures(0) {
+	if (m_options.alignment < 16 || (m_options.alignment & (m_options.alignment - 1)) != 0)
+		throw std::invalid_argument("FrameMemory: alignment must be a power of 2, at least 16.");
+	if (m_options.largePages) {
+		m_largePageSize = GetLargePageMinimum();
+		m_largePage = m_largePageSize != 0 && EnableLockMemoryPrivilege();
+	}
+}
+
+cv::Mat FrameMemory::allocate(cv::Size size, int type) {
+	cv::Mat mat;
+	mat.allocator = &m_allocator;
+	mat.create(size, type);
+	return mat;
+}
+
+void FrameMemory::create(cv::Mat& mat, cv::Size size, int type) {
+	if (mat.u != nullptr && mat.u->currAllocator == &m_allocator) {
+		mat.create(size, type);
+		return;
+	}
+	mat.release();
+	mat.allocator = &m_allocator;
+	mat.create(size, type);
+}
+
+size_t FrameMemory::getStep(int cols, int type) const {
+	return AlignUp(static_cast<size_t>(cols) * CV_ELEM_SIZE(type) + m_options.stridePadding, m_options.alignment);
+}
+
+bool FrameMemory::isLargePageEnabled() const {
+	return m_largePage;
+}
+
+FrameMemoryStats FrameMemory::getStats() const {
+	FrameMemoryStats stats;
+	stats.buffers = m_buffers;
+	stats.bytes = m_bytes;
+	stats.largePageBuffers = m_largePageBuffers;
+	stats.largePageBytes = m_largePageBytes;
+	stats.largePageFailures = m_largePageFailures;
+	return stats;
+}
+
+void* FrameMemory::Allocate(size_t bytes, Block& block) {
+	block.bytes = bytes;
+	block.largePage = false;
+	if (m_options.largePages && bytes >= m_options.largePageMinBytes) {
+		if (m_largePage) {
+			const size_t rounded = AlignUp(bytes, m_largePageSize);
+			void* base = VirtualAlloc(nullptr, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (base != nullptr) {
+				block.bytes = rounded;
+				block.largePage = true;
+				++m_largePageBuffers;
+				m_largePageBytes += rounded;
+				++m_buffers;
+				m_bytes += rounded;
+				return base;
+			}
+		}
+		++m_largePageFailures; // Physical memory is too fragmented, or no right.
+	}
+	void* base = _aligned_malloc(bytes, m_options.alignment);
+	if (base == nullptr)
+		return nullptr;
+	++m_buffers;
+	m_bytes += bytes;
+	return base;
+}
+
+void FrameMemory::Free(void* base, const Block& block) {
+	if (block.largePage) {
+		VirtualFree(base, 0, MEM_RELEASE);
+		--m_largePageBuffers;
+		m_largePageBytes -= block.bytes;
+	}
+	else {
+		_aligned_free(base);
+	}
+	--m_buffers;
+	m_bytes -= block.bytes;
+}
+
+FrameMemory::Allocator::Allocator(FrameMemory& owner) :
+	r_owner(owner) {}
+
+cv::UMatData* FrameMemory::Allocator::allocate(
+	int dims, const int* sizes, int type,
+	void* data, size_t* step,
+	cv::AccessFlag flags, cv::UMatUsageFlags usageFlags
+) const {
+	if (data != nullptr) // Wrapping user data, nothing to align.
+		return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+
+	// Pad and align the rows, the innermost dimension above the elements.
+	size_t total = CV_ELEM_SIZE(type);
+	for (int i = dims - 1; i >= 0; --i) {
+		if (step != nullptr)
+			step[i] = total;
+		total *= sizes[i];
+		if (i == dims - 1 && dims > 1)
+			total = AlignUp(total + r_owner.m_options.stridePadding, r_owner.m_options.alignment);
+	}
+
+	Block* block = new Block();
+	void* base = r_owner.Allocate(std::max<size_t>(total, 1), *block);
+	if (base == nullptr) {
+		delete block;
+		CV_Error(cv::Error::StsNoMem, "FrameMemory: failed to allocate.");
+	}
+	block->owner = r_owner.shared_from_this();
+
+	cv::UMatData* u = new cv::UMatData(this);
+	u->data = u->origdata = static_cast<uchar*>(base);
+	u->size = total;
+	u->userdata = block;
+	return u;
+}
+
+bool FrameMemory::Allocator::allocate(cv::UMatData*, cv::AccessFlag, cv::UMatUsageFlags) const {
+	return false; // No UMat.
+}
+
+void FrameMemory::Allocator::deallocate(cv::UMatData* u) const {
+	if (u == nullptr)
+		return;
+	CV_Assert(u->urefcount == 0);
+	CV_Assert(u->refcount == 0);
+	Block* block = static_cast<Block*>(u->userdata);
+	r_owner.Free(u->origdata, *block);
+	delete u;
+	delete block; // It may release the owner, and this with it.
+}
+
+} // namespace wgc
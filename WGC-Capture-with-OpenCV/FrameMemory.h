@@ -0,0 +1,98 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <atomic>
+#include <memory>
+#include "include/WGC/FrameMemory.h"
+
+namespace wgc {
+
+/**
+ * @brief 帧内存：行按对齐分配，大帧可放在大页上。每块内存都持有本对象，所以本对象比所有帧活得久。
+*/
+class FrameMemory final :
+	public IFrameMemory,
+	public std::enable_shared_from_this<FrameMemory> {
+public:
+	/**
+	 * @brief This function may throws.
+	*/
+	FrameMemory(const FrameMemoryOptions& options);
+
+public:
+	virtual cv::Mat allocate(cv::Size size, int type) override;
+	virtual void create(cv::Mat& mat, cv::Size size, int type) override;
+	virtual size_t getStep(int cols, int type) const override;
+
+	virtual bool isLargePageEnabled() const override;
+	virtual FrameMemoryStats getStats() const override;
+
+protected:
+	/**
+	 * @brief 交给cv::Mat的分配器，cv::Mat::create()经由它分配。
+	*/
+	class Allocator final :
+		public cv::MatAllocator {
+	public:
+		Allocator(FrameMemory& owner);
+
+	public:
+		virtual cv::UMatData* allocate(
+			int dims, const int* sizes, int type,
+			void* data, size_t* step,
+			cv::AccessFlag flags, cv::UMatUsageFlags usageFlags
+		) const override;
+		virtual bool allocate(cv::UMatData* data, cv::AccessFlag accessflags, cv::UMatUsageFlags usageFlags) const override;
+		virtual void deallocate(cv::UMatData* data) const override;
+
+	protected:
+		FrameMemory& r_owner;
+	};
+
+	/**
+	 * @brief 一块内存，记在UMatData::userdata中。
+	*/
+	struct Block {
+		std::shared_ptr<FrameMemory> owner;
+		size_t bytes;
+		bool largePage;
+	};
+
+	void* Allocate(size_t bytes, Block& block);
+	void Free(void* base, const Block& block);
+
+protected:
+	FrameMemoryOptions m_options;
+	bool m_largePage;        // 想要并且有权限使用大页。
+	size_t m_largePageSize;
+	Allocator m_allocator;
+
+	std::atomic<size_t> m_buffers;
+	std::atomic<size_t> m_bytes;
+	std::atomic<size_t> m_largePageBuffers;
+	std::atomic<size_t> m_largePageBytes;
+	std::atomic<size_t> m_largePageFailures;
+};
+
+} // namespace wgc
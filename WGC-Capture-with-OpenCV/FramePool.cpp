@@ -0,0 +1,109 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "FramePool.h"
+
+namespace {
+
+inline bool IsFree(const cv::Mat& buffer) {
+	// Only the pool refers to it.
+	return buffer.u == nullptr || CV_XADD(&buffer.u->refcount, 0) == 1;
+}
+
+} // namespace
+
+namespace wgc {
+
+FramePool::FramePool(size_t maxBuffers) :
+	m_maxBuffers(maxBuffers) {}
+
+cv::Mat FramePool::acquire(cv::Size size, int type) {
+	std::lock_guard lock(m_mutex);
+	// Buffers in use when the limit was lowered are dropped once freed, never reused.
+	// If every buffer left is in use, nothing below can be reused or added.
+	DropOverLimit();
+	cv::Mat* reusable = nullptr;
+	for (cv::Mat& buffer : m_buffers) {
+		if (!IsFree(buffer))
+			continue;
+		if (buffer.size() == size && buffer.type() == type)
+			return buffer;
+		reusable = &buffer;
+	}
+	if (reusable != nullptr) {
+		reusable->create(size, type);
+		return *reusable;
+	}
+	if (m_buffers.size() < m_maxBuffers) {
+		m_buffers.push_back(m_memory ? m_memory->allocate(size, type) : cv::Mat(size, type));
+		return m_buffers.back();
+	}
+	return cv::Mat();
+}
+
+void FramePool::trim() {
+	std::lock_guard lock(m_mutex);
+	for (auto it = m_buffers.begin(); it != m_buffers.end();) {
+		if (IsFree(*it))
+			it = m_buffers.erase(it);
+		else
+			++it;
+	}
+}
+
+size_t FramePool::getBytes() {
+	std::lock_guard lock(m_mutex);
+	size_t bytes = 0;
+	for (const cv::Mat& buffer : m_buffers)
+		bytes += buffer.step[0] * buffer.rows;
+	return bytes;
+}
+
+void FramePool::getBytes(size_t& usedBytes, size_t& freeBytes) {
+	std::lock_guard lock(m_mutex);
+	usedBytes = 0;
+	freeBytes = 0;
+	for (const cv::Mat& buffer : m_buffers)
+		(IsFree(buffer) ? freeBytes : usedBytes) += buffer.step[0] * buffer.rows;
+}
+
+void FramePool::setMaxBuffers(size_t maxBuffers) {
+	std::lock_guard lock(m_mutex);
+	m_maxBuffers = maxBuffers;
+	DropOverLimit();
+}
+
+void FramePool::setMemory(std::shared_ptr<IFrameMemory> memory) {
+	std::lock_guard lock(m_mutex);
+	m_memory = std::move(memory);
+	m_buffers.clear();
+}
+
+void FramePool::DropOverLimit() {
+	for (auto it = m_buffers.begin(); m_buffers.size() > m_maxBuffers && it != m_buffers.end();) {
+		if (IsFree(*it))
+			it = m_buffers.erase(it);
+		else
+			++it;
+	}
+}
+
+} // namespace wgc
@@ -0,0 +1,78 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <mutex>
+#include <vector>
+#include "include/WGC/FrameMemory.h"
+
+namespace wgc {
+
+/**
+ * @brief 帧缓冲池：只复用没有其他引用的cv::Mat，所以取出的缓冲可以放心交给其他线程，用完释放即可归还。
+*/
+class FramePool final {
+public:
+	FramePool(size_t maxBuffers);
+
+public:
+	/**
+	 * @brief 取出一个缓冲。全部被占用且已达上限时返回空的cv::Mat。
+	*/
+	cv::Mat acquire(cv::Size size, int type);
+	/**
+	 * @brief 释放没有被占用的缓冲。
+	*/
+	void trim();
+	/**
+	 * @brief 池中所有缓冲的字节数。
+	*/
+	size_t getBytes();
+	/**
+	 * @brief 池中被占用和空闲的缓冲的字节数。
+	*/
+	void getBytes(size_t& usedBytes, size_t& freeBytes);
+
+	/**
+	 * @brief 设置缓冲数上限。超出的空闲缓冲立即释放，被占用的用完后释放。
+	*/
+	void setMaxBuffers(size_t maxBuffers);
+	/**
+	 * @brief 设置分配新缓冲的内存，nullptr表示OpenCV默认的。池中的缓冲都被丢开，正在使用的用完后释放。
+	*/
+	void setMemory(std::shared_ptr<IFrameMemory> memory);
+
+protected:
+	/**
+	 * @brief 释放超出上限的空闲缓冲。需持有m_mutex。
+	*/
+	void DropOverLimit();
+
+protected:
+	std::mutex m_mutex;
+	size_t m_maxBuffers;
+	std::vector<cv::Mat> m_buffers;
+	std::shared_ptr<IFrameMemory> m_memory;
+};
+
+} // namespace wgc
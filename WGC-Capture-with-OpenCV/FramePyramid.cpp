@@ -0,0 +1,158 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "FramePyramid.h"
+
+#include <opencv2/imgproc.hpp>
+#include <emmintrin.h>
+
+namespace {
+
+constexpr int ParallelMinPixels = 256 * 256; // 小于此的层不并行。
+
+/**
+ * @brief 缩小BGRA的一行：row0和row1是源的两行，width为输出的像素数。
+*/
+void DecimateRow(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int width) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i two = _mm_set1_epi16(2);
+	int x = 0;
+	for (; x + 4 <= width; x += 4) {
+		// 8 source pixels of each row make 4 output pixels.
+		const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+		const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 16));
+		const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+		const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 16));
+		// Sum the two rows in 16 bits, two pixels in each register.
+		const __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+		const __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+		const __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+		const __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+		// Add the right pixel of each pair into the left one, then gather the left ones.
+		const __m128i lo = _mm_unpacklo_epi64(
+			_mm_add_epi16(s0, _mm_srli_si128(s0, 8)),
+			_mm_add_epi16(s1, _mm_srli_si128(s1, 8))
+		);
+		const __m128i hi = _mm_unpacklo_epi64(
+			_mm_add_epi16(s2, _mm_srli_si128(s2, 8)),
+			_mm_add_epi16(s3, _mm_srli_si128(s3, 8))
+		);
+		_mm_storeu_si128(
+			reinterpret_cast<__m128i*>(out + x * 4),
+			_mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(lo, two), 2), _mm_srli_epi16(_mm_add_epi16(hi, two), 2))
+		);
+	}
+	for (; x < width; ++x) {
+		for (int c = 0; c < 4; ++c) {
+			const int sum = row0[x * 8 + c] + row0[x * 8 + 4 + c] + row1[x * 8 + c] + row1[x * 8 + 4 + c];
+			out[x * 4 + c] = static_cast<uint8_t>((sum + 2) >> 2);
+		}
+	}
+}
+
+} // namespace
+
+namespace wgc {
+
+std::shared_ptr<IFramePyramid> IFramePyramid::createInstance(const cv::Mat& image) noexcept {
+	try {
+		FrameInfo info = {};
+		info.width = image.cols;
+		info.height = image.rows;
+		return std::make_shared<FramePyramid>(image, info);
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+FramePyramid::FramePyramid(const cv::Mat& frame, const FrameInfo& info) :
+	m_info(info),
+	m_count(0),
+	m_ready(0),
+	m_released(false) {
+	if (frame.empty())
+		return;
+	m_levels[0] = frame;
+	cv::Size size = frame.size();
+	m_count = 1;
+	while (m_count < FramePyramidMaxLevels && size.width >= 2 && size.height >= 2) {
+		size.width /= 2;
+		size.height /= 2;
+		++m_count;
+	}
+}
+
+int FramePyramid::getLevelCount() const {
+	return m_count;
+}
+
+cv::Mat FramePyramid::getLevel(int level) {
+	if (level < 0 || level >= m_count)
+		return cv::Mat();
+	if (level > 0 && level <= m_ready.load(std::memory_order_acquire))
+		return m_levels[level];
+	std::lock_guard lock(m_mutex);
+	int ready = m_ready.load(std::memory_order_relaxed);
+	while (ready < level) {
+		if (m_levels[ready].empty())
+			return cv::Mat(); // Level 0 is released.
+		Decimate(m_levels[ready], m_levels[ready + 1]);
+		m_ready.store(++ready, std::memory_order_release);
+	}
+	return m_levels[level];
+}
+
+bool FramePyramid::isComputed(int level) const {
+	return level >= 0 && level < m_count && level <= m_ready.load(std::memory_order_acquire) && !(level == 0 && m_released);
+}
+
+bool FramePyramid::isReleased() const {
+	return m_released;
+}
+
+FrameInfo FramePyramid::getInfo() const {
+	return m_info;
+}
+
+void FramePyramid::release() {
+	std::lock_guard lock(m_mutex);
+	m_levels[0].release();
+	m_released = true;
+}
+
+void FramePyramid::Decimate(const cv::Mat& src, cv::Mat& dst) {
+	const cv::Size size(src.cols / 2, src.rows / 2);
+	dst.create(size, src.type());
+	if (src.type() != CV_8UC4) {
+		cv::resize(src(cv::Rect(0, 0, size.width * 2, size.height * 2)), dst, size, 0.0, 0.0, cv::INTER_AREA);
+		return;
+	}
+	const auto rows = [&src, &dst](const cv::Range& range) -> void {
+		for (int y = range.start; y < range.end; ++y)
+			DecimateRow(src.ptr<uint8_t>(2 * y), src.ptr<uint8_t>(2 * y + 1), dst.ptr<uint8_t>(y), dst.cols);
+	};
+	if (size.area() >= ParallelMinPixels)
+		cv::parallel_for_(cv::Range(0, size.height), rows);
+	else
+		rows(cv::Range(0, size.height));
+}
+
+} // namespace wgc
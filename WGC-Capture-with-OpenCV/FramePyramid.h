@@ -0,0 +1,70 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <atomic>
+#include <mutex>
+#include "include/WGC/FramePyramid.h"
+
+namespace wgc {
+
+/**
+ * @brief 帧的金字塔：第一次请求时逐层缩小一半，之后共享。
+ * @brief 第1层及以上写好后才发布，之后不再改变，所以读已计算的层不加锁。
+*/
+class FramePyramid final :
+	public IFramePyramid {
+public:
+	/**
+	 * @brief This function may throws.
+	 */
+	FramePyramid(const cv::Mat& frame, const FrameInfo& info);
+
+public:
+	virtual int getLevelCount() const override;
+	virtual cv::Mat getLevel(int level) override;
+	virtual bool isComputed(int level) const override;
+	virtual bool isReleased() const override;
+	virtual FrameInfo getInfo() const override;
+
+public:
+	/**
+	 * @brief 帧被替换或失效时调用：等正在用第0层计算的请求结束，然后放开第0层。
+	*/
+	void release();
+
+	/**
+	 * @brief 每个2x2取平均，缩小一半。丢弃奇数的最后一行和一列。BGRA用SSE2，其他类型用cv::resize()。
+	*/
+	static void Decimate(const cv::Mat& src, cv::Mat& dst);
+
+protected:
+	FrameInfo m_info;
+	int m_count;
+	cv::Mat m_levels[FramePyramidMaxLevels];
+	std::atomic<int> m_ready; // 已计算到的层。
+	std::atomic<bool> m_released;
+	std::mutex m_mutex; // 保护计算和第0层。
+};
+
+} // namespace wgc
@@ -0,0 +1,437 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "FrameServer.h"
+
+#include <afunix.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint64_t MaxMessageBytes = 1ull << 30;
+
+bool MakeAddress(const std::wstring& path, sockaddr_un& address) {
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	const int len = WideCharToMultiByte(
+		CP_ACP, 0, path.c_str(), static_cast<int>(path.size()),
+		address.sun_path, sizeof(address.sun_path) - 1, nullptr, nullptr
+	);
+	return len > 0 || path.empty();
+}
+
+/**
+ * @brief Send all the buffers with gather writes. The buffers are modified.
+ */
+bool SendAll(SOCKET socket, WSABUF* buffers, DWORD count) {
+	while (count > 0) {
+		DWORD sent = 0;
+		if (WSASend(socket, buffers, count, &sent, 0, nullptr, nullptr) != 0)
+			return false;
+		// Skip what has been sent, usually everything.
+		while (count > 0 && sent >= buffers->len) {
+			sent -= buffers->len;
+			++buffers;
+			--count;
+		}
+		if (count > 0) {
+			buffers->buf += sent;
+			buffers->len -= sent;
+		}
+	}
+	return true;
+}
+
+bool RecvAll(SOCKET socket, void* data, size_t size) {
+	char* ptr = static_cast<char*>(data);
+	while (size > 0) {
+		const int len = static_cast<int>(std::min<size_t>(size, 1u << 30));
+		const int res = recv(socket, ptr, len, 0);
+		if (res <= 0)
+			return false;
+		ptr += res;
+		size -= res;
+	}
+	return true;
+}
+
+bool IsValidRequest(const wgc::StreamRequest& request) {
+	return std::memcmp(request.magic, wgc::StreamRequestMagic, sizeof(request.magic)) == 0 &&
+		request.version == wgc::StreamProtocolVersion &&
+		request.format <= wgc::StreamFormat::Gray &&
+		request.scale > 0.0f && request.scale <= 1.0f;
+}
+
+/**
+ * @brief Apply ROI, scale and format of the request. The result may refer to 'frame', 'scaled' or 'converted'.
+ */
+cv::Mat ConvertForRequest(const cv::Mat& frame, const wgc::StreamRequest& request, cv::Mat& scaled, cv::Mat& converted) {
+	cv::Rect roi(0, 0, frame.cols, frame.rows);
+	if (request.roiWidth > 0 && request.roiHeight > 0)
+		roi &= cv::Rect(request.roiX, request.roiY, request.roiWidth, request.roiHeight);
+	if (roi.empty())
+		return cv::Mat();
+
+	cv::Mat res = frame(roi);
+	if (request.scale < 1.0f) {
+		const cv::Size size(
+			std::max(1, cvRound(roi.width * request.scale)),
+			std::max(1, cvRound(roi.height * request.scale))
+		);
+		cv::resize(res, scaled, size, 0.0, 0.0, cv::InterpolationFlags::INTER_AREA);
+		res = scaled;
+	}
+
+	int code = -1;
+	switch (request.format) {
+	case wgc::StreamFormat::BGRA:
+		if (res.channels() == 3)
+			code = cv::ColorConversionCodes::COLOR_BGR2BGRA;
+		break;
+	case wgc::StreamFormat::BGR:
+		if (res.channels() == 4)
+			code = cv::ColorConversionCodes::COLOR_BGRA2BGR;
+		break;
+	case wgc::StreamFormat::Gray:
+		if (res.channels() == 4)
+			code = cv::ColorConversionCodes::COLOR_BGRA2GRAY;
+		else if (res.channels() == 3)
+			code = cv::ColorConversionCodes::COLOR_BGR2GRAY;
+		break;
+	}
+	if (code >= 0) {
+		cv::cvtColor(res, converted, code);
+		res = converted;
+	}
+	return res;
+}
+
+} // namespace
+
+namespace wgc {
+
+std::shared_ptr<IFrameServer> IFrameServer::createInstance(const std::wstring& path, const FrameServerOptions& options) noexcept {
+	try {
+		return std::make_shared<FrameServer>(path, options);
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+std::shared_ptr<IFrameClient> IFrameClient::createInstance(const std::wstring& path, const StreamRequest& request) noexcept {
+	try {
+		return std::make_shared<FrameClient>(path, request);
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+FrameServer::FrameServer(const std::wstring& path, const FrameServerOptions& options) :
+	m_options(options),
+	m_path(path),
+	m_listen(INVALID_SOCKET),
+
+	m_pool(options.maxSubscribers * 2 + 1),
+	m_closed(false) {
+	if (m_options.maxSubscribers == 0 || m_options.tileSize <= 0)
+		throw std::invalid_argument("FrameServer: invalid options.");
+
+	sockaddr_un address;
+	if (!MakeAddress(path, address))
+		throw std::invalid_argument("FrameServer: invalid path.");
+
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		throw std::runtime_error("FrameServer: failed to start winsock.");
+
+	DeleteFileW(path.c_str()); // A socket file left by a previous server makes bind() fail.
+	m_listen = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_listen == INVALID_SOCKET ||
+		bind(m_listen, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+		listen(m_listen, SOMAXCONN) != 0) {
+		if (m_listen != INVALID_SOCKET)
+			closesocket(m_listen);
+		WSACleanup();
+		throw std::runtime_error("FrameServer: failed to listen.");
+	}
+
+	m_acceptor = std::thread(&FrameServer::AcceptLoop, this);
+}
+
+FrameServer::~FrameServer() {
+	close();
+	WSACleanup();
+}
+
+bool FrameServer::push(const cv::Mat& frame, const FrameInfo& info) {
+	if (frame.empty())
+		return false;
+
+	std::lock_guard lock(m_mutex);
+	if (m_closed)
+		return false;
+	ReapSubscribers();
+	if (m_subscribers.empty())
+		return true;
+
+	// One copy shared by all subscribers. It returns to the pool when the last one is done with it.
+	cv::Mat snapshot = m_pool.acquire(frame.size(), frame.type());
+	if (snapshot.empty())
+		return false;
+	frame.copyTo(snapshot);
+
+	for (const auto& subscriber : m_subscribers) {
+		{
+			std::lock_guard lockSub(subscriber->mutex);
+			if (subscriber->hasPending) {
+				++subscriber->skipped;
+				++subscriber->skippedSinceSent;
+			}
+			subscriber->pending = snapshot;
+			subscriber->pendingInfo = info;
+			subscriber->hasPending = true;
+		}
+		subscriber->cond.notify_one();
+	}
+	return true;
+}
+
+void FrameServer::close() {
+	std::lock_guard lockClose(m_mutex_close);
+	{
+		std::lock_guard lock(m_mutex);
+		if (m_closed)
+			return;
+		m_closed = true;
+	}
+	closesocket(m_listen); // Wakes up accept().
+	if (m_acceptor.joinable())
+		m_acceptor.join();
+
+	std::lock_guard lock(m_mutex);
+	for (const auto& subscriber : m_subscribers)
+		StopSubscriber(subscriber.get());
+	m_subscribers.clear();
+	m_pool.trim();
+	DeleteFileW(m_path.c_str());
+}
+
+std::vector<SubscriberStats> FrameServer::getStats() {
+	std::lock_guard lock(m_mutex);
+	std::vector<SubscriberStats> res;
+	res.reserve(m_subscribers.size());
+	for (const auto& subscriber : m_subscribers) {
+		if (subscriber->finished || !subscriber->ready)
+			continue;
+		SubscriberStats stats;
+		stats.request = subscriber->request;
+		stats.sent = subscriber->sent;
+		stats.skipped = subscriber->skipped;
+		stats.bytes = subscriber->bytes;
+		res.push_back(stats);
+	}
+	return res;
+}
+
+void FrameServer::AcceptLoop() {
+	while (true) {
+		const SOCKET client = accept(m_listen, nullptr, nullptr);
+		if (client == INVALID_SOCKET)
+			break; // Closed.
+
+		// The request is read on the subscriber's thread, so a silent client does not delay the others.
+		std::lock_guard lock(m_mutex);
+		ReapSubscribers();
+		if (m_closed || m_subscribers.size() >= m_options.maxSubscribers) {
+			closesocket(client);
+			continue;
+		}
+		auto subscriber = std::make_unique<Subscriber>();
+		subscriber->socket = client;
+		subscriber->thread = std::thread(&FrameServer::SubscriberLoop, this, subscriber.get());
+		m_subscribers.push_back(std::move(subscriber));
+	}
+}
+
+void FrameServer::SubscriberLoop(Subscriber* subscriber) {
+	if (!ReadRequest(subscriber)) {
+		subscriber->finished = true; // Closed by the next push or connection.
+		return;
+	}
+
+	cv::Mat frame, scaled, converted;
+	FrameInfo info;
+	uint64_t skipped = 0;
+	std::vector<uint8_t> encoded;
+
+	while (true) {
+		{
+			std::unique_lock lock(subscriber->mutex);
+			subscriber->cond.wait(lock, [subscriber]() -> bool { return subscriber->hasPending || subscriber->closing; });
+			if (subscriber->closing)
+				break;
+			frame = subscriber->pending;
+			subscriber->pending.release();
+			info = subscriber->pendingInfo;
+			skipped = subscriber->skippedSinceSent;
+			subscriber->skippedSinceSent = 0;
+			subscriber->hasPending = false;
+		}
+
+		const cv::Mat output = ConvertForRequest(frame, subscriber->request, scaled, converted);
+		const bool encodedRes = !output.empty() && subscriber->encoder->encode(output, encoded);
+		frame.release(); // Back to the pool as soon as possible.
+		if (output.empty())
+			continue;
+		if (!encodedRes)
+			break;
+
+		StreamMessageHeader header;
+		std::memcpy(header.magic, StreamMessageMagic, sizeof(header.magic));
+		header.headerSize = sizeof(StreamMessageHeader);
+		header.sequence = info.sequence;
+		header.timestamp = info.timestamp;
+		header.dataSize = encoded.size();
+		header.skipped = skipped;
+
+		WSABUF buffers[2];
+		buffers[0].buf = reinterpret_cast<char*>(&header);
+		buffers[0].len = sizeof(header);
+		buffers[1].buf = reinterpret_cast<char*>(encoded.data());
+		buffers[1].len = static_cast<ULONG>(encoded.size());
+		if (!SendAll(subscriber->socket, buffers, 2))
+			break; // Disconnected.
+
+		++subscriber->sent;
+		subscriber->bytes += sizeof(header) + encoded.size();
+	}
+	subscriber->finished = true;
+}
+
+bool FrameServer::ReadRequest(Subscriber* subscriber) {
+	// A client that stays silent is dropped after a second.
+	const DWORD timeout = 1000;
+	setsockopt(subscriber->socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
+	StreamRequest request;
+	if (!RecvAll(subscriber->socket, &request, sizeof(request)) || !IsValidRequest(request))
+		return false;
+	DeltaCodecOptions codecOptions;
+	codecOptions.tileSize = m_options.tileSize;
+	codecOptions.keyframeInterval = static_cast<int>(std::min<uint32_t>(request.keyframeInterval, INT_MAX));
+	subscriber->encoder = IDeltaEncoder::createInstance(codecOptions);
+	if (subscriber->encoder == nullptr)
+		return false;
+	subscriber->request = request;
+	subscriber->ready = true;
+	return true;
+}
+
+void FrameServer::StopSubscriber(Subscriber* subscriber) {
+	{
+		std::lock_guard lock(subscriber->mutex);
+		subscriber->closing = true;
+		subscriber->pending.release();
+	}
+	subscriber->cond.notify_one();
+	shutdown(subscriber->socket, SD_BOTH); // Wakes up a blocking send.
+	if (subscriber->thread.joinable())
+		subscriber->thread.join();
+	closesocket(subscriber->socket);
+}
+
+void FrameServer::ReapSubscribers() {
+	for (auto i = m_subscribers.begin(); i != m_subscribers.end();) {
+		if ((*i)->finished) {
+			StopSubscriber(i->get());
+			i = m_subscribers.erase(i);
+		}
+		else {
+			++i;
+		}
+	}
+}
+
+FrameClient::FrameClient(const std::wstring& path, const StreamRequest& request) :
+	m_socket(INVALID_SOCKET),
+	m_skipped(0) {
+	sockaddr_un address;
+	if (!MakeAddress(path, address) || !IsValidRequest(request))
+		throw std::invalid_argument("FrameClient: invalid argument.");
+
+	m_decoder = IDeltaDecoder::createInstance();
+	if (m_decoder == nullptr)
+		throw std::runtime_error("FrameClient: failed to create decoder.");
+
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		throw std::runtime_error("FrameClient: failed to start winsock.");
+
+	m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	StreamRequest sending = request;
+	WSABUF buffer;
+	buffer.buf = reinterpret_cast<char*>(&sending);
+	buffer.len = sizeof(sending);
+	if (m_socket == INVALID_SOCKET ||
+		connect(m_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+		!SendAll(m_socket, &buffer, 1)) {
+		if (m_socket != INVALID_SOCKET)
+			closesocket(m_socket);
+		WSACleanup();
+		throw std::runtime_error("FrameClient: failed to connect.");
+	}
+}
+
+FrameClient::~FrameClient() {
+	closesocket(m_socket);
+	WSACleanup();
+}
+
+bool FrameClient::receive(cv::Mat& frame, FrameInfo& info) {
+	StreamMessageHeader header;
+	if (!RecvAll(m_socket, &header, sizeof(header)) ||
+		std::memcmp(header.magic, StreamMessageMagic, sizeof(header.magic)) != 0 ||
+		header.headerSize != sizeof(StreamMessageHeader) ||
+		header.dataSize == 0 || header.dataSize > MaxMessageBytes)
+		return false;
+
+	m_data.resize(static_cast<size_t>(header.dataSize));
+	if (!RecvAll(m_socket, m_data.data(), m_data.size()))
+		return false;
+	if (!m_decoder->decode(m_data.data(), m_data.size(), frame))
+		return false;
+
+	m_skipped += header.skipped;
+	info.sequence = header.sequence;
+	info.timestamp = header.timestamp;
+	info.width = frame.cols;
+	info.height = frame.rows;
+	return true;
+}
+
+uint64_t FrameClient::getSkippedCount() {
+	return m_skipped;
+}
+
+} // namespace wgc
@@ -0,0 +1,125 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <winsock2.h>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <condition_variable>
+#include "include/WGC/FrameServer.h"
+#include "include/WGC/DeltaCodec.h"
+#include "FramePool.h"
+
+namespace wgc {
+
+/**
+ * @brief 帧服务器。每个订阅者一个线程，只发送最新的帧。
+*/
+class FrameServer final :
+	public IFrameServer {
+public:
+	/**
+	 * @brief This function may throws.
+	 */
+	FrameServer(const std::wstring& path, const FrameServerOptions& options);
+
+	~FrameServer();
+
+public:
+	virtual bool push(const cv::Mat& frame, const FrameInfo& info) override;
+	virtual void close() override;
+
+	virtual std::vector<SubscriberStats> getStats() override;
+
+protected:
+	struct Subscriber {
+		SOCKET socket = INVALID_SOCKET;
+		StreamRequest request; // 由订阅者的线程读取，之后只读。
+		std::shared_ptr<IDeltaEncoder> encoder;
+		std::thread thread;
+
+		std::mutex mutex;
+		std::condition_variable cond;
+		cv::Mat pending; // 等待发送的最新帧，来自池，与其他订阅者共享，只读。
+		FrameInfo pendingInfo;
+		bool hasPending = false;
+		bool closing = false;
+		uint64_t skippedSinceSent = 0;
+
+		std::atomic<bool> ready = false; // 已读取request。
+		std::atomic<bool> finished = false;
+		std::atomic<size_t> sent = 0;
+		std::atomic<size_t> skipped = 0;
+		std::atomic<uint64_t> bytes = 0;
+	};
+
+	void AcceptLoop();
+	void SubscriberLoop(Subscriber* subscriber);
+	/**
+	 * @brief 在订阅者的线程上读取并检查请求，创建编码器。
+	*/
+	bool ReadRequest(Subscriber* subscriber);
+	void StopSubscriber(Subscriber* subscriber);
+	void ReapSubscribers();
+
+protected:
+	FrameServerOptions m_options;
+	std::wstring m_path;
+	SOCKET m_listen;
+	std::thread m_acceptor;
+
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<Subscriber>> m_subscribers;
+	FramePool m_pool;
+	bool m_closed;
+	std::mutex m_mutex_close;
+};
+
+/**
+ * @brief 帧服务器的客户端。
+*/
+class FrameClient final :
+	public IFrameClient {
+public:
+	/**
+	 * @brief This function may throws.
+	 */
+	FrameClient(const std::wstring& path, const StreamRequest& request);
+
+	~FrameClient();
+
+public:
+	virtual bool receive(cv::Mat& frame, FrameInfo& info) override;
+
+	virtual uint64_t getSkippedCount() override;
+
+protected:
+	SOCKET m_socket;
+	std::shared_ptr<IDeltaDecoder> m_decoder;
+	std::vector<uint8_t> m_data;
+	uint64_t m_skipped;
+};
+
+} // namespace wgc
@@ -0,0 +1,127 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "GraphicsDevice.h"
+
+#include <chrono>
+
+using namespace winrt;
+using namespace winrt::Windows::Graphics::Capture;
+
+namespace {
+
+struct __declspec(uuid("A9B3D012-3DF2-4EE3-B8D1-8695F457D3C1"))
+	IDirect3DDxgiInterfaceAccess : ::IUnknown {
+	virtual HRESULT __stdcall GetInterface(GUID const& id, void** object) = 0;
+};
+
+template <typename T> inline auto GetDXGIInterfaceFromObject(winrt::Windows::Foundation::IInspectable const& object) {
+	auto access = object.as<::IDirect3DDxgiInterfaceAccess>();
+	winrt::com_ptr<T> result;
+	winrt::check_hresult(access->GetInterface(winrt::guid_of<T>(), result.put_void()));
+	return result;
+}
+
+inline auto CreateD3DDevice(
+	D3D_DRIVER_TYPE const type,
+	com_ptr<ID3D11Device>& device
+) {
+	WINRT_ASSERT(!device);
+	constexpr UINT flags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
+	return D3D11CreateDevice(nullptr, type, nullptr, flags, nullptr, 0, D3D11_SDK_VERSION, device.put(), nullptr, nullptr);
+}
+
+inline auto CreateD3DDevice() {
+	com_ptr<ID3D11Device> device;
+	HRESULT hr = CreateD3DDevice(D3D_DRIVER_TYPE_HARDWARE, device);
+	if (DXGI_ERROR_UNSUPPORTED == hr)
+		hr = CreateD3DDevice(D3D_DRIVER_TYPE_WARP, device);
+	check_hresult(hr);
+	return device;
+}
+
+extern "C" {
+	HRESULT __stdcall CreateDirect3D11DeviceFromDXGIDevice(
+		IDXGIDevice* dxgiDevice,
+		::IInspectable** graphicsDevice
+	);
+}
+
+inline auto CreateDirect3DDevice(IDXGIDevice* dxgi_device) {
+	com_ptr<::IInspectable> d3d_device;
+	check_hresult(CreateDirect3D11DeviceFromDXGIDevice(dxgi_device, d3d_device.put()));
+	return d3d_device.as<Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice>();
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+namespace wgc {
+
+GraphicsDevice::GraphicsDevice(StartupTimes& times) :
+	m_device(nullptr) {
+	auto start = std::chrono::steady_clock::now();
+	com_ptr<ID3D11Device> d3dDevice = CreateD3DDevice();
+	times.deviceSeconds = SecondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	com_ptr<IDXGIDevice> dxgiDevice = d3dDevice.as<IDXGIDevice>();
+	m_device = CreateDirect3DDevice(dxgiDevice.get());
+	m_d3dDevice = ::GetDXGIInterfaceFromObject<ID3D11Device>(m_device);
+	m_d3dDevice->GetImmediateContext(m_context.put());
+	// The factory is agile, so it can be used from any thread, and is resolved only once.
+	m_interop = get_activation_factory<GraphicsCaptureItem>().as<IGraphicsCaptureItemInterop>();
+	times.interopSeconds = SecondsSince(start);
+}
+
+GraphicsDevice::~GraphicsDevice() {
+	m_interop = nullptr;
+	m_context = nullptr;
+	m_d3dDevice = nullptr;
+	m_device.Close();
+}
+
+winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice const& GraphicsDevice::getDevice() const {
+	return m_device;
+}
+
+winrt::com_ptr<ID3D11Device> const& GraphicsDevice::getD3DDevice() const {
+	return m_d3dDevice;
+}
+
+winrt::com_ptr<ID3D11DeviceContext> const& GraphicsDevice::getContext() const {
+	return m_context;
+}
+
+bool GraphicsDevice::createItemForWindow(GraphicsCaptureItem& item, HWND hwnd) const {
+	const auto res = m_interop->CreateForWindow(hwnd, guid_of<IGraphicsCaptureItem>(), put_abi(item));
+	return res == S_OK;
+}
+
+bool GraphicsDevice::createItemForMonitor(GraphicsCaptureItem& item, HMONITOR hmonitor) const {
+	const auto res = m_interop->CreateForMonitor(hmonitor, guid_of<IGraphicsCaptureItem>(), put_abi(item));
+	return res == S_OK;
+}
+
+} // namespace wgc
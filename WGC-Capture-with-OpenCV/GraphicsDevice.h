@@ -0,0 +1,60 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <windows.graphics.capture.interop.h>
+#include "include/WGC/WGC.h"
+
+namespace wgc {
+
+/**
+ * @brief 工厂的所有截取器共用的图形设备，以及开始截取时要用的接口。创建一次，每次开始截取不再重新获取。
+*/
+class GraphicsDevice final {
+public:
+	/**
+	 * @brief 创建设备并获取激活工厂，同时把各步耗时写入times。
+	 * @brief This function may throws.
+	 */
+	explicit GraphicsDevice(StartupTimes& times);
+	~GraphicsDevice();
+
+public:
+	winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice const& getDevice() const;
+	winrt::com_ptr<ID3D11Device> const& getD3DDevice() const;
+	winrt::com_ptr<ID3D11DeviceContext> const& getContext() const;
+
+	/**
+	 * @brief 用缓存的激活工厂创建截取项。
+	 */
+	bool createItemForWindow(winrt::Windows::Graphics::Capture::GraphicsCaptureItem& item, HWND hwnd) const;
+	bool createItemForMonitor(winrt::Windows::Graphics::Capture::GraphicsCaptureItem& item, HMONITOR hmonitor) const;
+
+protected:
+	winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice m_device;
+	winrt::com_ptr<ID3D11Device> m_d3dDevice;
+	winrt::com_ptr<ID3D11DeviceContext> m_context; // 即时上下文，与设备一样由所有截取器共用。
+	winrt::com_ptr<IGraphicsCaptureItemInterop> m_interop;
+};
+
+} // namespace wgc
@@ -0,0 +1,178 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "ImageSaver.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+bool WriteWholeFile(const std::wstring& path, const std::vector<uchar>& data) {
+	HANDLE file = CreateFileW(
+		path.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL
+	);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	DWORD written = 0;
+	const bool res =
+		WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &written, nullptr) &&
+		written == data.size();
+	CloseHandle(file);
+	return res;
+}
+
+} // namespace
+
+namespace wgc {
+
+ImageSaver::ImageSaver(size_t threads, size_t maxQueued) :
+	m_threadCount(threads),
+	m_maxQueued(maxQueued),
+	m_running(0),
+	m_stop(false) {
+	if (m_threadCount == 0)
+		m_threadCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+	if (m_maxQueued == 0)
+		m_maxQueued = 1;
+}
+
+ImageSaver::~ImageSaver() {
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_cond_job.notify_all();
+	m_cond_slot.notify_all();
+	for (std::thread& thread : m_threads)
+		thread.join(); // Queued images are still saved.
+}
+
+std::future<bool> ImageSaver::post(
+	cv::Mat image, const std::wstring& path,
+	ImageFormat format, const SaveOptions& options,
+	bool wait, double* waitedSeconds,
+	std::function<void(bool)> done
+) {
+	Job job;
+	job.image = std::move(image);
+	job.path = path;
+	job.format = format;
+	job.options = options;
+	job.done = std::move(done);
+	std::future<bool> res = job.promise.get_future();
+
+	{
+		std::unique_lock lock(m_mutex);
+		if (wait && !m_stop && m_jobs.size() >= m_maxQueued) {
+			const auto start = std::chrono::steady_clock::now();
+			m_cond_slot.wait(lock, [this]() -> bool { return m_stop || m_jobs.size() < m_maxQueued; });
+			if (waitedSeconds != nullptr)
+				*waitedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		if (m_stop || m_jobs.size() >= m_maxQueued) {
+			lock.unlock();
+			job.image.release();
+			if (job.done)
+				job.done(false);
+			job.promise.set_value(false);
+			return res;
+		}
+		if (m_threads.empty()) {
+			for (size_t i = 0; i < m_threadCount; ++i)
+				m_threads.emplace_back(&ImageSaver::WorkerLoop, this);
+		}
+		m_jobs.push_back(std::move(job));
+	}
+	m_cond_job.notify_one();
+	return res;
+}
+
+size_t ImageSaver::getPending() {
+	std::lock_guard lock(m_mutex);
+	return m_jobs.size() + m_running;
+}
+
+void ImageSaver::WorkerLoop() {
+	while (true) {
+		Job job;
+		{
+			std::unique_lock lock(m_mutex);
+			m_cond_job.wait(lock, [this]() -> bool { return m_stop || !m_jobs.empty(); });
+			if (m_jobs.empty())
+				return;
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			++m_running;
+		}
+		m_cond_slot.notify_one();
+
+		bool res = false;
+		try {
+			res = Save(job);
+		}
+		catch (...) {}
+		job.image.release(); // Give the buffer back to its pool before anyone waits on the result.
+		if (job.done)
+			job.done(res);
+		job.promise.set_value(res);
+
+		std::lock_guard lock(m_mutex);
+		--m_running;
+	}
+}
+
+const wchar_t* ImageSaver::GetExtension(ImageFormat format) {
+	switch (format) {
+	case ImageFormat::JPEG:
+		return L".jpg";
+	case ImageFormat::WebP:
+		return L".webp";
+	default:
+		return L".png";
+	}
+}
+
+bool ImageSaver::Save(const Job& job) {
+	const char* ext = ".png";
+	std::vector<int> params;
+	switch (job.format) {
+	case ImageFormat::PNG:
+		params = { cv::IMWRITE_PNG_COMPRESSION, std::clamp(job.options.pngCompression, 0, 9) };
+		break;
+	case ImageFormat::JPEG:
+		ext = ".jpg";
+		params = { cv::IMWRITE_JPEG_QUALITY, std::clamp(job.options.quality, 1, 100) };
+		break;
+	case ImageFormat::WebP:
+		ext = ".webp";
+		params = { cv::IMWRITE_WEBP_QUALITY, std::max(job.options.quality, 1) };
+		break;
+	}
+
+	std::vector<uchar> data;
+	if (!cv::imencode(ext, job.image, data, params))
+		return false;
+	return WriteWholeFile(job.path, data);
+}
+
+} // namespace wgc
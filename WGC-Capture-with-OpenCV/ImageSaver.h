@@ -0,0 +1,97 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <mutex>
+#include <deque>
+#include <functional>
+#include <future>
+#include <thread>
+#include <condition_variable>
+#include "include/WGC/WGC.h"
+
+namespace wgc {
+
+/**
+ * @brief 图片保存线程池：在后台线程编码并写入文件，队列有上限。
+*/
+class ImageSaver final {
+public:
+	/**
+	 * @param threads: 编码线程数，0表示按CPU数决定。
+	 * @param maxQueued: 排队的图片数上限。
+	*/
+	ImageSaver(size_t threads, size_t maxQueued);
+
+	~ImageSaver();
+
+public:
+	/**
+	 * @brief 提交一张图片。图片不会被复制，提交后不要再修改它。
+	 * @param wait: 队列满时是否等待。不等待则立即返回false的future。
+	 * @param waitedSeconds: 若不为空，写入等待的时间。
+	 * @param done: 若不为空，保存结束后（图片已释放）在编码线程上调用。
+	*/
+	std::future<bool> post(
+		cv::Mat image, const std::wstring& path,
+		ImageFormat format, const SaveOptions& options,
+		bool wait, double* waitedSeconds = nullptr,
+		std::function<void(bool)> done = nullptr
+	);
+
+	/**
+	 * @brief 排队及正在编码的图片数。
+	*/
+	size_t getPending();
+
+	/**
+	 * @brief 文件扩展名，包括点。
+	*/
+	static const wchar_t* GetExtension(ImageFormat format);
+
+protected:
+	struct Job {
+		cv::Mat image;
+		std::wstring path;
+		ImageFormat format;
+		SaveOptions options;
+		std::promise<bool> promise;
+		std::function<void(bool)> done;
+	};
+
+	void WorkerLoop();
+	static bool Save(const Job& job);
+
+protected:
+	size_t m_threadCount;
+	size_t m_maxQueued;
+	size_t m_running; // 正在编码的图片数。
+	bool m_stop;
+	std::deque<Job> m_jobs;
+	std::vector<std::thread> m_threads; // 第一次提交时才创建。
+	std::mutex m_mutex;
+	std::condition_variable m_cond_job;
+	std::condition_variable m_cond_slot;
+};
+
+} // namespace wgc
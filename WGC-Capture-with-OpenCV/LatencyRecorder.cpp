@@ -0,0 +1,127 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "LatencyRecorder.h"
+
+#include <algorithm>
+
+namespace {
+
+/**
+ * @brief 已排序样本的百分位数，取最近的秩。
+*/
+double Percentile(const std::vector<float>& sorted, double p) {
+	if (sorted.empty())
+		return 0.0;
+	const size_t rank = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+	return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+} // namespace
+
+namespace wgc {
+
+LatencyRecorder::LatencyRecorder() :
+	m_maxSamples(65536) {}
+
+void LatencyRecorder::setPreset(const std::string& preset, size_t maxSamples) {
+	m_preset = preset;
+	m_maxSamples = std::max<size_t>(maxSamples, 1);
+}
+
+void LatencyRecorder::add(LatencyMode mode, double ms) {
+	Series& series = Get(mode);
+	if (series.count == 0) {
+		series.minMs = ms;
+		series.maxMs = ms;
+	}
+	else {
+		series.minMs = std::min(series.minMs, ms);
+		series.maxMs = std::max(series.maxMs, ms);
+	}
+	series.sumMs += ms;
+	++series.count;
+	if (series.samples.size() != m_maxSamples && series.next != 0) {
+		// The limit changed after the ring was full, put it in order first.
+		std::rotate(series.samples.begin(), series.samples.begin() + series.next, series.samples.end());
+		series.next = 0;
+	}
+	if (series.samples.size() > m_maxSamples)
+		series.samples.erase(series.samples.begin(), series.samples.end() - m_maxSamples); // Keep the latest.
+	if (series.samples.size() < m_maxSamples) {
+		series.samples.push_back(static_cast<float>(ms));
+		return;
+	}
+	series.samples[series.next] = static_cast<float>(ms);
+	series.next = (series.next + 1) % series.samples.size();
+}
+
+void LatencyRecorder::addUndecoded(LatencyMode mode) {
+	++Get(mode).undecoded;
+}
+
+std::vector<LatencyStats> LatencyRecorder::getStats() const {
+	std::vector<LatencyStats> result;
+	result.reserve(m_series.size());
+	std::vector<float> sorted;
+	for (const Series& series : m_series) {
+		LatencyStats stats = {};
+		stats.preset = series.preset;
+		stats.mode = series.mode;
+		stats.count = series.count;
+		stats.undecoded = series.undecoded;
+		if (series.count > 0) {
+			stats.minMs = series.minMs;
+			stats.maxMs = series.maxMs;
+			stats.meanMs = series.sumMs / series.count;
+		}
+		// In arrival order: the ring starts at 'next' once it is full.
+		stats.samples.reserve(series.samples.size());
+		stats.samples.insert(stats.samples.end(), series.samples.begin() + series.next, series.samples.end());
+		stats.samples.insert(stats.samples.end(), series.samples.begin(), series.samples.begin() + series.next);
+
+		sorted = stats.samples;
+		std::sort(sorted.begin(), sorted.end());
+		stats.p50Ms = Percentile(sorted, 0.50);
+		stats.p90Ms = Percentile(sorted, 0.90);
+		stats.p99Ms = Percentile(sorted, 0.99);
+		result.push_back(std::move(stats));
+	}
+	return result;
+}
+
+void LatencyRecorder::reset() {
+	m_series.clear();
+}
+
+LatencyRecorder::Series& LatencyRecorder::Get(LatencyMode mode) {
+	for (Series& series : m_series) {
+		if (series.mode == mode && series.preset == m_preset)
+			return series;
+	}
+	Series series = {};
+	series.preset = m_preset;
+	series.mode = mode;
+	m_series.push_back(std::move(series));
+	return m_series.back();
+}
+
+} // namespace wgc
@@ -0,0 +1,74 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <string>
+#include <vector>
+#include "include/WGC/WGC.h"
+
+namespace wgc {
+
+/**
+ * @brief 按预设和投递方式记录延迟。不加锁，由使用者保护。
+*/
+class LatencyRecorder final {
+public:
+	LatencyRecorder();
+
+public:
+	/**
+	 * @brief 之后的结果记在preset下。已有的结果保留。
+	 */
+	void setPreset(const std::string& preset, size_t maxSamples);
+
+	void add(LatencyMode mode, double ms);
+	void addUndecoded(LatencyMode mode);
+
+	std::vector<LatencyStats> getStats() const;
+	void reset();
+
+protected:
+	/**
+	 * @brief 一个预设在一种方式下的结果。样本保存在环形数组中。
+	 */
+	struct Series {
+		std::string preset;
+		LatencyMode mode;
+		size_t count;
+		size_t undecoded;
+		double minMs;
+		double maxMs;
+		double sumMs;
+		std::vector<float> samples;
+		size_t next; // samples满后，下一个要覆盖的位置。
+	};
+
+	Series& Get(LatencyMode mode);
+
+protected:
+	std::string m_preset;
+	size_t m_maxSamples;
+	std::vector<Series> m_series; // 按首次出现的顺序。
+};
+
+} // namespace wgc
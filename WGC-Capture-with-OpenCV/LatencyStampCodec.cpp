@@ -0,0 +1,157 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "LatencyStampCodec.h"
+
+#include <stdexcept>
+
+namespace {
+
+constexpr int StampBytes = wgc::LatencyStampColumns * wgc::LatencyStampRows / 8; // 16字节。
+constexpr uint8_t StampMagic[2] = { 'W', 'L' };
+constexpr int MaxCellSize = 256;
+
+uint16_t Fletcher16(const uint8_t* data, size_t size) {
+	uint32_t a = 0;
+	uint32_t b = 0;
+	for (size_t i = 0; i < size; ++i) {
+		a = (a + data[i]) % 255;
+		b = (b + a) % 255;
+	}
+	return static_cast<uint16_t>((b << 8) | a);
+}
+
+void Pack(const wgc::LatencyStamp& stamp, uint8_t* bytes) {
+	bytes[0] = StampMagic[0];
+	bytes[1] = StampMagic[1];
+	for (int i = 0; i < 4; ++i)
+		bytes[2 + i] = static_cast<uint8_t>(stamp.counter >> (8 * i));
+	const uint64_t timestamp = static_cast<uint64_t>(stamp.timestamp);
+	for (int i = 0; i < 8; ++i)
+		bytes[6 + i] = static_cast<uint8_t>(timestamp >> (8 * i));
+	const uint16_t check = Fletcher16(bytes, 14);
+	bytes[14] = static_cast<uint8_t>(check);
+	bytes[15] = static_cast<uint8_t>(check >> 8);
+}
+
+bool Unpack(const uint8_t* bytes, wgc::LatencyStamp& stamp) {
+	if (bytes[0] != StampMagic[0] || bytes[1] != StampMagic[1])
+		return false;
+	const uint16_t check = Fletcher16(bytes, 14);
+	if (bytes[14] != static_cast<uint8_t>(check) || bytes[15] != static_cast<uint8_t>(check >> 8))
+		return false;
+	uint32_t counter = 0;
+	for (int i = 0; i < 4; ++i)
+		counter |= static_cast<uint32_t>(bytes[2 + i]) << (8 * i);
+	uint64_t timestamp = 0;
+	for (int i = 0; i < 8; ++i)
+		timestamp |= static_cast<uint64_t>(bytes[6 + i]) << (8 * i);
+	stamp.counter = counter;
+	stamp.timestamp = static_cast<int64_t>(timestamp);
+	return true;
+}
+
+} // namespace
+
+namespace wgc {
+
+std::shared_ptr<ILatencyStampCodec> ILatencyStampCodec::createInstance(const LatencyStampLayout& layout) noexcept {
+	if (!LatencyStampCodec::IsValid(layout))
+		return nullptr;
+	try {
+		return std::make_shared<LatencyStampCodec>(layout);
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+int64_t ILatencyStampCodec::now() noexcept {
+	static const int64_t frequency = []() -> int64_t {
+		LARGE_INTEGER f;
+		QueryPerformanceFrequency(&f);
+		return f.QuadPart;
+	}();
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	// Split to avoid overflow of counter * 10^7.
+	return counter.QuadPart / frequency * 10000000 + counter.QuadPart % frequency * 10000000 / frequency;
+}
+
+LatencyStampCodec::LatencyStampCodec(const LatencyStampLayout& layout) :
+	m_layout(layout) {
+	if (!IsValid(layout))
+		throw std::invalid_argument("LatencyStampCodec: invalid layout.");
+}
+
+bool LatencyStampCodec::IsValid(const LatencyStampLayout& layout) {
+	return layout.origin.x >= 0 && layout.origin.y >= 0 &&
+		layout.cellSize >= 2 && layout.cellSize <= MaxCellSize;
+}
+
+cv::Size LatencyStampCodec::getSize() {
+	return cv::Size(LatencyStampColumns * m_layout.cellSize, LatencyStampRows * m_layout.cellSize);
+}
+
+bool LatencyStampCodec::encode(cv::Mat& frame, const LatencyStamp& stamp) {
+	if (frame.type() != CV_8UC4 && frame.type() != CV_8UC3)
+		return false;
+	const cv::Rect area(m_layout.origin, getSize());
+	if ((area & cv::Rect(0, 0, frame.cols, frame.rows)) != area)
+		return false;
+
+	uint8_t bytes[StampBytes];
+	Pack(stamp, bytes);
+	const cv::Scalar white(255, 255, 255, 255);
+	const cv::Scalar black(0, 0, 0, 255);
+	for (int bit = 0; bit < StampBytes * 8; ++bit) {
+		const bool one = (bytes[bit / 8] >> (7 - bit % 8)) & 1;
+		const cv::Rect cell(
+			m_layout.origin.x + (bit % LatencyStampColumns) * m_layout.cellSize,
+			m_layout.origin.y + (bit / LatencyStampColumns) * m_layout.cellSize,
+			m_layout.cellSize, m_layout.cellSize
+		);
+		frame(cell).setTo(one ? white : black);
+	}
+	return true;
+}
+
+bool LatencyStampCodec::decode(const cv::Mat& frame, double scale, LatencyStamp& stamp) {
+	if ((frame.type() != CV_8UC4 && frame.type() != CV_8UC3) || !(scale > 0.0))
+		return false;
+	const int channels = frame.channels();
+	uint8_t bytes[StampBytes] = {};
+	for (int bit = 0; bit < StampBytes * 8; ++bit) {
+		// Centre of the cell, in the scaled frame.
+		const double cx = m_layout.origin.x + (bit % LatencyStampColumns + 0.5) * m_layout.cellSize;
+		const double cy = m_layout.origin.y + (bit / LatencyStampColumns + 0.5) * m_layout.cellSize;
+		const int x = static_cast<int>(cx * scale);
+		const int y = static_cast<int>(cy * scale);
+		if (x >= frame.cols || y >= frame.rows)
+			return false;
+		const uint8_t* pixel = frame.ptr<uint8_t>(y) + static_cast<size_t>(x) * channels;
+		const int sum = pixel[0] + pixel[1] + pixel[2];
+		if (sum >= 3 * 128)
+			bytes[bit / 8] |= static_cast<uint8_t>(1 << (7 - bit % 8));
+	}
+	return Unpack(bytes, stamp);
+}
+
+} // namespace wgc
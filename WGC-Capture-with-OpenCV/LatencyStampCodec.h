@@ -0,0 +1,51 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include "include/WGC/LatencyProbe.h"
+
+namespace wgc {
+
+/**
+ * @brief 延迟戳的编码和解码。只读写各格的中心，不处理整帧。
+*/
+class LatencyStampCodec final :
+	public ILatencyStampCodec {
+public:
+	/**
+	 * @brief This function may throws.
+	 */
+	explicit LatencyStampCodec(const LatencyStampLayout& layout = {});
+
+public:
+	static bool IsValid(const LatencyStampLayout& layout);
+
+	virtual cv::Size getSize() override;
+	virtual bool encode(cv::Mat& frame, const LatencyStamp& stamp) override;
+	virtual bool decode(const cv::Mat& frame, double scale, LatencyStamp& stamp) override;
+
+protected:
+	LatencyStampLayout m_layout;
+};
+
+} // namespace wgc
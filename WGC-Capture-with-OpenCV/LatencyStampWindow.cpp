@@ -0,0 +1,153 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "LatencyStampWindow.h"
+
+#include <mutex>
+#include <stdexcept>
+#include <dwmapi.h>
+
+namespace {
+
+constexpr wchar_t WindowClassName[] = L"WGCLatencyStampWindow";
+constexpr uint8_t BorderGrey = 128; // 边框的灰度，与黑白两种格子都能区分。
+
+bool RegisterWindowClass() {
+	static std::once_flag once;
+	static bool registered = false;
+	std::call_once(once, []() -> void {
+		WNDCLASSEXW wc = { sizeof(WNDCLASSEXW) };
+		wc.lpfnWndProc = DefWindowProcW;
+		wc.hInstance = GetModuleHandleW(nullptr);
+		wc.hCursor = LoadCursorW(NULL, IDC_ARROW);
+		wc.lpszClassName = WindowClassName;
+		registered = RegisterClassExW(&wc) != 0 || GetLastError() == ERROR_CLASS_ALREADY_EXISTS;
+	});
+	return registered;
+}
+
+} // namespace
+
+namespace wgc {
+
+std::shared_ptr<ILatencyStampWindow> ILatencyStampWindow::createInstance(const LatencyStampWindowOptions& options) noexcept {
+	try {
+		return std::make_shared<LatencyStampWindow>(options);
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+LatencyStampWindow::LatencyStampWindow(const LatencyStampWindowOptions& options) :
+	m_options(options),
+	m_codec(LatencyStampLayout{ cv::Point(options.margin, options.margin), options.cellSize }),
+	m_hwnd(NULL),
+	m_stop(false),
+	m_drawn(0) {
+	if (options.margin < 0)
+		throw std::invalid_argument("LatencyStampWindow: invalid margin.");
+	if (!RegisterWindowClass())
+		throw std::runtime_error("LatencyStampWindow: failed to register the window class.");
+	const cv::Size stamp = m_codec.getSize();
+	m_image.create(stamp.height + 2 * options.margin, stamp.width + 2 * options.margin, CV_8UC4);
+	m_image.setTo(cv::Scalar(BorderGrey, BorderGrey, BorderGrey, 255));
+
+	// The window belongs to the thread that creates it, and that thread pumps its messages.
+	std::promise<HWND> created;
+	std::future<HWND> hwnd = created.get_future();
+	m_thread = std::thread(&LatencyStampWindow::WindowLoop, this, std::ref(created));
+	m_hwnd = hwnd.get();
+	if (m_hwnd == NULL) {
+		m_thread.join();
+		throw std::runtime_error("LatencyStampWindow: failed to create the window.");
+	}
+}
+
+LatencyStampWindow::~LatencyStampWindow() {
+	m_stop = true;
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+HWND LatencyStampWindow::getWindow() {
+	return m_hwnd;
+}
+
+LatencyStampLayout LatencyStampWindow::getLayout(bool monitorCapture) {
+	LatencyStampLayout layout = { cv::Point(m_options.margin, m_options.margin), m_options.cellSize };
+	if (!monitorCapture)
+		return layout;
+	RECT rect = {};
+	GetWindowRect(m_hwnd, &rect);
+	MONITORINFO info = { sizeof(MONITORINFO) };
+	if (GetMonitorInfoW(MonitorFromWindow(m_hwnd, MONITOR_DEFAULTTONEAREST), &info)) {
+		layout.origin.x += rect.left - info.rcMonitor.left;
+		layout.origin.y += rect.top - info.rcMonitor.top;
+	}
+	return layout;
+}
+
+size_t LatencyStampWindow::getDrawnCount() {
+	return m_drawn;
+}
+
+void LatencyStampWindow::WindowLoop(std::promise<HWND>& created) {
+	HWND hwnd = CreateWindowExW(
+		WS_EX_TOPMOST | WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE,
+		WindowClassName, L"WGC Latency Stamp",
+		WS_POPUP | WS_VISIBLE,
+		m_options.position.x, m_options.position.y, m_image.cols, m_image.rows,
+		NULL, NULL, GetModuleHandleW(nullptr), nullptr
+	);
+	created.set_value(hwnd); // 'created' is gone after this.
+	if (hwnd == NULL)
+		return;
+
+	BITMAPINFO bmi = {};
+	bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	bmi.bmiHeader.biWidth = m_image.cols;
+	bmi.bmiHeader.biHeight = -m_image.rows; // Top-down.
+	bmi.bmiHeader.biPlanes = 1;
+	bmi.bmiHeader.biBitCount = 32;
+	bmi.bmiHeader.biCompression = BI_RGB;
+
+	uint32_t counter = 0;
+	MSG msg;
+	while (!m_stop) {
+		while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
+			TranslateMessage(&msg);
+			DispatchMessageW(&msg);
+		}
+		// Draw right after a composition, so every stamp stays on the screen for one whole frame.
+		if (FAILED(DwmFlush()))
+			Sleep(1);
+
+		m_codec.encode(m_image, LatencyStamp{ counter++, ILatencyStampCodec::now() });
+		HDC dc = GetDC(hwnd);
+		SetDIBitsToDevice(dc, 0, 0, m_image.cols, m_image.rows, 0, 0, 0, m_image.rows, m_image.data, &bmi, DIB_RGB_COLORS);
+		ReleaseDC(hwnd, dc);
+		GdiFlush();
+		++m_drawn;
+	}
+	DestroyWindow(hwnd);
+}
+
+} // namespace wgc
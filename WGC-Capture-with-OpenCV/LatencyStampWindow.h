@@ -0,0 +1,63 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include "include/WGC/LatencyProbe.h"
+#include "LatencyStampCodec.h"
+
+namespace wgc {
+
+/**
+ * @brief 延迟戳窗口。在自己的线程上创建窗口，每次桌面合成后画一个新的戳。
+*/
+class LatencyStampWindow final :
+	public ILatencyStampWindow {
+public:
+	/**
+	 * @brief This function may throws.
+	 */
+	explicit LatencyStampWindow(const LatencyStampWindowOptions& options);
+	~LatencyStampWindow();
+
+public:
+	virtual HWND getWindow() override;
+	virtual LatencyStampLayout getLayout(bool monitorCapture) override;
+	virtual size_t getDrawnCount() override;
+
+protected:
+	void WindowLoop(std::promise<HWND>& created);
+
+protected:
+	LatencyStampWindowOptions m_options;
+	LatencyStampCodec m_codec; // 戳在m_image中的位置。
+	cv::Mat m_image;           // 窗口的全部内容，BGRA，仅在窗口线程上使用。
+	HWND m_hwnd;
+	std::thread m_thread;
+	std::atomic<bool> m_stop;
+	std::atomic<size_t> m_drawn;
+};
+
+} // namespace wgc
@@ -0,0 +1,184 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "MotionEstimator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace {
+
+constexpr int MinBlockSize = 4;
+constexpr int MaxBlockSize = 64;    // 64x64x4x255仍在int32之内。
+constexpr int MaxSearchRange = 32;  // 向量存为int8。
+
+int DivUp(int a, int b) {
+	return (a + b - 1) / b;
+}
+
+} // namespace
+
+namespace wgc {
+
+uint32_t BlockSad(
+	const uint8_t* a, size_t stepA, const uint8_t* b, size_t stepB,
+	int bytes, int rows, uint32_t limit
+) {
+	uint32_t sum = 0;
+	for (int y = 0; y < rows; ++y, a += stepA, b += stepB) {
+		// _mm_sad_epu8 sums 8 bytes into each 64-bit half, which cannot overflow within a block.
+		__m128i acc = _mm_setzero_si128();
+		int x = 0;
+		for (; x + 16 <= bytes; x += 16) {
+			const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + x));
+			const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+			acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+		}
+		if (x + 8 <= bytes) {
+			const __m128i va = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(a + x));
+			const __m128i vb = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(b + x));
+			acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+			x += 8;
+		}
+		if (x < bytes) {
+			uint32_t pa, pb; // The last pixel.
+			std::memcpy(&pa, a + x, 4);
+			std::memcpy(&pb, b + x, 4);
+			const __m128i va = _mm_cvtsi32_si128(static_cast<int>(pa));
+			const __m128i vb = _mm_cvtsi32_si128(static_cast<int>(pb));
+			acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+		}
+		sum += static_cast<uint32_t>(_mm_cvtsi128_si32(acc)) +
+			static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+		if (sum >= limit)
+			break;
+	}
+	return sum;
+}
+
+MotionEstimator::MotionEstimator() {}
+
+bool MotionEstimator::IsValid(const MotionOptions& options) {
+	return
+		options.blockSize >= MinBlockSize && options.blockSize <= MaxBlockSize &&
+		options.blockSize % 4 == 0 &&
+		options.searchRange >= 0 && options.searchRange <= MaxSearchRange;
+}
+
+void MotionEstimator::setOptions(const MotionOptions& options) {
+	m_options = options;
+	reset();
+}
+
+const MotionOptions& MotionEstimator::getOptions() const {
+	return m_options;
+}
+
+void MotionEstimator::reset() {
+	m_prev.release();
+	m_next.release();
+}
+
+MotionMap MotionEstimator::process(const cv::Mat& frame) {
+	MotionMap map = {};
+	map.valid = false;
+	map.blockSize = m_options.blockSize;
+	if (frame.type() != CV_8UC4 || frame.empty()) {
+		reset();
+		return map;
+	}
+	if (m_prev.size() != frame.size()) {
+		frame.copyTo(m_prev); // Nothing to compare with yet.
+		m_next.release();
+		return map;
+	}
+
+	const int bs = m_options.blockSize;
+	const cv::Size mapSize(DivUp(frame.cols, bs), DivUp(frame.rows, bs));
+	map.sad.create(mapSize, CV_32SC1);
+	if (m_options.searchRange > 0) {
+		map.vectors.create(mapSize, CV_8SC2);
+		map.residual.create(mapSize, CV_32SC1);
+	}
+	m_next.create(frame.size(), CV_8UC4);
+	cv::parallel_for_(
+		cv::Range(0, mapSize.height),
+		[this, &frame, &map](const cv::Range& range) -> void {
+			for (int band = range.start; band < range.end; ++band)
+				ProcessBand(frame, band, map);
+		}
+	);
+	std::swap(m_prev, m_next);
+	map.valid = true;
+	return map;
+}
+
+size_t MotionEstimator::getBytes() const {
+	return m_prev.total() * m_prev.elemSize() + m_next.total() * m_next.elemSize();
+}
+
+void MotionEstimator::ProcessBand(const cv::Mat& frame, int band, MotionMap& map) {
+	const int bs = m_options.blockSize;
+	const int range = m_options.searchRange;
+	const int y0 = band * bs;
+	const int rows = std::min(bs, frame.rows - y0);
+	const size_t stepCur = frame.step;
+	const size_t stepPrev = m_prev.step;
+
+	int32_t* sadRow = map.sad.ptr<int32_t>(band);
+	for (int bx = 0; bx < map.sad.cols; ++bx) {
+		const int x0 = bx * bs;
+		const int cols = std::min(bs, frame.cols - x0);
+		const uint8_t* cur = frame.ptr<uint8_t>(y0) + x0 * 4;
+		const uint32_t sad0 = BlockSad(cur, stepCur, m_prev.ptr<uint8_t>(y0) + x0 * 4, stepPrev, cols * 4, rows);
+		sadRow[bx] = static_cast<int32_t>(sad0);
+		if (range <= 0)
+			continue;
+
+		// Candidates must lie inside the previous frame. Ties keep the zero vector, or the one found first.
+		uint32_t best = sad0;
+		int bestX = 0, bestY = 0;
+		const int dyMin = std::max(-range, -y0), dyMax = std::min(range, frame.rows - rows - y0);
+		const int dxMin = std::max(-range, -x0), dxMax = std::min(range, frame.cols - cols - x0);
+		for (int dy = dyMin; dy <= dyMax && best > 0; ++dy) {
+			const uint8_t* prevRow = m_prev.ptr<uint8_t>(y0 + dy);
+			for (int dx = dxMin; dx <= dxMax && best > 0; ++dx) {
+				if (dx == 0 && dy == 0)
+					continue;
+				const uint32_t sad = BlockSad(cur, stepCur, prevRow + (x0 + dx) * 4, stepPrev, cols * 4, rows, best);
+				if (sad < best) {
+					best = sad;
+					bestX = dx;
+					bestY = dy;
+				}
+			}
+		}
+		map.vectors.ptr<cv::Vec<schar, 2>>(band)[bx] = cv::Vec<schar, 2>(static_cast<schar>(bestX), static_cast<schar>(bestY));
+		map.residual.ptr<int32_t>(band)[bx] = static_cast<int32_t>(best);
+	}
+
+	// Copy the band while it is still in the cache. Other bands may still search m_prev, so it goes to m_next.
+	for (int y = y0; y < y0 + rows; ++y)
+		std::memcpy(m_next.ptr<uint8_t>(y), frame.ptr<uint8_t>(y), static_cast<size_t>(frame.cols) * 4);
+}
+
+} // namespace wgc
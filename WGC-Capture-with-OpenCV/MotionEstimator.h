@@ -0,0 +1,76 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include "include/WGC/WGC.h"
+
+namespace wgc {
+
+/**
+ * @brief 逐块运动图：与上一帧比较各块的SAD，并可在小范围内搜索最佳运动向量。
+ * @brief 读一遍帧，在同一趟中把它复制为下一次比较用的上一帧。
+*/
+class MotionEstimator final {
+public:
+	MotionEstimator();
+
+public:
+	static bool IsValid(const MotionOptions& options);
+
+	/**
+	 * @brief 设置选项，并忘记上一帧。
+	*/
+	void setOptions(const MotionOptions& options);
+	const MotionOptions& getOptions() const;
+	/**
+	 * @brief 释放上一帧，下一帧的结果无效。
+	*/
+	void reset();
+	/**
+	 * @brief 与上一帧比较，然后记住本帧。frame须为CV_8UC4，否则返回无效的结果并忘记上一帧。
+	*/
+	MotionMap process(const cv::Mat& frame);
+	/**
+	 * @brief 保存上一帧用的字节数。
+	*/
+	size_t getBytes() const;
+
+protected:
+	void ProcessBand(const cv::Mat& frame, int band, MotionMap& map);
+
+protected:
+	MotionOptions m_options;
+	cv::Mat m_prev; // 上一帧。
+	cv::Mat m_next; // 本帧复制到这里，然后与m_prev交换。
+};
+
+/**
+ * @brief 两块BGRA像素所有通道的绝对差之和（SSE2）。bytes为每行的字节数，须是4的倍数。
+ * @brief 若某行之后和已不小于limit，就提前返回当时的和。
+*/
+uint32_t BlockSad(
+	const uint8_t* a, size_t stepA, const uint8_t* b, size_t stepB,
+	int bytes, int rows, uint32_t limit = UINT32_MAX
+);
+
+} // namespace wgc
@@ -0,0 +1,276 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "PrerollBuffer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t MinArenaBytes = 1u << 20;
+constexpr DWORD MaxWriteChunk = 64u << 20;
+
+bool WriteAt(HANDLE file, uint64_t offset, const void* data, size_t size) {
+	const char* ptr = static_cast<const char*>(data);
+	while (size > 0) {
+		const DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, MaxWriteChunk));
+		OVERLAPPED ov = {};
+		ov.Offset = static_cast<DWORD>(offset);
+		ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		DWORD written = 0;
+		if (!WriteFile(file, ptr, chunk, &written, &ov) || written != chunk)
+			return false;
+		ptr += chunk;
+		offset += chunk;
+		size -= chunk;
+	}
+	return true;
+}
+
+} // namespace
+
+namespace wgc {
+
+PrerollBuffer::PrerollBuffer(const PrerollOptions& options) :
+	m_options(options),
+	m_frameBytes(0),
+
+	m_tail(0),
+	m_used(0),
+	m_nextId(0),
+	m_dropped(0),
+
+	m_dumping(false),
+	m_stop(false) {
+	if (options.arenaBytes < MinArenaBytes || !(options.seconds >= 0.0) || options.keyframeInterval <= 0)
+		throw std::invalid_argument("PrerollBuffer: invalid options.");
+	DeltaCodecOptions codec;
+	codec.tileSize = options.tileSize;
+	codec.keyframeInterval = options.keyframeInterval;
+	m_encoder = IDeltaEncoder::createInstance(codec);
+	if (!m_encoder)
+		throw std::invalid_argument("PrerollBuffer: invalid tile size.");
+	m_arena.reset(new uint8_t[options.arenaBytes]); // Not zeroed, so pages are only touched as frames arrive.
+	m_dumper = std::thread(&PrerollBuffer::DumpLoop, this);
+}
+
+PrerollBuffer::~PrerollBuffer() {
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_cond.notify_all();
+	m_dumper.join();
+}
+
+void PrerollBuffer::push(const cv::Mat& frame, const FrameInfo& info) {
+	if (!m_encoder->encode(frame, m_encoded)) {
+		m_encoder->reset();
+		std::lock_guard lock(m_mutex);
+		++m_dropped;
+		return;
+	}
+	m_frameBytes = frame.total() * frame.elemSize();
+	const bool keyframe = IDeltaDecoder::isKeyframe(m_encoded.data(), m_encoded.size());
+
+	std::lock_guard lock(m_mutex);
+	if (m_encoded.size() > m_options.arenaBytes) {
+		m_encoder->reset(); // The next frame must not refer to this one.
+		++m_dropped;
+		return;
+	}
+	if (m_options.seconds > 0.0) {
+		// Drop the oldest group while the next one still reaches back to the start of the window.
+		const int64_t start = info.timestamp - static_cast<int64_t>(m_options.seconds * 1e7);
+		while (true) {
+			size_t next = 1;
+			while (next < m_entries.size() && !m_entries[next].keyframe)
+				++next;
+			if (next >= m_entries.size() || m_entries[next].timestamp > start)
+				break;
+			EvictGroup();
+		}
+	}
+	const size_t offset = Allocate(m_encoded.size());
+	if (!keyframe && m_entries.empty()) {
+		m_encoder->reset(); // Its keyframe was evicted to make room, so the group cannot fit.
+		++m_dropped;
+		return;
+	}
+	std::memcpy(m_arena.get() + offset, m_encoded.data(), m_encoded.size());
+
+	Entry entry;
+	entry.id = m_nextId++;
+	entry.sequence = info.sequence;
+	entry.timestamp = info.timestamp;
+	entry.offset = offset;
+	entry.size = m_encoded.size();
+	entry.keyframe = keyframe;
+	m_entries.push_back(entry);
+	m_tail = offset + entry.size;
+	m_used += entry.size;
+}
+
+std::future<bool> PrerollBuffer::dump(const std::wstring& path) {
+	DumpJob job;
+	job.path = path;
+	std::future<bool> res = job.promise.get_future();
+	{
+		std::lock_guard lock(m_mutex);
+		if (m_entries.empty()) {
+			job.promise.set_value(false);
+			return res;
+		}
+		job.lastId = m_entries.back().id;
+		m_dumps.push_back(std::move(job));
+	}
+	m_cond.notify_all();
+	return res;
+}
+
+PrerollStatus PrerollBuffer::getStatus() {
+	std::lock_guard lock(m_mutex);
+	PrerollStatus status = {};
+	status.frames = m_entries.size();
+	status.usedBytes = m_used;
+	status.arenaBytes = m_options.arenaBytes;
+	if (!m_entries.empty())
+		status.seconds = static_cast<double>(m_entries.back().timestamp - m_entries.front().timestamp) / 1e7;
+	status.dropped = m_dropped;
+	status.pendingDumps = m_dumps.size() + (m_dumping ? 1 : 0);
+	return status;
+}
+
+size_t PrerollBuffer::getBytes() const {
+	return m_options.arenaBytes + m_frameBytes;
+}
+
+size_t PrerollBuffer::Allocate(size_t size) {
+	while (!m_entries.empty()) {
+		const size_t head = m_entries.front().offset;
+		if (head < m_tail) {
+			// Free space is after the tail and before the head.
+			if (m_tail + size <= m_options.arenaBytes)
+				return m_tail;
+			if (size <= head)
+				return 0;
+		}
+		else if (m_tail + size <= head) {
+			return m_tail; // Wrapped: free space is between the tail and the head.
+		}
+		EvictGroup();
+	}
+	return 0;
+}
+
+void PrerollBuffer::EvictGroup() {
+	do {
+		m_used -= m_entries.front().size;
+		m_entries.pop_front();
+	} while (!m_entries.empty() && !m_entries.front().keyframe);
+	if (m_entries.empty())
+		m_tail = 0;
+}
+
+void PrerollBuffer::DumpLoop() {
+	while (true) {
+		DumpJob job;
+		{
+			std::unique_lock lock(m_mutex);
+			m_cond.wait(lock, [this]() -> bool { return m_stop || !m_dumps.empty(); });
+			if (m_stop)
+				break;
+			job = std::move(m_dumps.front());
+			m_dumps.pop_front();
+			m_dumping = true;
+		}
+		const bool res = Dump(job);
+		{
+			std::lock_guard lock(m_mutex);
+			m_dumping = false;
+		}
+		job.promise.set_value(res);
+	}
+	std::lock_guard lock(m_mutex);
+	for (DumpJob& job : m_dumps)
+		job.promise.set_value(false);
+	m_dumps.clear();
+}
+
+bool PrerollBuffer::Dump(const DumpJob& job) {
+	HANDLE file = CreateFileW(
+		job.path.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL
+	);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	PrerollFileHeader header = {};
+	std::memcpy(header.magic, PrerollFileMagic, sizeof(header.magic));
+	header.version = PrerollFileVersion;
+	header.headerSize = sizeof(PrerollFileHeader);
+	header.recordSize = sizeof(PrerollRecord);
+	bool ok = WriteAt(file, 0, &header, sizeof(header));
+
+	// Copy one frame at a time, so the capture thread never waits for the disk.
+	uint64_t offset = sizeof(header);
+	uint64_t next = 0;
+	std::vector<uint8_t> buffer;
+	while (ok) {
+		PrerollRecord record;
+		{
+			std::lock_guard lock(m_mutex);
+			if (m_stop) {
+				ok = false;
+				break;
+			}
+			if (m_entries.empty())
+				break;
+			const uint64_t first = m_entries.front().id;
+			if (next < first)
+				next = first; // Evicted meanwhile: go on from the oldest keyframe left.
+			if (next > job.lastId || next > m_entries.back().id)
+				break;
+			const Entry& entry = m_entries[static_cast<size_t>(next - first)];
+			record.sequence = entry.sequence;
+			record.timestamp = entry.timestamp;
+			record.size = entry.size;
+			buffer.assign(m_arena.get() + entry.offset, m_arena.get() + entry.offset + entry.size);
+		}
+		ok =
+			WriteAt(file, offset, &record, sizeof(record)) &&
+			WriteAt(file, offset + sizeof(record), buffer.data(), buffer.size());
+		offset += sizeof(record) + buffer.size();
+		++header.frameCount;
+		++next;
+	}
+	ok = ok && header.frameCount > 0 &&
+		WriteAt(file, offsetof(PrerollFileHeader, frameCount), &header.frameCount, sizeof(header.frameCount));
+	CloseHandle(file);
+	if (!ok)
+		DeleteFileW(job.path.c_str());
+	return ok;
+}
+
+} // namespace wgc
@@ -0,0 +1,116 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <memory>
+#include <thread>
+#include <condition_variable>
+#include "include/WGC/Preroll.h"
+#include "include/WGC/DeltaCodec.h"
+
+namespace wgc {
+
+/**
+ * @brief 预录缓冲：最近的帧以差分编码保存在固定大小的环形内存中，满时按关键帧组淘汰最旧的。
+ * @brief 转储在自己的线程上逐帧复制并写入文件，截取线程最多等待复制一帧的时间。
+*/
+class PrerollBuffer final {
+public:
+	/**
+	 * @brief This function may throws.
+	 */
+	PrerollBuffer(const PrerollOptions& options);
+
+	/**
+	 * @brief 未完成的转储都失败。
+	*/
+	~PrerollBuffer();
+
+public:
+	/**
+	 * @brief 编码并保存一帧。只在截取线程上调用。
+	*/
+	void push(const cv::Mat& frame, const FrameInfo& info);
+	/**
+	 * @brief 把目前保存的帧写入文件。排在之前的转储之后。
+	*/
+	std::future<bool> dump(const std::wstring& path);
+
+	PrerollStatus getStatus();
+	/**
+	 * @brief 环形内存和编码器参考帧的字节数。
+	*/
+	size_t getBytes() const;
+
+protected:
+	struct Entry {
+		uint64_t id;       // 连续递增，用于判断转储中的帧是否已被淘汰。
+		uint64_t sequence;
+		int64_t timestamp;
+		size_t offset;     // 在环形内存中的位置。
+		size_t size;
+		bool keyframe;
+	};
+	struct DumpJob {
+		std::wstring path;
+		uint64_t lastId; // 请求时最新的帧。
+		std::promise<bool> promise;
+	};
+
+	/**
+	 * @brief 在锁内调用。为size字节找到位置，必要时淘汰最旧的关键帧组。
+	*/
+	size_t Allocate(size_t size);
+	/**
+	 * @brief 在锁内调用。淘汰最旧的一帧及其后直到下一个关键帧的帧。
+	*/
+	void EvictGroup();
+	void DumpLoop();
+	bool Dump(const DumpJob& job);
+
+protected:
+	PrerollOptions m_options;
+	std::shared_ptr<IDeltaEncoder> m_encoder; // 只在截取线程上使用。
+	std::vector<uint8_t> m_encoded;
+	std::atomic<size_t> m_frameBytes;         // 编码器参考帧的字节数。
+
+	std::mutex m_mutex;
+	std::unique_ptr<uint8_t[]> m_arena;
+	size_t m_tail;  // 下一帧的位置。
+	size_t m_used;
+	std::deque<Entry> m_entries; // 从旧到新，第一个总是关键帧。
+	uint64_t m_nextId;
+	size_t m_dropped;
+
+	std::deque<DumpJob> m_dumps;
+	bool m_dumping;
+	bool m_stop;
+	std::condition_variable m_cond;
+	std::thread m_dumper;
+};
+
+} // namespace wgc
@@ -0,0 +1,270 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "Recorder.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+constexpr DWORD MaxWriteChunk = 64u << 20;
+
+} // namespace
+
+namespace wgc {
+
+std::shared_ptr<IRecorder> IRecorder::createInstance(const std::wstring& path, const RecorderOptions& options) noexcept {
+	try {
+		return std::make_shared<Recorder>(path, options);
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+Recorder::Recorder(const std::wstring& path, const RecorderOptions& options) :
+	m_options(options),
+	m_file(INVALID_HANDLE_VALUE),
+	m_header(),
+	m_dataEnd(0),
+	m_fileSize(0),
+
+	m_accepted(0),
+	m_allocated(0),
+	m_closing(false),
+
+	m_written(0),
+	m_dropped(0) {
+	if (m_options.maxFrames == 0 || m_options.queueDepth == 0)
+		throw std::invalid_argument("Recorder: maxFrames and queueDepth must be positive.");
+
+	// Readers are allowed to open and map the file while we are writing.
+	m_file = CreateFileW(
+		path.c_str(), GENERIC_READ | GENERIC_WRITE,
+		FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL
+	);
+	if (m_file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("Recorder: failed to create file.");
+
+	SYSTEM_INFO sysInfo;
+	GetSystemInfo(&sysInfo);
+	const uint64_t pageSize = sysInfo.dwPageSize;
+
+	std::memcpy(m_header.magic, RecordFileMagic, sizeof(m_header.magic));
+	m_header.version = RecordFileVersion;
+	m_header.headerSize = sizeof(RecordFileHeader);
+	m_header.entrySize = sizeof(RecordIndexEntry);
+	m_header.pageSize = static_cast<uint32_t>(pageSize);
+	m_header.indexOffset = AlignUp(sizeof(RecordFileHeader), pageSize);
+	m_header.indexCapacity = m_options.maxFrames;
+	m_header.dataOffset = AlignUp(m_header.indexOffset + m_header.indexCapacity * sizeof(RecordIndexEntry), pageSize);
+	m_header.frameCount = 0;
+	m_header.finished = 0;
+	m_dataEnd = m_header.dataOffset;
+
+	if (!Reserve(m_dataEnd) || !WriteAt(0, &m_header, sizeof(m_header))) {
+		CloseHandle(m_file);
+		throw std::runtime_error("Recorder: failed to initialize file.");
+	}
+
+	m_writer = std::thread(&Recorder::WriterLoop, this);
+}
+
+Recorder::~Recorder() {
+	close();
+}
+
+bool Recorder::push(const cv::Mat& frame, const FrameInfo& info, const std::vector<cv::Rect>& dirtyRects) {
+	if (frame.empty())
+		return false;
+	cv::Mat buffer;
+	{
+		std::lock_guard lock(m_mutex);
+		if (m_closing || m_accepted >= m_options.maxFrames) {
+			++m_dropped;
+			return false;
+		}
+		if (!m_free.empty()) {
+			buffer = std::move(m_free.back());
+			m_free.pop_back();
+		}
+		else if (m_allocated < m_options.queueDepth) {
+			++m_allocated;
+		}
+		else {
+			++m_dropped;
+			return false;
+		}
+		++m_accepted;
+	}
+
+	Job job;
+	job.frame = std::move(buffer);
+	frame.copyTo(job.frame); // Reuses the pooled buffer if the size keeps the same.
+
+	RecordIndexEntry& entry = job.entry;
+	std::memset(&entry, 0, sizeof(entry));
+	entry.sequence = info.sequence;
+	entry.timestamp = info.timestamp;
+	entry.width = job.frame.cols;
+	entry.height = job.frame.rows;
+	entry.type = job.frame.type();
+	entry.step = static_cast<uint32_t>(job.frame.step[0]);
+	entry.size = static_cast<uint64_t>(entry.step) * entry.height;
+	if (dirtyRects.size() <= RecordMaxDirtyRects) {
+		for (const cv::Rect& rect : dirtyRects)
+			entry.dirty[entry.dirtyCount++] = { rect.x, rect.y, rect.width, rect.height };
+	}
+	else {
+		cv::Rect bound = dirtyRects.front();
+		for (const cv::Rect& rect : dirtyRects)
+			bound |= rect;
+		entry.dirty[entry.dirtyCount++] = { bound.x, bound.y, bound.width, bound.height };
+	}
+
+	{
+		std::lock_guard lock(m_mutex);
+		if (m_closing) {
+			// Closed while copying: give back the index slot, and the buffer so it stays counted by m_allocated.
+			--m_accepted;
+			m_free.push_back(std::move(job.frame));
+			++m_dropped;
+			return false;
+		}
+		m_jobs.push_back(std::move(job));
+	}
+	m_cond.notify_one();
+	return true;
+}
+
+void Recorder::close() {
+	std::lock_guard lockClose(m_mutex_close);
+	if (m_file == INVALID_HANDLE_VALUE)
+		return;
+	{
+		std::lock_guard lock(m_mutex);
+		m_closing = true;
+	}
+	m_cond.notify_one();
+	if (m_writer.joinable())
+		m_writer.join();
+
+	// Trim the preallocated tail. This fails if a reader still maps it, which is harmless.
+	FILE_END_OF_FILE_INFO eof;
+	eof.EndOfFile.QuadPart = static_cast<LONGLONG>(m_dataEnd);
+	SetFileInformationByHandle(m_file, FileEndOfFileInfo, &eof, sizeof(eof));
+
+	m_header.finished = 1;
+	WriteAt(offsetof(RecordFileHeader, finished), &m_header.finished, sizeof(m_header.finished));
+	CloseHandle(m_file);
+	m_file = INVALID_HANDLE_VALUE;
+}
+
+size_t Recorder::getWrittenCount() {
+	return m_written;
+}
+
+size_t Recorder::getDroppedCount() {
+	return m_dropped;
+}
+
+void Recorder::WriterLoop() {
+	bool failed = false;
+	while (true) {
+		Job job;
+		{
+			std::unique_lock lock(m_mutex);
+			m_cond.wait(lock, [this]() -> bool { return m_closing || !m_jobs.empty(); });
+			if (m_jobs.empty())
+				break;
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		if (!failed) {
+			RecordIndexEntry& entry = job.entry;
+			entry.offset = m_dataEnd;
+			const uint64_t index = m_header.frameCount;
+			const uint64_t next = AlignUp(entry.offset + entry.size, m_header.pageSize);
+
+			// Payload first, then its entry, then the count, so a reader never sees a partial frame.
+			failed =
+				!Reserve(next) ||
+				!WriteAt(entry.offset, job.frame.data, static_cast<size_t>(entry.size)) ||
+				!WriteAt(m_header.indexOffset + index * sizeof(RecordIndexEntry), &entry, sizeof(entry));
+			if (!failed) {
+				m_header.frameCount = index + 1;
+				failed = !WriteAt(offsetof(RecordFileHeader, frameCount), &m_header.frameCount, sizeof(m_header.frameCount));
+				m_dataEnd = next;
+				++m_written;
+			}
+		}
+		if (failed)
+			++m_dropped;
+
+		std::lock_guard lock(m_mutex);
+		m_free.push_back(std::move(job.frame));
+	}
+}
+
+bool Recorder::WriteAt(uint64_t offset, const void* data, size_t size) {
+	const char* ptr = static_cast<const char*>(data);
+	while (size > 0) {
+		const DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, MaxWriteChunk));
+		OVERLAPPED ov = {};
+		ov.Offset = static_cast<DWORD>(offset);
+		ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		DWORD written = 0;
+		if (!WriteFile(m_file, ptr, chunk, &written, &ov) || written != chunk)
+			return false;
+		ptr += chunk;
+		offset += chunk;
+		size -= chunk;
+	}
+	return true;
+}
+
+bool Recorder::Reserve(uint64_t end) {
+	if (end <= m_fileSize)
+		return true;
+	const uint64_t step = std::max<uint64_t>(m_options.preallocateBytes, m_header.pageSize);
+	const uint64_t size = AlignUp(end, step);
+
+	FILE_ALLOCATION_INFO alloc;
+	alloc.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+	SetFileInformationByHandle(m_file, FileAllocationInfo, &alloc, sizeof(alloc));
+
+	FILE_END_OF_FILE_INFO eof;
+	eof.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+	if (!SetFileInformationByHandle(m_file, FileEndOfFileInfo, &eof, sizeof(eof)))
+		return false;
+	m_fileSize = size;
+	return true;
+}
+
+} // namespace wgc
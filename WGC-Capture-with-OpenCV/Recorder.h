@@ -0,0 +1,85 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <deque>
+#include <condition_variable>
+#include "include/WGC/Recorder.h"
+
+namespace wgc {
+
+/**
+ * @brief 录制器。
+*/
+class Recorder final :
+	public IRecorder {
+public:
+	/**
+	 * @brief This function may throws.
+	 */
+	Recorder(const std::wstring& path, const RecorderOptions& options);
+
+	~Recorder();
+
+public:
+	virtual bool push(const cv::Mat& frame, const FrameInfo& info, const std::vector<cv::Rect>& dirtyRects = {}) override;
+	virtual void close() override;
+
+	virtual size_t getWrittenCount() override;
+	virtual size_t getDroppedCount() override;
+
+protected:
+	struct Job {
+		cv::Mat frame;
+		RecordIndexEntry entry;
+	};
+
+	void WriterLoop();
+	bool WriteAt(uint64_t offset, const void* data, size_t size);
+	bool Reserve(uint64_t end);
+
+protected:
+	RecorderOptions m_options;
+	HANDLE m_file;
+	RecordFileHeader m_header;
+	uint64_t m_dataEnd;  // 下一个帧数据的偏移。
+	uint64_t m_fileSize; // 已预分配的文件大小。
+
+	size_t m_accepted; // 已占用的索引数，包括排队中的帧。
+	size_t m_allocated; // 已分配的缓冲数。
+	std::vector<cv::Mat> m_free;
+	std::deque<Job> m_jobs;
+	bool m_closing;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::thread m_writer;
+	std::mutex m_mutex_close;
+
+	std::atomic<size_t> m_written;
+	std::atomic<size_t> m_dropped;
+};
+
+} // namespace wgc
@@ -0,0 +1,206 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "RegionWatcher.h"
+
+#include <algorithm>
+#include <cstring>
+#include "MotionEstimator.h"
+
+namespace {
+
+constexpr int TileSize = 32; // 网格的块边长。32x32x4x255仍在uint32之内。
+
+int DivUp(int a, int b) {
+	return (a + b - 1) / b;
+}
+
+bool TileChanged(const cv::Mat& a, const cv::Mat& b, const cv::Rect& tile) {
+	const size_t bytes = static_cast<size_t>(tile.width) * 4;
+	for (int y = tile.y; y < tile.y + tile.height; ++y) {
+		if (std::memcmp(a.ptr<uint8_t>(y) + tile.x * 4, b.ptr<uint8_t>(y) + tile.x * 4, bytes) != 0)
+			return true;
+	}
+	return false;
+}
+
+void CopyTile(const cv::Mat& src, cv::Mat& dst, const cv::Rect& tile) {
+	const size_t bytes = static_cast<size_t>(tile.width) * 4;
+	for (int y = tile.y; y < tile.y + tile.height; ++y)
+		std::memcpy(dst.ptr<uint8_t>(y) + tile.x * 4, src.ptr<uint8_t>(y) + tile.x * 4, bytes);
+}
+
+} // namespace
+
+namespace wgc {
+
+RegionWatcher::RegionWatcher() :
+	m_nextId(0),
+	m_indexDirty(true) {}
+
+int RegionWatcher::add(const cv::Rect& rect, double threshold, RegionCallback callback) {
+	Watcher watcher = {};
+	watcher.id = m_nextId++;
+	watcher.rect = rect;
+	watcher.threshold = threshold;
+	watcher.callback = std::make_shared<const RegionCallback>(std::move(callback));
+	watcher.primed = false;
+	m_watchers.push_back(std::move(watcher));
+	m_indexDirty = true;
+	return m_watchers.back().id;
+}
+
+bool RegionWatcher::remove(int id) {
+	const auto it = std::find_if(
+		m_watchers.begin(), m_watchers.end(),
+		[id](const Watcher& watcher) -> bool { return watcher.id == id; }
+	);
+	if (it == m_watchers.end())
+		return false;
+	m_watchers.erase(it);
+	m_indexDirty = true;
+	if (m_watchers.empty())
+		reset();
+	return true;
+}
+
+bool RegionWatcher::empty() const {
+	return m_watchers.empty();
+}
+
+void RegionWatcher::reset() {
+	m_prev.release();
+	m_size = cv::Size();
+	m_indexDirty = true;
+}
+
+void RegionWatcher::process(const cv::Mat& frame, std::vector<Fired>& fired) {
+	if (frame.type() != CV_8UC4 || frame.empty()) {
+		reset();
+		return;
+	}
+	if (m_indexDirty || m_size != frame.size())
+		BuildIndex(frame.size());
+
+	m_touched.clear();
+	for (int ty = 0; ty < m_grid.height; ++ty) {
+		const int y0 = ty * TileSize;
+		const int rows = std::min(TileSize, frame.rows - y0);
+		for (int tx = 0; tx < m_grid.width; ++tx) {
+			const size_t cell = static_cast<size_t>(ty) * m_grid.width + tx;
+			const uint32_t begin = m_cellStart[cell], end = m_cellStart[cell + 1];
+			if (begin == end)
+				continue; // Nobody watches it, so it is never read.
+			const cv::Rect tile(tx * TileSize, y0, std::min(TileSize, frame.cols - tx * TileSize), rows);
+			if (!m_tileValid[cell]) {
+				CopyTile(frame, m_prev, tile);
+				m_tileValid[cell] = 1;
+				continue;
+			}
+			if (!TileChanged(frame, m_prev, tile))
+				continue;
+			for (uint32_t i = begin; i < end; ++i) {
+				Watcher& watcher = m_watchers[m_cellItems[i]];
+				if (!watcher.primed)
+					continue;
+				const cv::Rect area = tile & watcher.clipped;
+				const uint32_t sad = BlockSad(
+					frame.ptr<uint8_t>(area.y) + area.x * 4, frame.step,
+					m_prev.ptr<uint8_t>(area.y) + area.x * 4, m_prev.step,
+					area.width * 4, area.height
+				);
+				if (sad == 0)
+					continue;
+				if (watcher.sad == 0)
+					m_touched.push_back(m_cellItems[i]);
+				watcher.sad += sad;
+			}
+			CopyTile(frame, m_prev, tile);
+		}
+	}
+
+	for (uint32_t index : m_touched) {
+		Watcher& watcher = m_watchers[index];
+		const double change = static_cast<double>(watcher.sad) / watcher.clipped.area();
+		watcher.sad = 0;
+		if (change > watcher.threshold)
+			fired.push_back({ { watcher.id, watcher.clipped, change }, watcher.callback });
+	}
+	for (Watcher& watcher : m_watchers)
+		watcher.primed = true;
+}
+
+size_t RegionWatcher::getBytes() const {
+	return m_prev.total() * m_prev.elemSize();
+}
+
+void RegionWatcher::BuildIndex(cv::Size size) {
+	const bool resized = size != m_size;
+	m_size = size;
+	m_grid = cv::Size(DivUp(size.width, TileSize), DivUp(size.height, TileSize));
+	const size_t cells = static_cast<size_t>(m_grid.area());
+	const cv::Rect bounds(0, 0, size.width, size.height);
+	if (resized)
+		m_prev.create(size, CV_8UC4);
+
+	// Count the regions over each tile, then fill, so the index is two flat arrays.
+	m_cellStart.assign(cells + 1, 0);
+	for (Watcher& watcher : m_watchers) {
+		watcher.clipped = watcher.rect & bounds;
+		watcher.sad = 0;
+		if (resized)
+			watcher.primed = false;
+		if (watcher.clipped.empty())
+			continue;
+		const int tx0 = watcher.clipped.x / TileSize, tx1 = (watcher.clipped.br().x - 1) / TileSize;
+		const int ty0 = watcher.clipped.y / TileSize, ty1 = (watcher.clipped.br().y - 1) / TileSize;
+		for (int ty = ty0; ty <= ty1; ++ty) {
+			for (int tx = tx0; tx <= tx1; ++tx)
+				++m_cellStart[static_cast<size_t>(ty) * m_grid.width + tx + 1];
+		}
+	}
+	for (size_t cell = 0; cell < cells; ++cell)
+		m_cellStart[cell + 1] += m_cellStart[cell];
+	m_cellItems.resize(m_cellStart[cells]);
+	std::vector<uint32_t> fill(m_cellStart.begin(), m_cellStart.end() - 1);
+	for (size_t i = 0; i < m_watchers.size(); ++i) {
+		const cv::Rect& clipped = m_watchers[i].clipped;
+		if (clipped.empty())
+			continue;
+		const int tx0 = clipped.x / TileSize, tx1 = (clipped.br().x - 1) / TileSize;
+		const int ty0 = clipped.y / TileSize, ty1 = (clipped.br().y - 1) / TileSize;
+		for (int ty = ty0; ty <= ty1; ++ty) {
+			for (int tx = tx0; tx <= tx1; ++tx)
+				m_cellItems[fill[static_cast<size_t>(ty) * m_grid.width + tx]++] = static_cast<uint32_t>(i);
+		}
+	}
+
+	// Tiles nobody watches are not kept up to date, so they are stale when watched again.
+	if (resized)
+		m_tileValid.assign(cells, 0);
+	for (size_t cell = 0; cell < cells; ++cell) {
+		if (m_cellStart[cell] == m_cellStart[cell + 1])
+			m_tileValid[cell] = 0;
+	}
+	m_indexDirty = false;
+}
+
+} // namespace wgc
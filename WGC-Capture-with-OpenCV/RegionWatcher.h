@@ -0,0 +1,97 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <memory>
+#include <vector>
+#include "include/WGC/WGC.h"
+
+namespace wgc {
+
+/**
+ * @brief 区域监视：把监视的区域登记在固定大小的块网格中。
+ * @brief 每帧只比较有区域覆盖的块，有变化的块只与覆盖它的区域求差。
+*/
+class RegionWatcher final {
+public:
+	RegionWatcher();
+
+public:
+	/**
+	 * @brief 变化超过阈值的区域及其回调。
+	*/
+	struct Fired {
+		RegionChange change;
+		std::shared_ptr<const RegionCallback> callback;
+	};
+
+	/**
+	 * @brief 添加区域，返回其id。参数须已检查。
+	*/
+	int add(const cv::Rect& rect, double threshold, RegionCallback callback);
+	bool remove(int id);
+	bool empty() const;
+	/**
+	 * @brief 忘记上一帧，下一帧只记住不比较。
+	*/
+	void reset();
+	/**
+	 * @brief 与上一帧比较，把变化超过阈值的区域追加到fired，然后记住本帧。frame须为CV_8UC4，否则忘记上一帧。
+	*/
+	void process(const cv::Mat& frame, std::vector<Fired>& fired);
+	/**
+	 * @brief 保存上一帧用的字节数。
+	*/
+	size_t getBytes() const;
+
+protected:
+	struct Watcher {
+		int id;
+		cv::Rect rect;
+		double threshold;
+		std::shared_ptr<const RegionCallback> callback;
+		cv::Rect clipped; // 在当前帧内的部分，可能为空。
+		uint64_t sad;     // 本帧累计的绝对差之和。
+		bool primed;      // 上一帧已记住它的所有块。
+	};
+
+	/**
+	 * @brief 按帧尺寸重建网格。尺寸变化时所有块失效，否则只有不再被覆盖的块失效。
+	*/
+	void BuildIndex(cv::Size size);
+
+protected:
+	std::vector<Watcher> m_watchers; // 按添加顺序。
+	int m_nextId;
+	bool m_indexDirty; // 区域列表变了，需要重建网格。
+
+	cv::Size m_size; // 网格对应的帧尺寸。
+	cv::Size m_grid; // 块的列数和行数。
+	std::vector<uint32_t> m_cellStart; // 各块在m_cellItems中的起点，最后多一个终点。
+	std::vector<uint32_t> m_cellItems; // 覆盖各块的区域在m_watchers中的序号。
+	std::vector<uint8_t> m_tileValid;  // 该块在m_prev中是上一帧。
+	std::vector<uint32_t> m_touched;   // 本帧有差异的区域。
+	cv::Mat m_prev; // 上一帧，只维护有区域覆盖的块。
+};
+
+} // namespace wgc
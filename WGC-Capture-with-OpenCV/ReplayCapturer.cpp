@@ -0,0 +1,319 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "ReplayCapturer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Maps recorded timestamps to wall-clock deadlines, scaled by the replay speed.
+ */
+class VirtualClock final {
+public:
+	using Clock = std::chrono::steady_clock;
+	using Ticks = std::chrono::duration<int64_t, std::ratio<1, 10000000>>; // 100ns, same as FrameInfo::timestamp.
+
+	explicit VirtualClock(double speed) :
+		m_speed(speed),
+		m_origin(0) {}
+
+	/**
+	 * @brief Anchor the recorded timestamp to now.
+	 */
+	void reset(int64_t timestamp) {
+		m_origin = timestamp;
+		m_start = Clock::now();
+	}
+
+	/**
+	 * @brief Whether frames should be delivered without waiting.
+	 */
+	bool unlimited() const {
+		return !(m_speed > 0.0);
+	}
+
+	Clock::time_point deadline(int64_t timestamp) const {
+		const double elapsed = static_cast<double>(timestamp - m_origin) / m_speed;
+		return m_start + std::chrono::duration_cast<Clock::duration>(Ticks(static_cast<int64_t>(elapsed)));
+	}
+
+protected:
+	double m_speed;
+	int64_t m_origin;
+	Clock::time_point m_start;
+};
+
+} // namespace
+
+namespace wgc {
+
+ReplayCapturer::ReplayCapturer(const std::wstring& path, const ReplayOptions& options, size_t id, std::shared_ptr<ImageSaver> saver, std::shared_ptr<BudgetTracker> budget) :
+	CapturerBase(id, saver, budget),
+
+	m_options(options),
+
+	m_file(INVALID_HANDLE_VALUE),
+	m_mapping(NULL),
+	m_view(nullptr),
+	m_viewSize(0),
+	m_header(nullptr),
+
+	m_stop(false),
+	m_generation(0),
+
+	m_finished(false),
+	m_started(false),
+	m_isWindow(false),
+	m_clientarea(false) {
+	// The recorder may still be writing, so share both read and write.
+	m_file = CreateFileW(
+		path.c_str(), GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL
+	);
+	if (m_file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("ReplayCapturer: failed to open file.");
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(RecordFileHeader))) {
+		CloseHandle(m_file);
+		throw std::runtime_error("ReplayCapturer: file is too small.");
+	}
+	m_viewSize = static_cast<uint64_t>(size.QuadPart);
+
+	m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping != NULL)
+		m_view = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_view == nullptr) {
+		if (m_mapping != NULL)
+			CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		throw std::runtime_error("ReplayCapturer: failed to map file.");
+	}
+
+	m_header = reinterpret_cast<const RecordFileHeader*>(m_view);
+	if (std::memcmp(m_header->magic, RecordFileMagic, sizeof(RecordFileMagic)) != 0 ||
+		m_header->version != RecordFileVersion ||
+		m_header->entrySize != sizeof(RecordIndexEntry) ||
+		m_header->indexOffset > m_viewSize ||
+		m_header->indexCapacity > (m_viewSize - m_header->indexOffset) / sizeof(RecordIndexEntry)) { // Not summed, it could overflow.
+		UnmapViewOfFile(m_view);
+		CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		throw std::runtime_error("ReplayCapturer: not a recorded file.");
+	}
+}
+
+ReplayCapturer::~ReplayCapturer() {
+	stopCapture();
+	JoinRetired();
+	// Only the player thread is left, when destroyed from its own callback. It would return into the freed object,
+	// so this is forbidden (see IFactory::destroyCapturer()), and the joinable thread terminates in release builds.
+	assert(m_retired.empty());
+	UnmapViewOfFile(m_view);
+	CloseHandle(m_mapping);
+	CloseHandle(m_file);
+}
+
+bool ReplayCapturer::startCaptureWindow(HWND, bool) {
+	Start(true, nullptr);
+	return true;
+}
+
+bool ReplayCapturer::startCaptureMonitor(HMONITOR, bool) {
+	Start(false, nullptr);
+	return true;
+}
+
+bool ReplayCapturer::startCaptureWindowWithCallback(HWND, std::function<void(const cv::Mat&)> cb) {
+	Start(true, cb);
+	return true;
+}
+
+bool ReplayCapturer::startCaptureMonitorWithCallback(HMONITOR, std::function<void(const cv::Mat&)> cb) {
+	Start(false, cb);
+	return true;
+}
+
+void ReplayCapturer::stopCapture() {
+	if (!m_started)
+		return;
+	{
+		std::lock_guard lock(m_mutex_wait);
+		m_stop = true;
+	}
+	m_cond_wait.notify_all();
+	if (m_player.joinable()) {
+		if (m_player.get_id() == std::this_thread::get_id())
+			m_retired.push_back(std::move(m_player)); // Called from the callback, it exits after the callback returns.
+		else
+			m_player.join();
+	}
+	StopDelivery();
+	m_started = false;
+	m_finished = false;
+}
+
+void ReplayCapturer::setClipToClientArea(bool enabled) {
+	m_clientarea = enabled;
+}
+
+bool ReplayCapturer::isClipToClientArea() {
+	return m_clientarea;
+}
+
+bool ReplayCapturer::isCapturing() {
+	return m_started && !m_finished;
+}
+
+bool ReplayCapturer::isCaptureWindow() {
+	return m_started && m_isWindow;
+}
+
+bool ReplayCapturer::isCaptureMonitor() {
+	return m_started && !m_isWindow;
+}
+
+void ReplayCapturer::askForRefresh() {
+	{
+		std::lock_guard lock(m_mutex_wait);
+		CapturerBase::askForRefresh();
+	}
+	m_cond_wait.notify_all();
+}
+
+void ReplayCapturer::Start(bool window, std::function<void(const cv::Mat&)> cb) {
+	stopCapture();
+	JoinRetired();
+	BeginStart();
+
+	m_isWindow = window;
+	m_callback = cb;
+	uint64_t generation;
+	{
+		std::lock_guard lock(m_mutex_wait);
+		m_stop = false;
+		generation = ++m_generation; // A player stopped from its callback sees it and exits.
+	}
+	m_finished = false;
+	StartDelivery();
+	m_started = true;
+	askForRefresh();
+	m_player = std::thread(&ReplayCapturer::PlayLoop, this, static_cast<bool>(cb), generation);
+	EndStart(0.0); // Replay needs no graphics device.
+}
+
+void ReplayCapturer::JoinRetired() {
+	const auto current = std::partition(
+		m_retired.begin(), m_retired.end(),
+		[](const std::thread& player) -> bool { return player.get_id() != std::this_thread::get_id(); }
+	);
+	for (auto it = m_retired.begin(); it != current; ++it)
+		it->join();
+	m_retired.erase(m_retired.begin(), current);
+}
+
+void ReplayCapturer::PlayLoop(bool withCallback, uint64_t generation) {
+	VirtualClock clock(m_options.speed);
+	uint64_t index = 0;
+
+	while (true) {
+		const uint64_t count = GetFrameCount();
+		if (index >= count) {
+			if (!m_options.loop || count == 0)
+				break;
+			index = 0;
+		}
+
+		FrameInfo info;
+		cv::Mat frame;
+		if (!GetFrame(index, info, frame))
+			break;
+		EnterCaptureThread(true);
+		if (index == 0)
+			clock.reset(info.timestamp);
+
+		{
+			std::unique_lock lock(m_mutex_wait);
+			const auto stopped = [this, generation]() -> bool { return m_stop || m_generation != generation; };
+			if (!clock.unlimited()) {
+				if (m_cond_wait.wait_until(lock, clock.deadline(info.timestamp), stopped))
+					break;
+			}
+			else if (!withCallback) {
+				// As fast as possible, but polling consumers still get every frame in order.
+				m_cond_wait.wait(lock, [this, &stopped]() -> bool { return stopped() || m_img_needRefresh; });
+			}
+			if (stopped())
+				break;
+		}
+
+		RunFrameSinks(frame, info);
+		if (withCallback)
+			DeliverFrameToCallback(frame, info);
+		else if (TakeRefreshRequest())
+			DeliverFrame(frame, info);
+		ApplyMemoryBudget();
+		++index;
+	}
+	std::lock_guard lock(m_mutex_wait);
+	if (m_generation == generation)
+		m_finished = true; // Not if restarted meanwhile.
+}
+
+uint64_t ReplayCapturer::GetFrameCount() const {
+	// The recorder updates the count after the entry and payload, read it only once per frame.
+	const uint64_t count = *reinterpret_cast<const volatile uint64_t*>(&m_header->frameCount);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return std::min(count, m_header->indexCapacity);
+}
+
+bool ReplayCapturer::GetFrame(uint64_t index, FrameInfo& info, cv::Mat& frame) const {
+	const RecordIndexEntry& entry = reinterpret_cast<const RecordIndexEntry*>(m_view + m_header->indexOffset)[index];
+	if (entry.offset > m_viewSize || entry.size > m_viewSize - entry.offset)
+		return false; // Written after we mapped the file, or corrupt.
+	// The entry comes from the file, so never build a cv::Mat larger than its payload.
+	if (entry.type != CV_8UC3 && entry.type != CV_8UC4)
+		return false;
+	if (entry.width <= 0 || entry.height <= 0)
+		return false;
+	const uint64_t rowBytes = static_cast<uint64_t>(entry.width) * CV_ELEM_SIZE(entry.type);
+	if (entry.step < rowBytes || static_cast<uint64_t>(entry.step) * static_cast<uint64_t>(entry.height) > entry.size)
+		return false;
+
+	info.sequence = entry.sequence;
+	info.timestamp = entry.timestamp;
+	info.width = entry.width;
+	info.height = entry.height;
+	frame = cv::Mat(
+		entry.height, entry.width, entry.type,
+		const_cast<uint8_t*>(m_view + entry.offset), entry.step
+	);
+	return true;
+}
+
+} // namespace wgc
@@ -0,0 +1,99 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <vector>
+#include "CapturerBase.h"
+#include "include/WGC/Recorder.h"
+
+namespace wgc {
+
+/**
+ * @brief 回放截取器：按录制时的时间戳回放录制文件。帧直接引用映射的文件，不复制。
+*/
+class ReplayCapturer final :
+	public CapturerBase {
+public:
+	/**
+	 * @brief This function may throws.
+	 */
+	ReplayCapturer(const std::wstring& path, const ReplayOptions& options, size_t id, std::shared_ptr<ImageSaver> saver, std::shared_ptr<BudgetTracker> budget);
+
+	~ReplayCapturer();
+
+public:
+	virtual bool startCaptureWindow(HWND hwnd, bool freeThreaded = true) override;
+	virtual bool startCaptureMonitor(HMONITOR hmonitor, bool freeThreaded = true) override;
+
+	virtual bool startCaptureWindowWithCallback(HWND hwnd, std::function<void(const cv::Mat&)> cb) override;
+	virtual bool startCaptureMonitorWithCallback(HMONITOR hmonitor, std::function<void(const cv::Mat&)> cb) override;
+
+	virtual void stopCapture() override;
+
+	virtual void setClipToClientArea(bool enabled) override;
+	virtual bool isClipToClientArea() override;
+
+	virtual bool isCapturing() override;
+	virtual bool isCaptureWindow() override;
+	virtual bool isCaptureMonitor() override;
+
+	virtual void askForRefresh() override;
+
+protected:
+	void Start(bool window, std::function<void(const cv::Mat&)> cb);
+	void PlayLoop(bool withCallback, uint64_t generation);
+	/**
+	 * @brief 等待已停止的回放线程结束，当前线程除外。
+	*/
+	void JoinRetired();
+
+	uint64_t GetFrameCount() const;
+	bool GetFrame(uint64_t index, FrameInfo& info, cv::Mat& frame) const;
+
+protected:
+	ReplayOptions m_options;
+
+	HANDLE m_file;
+	HANDLE m_mapping;
+	const uint8_t* m_view;
+	uint64_t m_viewSize;
+	const RecordFileHeader* m_header; // 指向映射的文件头。
+
+	std::thread m_player;
+	std::mutex m_mutex_wait;
+	std::condition_variable m_cond_wait;
+	bool m_stop;
+	uint64_t m_generation; // 每次开始加一，旧的回放线程看到变化就退出。受m_mutex_wait保护。
+	std::vector<std::thread> m_retired; // 在回调中停止的回放线程，回调返回后才退出，由下一次开始或析构等待。不能在回调中析构。
+
+	std::atomic<bool> m_finished; // 不循环时，放完最后一帧。
+	bool m_started;
+	bool m_isWindow;
+	std::atomic<bool> m_clientarea; // 仅记录，回放不裁剪。
+};
+
+} // namespace wgc
@@ -0,0 +1,323 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "SharedRing.h"
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+constexpr int MaxReadAttempts = 16;
+
+/**
+ * @brief The ring is shared with other processes, so its fields are accessed as volatile with explicit fences.
+ */
+uint64_t LoadAcquire(const uint64_t& value) {
+	const uint64_t res = *reinterpret_cast<const volatile uint64_t*>(&value);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return res;
+}
+
+void StoreRelease(uint64_t& value, uint64_t desired) {
+	std::atomic_thread_fence(std::memory_order_release);
+	*reinterpret_cast<volatile uint64_t*>(&value) = desired;
+}
+
+std::wstring EventName(const std::wstring& name, int i) {
+	return name + (i == 0 ? L"_0" : L"_1");
+}
+
+} // namespace
+
+namespace wgc {
+
+std::shared_ptr<IFramePublisher> IFramePublisher::createInstance(const std::wstring& name, const SharedRingOptions& options) noexcept {
+	try {
+		return std::make_shared<FramePublisher>(name, options);
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+std::shared_ptr<IFrameRingReader> IFrameRingReader::createInstance(const std::wstring& name) noexcept {
+	try {
+		return std::make_shared<FrameRingReader>(name);
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+FramePublisher::FramePublisher(const std::wstring& name, const SharedRingOptions& options) :
+	m_mapping(NULL),
+	m_events{ NULL, NULL },
+	m_view(nullptr),
+	m_header(nullptr),
+	m_slots(nullptr),
+
+	m_published(0) {
+	if (options.slotCount < 2 || options.slotCount > SharedRingMaxSlots || options.slotBytes == 0)
+		throw std::invalid_argument("FramePublisher: invalid options.");
+
+	SYSTEM_INFO sysInfo;
+	GetSystemInfo(&sysInfo);
+	const uint64_t pageSize = sysInfo.dwPageSize;
+
+	const uint64_t slotsOffset = AlignUp(sizeof(SharedRingHeader), 64);
+	const uint64_t dataOffset = AlignUp(slotsOffset + options.slotCount * sizeof(SharedRingSlot), pageSize);
+	const uint64_t slotStride = AlignUp(options.slotBytes, pageSize);
+	const uint64_t mappingSize = dataOffset + options.slotCount * slotStride;
+
+	m_mapping = CreateFileMappingW(
+		INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE | SEC_COMMIT,
+		static_cast<DWORD>(mappingSize >> 32), static_cast<DWORD>(mappingSize), name.c_str()
+	);
+	if (m_mapping == NULL)
+		throw std::runtime_error("FramePublisher: failed to create mapping.");
+	if (GetLastError() == ERROR_ALREADY_EXISTS) {
+		CloseHandle(m_mapping);
+		throw std::runtime_error("FramePublisher: the ring already exists.");
+	}
+
+	m_view = static_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, 0));
+	if (m_view == nullptr) {
+		CloseHandle(m_mapping);
+		throw std::runtime_error("FramePublisher: failed to map.");
+	}
+
+	for (int i = 0; i < 2; ++i) {
+		m_events[i] = CreateEventW(nullptr, TRUE, FALSE, EventName(name, i).c_str());
+		if (m_events[i] == NULL) {
+			if (i == 1)
+				CloseHandle(m_events[0]);
+			UnmapViewOfFile(m_view);
+			CloseHandle(m_mapping);
+			throw std::runtime_error("FramePublisher: failed to create events.");
+		}
+		ResetEvent(m_events[i]);
+	}
+
+	// The mapping is zero-filled, so all slots are unlocked and nothing is published.
+	m_header = reinterpret_cast<SharedRingHeader*>(m_view);
+	m_slots = reinterpret_cast<SharedRingSlot*>(m_view + slotsOffset);
+	m_header->version = SharedRingVersion;
+	m_header->headerSize = sizeof(SharedRingHeader);
+	m_header->slotHeaderSize = sizeof(SharedRingSlot);
+	m_header->slotCount = static_cast<uint32_t>(options.slotCount);
+	m_header->slotsOffset = slotsOffset;
+	m_header->slotBytes = options.slotBytes;
+	m_header->slotStride = slotStride;
+	m_header->dataOffset = dataOffset;
+	m_header->mappingSize = mappingSize;
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(m_header->magic, SharedRingMagic, sizeof(SharedRingMagic));
+}
+
+FramePublisher::~FramePublisher() {
+	CloseHandle(m_events[0]);
+	CloseHandle(m_events[1]);
+	UnmapViewOfFile(m_view);
+	CloseHandle(m_mapping);
+}
+
+bool FramePublisher::push(const cv::Mat& frame, const FrameInfo& info) {
+	const uint64_t rowBytes = static_cast<uint64_t>(frame.cols) * frame.elemSize();
+	if (frame.empty() || rowBytes * frame.rows > m_header->slotBytes)
+		return false;
+
+	std::lock_guard lock(m_mutex);
+	const uint64_t index = m_published;
+	const uint64_t slotId = index % m_header->slotCount;
+	SharedRingSlot& slot = m_slots[slotId];
+	uint8_t* payload = m_view + m_header->dataOffset + slotId * m_header->slotStride;
+
+	// Readers seeing an odd lock, or a different lock after reading, will retry or drop their view.
+	const uint64_t slotLock = slot.lock;
+	StoreRelease(slot.lock, slotLock + 1);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	cv::Mat target(frame.rows, frame.cols, frame.type(), payload, static_cast<size_t>(rowBytes));
+	frame.copyTo(target);
+	slot.index = index;
+	slot.sequence = info.sequence;
+	slot.timestamp = info.timestamp;
+	slot.width = frame.cols;
+	slot.height = frame.rows;
+	slot.type = frame.type();
+	slot.step = static_cast<uint32_t>(rowBytes);
+
+	StoreRelease(slot.lock, slotLock + 2);
+
+	// See the layout in SharedRing.h for why the events are alternated.
+	ResetEvent(m_events[(index + 1) % 2]);
+	StoreRelease(m_header->published, index + 1);
+	SetEvent(m_events[index % 2]);
+
+	m_published = index + 1;
+	return true;
+}
+
+uint64_t FramePublisher::getPublishedCount() {
+	std::lock_guard lock(m_mutex);
+	return m_published;
+}
+
+FrameRingReader::FrameRingReader(const std::wstring& name) :
+	m_mapping(NULL),
+	m_events{ NULL, NULL },
+	m_view(nullptr),
+	m_header(nullptr),
+	m_slots(nullptr),
+
+	m_next(0),
+	m_skipped(0),
+	m_viewSlot(0),
+	m_viewLock(1) {
+	m_mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, name.c_str());
+	if (m_mapping == NULL)
+		throw std::runtime_error("FrameRingReader: failed to open mapping.");
+
+	m_view = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	MEMORY_BASIC_INFORMATION region{};
+	if (m_view == nullptr || VirtualQuery(m_view, &region, sizeof(region)) == 0 || region.RegionSize < sizeof(SharedRingHeader)) {
+		if (m_view != nullptr)
+			UnmapViewOfFile(m_view);
+		CloseHandle(m_mapping);
+		throw std::runtime_error("FrameRingReader: failed to map.");
+	}
+
+	m_header = reinterpret_cast<const SharedRingHeader*>(m_view);
+	const bool ready = std::memcmp(
+		const_cast<const char*>(reinterpret_cast<const volatile char*>(m_header->magic)),
+		SharedRingMagic, sizeof(SharedRingMagic)
+	) == 0;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (!ready ||
+		m_header->version != SharedRingVersion ||
+		m_header->slotHeaderSize != sizeof(SharedRingSlot) ||
+		m_header->slotCount < 2 || m_header->slotCount > SharedRingMaxSlots ||
+		m_header->mappingSize > region.RegionSize ||
+		m_header->dataOffset + m_header->slotCount * m_header->slotStride > m_header->mappingSize ||
+		m_header->slotBytes > m_header->slotStride) {
+		UnmapViewOfFile(m_view);
+		CloseHandle(m_mapping);
+		throw std::runtime_error("FrameRingReader: not a frame ring.");
+	}
+	m_slots = reinterpret_cast<const SharedRingSlot*>(m_view + m_header->slotsOffset);
+
+	for (int i = 0; i < 2; ++i) {
+		m_events[i] = OpenEventW(SYNCHRONIZE, FALSE, EventName(name, i).c_str());
+		if (m_events[i] == NULL) {
+			if (i == 1)
+				CloseHandle(m_events[0]);
+			UnmapViewOfFile(m_view);
+			CloseHandle(m_mapping);
+			throw std::runtime_error("FrameRingReader: failed to open events.");
+		}
+	}
+}
+
+FrameRingReader::~FrameRingReader() {
+	CloseHandle(m_events[0]);
+	CloseHandle(m_events[1]);
+	UnmapViewOfFile(m_view);
+	CloseHandle(m_mapping);
+}
+
+bool FrameRingReader::waitForFrame(uint32_t timeoutMs) {
+	const uint64_t published = LoadAcquire(m_header->published);
+	if (published > m_next)
+		return true;
+	WaitForSingleObject(m_events[published % 2], timeoutMs);
+	return LoadAcquire(m_header->published) > m_next;
+}
+
+bool FrameRingReader::acquireLatest(cv::Mat& view, FrameInfo& info) {
+	for (int attempt = 0; attempt < MaxReadAttempts; ++attempt) {
+		const uint64_t published = LoadAcquire(m_header->published);
+		if (published == 0)
+			return false;
+		const uint64_t index = published - 1;
+		const uint64_t slotId = index % m_header->slotCount;
+		const SharedRingSlot& slot = m_slots[slotId];
+
+		const uint64_t slotLock = LoadAcquire(slot.lock);
+		if (slotLock & 1) {
+			SwitchToThread();
+			continue;
+		}
+		SharedRingSlot copy;
+		std::memcpy(&copy, const_cast<const SharedRingSlot*>(&slot), sizeof(copy));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (*reinterpret_cast<const volatile uint64_t*>(&slot.lock) != slotLock || copy.index != index)
+			continue; // Overwritten while reading, try the newer one.
+
+		if (copy.width <= 0 || copy.height <= 0 ||
+			static_cast<uint64_t>(copy.step) * copy.height > m_header->slotBytes)
+			return false;
+
+		view = cv::Mat(
+			copy.height, copy.width, copy.type,
+			const_cast<uint8_t*>(m_view + m_header->dataOffset + slotId * m_header->slotStride), copy.step
+		);
+		info.sequence = copy.sequence;
+		info.timestamp = copy.timestamp;
+		info.width = copy.width;
+		info.height = copy.height;
+
+		if (index > m_next)
+			m_skipped += index - m_next;
+		if (index >= m_next)
+			m_next = index + 1;
+		m_viewSlot = slotId;
+		m_viewLock = slotLock;
+		return true;
+	}
+	return false;
+}
+
+bool FrameRingReader::isViewValid() {
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return *reinterpret_cast<const volatile uint64_t*>(&m_slots[m_viewSlot].lock) == m_viewLock;
+}
+
+bool FrameRingReader::copyLatest(cv::Mat& target, FrameInfo& info) {
+	cv::Mat view;
+	for (int attempt = 0; attempt < MaxReadAttempts; ++attempt) {
+		if (!acquireLatest(view, info))
+			return false;
+		view.copyTo(target);
+		if (isViewValid())
+			return true;
+	}
+	return false;
+}
+
+uint64_t FrameRingReader::getSkippedCount() {
+	return m_skipped;
+}
+
+} // namespace wgc
@@ -0,0 +1,94 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <mutex>
+#include "include/WGC/SharedRing.h"
+
+namespace wgc {
+
+/**
+ * @brief 共享内存帧环的发布端。
+*/
+class FramePublisher final :
+	public IFramePublisher {
+public:
+	/**
+	 * @brief This function may throws.
+	 */
+	FramePublisher(const std::wstring& name, const SharedRingOptions& options);
+
+	~FramePublisher();
+
+public:
+	virtual bool push(const cv::Mat& frame, const FrameInfo& info) override;
+
+	virtual uint64_t getPublishedCount() override;
+
+protected:
+	HANDLE m_mapping;
+	HANDLE m_events[2];
+	uint8_t* m_view;
+	SharedRingHeader* m_header;
+	SharedRingSlot* m_slots;
+
+	uint64_t m_published; // 只有发布端写，不必从共享内存读。
+	std::mutex m_mutex;
+};
+
+/**
+ * @brief 共享内存帧环的读取端。可在另一个进程中使用。
+*/
+class FrameRingReader final :
+	public IFrameRingReader {
+public:
+	/**
+	 * @brief This function may throws.
+	 */
+	FrameRingReader(const std::wstring& name);
+
+	~FrameRingReader();
+
+public:
+	virtual bool waitForFrame(uint32_t timeoutMs) override;
+
+	virtual bool acquireLatest(cv::Mat& view, FrameInfo& info) override;
+	virtual bool isViewValid() override;
+	virtual bool copyLatest(cv::Mat& target, FrameInfo& info) override;
+
+	virtual uint64_t getSkippedCount() override;
+
+protected:
+	HANDLE m_mapping;
+	HANDLE m_events[2];
+	const uint8_t* m_view;
+	const SharedRingHeader* m_header;
+	const SharedRingSlot* m_slots;
+
+	uint64_t m_next;     // 下一个未读的帧的序号。
+	uint64_t m_skipped;
+	uint64_t m_viewSlot; // 上次取得的视图所在的槽。
+	uint64_t m_viewLock; // 取得视图时槽的锁值。
+};
+
+} // namespace wgc
@@ -0,0 +1,143 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "StatsAccumulator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace {
+
+constexpr size_t BandBytes = 128 << 10; // 每带的字节数上限，使一带留在L2中。
+constexpr int FlushIterations = 128;    // 16位累加器在溢出前最多累加的次数（每次每通道至多加510）。
+
+} // namespace
+
+namespace wgc {
+
+StatsAccumulator::StatsAccumulator() {
+	reset();
+}
+
+void StatsAccumulator::reset() {
+	m_count = 0;
+	std::memset(m_sum, 0, sizeof(m_sum));
+	std::memset(m_min, 0xFF, sizeof(m_min));
+	std::memset(m_max, 0, sizeof(m_max));
+	std::memset(m_hist, 0, sizeof(m_hist));
+}
+
+void StatsAccumulator::addRow(const uint8_t* bgra, int count) {
+	if (count <= 0)
+		return;
+
+	// Four pixels per vector: every fourth byte belongs to the same channel.
+	const __m128i zero = _mm_setzero_si128();
+	__m128i vmin = _mm_set1_epi8(-1);
+	__m128i vmax = zero;
+	__m128i sum16 = zero; // [B G R A B G R A] of even and odd pixels.
+	__m128i sum32lo = zero, sum32hi = zero;
+	int x = 0, pending = 0;
+	for (; x + 4 <= count; x += 4) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgra + x * 4));
+		vmin = _mm_min_epu8(vmin, v);
+		vmax = _mm_max_epu8(vmax, v);
+		sum16 = _mm_add_epi16(sum16, _mm_add_epi16(_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero)));
+		if (++pending == FlushIterations) {
+			sum32lo = _mm_add_epi32(sum32lo, _mm_unpacklo_epi16(sum16, zero));
+			sum32hi = _mm_add_epi32(sum32hi, _mm_unpackhi_epi16(sum16, zero));
+			sum16 = zero;
+			pending = 0;
+		}
+	}
+	sum32lo = _mm_add_epi32(sum32lo, _mm_unpacklo_epi16(sum16, zero));
+	sum32hi = _mm_add_epi32(sum32hi, _mm_unpackhi_epi16(sum16, zero));
+
+	alignas(16) uint8_t mins[16], maxs[16];
+	alignas(16) uint32_t sums[8];
+	_mm_store_si128(reinterpret_cast<__m128i*>(mins), vmin);
+	_mm_store_si128(reinterpret_cast<__m128i*>(maxs), vmax);
+	_mm_store_si128(reinterpret_cast<__m128i*>(sums), _mm_add_epi32(sum32lo, sum32hi));
+	for (int c = 0; c < 4; ++c) {
+		m_sum[c] += static_cast<uint64_t>(sums[c]) + sums[c + 4];
+		m_min[c] = std::min({ m_min[c], mins[c], mins[c + 4], mins[c + 8], mins[c + 12] });
+		m_max[c] = std::max({ m_max[c], maxs[c], maxs[c + 4], maxs[c + 8], maxs[c + 12] });
+	}
+	for (; x < count; ++x) {
+		const uint8_t* p = bgra + x * 4;
+		for (int c = 0; c < 4; ++c) {
+			m_sum[c] += p[c];
+			m_min[c] = std::min(m_min[c], p[c]);
+			m_max[c] = std::max(m_max[c], p[c]);
+		}
+	}
+
+	// Histograms stay scalar, but read the row again while it is still in L1.
+	const uint8_t* p = bgra;
+	for (int i = 0; i < count; ++i, p += 4) {
+		++m_hist[0][p[0] >> 3];
+		++m_hist[1][p[1] >> 3];
+		++m_hist[2][p[2] >> 3];
+	}
+	m_count += count;
+}
+
+void StatsAccumulator::get(RegionStats& stats) const {
+	for (int c = 0; c < 4; ++c) {
+		stats.mean[c] = m_count ? static_cast<double>(m_sum[c]) / m_count : 0.0;
+		stats.min[c] = m_count ? m_min[c] : 0;
+		stats.max[c] = m_max[c];
+	}
+	std::memcpy(stats.histogram, m_hist, sizeof(m_hist));
+}
+
+void AccumulateStats(
+	const cv::Mat& frame, const std::vector<cv::Rect>& rects, std::vector<StatsAccumulator>& accs,
+	cv::Mat* target, bool convertToBGR
+) {
+	for (StatsAccumulator& acc : accs)
+		acc.reset();
+	if (target)
+		target->create(frame.size(), convertToBGR ? CV_8UC3 : frame.type());
+
+	const int bandRows = std::max(1, static_cast<int>(BandBytes / std::max<size_t>(frame.step, 1)));
+	for (int y0 = 0; y0 < frame.rows; y0 += bandRows) {
+		const int y1 = std::min(y0 + bandRows, frame.rows);
+		for (size_t i = 0; i < rects.size(); ++i) {
+			const cv::Rect& rect = rects[i];
+			const int top = std::max(y0, rect.y);
+			const int bottom = std::min(y1, rect.y + rect.height);
+			for (int y = top; y < bottom; ++y)
+				accs[i].addRow(frame.ptr<uint8_t>(y, rect.x), rect.width);
+		}
+		if (target == nullptr)
+			continue;
+		const cv::Range rows(y0, y1);
+		cv::Mat band = target->rowRange(rows);
+		if (convertToBGR)
+			cv::cvtColor(frame.rowRange(rows), band, cv::ColorConversionCodes::COLOR_BGRA2BGR, 3);
+		else
+			frame.rowRange(rows).copyTo(band);
+	}
+}
+
+} // namespace wgc
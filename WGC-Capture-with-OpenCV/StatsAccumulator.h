@@ -0,0 +1,65 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <vector>
+#include "include/WGC/WGC.h"
+
+namespace wgc {
+
+/**
+ * @brief 区域统计的累加器：均值、最值和32级直方图。按行输入BGRA像素。
+*/
+class StatsAccumulator final {
+public:
+	StatsAccumulator();
+
+public:
+	void reset();
+	/**
+	 * @brief 累加一行中连续的count个BGRA像素。
+	*/
+	void addRow(const uint8_t* bgra, int count);
+	/**
+	 * @brief 写出mean、min、max和histogram。
+	*/
+	void get(RegionStats& stats) const;
+
+protected:
+	uint64_t m_count;
+	uint64_t m_sum[4];
+	uint8_t m_min[4];
+	uint8_t m_max[4];
+	uint32_t m_hist[3][32];
+};
+
+/**
+ * @brief 按带（几行）遍历帧：先把各区域在带内的行交给累加器，再复制（可同时转为BGR）这一带，使其仍在缓存中。
+ * @brief target为nullptr时只统计。rects须在帧内，与accs一一对应。
+*/
+void AccumulateStats(
+	const cv::Mat& frame, const std::vector<cv::Rect>& rects, std::vector<StatsAccumulator>& accs,
+	cv::Mat* target, bool convertToBGR
+);
+
+} // namespace wgc
@@ -0,0 +1,218 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "SyntheticCapturer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+
+constexpr int MaxSyntheticSide = 16384; // 合成帧的最大边长。
+
+} // namespace
+
+namespace wgc {
+
+SyntheticCapturer::SyntheticCapturer(const SyntheticOptions& options, size_t id, std::shared_ptr<ImageSaver> saver, std::shared_ptr<BudgetTracker> budget) :
+	CapturerBase(id, saver, budget),
+
+	m_options(options),
+	m_codec(options.layout),
+	m_current(0),
+
+	m_stop(false),
+	m_generation(0),
+
+	m_started(false),
+	m_isWindow(false),
+	m_clientarea(false) {
+	if (options.width <= 0 || options.height <= 0 || options.width > MaxSyntheticSide || options.height > MaxSyntheticSide || options.fps < 0.0)
+		throw std::invalid_argument("SyntheticCapturer: invalid options.");
+	const cv::Rect stamp(options.layout.origin, m_codec.getSize());
+	if (options.stamp && (stamp & cv::Rect(0, 0, options.width, options.height)) != stamp)
+		throw std::invalid_argument("SyntheticCapturer: the stamp is outside the frame.");
+	m_frames[0].create(options.height, options.width, CV_8UC4);
+	m_frames[1].create(options.height, options.width, CV_8UC4);
+}
+
+SyntheticCapturer::~SyntheticCapturer() {
+	stopCapture();
+	JoinRetired();
+	// Only the generator thread is left, when destroyed from its own callback. It would return into the freed object,
+	// so this is forbidden (see IFactory::destroyCapturer()), and the joinable thread terminates in release builds.
+	assert(m_retired.empty());
+}
+
+bool SyntheticCapturer::startCaptureWindow(HWND, bool) {
+	Start(true, nullptr);
+	return true;
+}
+
+bool SyntheticCapturer::startCaptureMonitor(HMONITOR, bool) {
+	Start(false, nullptr);
+	return true;
+}
+
+bool SyntheticCapturer::startCaptureWindowWithCallback(HWND, std::function<void(const cv::Mat&)> cb) {
+	Start(true, cb);
+	return true;
+}
+
+bool SyntheticCapturer::startCaptureMonitorWithCallback(HMONITOR, std::function<void(const cv::Mat&)> cb) {
+	Start(false, cb);
+	return true;
+}
+
+void SyntheticCapturer::stopCapture() {
+	if (!m_started)
+		return;
+	{
+		std::lock_guard lock(m_mutex_wait);
+		m_stop = true;
+	}
+	m_cond_wait.notify_all();
+	if (m_generator.joinable()) {
+		if (m_generator.get_id() == std::this_thread::get_id())
+			m_retired.push_back(std::move(m_generator)); // Called from the callback, it exits after the callback returns.
+		else
+			m_generator.join();
+	}
+	StopDelivery();
+	m_started = false;
+}
+
+void SyntheticCapturer::setClipToClientArea(bool enabled) {
+	m_clientarea = enabled;
+}
+
+bool SyntheticCapturer::isClipToClientArea() {
+	return m_clientarea;
+}
+
+bool SyntheticCapturer::isCapturing() {
+	return m_started;
+}
+
+bool SyntheticCapturer::isCaptureWindow() {
+	return m_started && m_isWindow;
+}
+
+bool SyntheticCapturer::isCaptureMonitor() {
+	return m_started && !m_isWindow;
+}
+
+void SyntheticCapturer::askForRefresh() {
+	{
+		std::lock_guard lock(m_mutex_wait);
+		CapturerBase::askForRefresh();
+	}
+	m_cond_wait.notify_all();
+}
+
+void SyntheticCapturer::Start(bool window, std::function<void(const cv::Mat&)> cb) {
+	stopCapture();
+	JoinRetired();
+	BeginStart();
+
+	m_isWindow = window;
+	m_callback = cb;
+	uint64_t generation;
+	{
+		std::lock_guard lock(m_mutex_wait);
+		m_stop = false;
+		generation = ++m_generation;
+	}
+	StartDelivery();
+	m_started = true;
+	askForRefresh();
+	m_generator = std::thread(&SyntheticCapturer::GenerateLoop, this, static_cast<bool>(cb), generation);
+	EndStart(0.0);
+}
+
+void SyntheticCapturer::JoinRetired() {
+	const auto current = std::partition(
+		m_retired.begin(), m_retired.end(),
+		[](const std::thread& generator) -> bool { return generator.get_id() != std::this_thread::get_id(); }
+	);
+	for (auto it = m_retired.begin(); it != current; ++it)
+		it->join();
+	m_retired.erase(m_retired.begin(), current);
+}
+
+void SyntheticCapturer::GenerateLoop(bool withCallback, uint64_t generation) {
+	using Clock = std::chrono::steady_clock;
+	const bool unlimited = !(m_options.fps > 0.0);
+	const Clock::duration interval = unlimited ? Clock::duration::zero() :
+		std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_options.fps));
+	Clock::time_point deadline = Clock::now();
+
+	for (uint64_t index = 0; ; ++index) {
+		{
+			std::unique_lock lock(m_mutex_wait);
+			const auto stopped = [this, generation]() -> bool { return m_stop || m_generation != generation; };
+			if (!unlimited) {
+				if (m_cond_wait.wait_until(lock, deadline, stopped))
+					break;
+				deadline += interval;
+			}
+			else if (!withCallback) {
+				// As fast as possible, but only when a frame is asked for, like replay.
+				m_cond_wait.wait(lock, [this, &stopped]() -> bool { return stopped() || m_img_needRefresh; });
+			}
+			if (stopped())
+				break;
+		}
+		EnterCaptureThread(true);
+
+		cv::Mat& frame = m_frames[m_current];
+		FrameInfo info;
+		info.sequence = index;
+		info.width = frame.cols;
+		info.height = frame.rows;
+		info.timestamp = ILatencyStampCodec::now();
+		Draw(frame, index);
+		if (m_options.stamp)
+			m_codec.encode(frame, LatencyStamp{ static_cast<uint32_t>(index), info.timestamp });
+
+		RunFrameSinks(frame, info);
+		if (withCallback) {
+			DeliverFrameToCallback(frame, info);
+		}
+		else if (TakeRefreshRequest()) {
+			DeliverFrame(frame, info);
+			m_current ^= 1;
+		}
+		ApplyMemoryBudget();
+	}
+}
+
+void SyntheticCapturer::Draw(cv::Mat& frame, uint64_t index) {
+	// A bar moves across a flat background, so consecutive frames differ like a real desktop.
+	const int barWidth = std::max(1, frame.cols / 32);
+	const int x = static_cast<int>((index * barWidth) % static_cast<uint64_t>(frame.cols));
+	frame.setTo(cv::Scalar(64, 64, 64, 255));
+	frame(cv::Rect(x, 0, std::min(barWidth, frame.cols - x), frame.rows)).setTo(cv::Scalar(200, 160, 96, 255));
+}
+
+} // namespace wgc
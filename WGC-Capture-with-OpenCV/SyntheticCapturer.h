@@ -0,0 +1,96 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <vector>
+#include "CapturerBase.h"
+#include "LatencyStampCodec.h"
+
+namespace wgc {
+
+/**
+ * @brief 合成截取器：在自己的线程上按帧率生成帧，并在生成时画上延迟戳。用于没有显示器时测量本库。
+*/
+class SyntheticCapturer final :
+	public CapturerBase {
+public:
+	/**
+	 * @brief This function may throws.
+	 */
+	SyntheticCapturer(const SyntheticOptions& options, size_t id, std::shared_ptr<ImageSaver> saver, std::shared_ptr<BudgetTracker> budget);
+
+	~SyntheticCapturer();
+
+public:
+	virtual bool startCaptureWindow(HWND hwnd, bool freeThreaded = true) override;
+	virtual bool startCaptureMonitor(HMONITOR hmonitor, bool freeThreaded = true) override;
+
+	virtual bool startCaptureWindowWithCallback(HWND hwnd, std::function<void(const cv::Mat&)> cb) override;
+	virtual bool startCaptureMonitorWithCallback(HMONITOR hmonitor, std::function<void(const cv::Mat&)> cb) override;
+
+	virtual void stopCapture() override;
+
+	virtual void setClipToClientArea(bool enabled) override;
+	virtual bool isClipToClientArea() override;
+
+	virtual bool isCapturing() override;
+	virtual bool isCaptureWindow() override;
+	virtual bool isCaptureMonitor() override;
+
+	virtual void askForRefresh() override;
+
+protected:
+	void Start(bool window, std::function<void(const cv::Mat&)> cb);
+	void GenerateLoop(bool withCallback, uint64_t generation);
+	/**
+	 * @brief 等待已停止的生成线程结束，当前线程除外。
+	*/
+	void JoinRetired();
+	/**
+	 * @brief 在frame中画出第index帧。
+	 */
+	void Draw(cv::Mat& frame, uint64_t index);
+
+protected:
+	SyntheticOptions m_options;
+	LatencyStampCodec m_codec;
+	cv::Mat m_frames[2]; // 轮流生成。轮询模式交出一帧后换到另一个，用户读完前不覆盖它。
+	int m_current;
+
+	std::thread m_generator;
+	std::mutex m_mutex_wait;
+	std::condition_variable m_cond_wait;
+	bool m_stop;
+	uint64_t m_generation; // 每次开始加一，旧的生成线程看到变化就退出。受m_mutex_wait保护。
+	std::vector<std::thread> m_retired; // 在回调中停止的生成线程，由下一次开始或析构等待。不能在回调中析构。
+
+	bool m_started;
+	bool m_isWindow;
+	std::atomic<bool> m_clientarea; // 仅记录，不裁剪。
+};
+
+} // namespace wgc
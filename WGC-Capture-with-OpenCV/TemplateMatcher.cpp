@@ -0,0 +1,409 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "TemplateMatcher.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr int MinCoarseSide = 8;          // Templates are not shrunk below this.
+constexpr int CoarseCandidates = 3;       // Peaks at the coarse level refined at full resolution.
+constexpr int MaxFinePositions = 64 * 64; // Smaller windows are searched at full resolution directly.
+
+bool IsValidImage(const cv::Mat& image) {
+	return !image.empty() && image.depth() == CV_8U &&
+		(image.channels() == 1 || image.channels() == 3 || image.channels() == 4);
+}
+
+void ConvertImage(const cv::Mat& src, bool grayscale, cv::Mat& dst) {
+	switch (src.channels()) {
+	case 4:
+		cv::cvtColor(src, dst, grayscale ? cv::ColorConversionCodes::COLOR_BGRA2GRAY : cv::ColorConversionCodes::COLOR_BGRA2BGR);
+		break;
+	case 3:
+		if (grayscale)
+			cv::cvtColor(src, dst, cv::ColorConversionCodes::COLOR_BGR2GRAY);
+		else
+			src.copyTo(dst);
+		break;
+	default:
+		if (grayscale)
+			src.copyTo(dst);
+		else
+			cv::cvtColor(src, dst, cv::ColorConversionCodes::COLOR_GRAY2BGR);
+		break;
+	}
+}
+
+cv::Rect Expand(const cv::Rect& rect, int left, int top, int right, int bottom) {
+	return cv::Rect(rect.x - left, rect.y - top, rect.width + left + right, rect.height + top + bottom);
+}
+
+} // namespace
+
+namespace wgc {
+
+std::shared_ptr<ITemplateMatcher> ITemplateMatcher::createInstance(const TemplateMatcherOptions& options) noexcept {
+	if (options.pyramidLevels < 0 || options.pyramidLevels > 6 ||
+		options.tileSize <= 0 || options.searchMargin < 0 ||
+		!(options.threshold > -1.0 && options.threshold <= 1.0) || options.coarseSlack < 0.0)
+		return nullptr;
+	try {
+		return std::make_shared<TemplateMatcher>(options);
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+TemplateMatcher::TemplateMatcher(const TemplateMatcherOptions& options) :
+	m_options(options),
+	m_nextId(0),
+	m_current(0),
+	m_hasPrev(false),
+	m_allDirty(true) {}
+
+int TemplateMatcher::addTemplate(const cv::Mat& image, const cv::Mat& mask) {
+	if (!IsValidImage(image))
+		return -1;
+
+	cv::Mat templMask;
+	if (!mask.empty()) {
+		if (mask.size() != image.size() || mask.type() != CV_8UC1)
+			return -1;
+		templMask = mask;
+	}
+	else if (image.channels() == 4) {
+		cv::extractChannel(image, templMask, 3);
+	}
+	if (!templMask.empty()) {
+		if (cv::countNonZero(templMask) == 0)
+			return -1;
+		if (cv::countNonZero(templMask) == static_cast<int>(templMask.total()))
+			templMask.release(); // Fully opaque, the unmasked path is faster.
+		else
+			cv::compare(templMask, 0, templMask, cv::CmpTypes::CMP_GT);
+	}
+
+	Template t;
+	t.id = m_nextId++;
+	t.images.resize(1);
+	ConvertImage(image, m_options.grayscale, t.images[0]);
+	t.masks.push_back(templMask);
+	while (static_cast<int>(t.images.size()) <= m_options.pyramidLevels &&
+		std::min(t.images.back().cols, t.images.back().rows) / 2 >= MinCoarseSide) {
+		cv::Mat down;
+		cv::pyrDown(t.images.back(), down);
+		cv::Mat downMask;
+		if (!templMask.empty()) {
+			cv::resize(t.masks.back(), downMask, down.size(), 0.0, 0.0, cv::InterpolationFlags::INTER_NEAREST);
+			if (cv::countNonZero(downMask) == 0)
+				break;
+		}
+		t.images.push_back(down);
+		t.masks.push_back(downMask);
+	}
+	t.last.id = t.id;
+	t.needFull = true;
+	m_templates.push_back(std::move(t));
+	return m_templates.back().id;
+}
+
+bool TemplateMatcher::removeTemplate(int id) {
+	auto it = std::find_if(
+		m_templates.begin(), m_templates.end(),
+		[id](const Template& t) -> bool { return t.id == id; }
+	);
+	if (it == m_templates.end())
+		return false;
+	m_templates.erase(it);
+	return true;
+}
+
+const std::vector<MatchResult>& TemplateMatcher::match(const cv::Mat& frame) {
+	if (!PrepareFrame(frame))
+		return m_results;
+	if (!m_allDirty)
+		DiffTiles();
+	CollectDirtyRegions();
+	return MatchAll();
+}
+
+const std::vector<MatchResult>& TemplateMatcher::match(const cv::Mat& frame, const std::vector<cv::Rect>& dirtyRects) {
+	if (!PrepareFrame(frame))
+		return m_results;
+	if (!m_allDirty)
+		MarkRects(dirtyRects);
+	CollectDirtyRegions();
+	return MatchAll();
+}
+
+const std::vector<MatchResult>& TemplateMatcher::matchLatest(ICapturer& capturer) {
+	capturer.copyMatTo(m_input);
+	return match(m_input);
+}
+
+void TemplateMatcher::reset() {
+	m_hasPrev = false;
+	for (Template& t : m_templates) {
+		t.last = MatchResult();
+		t.last.id = t.id;
+		t.needFull = true;
+	}
+	m_results.clear();
+}
+
+bool TemplateMatcher::PrepareFrame(const cv::Mat& frame) {
+	if (!IsValidImage(frame))
+		return false;
+
+	m_current ^= 1;
+	cv::Mat& work = m_work[m_current];
+	ConvertImage(frame, m_options.grayscale, work);
+	m_allDirty = !m_hasPrev || m_work[m_current ^ 1].size() != work.size();
+
+	size_t levels = 1;
+	for (const Template& t : m_templates)
+		levels = std::max(levels, t.images.size());
+	m_pyramid.resize(levels);
+	m_pyramid[0] = work;
+	for (size_t i = 1; i < levels; ++i)
+		cv::pyrDown(m_pyramid[i - 1], m_pyramid[i]);
+
+	const int ts = m_options.tileSize;
+	m_dirtyTiles.create((work.rows + ts - 1) / ts, (work.cols + ts - 1) / ts, CV_8UC1);
+	m_dirtyTiles.setTo(m_allDirty ? 1 : 0);
+	return true;
+}
+
+void TemplateMatcher::DiffTiles() {
+	const cv::Mat& cur = m_work[m_current];
+	const cv::Mat& prev = m_work[m_current ^ 1];
+	const int ts = m_options.tileSize;
+	const size_t elemSize = cur.elemSize();
+	cv::parallel_for_(
+		cv::Range(0, m_dirtyTiles.rows),
+		[&](const cv::Range& range) -> void {
+			for (int ty = range.start; ty < range.end; ++ty) {
+				const int y0 = ty * ts;
+				const int y1 = std::min(y0 + ts, cur.rows);
+				uchar* flags = m_dirtyTiles.ptr<uchar>(ty);
+				for (int tx = 0; tx < m_dirtyTiles.cols; ++tx) {
+					const int x0 = tx * ts;
+					const size_t bytes = (std::min(x0 + ts, cur.cols) - x0) * elemSize;
+					for (int y = y0; y < y1; ++y) {
+						if (std::memcmp(cur.ptr<uchar>(y) + x0 * elemSize, prev.ptr<uchar>(y) + x0 * elemSize, bytes) != 0) {
+							flags[tx] = 1;
+							break;
+						}
+					}
+				}
+			}
+		}
+	);
+}
+
+void TemplateMatcher::MarkRects(const std::vector<cv::Rect>& rects) {
+	const cv::Rect frameRect(0, 0, m_work[m_current].cols, m_work[m_current].rows);
+	const int ts = m_options.tileSize;
+	for (const cv::Rect& rect : rects) {
+		const cv::Rect r = rect & frameRect;
+		if (r.empty())
+			continue;
+		const cv::Rect tiles(r.x / ts, r.y / ts, (r.br().x - 1) / ts - r.x / ts + 1, (r.br().y - 1) / ts - r.y / ts + 1);
+		m_dirtyTiles(tiles).setTo(1);
+	}
+}
+
+void TemplateMatcher::CollectDirtyRegions() {
+	m_dirtyRegions.clear();
+	if (m_allDirty)
+		return;
+
+	cv::Mat labels, stats, centroids;
+	const int count = cv::connectedComponentsWithStats(m_dirtyTiles, labels, stats, centroids, 8, CV_32S);
+	const cv::Rect frameRect(0, 0, m_work[m_current].cols, m_work[m_current].rows);
+	const int ts = m_options.tileSize;
+	for (int i = 1; i < count; ++i) { // 0 is the background.
+		const cv::Rect tiles(
+			stats.at<int>(i, cv::CC_STAT_LEFT), stats.at<int>(i, cv::CC_STAT_TOP),
+			stats.at<int>(i, cv::CC_STAT_WIDTH), stats.at<int>(i, cv::CC_STAT_HEIGHT)
+		);
+		m_dirtyRegions.push_back(cv::Rect(tiles.x * ts, tiles.y * ts, tiles.width * ts, tiles.height * ts) & frameRect);
+	}
+}
+
+bool TemplateMatcher::IsDirty(const cv::Rect& rect) const {
+	if (m_allDirty)
+		return true;
+	const int ts = m_options.tileSize;
+	const cv::Rect tiles = cv::Rect(
+		rect.x / ts, rect.y / ts,
+		(rect.br().x - 1) / ts - rect.x / ts + 1, (rect.br().y - 1) / ts - rect.y / ts + 1
+	) & cv::Rect(0, 0, m_dirtyTiles.cols, m_dirtyTiles.rows);
+	return tiles.empty() || cv::countNonZero(m_dirtyTiles(tiles)) > 0;
+}
+
+const std::vector<MatchResult>& TemplateMatcher::MatchAll() {
+	cv::parallel_for_(
+		cv::Range(0, static_cast<int>(m_templates.size())),
+		[this](const cv::Range& range) -> void {
+			for (int i = range.start; i < range.end; ++i)
+				MatchOne(m_templates[i]);
+		}
+	);
+	m_results.resize(m_templates.size());
+	for (size_t i = 0; i < m_templates.size(); ++i)
+		m_results[i] = m_templates[i].last;
+	m_hasPrev = true;
+	return m_results;
+}
+
+void TemplateMatcher::MatchOne(Template& t) const {
+	const cv::Mat& frame = m_pyramid[0];
+	const cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+	const cv::Size size = t.images[0].size();
+
+	MatchResult res;
+	res.id = t.id;
+	if (size.width > frame.cols || size.height > frame.rows) {
+		t.last = res;
+		t.needFull = true;
+		return;
+	}
+
+	bool full = m_allDirty || t.needFull;
+	if (!full && t.last.found) {
+		// Still there if nothing under it changed.
+		if (!IsDirty(t.last.rect)) {
+			t.last.reused = true;
+			return;
+		}
+		// Usually it moved a little, or its content changed in place.
+		const int margin = m_options.searchMargin;
+		Search(t, Expand(t.last.rect, margin, margin, margin, margin) & frameRect, res);
+		// Lost: other unchanged areas may hold a weaker match, so the whole frame has to be searched.
+		full = res.score < m_options.threshold;
+	}
+
+	if (full) {
+		res = MatchResult();
+		res.id = t.id;
+		Search(t, frameRect, res);
+	}
+	else if (!t.last.found) {
+		// Unchanged areas did not match before, so they still do not.
+		if (m_dirtyRegions.empty()) {
+			t.last.reused = true;
+			return;
+		}
+		for (const cv::Rect& region : m_dirtyRegions) {
+			const cv::Rect window = Expand(
+				region, size.width - 1, size.height - 1, size.width - 1, size.height - 1
+			) & frameRect;
+			Search(t, window, res);
+		}
+	}
+
+	res.found = res.score >= m_options.threshold;
+	res.reused = false;
+	t.last = res;
+	t.needFull = false;
+}
+
+void TemplateMatcher::Search(const Template& t, const cv::Rect& window, MatchResult& best) const {
+	const cv::Size size = t.images[0].size();
+	if (window.width < size.width || window.height < size.height)
+		return;
+
+	// Pick the coarsest level that still holds the window.
+	int level = static_cast<int>(t.images.size()) - 1;
+	const int positions = (window.width - size.width + 1) * (window.height - size.height + 1);
+	if (positions <= MaxFinePositions)
+		level = 0;
+	cv::Rect coarse;
+	while (level > 0) {
+		coarse = cv::Rect(window.x >> level, window.y >> level, window.width >> level, window.height >> level) &
+			cv::Rect(0, 0, m_pyramid[level].cols, m_pyramid[level].rows);
+		if (coarse.width >= t.images[level].cols && coarse.height >= t.images[level].rows)
+			break;
+		--level;
+	}
+	if (level == 0) {
+		SearchFine(t, window, best);
+		return;
+	}
+
+	cv::Mat result;
+	cv::matchTemplate(
+		m_pyramid[level](coarse), t.images[level], result,
+		cv::TemplateMatchModes::TM_CCOEFF_NORMED,
+		t.masks[level] // Empty if unmasked.
+	);
+	cv::patchNaNs(result, -1.0);
+
+	const cv::Size coarseSize = t.images[level].size();
+	const int radius = (1 << level) + 1;
+	for (int i = 0; i < CoarseCandidates; ++i) {
+		double maxVal;
+		cv::Point maxLoc;
+		cv::minMaxLoc(result, nullptr, &maxVal, nullptr, &maxLoc);
+		if (maxVal < m_options.threshold - m_options.coarseSlack)
+			break;
+
+		const cv::Point candidate((coarse.x + maxLoc.x) << level, (coarse.y + maxLoc.y) << level);
+		SearchFine(t, Expand(cv::Rect(candidate, size), radius, radius, radius, radius) & window, best);
+		if (best.score >= m_options.threshold)
+			break;
+
+		// Suppress this peak, try the next one.
+		cv::rectangle(
+			result,
+			cv::Rect(maxLoc.x - coarseSize.width / 2, maxLoc.y - coarseSize.height / 2, coarseSize.width, coarseSize.height),
+			cv::Scalar(-1.0), cv::FILLED
+		);
+	}
+}
+
+void TemplateMatcher::SearchFine(const Template& t, const cv::Rect& window, MatchResult& best) const {
+	const cv::Size size = t.images[0].size();
+	if (window.width < size.width || window.height < size.height)
+		return;
+
+	cv::Mat result;
+	cv::matchTemplate(
+		m_pyramid[0](window), t.images[0], result,
+		cv::TemplateMatchModes::TM_CCOEFF_NORMED,
+		t.masks[0]
+	);
+	cv::patchNaNs(result, -1.0);
+
+	double maxVal;
+	cv::Point maxLoc;
+	cv::minMaxLoc(result, nullptr, &maxVal, nullptr, &maxLoc);
+	if (maxVal > best.score || best.rect.empty()) {
+		best.score = maxVal;
+		best.rect = cv::Rect(window.tl() + maxLoc, size);
+	}
+}
+
+} // namespace wgc
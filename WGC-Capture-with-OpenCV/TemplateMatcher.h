@@ -0,0 +1,98 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include "include/WGC/TemplateMatcher.h"
+
+namespace wgc {
+
+/**
+ * @brief 模板匹配器。
+*/
+class TemplateMatcher final :
+	public ITemplateMatcher {
+public:
+	TemplateMatcher(const TemplateMatcherOptions& options);
+
+public:
+	virtual int addTemplate(const cv::Mat& image, const cv::Mat& mask = cv::Mat()) override;
+	virtual bool removeTemplate(int id) override;
+
+	virtual const std::vector<MatchResult>& match(const cv::Mat& frame) override;
+	virtual const std::vector<MatchResult>& match(const cv::Mat& frame, const std::vector<cv::Rect>& dirtyRects) override;
+	virtual const std::vector<MatchResult>& matchLatest(ICapturer& capturer) override;
+
+	virtual void reset() override;
+
+protected:
+	struct Template {
+		int id;
+		std::vector<cv::Mat> images; // 各层金字塔，[0]为原尺寸。
+		std::vector<cv::Mat> masks;  // 与images对应，无遮罩时为空。
+		MatchResult last;
+		bool needFull;               // 新加入、丢失或重置后，需要搜索整帧。
+	};
+
+	/**
+	 * @brief 转换格式并建立金字塔，返回是否与上一帧尺寸相同。
+	*/
+	bool PrepareFrame(const cv::Mat& frame);
+	/**
+	 * @brief 比较两帧，标记变化的tile。
+	*/
+	void DiffTiles();
+	void MarkRects(const std::vector<cv::Rect>& rects);
+	/**
+	 * @brief 把变化的tile合并为区域。
+	*/
+	void CollectDirtyRegions();
+	bool IsDirty(const cv::Rect& rect) const;
+
+	const std::vector<MatchResult>& MatchAll();
+	void MatchOne(Template& t) const;
+	/**
+	 * @brief 在窗口（原尺寸坐标）内从粗到细地搜索，更新best。
+	*/
+	void Search(const Template& t, const cv::Rect& window, MatchResult& best) const;
+	/**
+	 * @brief 在窗口内以原尺寸搜索，更新best。
+	*/
+	void SearchFine(const Template& t, const cv::Rect& window, MatchResult& best) const;
+
+protected:
+	TemplateMatcherOptions m_options;
+	int m_nextId;
+	std::vector<Template> m_templates;
+	std::vector<MatchResult> m_results;
+
+	cv::Mat m_input;            // matchLatest用。
+	cv::Mat m_work[2];          // 当前帧与上一帧，已转换格式。
+	int m_current;
+	bool m_hasPrev;
+	std::vector<cv::Mat> m_pyramid;
+	cv::Mat m_dirtyTiles;       // 每个tile一个字节。
+	std::vector<cv::Rect> m_dirtyRegions;
+	bool m_allDirty;
+};
+
+} // namespace wgc
@@ -0,0 +1,328 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "TilePool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t DefaultL2Bytes = 1 << 20; // 查询不到L2大小时使用。
+
+inline uint64_t PackRange(uint32_t begin, uint32_t end) {
+	return static_cast<uint64_t>(begin) | (static_cast<uint64_t>(end) << 32);
+}
+
+/**
+ * @brief 查询一个L2缓存的字节数。
+*/
+size_t QueryL2Bytes() {
+	DWORD bytes = 0;
+	if (GetLogicalProcessorInformation(nullptr, &bytes) || GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+		return DefaultL2Bytes;
+	std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> infos(bytes / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+	if (!GetLogicalProcessorInformation(infos.data(), &bytes))
+		return DefaultL2Bytes;
+	for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION& info : infos) {
+		if (info.Relationship == RelationCache && info.Cache.Level == 2 && info.Cache.Size > 0)
+			return info.Cache.Size;
+	}
+	return DefaultL2Bytes;
+}
+
+} // namespace
+
+namespace wgc {
+
+std::shared_ptr<ITilePool> ITilePool::createInstance(int threads) noexcept {
+	try {
+		return std::make_shared<TilePool>(threads);
+	}
+	catch (...) {}
+	return nullptr;
+}
+
+TilePool::TilePool(int threads) :
+	m_l2Bytes(QueryL2Bytes()),
+
+	m_generation(0),
+	m_stop(false),
+	m_active(0),
+	m_busy(0),
+
+	m_frame(nullptr),
+	m_tilesX(0),
+	m_fn(nullptr),
+	m_remaining(0) {
+	if (threads < 0)
+		throw std::invalid_argument("TilePool: negative thread count.");
+	if (threads == 0)
+		threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+	for (int i = 0; i < threads; ++i) {
+		m_workers.push_back(std::make_unique<Worker>());
+		m_workers.back()->range = 0;
+	}
+	const std::vector<GROUP_AFFINITY> nodes = AssignNodes();
+	try {
+		for (int i = 1; i < threads; ++i) {
+			const bool pin = !nodes.empty();
+			m_threads.emplace_back(&TilePool::WorkerLoop, this, i, pin ? nodes[m_workers[i]->node] : GROUP_AFFINITY{}, pin);
+		}
+	}
+	catch (...) {
+		{
+			std::lock_guard lock(m_mutex);
+			m_stop = true;
+		}
+		m_cond_start.notify_all();
+		for (std::thread& thread : m_threads)
+			thread.join();
+		throw;
+	}
+}
+
+TilePool::~TilePool() {
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_cond_start.notify_all();
+	for (std::thread& thread : m_threads)
+		thread.join();
+}
+
+int TilePool::getThreadCount() const {
+	return static_cast<int>(m_workers.size());
+}
+
+cv::Size TilePool::getDefaultTileSize(size_t elemSize) const {
+	// A quarter of L2 leaves room for the outputs and whatever else fn touches.
+	const double pixels = static_cast<double>(m_l2Bytes / 4) / std::max<size_t>(elemSize, 1);
+	const int side = std::max(16, static_cast<int>(std::sqrt(pixels)) & ~15);
+	return cv::Size(side, side);
+}
+
+size_t TilePool::getTileCount(const cv::Mat& frame, cv::Size tileSize) const {
+	if (frame.empty())
+		return 0;
+	if (tileSize.empty())
+		tileSize = getDefaultTileSize(frame.elemSize());
+	const size_t tilesX = (frame.cols + tileSize.width - 1) / tileSize.width;
+	const size_t tilesY = (frame.rows + tileSize.height - 1) / tileSize.height;
+	return tilesX * tilesY;
+}
+
+void TilePool::forEachTile(const cv::Mat& frame, cv::Size tileSize, const TileFunction& fn, int maxThreads) {
+	forEachTileIndexed(
+		frame, tileSize,
+		[&fn](const cv::Mat& tile, const cv::Rect& rect, size_t) -> void {
+			fn(tile, rect);
+		},
+		maxThreads
+	);
+}
+
+void TilePool::forEachTileIndexed(const cv::Mat& frame, cv::Size tileSize, const IndexedTileFunction& fn, int maxThreads) {
+	if (tileSize.empty())
+		tileSize = getDefaultTileSize(frame.elemSize());
+	const size_t count = getTileCount(frame, tileSize);
+	if (count == 0)
+		return;
+	if (count >= UINT32_MAX)
+		throw std::invalid_argument("TilePool: too many tiles.");
+
+	std::lock_guard lockCall(m_mutex_call);
+	m_frame = &frame;
+	m_tileSize = tileSize;
+	m_tilesX = (frame.cols + tileSize.width - 1) / tileSize.width;
+	m_fn = &fn;
+	m_error = nullptr;
+	m_remaining = static_cast<uint32_t>(count);
+
+	// Contiguous chunks: neighbouring tiles, and neighbouring workers share a NUMA node.
+	int workers = static_cast<int>(m_workers.size());
+	if (maxThreads > 0)
+		workers = std::min(workers, maxThreads);
+	workers = static_cast<int>(std::min<size_t>(workers, count));
+	for (int i = 0; i < static_cast<int>(m_workers.size()); ++i) {
+		const uint32_t begin = (i < workers) ? static_cast<uint32_t>(count * i / workers) : 0;
+		const uint32_t end = (i < workers) ? static_cast<uint32_t>(count * (i + 1) / workers) : 0;
+		m_workers[i]->range.store(PackRange(begin, end), std::memory_order_release);
+	}
+
+	if (workers > 1) {
+		{
+			std::lock_guard lock(m_mutex);
+			m_active = workers;
+			++m_generation;
+		}
+		m_cond_start.notify_all();
+	}
+	Work(0);
+	{
+		// A worker that woke up late may still be running a tile it stole.
+		std::unique_lock lock(m_mutex);
+		m_cond_done.wait(lock, [this]() -> bool { return m_remaining == 0 && m_busy == 0; });
+	}
+
+	m_frame = nullptr;
+	m_fn = nullptr;
+	if (m_error) {
+		std::exception_ptr error = m_error;
+		m_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+std::vector<GROUP_AFFINITY> TilePool::AssignNodes() {
+	std::vector<GROUP_AFFINITY> nodes;
+	DWORD bytes = 0;
+	if (!GetLogicalProcessorInformationEx(RelationNumaNode, nullptr, &bytes) && GetLastError() == ERROR_INSUFFICIENT_BUFFER) {
+		std::vector<uint8_t> buffer(bytes);
+		if (GetLogicalProcessorInformationEx(RelationNumaNode, reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()), &bytes)) {
+			for (DWORD offset = 0; offset < bytes;) {
+				const auto* info = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+				if (info->Relationship == RelationNumaNode)
+					nodes.push_back(info->NumaNode.GroupMask);
+				offset += info->Size;
+			}
+		}
+	}
+
+	// Blocks of neighbouring workers per node, so neighbouring chunks stay on one node.
+	const int count = static_cast<int>(m_workers.size());
+	const int nodeCount = std::max<int>(1, static_cast<int>(nodes.size()));
+	for (int i = 0; i < count; ++i)
+		m_workers[i]->node = i * nodeCount / count;
+	for (int i = 0; i < count; ++i) {
+		std::vector<int>& victims = m_workers[i]->victims;
+		for (int j = 0; j < count; ++j) {
+			if (j != i)
+				victims.push_back(j);
+		}
+		const int node = m_workers[i]->node;
+		std::stable_sort(
+			victims.begin(), victims.end(),
+			[this, i, node](int a, int b) -> bool {
+				const bool farA = m_workers[a]->node != node;
+				const bool farB = m_workers[b]->node != node;
+				if (farA != farB)
+					return farB;
+				return std::abs(a - i) < std::abs(b - i);
+			}
+		);
+	}
+
+	if (nodes.size() <= 1)
+		nodes.clear(); // One node: leave the threads to the scheduler.
+	return nodes;
+}
+
+void TilePool::WorkerLoop(int index, GROUP_AFFINITY affinity, bool pin) {
+	if (pin)
+		SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+
+	uint64_t seen = 0;
+	std::unique_lock lock(m_mutex);
+	while (true) {
+		m_cond_start.wait(lock, [this, &seen]() -> bool { return m_stop || m_generation != seen; });
+		if (m_stop)
+			return;
+		seen = m_generation;
+		if (index >= m_active)
+			continue;
+		++m_busy;
+		lock.unlock();
+		Work(index);
+		lock.lock();
+		if (--m_busy == 0)
+			m_cond_done.notify_all();
+	}
+}
+
+void TilePool::Work(int index) {
+	Worker& self = *m_workers[index];
+	uint32_t tile;
+	do {
+		while (Pop(self, tile))
+			RunTile(tile);
+	} while (Steal(index));
+}
+
+bool TilePool::Pop(Worker& worker, uint32_t& tile) {
+	uint64_t range = worker.range.load(std::memory_order_acquire);
+	while (true) {
+		const uint32_t begin = static_cast<uint32_t>(range);
+		const uint32_t end = static_cast<uint32_t>(range >> 32);
+		if (begin >= end)
+			return false;
+		if (worker.range.compare_exchange_weak(range, PackRange(begin + 1, end), std::memory_order_acq_rel, std::memory_order_acquire)) {
+			tile = begin;
+			return true;
+		}
+	}
+}
+
+bool TilePool::Steal(int index) {
+	Worker& self = *m_workers[index];
+	for (int victim : self.victims) {
+		Worker& other = *m_workers[victim];
+		uint64_t range = other.range.load(std::memory_order_acquire);
+		while (true) {
+			const uint32_t begin = static_cast<uint32_t>(range);
+			const uint32_t end = static_cast<uint32_t>(range >> 32);
+			if (begin >= end)
+				break;
+			// Take the back half, the owner keeps walking from the front. Take the last one too.
+			const uint32_t mid = begin + (end - begin) / 2;
+			if (other.range.compare_exchange_weak(range, PackRange(begin, mid), std::memory_order_acq_rel, std::memory_order_acquire)) {
+				self.range.store(PackRange(mid, end), std::memory_order_release);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void TilePool::RunTile(uint32_t tile) {
+	const int tx = static_cast<int>(tile % m_tilesX);
+	const int ty = static_cast<int>(tile / m_tilesX);
+	const int x = tx * m_tileSize.width;
+	const int y = ty * m_tileSize.height;
+	const cv::Rect rect(x, y, std::min(m_tileSize.width, m_frame->cols - x), std::min(m_tileSize.height, m_frame->rows - y));
+	try {
+		(*m_fn)((*m_frame)(rect), rect, tile);
+	}
+	catch (...) {
+		std::lock_guard lock(m_mutex_error);
+		if (!m_error)
+			m_error = std::current_exception();
+	}
+	if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		std::lock_guard lock(m_mutex);
+		m_cond_done.notify_all();
+	}
+}
+
+} // namespace wgc
@@ -0,0 +1,107 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <condition_variable>
+#include "include/WGC/TilePool.h"
+
+namespace wgc {
+
+/**
+ * @brief 分块并行的线程池。每个工作者拥有一段连续的块序号，做完后从其他工作者（优先同一NUMA节点）处窃取一半。
+ * @brief 0号工作者是调用者自己。
+*/
+class TilePool final :
+	public ITilePool {
+public:
+	/**
+	 * @brief This function may throws.
+	 * @param threads: 工作者数，包括调用者，0表示按逻辑处理器数决定。
+	*/
+	TilePool(int threads);
+
+	~TilePool();
+
+public:
+	virtual int getThreadCount() const override;
+	virtual cv::Size getDefaultTileSize(size_t elemSize) const override;
+	virtual size_t getTileCount(const cv::Mat& frame, cv::Size tileSize) const override;
+
+	virtual void forEachTile(const cv::Mat& frame, cv::Size tileSize, const TileFunction& fn, int maxThreads = 0) override;
+	virtual void forEachTileIndexed(const cv::Mat& frame, cv::Size tileSize, const IndexedTileFunction& fn, int maxThreads = 0) override;
+
+protected:
+	/**
+	 * @brief 工作者剩余的块序号区间，低32位为begin，高32位为end，由所有者从前端取、窃取者从后端取。
+	*/
+	struct alignas(64) Worker {
+		std::atomic<uint64_t> range;
+		int node;                 // NUMA节点。
+		std::vector<int> victims; // 窃取的顺序：同节点的近邻优先。
+	};
+
+	/**
+	 * @brief 查询NUMA节点，给工作者分配节点并排好窃取顺序。返回各节点的处理器亲和性，只有一个节点时为空。
+	*/
+	std::vector<GROUP_AFFINITY> AssignNodes();
+
+	void WorkerLoop(int index, GROUP_AFFINITY affinity, bool pin);
+	/**
+	 * @brief 做完自己的块，再不断窃取，直到所有区间都空了。
+	*/
+	void Work(int index);
+	bool Pop(Worker& worker, uint32_t& tile);
+	bool Steal(int index);
+	void RunTile(uint32_t tile);
+
+protected:
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::vector<std::thread> m_threads;
+	size_t m_l2Bytes;
+
+	std::mutex m_mutex_call; // 一次只做一个任务。
+
+	std::mutex m_mutex;
+	std::condition_variable m_cond_start;
+	std::condition_variable m_cond_done;
+	uint64_t m_generation;
+	bool m_stop;
+	int m_active; // 参与本次任务的工作者数。
+	int m_busy;   // 正在本次任务中的后台工作者数。
+
+	// 本次任务。
+	const cv::Mat* m_frame;
+	cv::Size m_tileSize;
+	int m_tilesX;
+	const IndexedTileFunction* m_fn;
+	std::atomic<uint32_t> m_remaining;
+	std::exception_ptr m_error;
+	std::mutex m_mutex_error;
+};
+
+} // namespace wgc
@@ -0,0 +1,213 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#include "pch.h"
+#include "ViewFanout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+/**
+ * @brief 合并重叠（overlapping为false时只合并相同）的区域，直到无可合并。members记录各区域由哪些原区域合并而来。
+*/
+void MergeAreas(std::vector<cv::Rect>& rects, std::vector<std::vector<size_t>>& members, bool overlapping) {
+	bool merged = true;
+	while (merged) {
+		merged = false;
+		for (size_t i = 0; i < rects.size() && !merged; ++i) {
+			for (size_t j = i + 1; j < rects.size(); ++j) {
+				if (overlapping ? (rects[i] & rects[j]).empty() : rects[i] != rects[j])
+					continue;
+				rects[i] |= rects[j];
+				members[i].insert(members[i].end(), members[j].begin(), members[j].end());
+				rects.erase(rects.begin() + j);
+				members.erase(members.begin() + j);
+				merged = true;
+				break;
+			}
+		}
+	}
+}
+
+} // namespace
+
+namespace wgc {
+
+ViewFanout::ViewFanout() :
+	m_nextId(0),
+	m_dirty(true) {}
+
+bool ViewFanout::IsValid(const ViewOptions& options) {
+	const cv::Rect& roi = options.roi;
+	if (roi != cv::Rect() && (roi.x < 0 || roi.y < 0 || roi.width <= 0 || roi.height <= 0))
+		return false;
+	if (!(options.scale > 0.0 && options.scale <= 1.0))
+		return false;
+	if (options.colorConversion < 0)
+		return options.colorConversion == -1;
+	try {
+		cv::Mat converted;
+		cv::cvtColor(cv::Mat(2, 2, CV_8UC4, cv::Scalar::all(0)), converted, options.colorConversion);
+		return true;
+	}
+	catch (...) {}
+	return false;
+}
+
+int ViewFanout::add(const ViewOptions& options, ViewCallback callback) {
+	Subscriber subscriber = {};
+	subscriber.id = m_nextId++;
+	subscriber.options = options;
+	subscriber.callback = std::make_shared<const ViewCallback>(std::move(callback));
+	subscriber.output = -1;
+	m_subscribers.push_back(std::move(subscriber));
+	m_dirty = true;
+	return m_subscribers.back().id;
+}
+
+bool ViewFanout::remove(int id) {
+	const auto it = std::find_if(
+		m_subscribers.begin(), m_subscribers.end(),
+		[id](const Subscriber& subscriber) -> bool { return subscriber.id == id; }
+	);
+	if (it == m_subscribers.end())
+		return false;
+	m_subscribers.erase(it);
+	m_dirty = true;
+	if (m_subscribers.empty()) {
+		m_graph.reset();
+		m_outputs.clear();
+	}
+	return true;
+}
+
+bool ViewFanout::empty() const {
+	return m_subscribers.empty();
+}
+
+void ViewFanout::process(const cv::Mat& frame, bool fresh, std::vector<Delivery>& deliveries) {
+	if (frame.empty() || m_subscribers.empty())
+		return;
+	if (m_dirty || m_size != frame.size())
+		Build(frame.size());
+	if (fresh)
+		m_outputs.clear(); // The last results may still be held by the delivery thread.
+	if (!m_graph->run(frame, m_outputs))
+		return;
+	for (const Subscriber& subscriber : m_subscribers) {
+		if (subscriber.output < 0)
+			continue;
+		const cv::Mat& output = m_outputs[subscriber.output];
+		const cv::Rect part = subscriber.part & cv::Rect(0, 0, output.cols, output.rows);
+		if (part.empty())
+			continue;
+		deliveries.push_back({ output(part), subscriber.callback });
+	}
+}
+
+size_t ViewFanout::getBytes() {
+	size_t bytes = 0;
+	for (const cv::Mat& output : m_outputs)
+		bytes += output.total() * output.elemSize();
+	if (m_graph)
+		bytes += m_graph->getPoolBytes();
+	return bytes;
+}
+
+void ViewFanout::Build(cv::Size size) {
+	m_size = size;
+	m_graph = std::make_unique<FrameGraph>();
+	m_outputs.clear();
+	const cv::Rect bounds(0, 0, size.width, size.height);
+
+	// Views of the same scale and format are merged where they overlap, if not resized.
+	std::map<std::tuple<double, int>, std::vector<size_t>> groups;
+	for (size_t i = 0; i < m_subscribers.size(); ++i) {
+		Subscriber& subscriber = m_subscribers[i];
+		subscriber.output = -1;
+		const cv::Rect roi = (subscriber.options.roi == cv::Rect()) ? bounds : (subscriber.options.roi & bounds);
+		if (roi.empty())
+			continue;
+		subscriber.part = roi; // In the frame for now.
+		groups[{ subscriber.options.scale, subscriber.options.colorConversion }].push_back(i);
+	}
+
+	// Crops and resizes are shared by groups that need the same area, so only the conversions differ.
+	std::map<std::tuple<int, int, int, int>, int> crops;
+	std::map<std::tuple<int, int, int, int, double>, int> resizes;
+	for (const auto& [key, indices] : groups) {
+		const auto [scale, code] = key;
+		std::vector<cv::Rect> areas;
+		std::vector<std::vector<size_t>> members;
+		for (size_t i : indices) {
+			areas.push_back(m_subscribers[i].part);
+			members.push_back({ i });
+		}
+		// A part of a resized area would differ from resizing the view alone, in size and in sampling.
+		// So resized views are merged only if identical, and each is exactly lround(roi * scale).
+		MergeAreas(areas, members, scale == 1.0);
+
+		for (size_t a = 0; a < areas.size(); ++a) {
+			const cv::Rect& area = areas[a];
+			const std::tuple<int, int, int, int> areaKey(area.x, area.y, area.width, area.height);
+			int node = IFrameGraph::Input;
+			if (area != bounds) {
+				auto it = crops.find(areaKey);
+				if (it == crops.end())
+					it = crops.emplace(areaKey, m_graph->crop(node, area)).first;
+				node = it->second;
+			}
+			cv::Size scaled = area.size();
+			if (scale != 1.0) {
+				scaled.width = std::max(1, static_cast<int>(std::lround(area.width * scale)));
+				scaled.height = std::max(1, static_cast<int>(std::lround(area.height * scale)));
+				const auto resizeKey = std::tuple_cat(areaKey, std::make_tuple(scale));
+				auto it = resizes.find(resizeKey);
+				if (it == resizes.end())
+					it = resizes.emplace(resizeKey, m_graph->resize(node, scaled)).first;
+				node = it->second;
+			}
+			if (code >= 0)
+				node = m_graph->cvtColor(node, code);
+			const int output = m_graph->addOutput(node);
+
+			// Each view is its part of the merged output, in the pixels of the output.
+			const double sx = static_cast<double>(scaled.width) / area.width;
+			const double sy = static_cast<double>(scaled.height) / area.height;
+			for (size_t i : members[a]) {
+				Subscriber& subscriber = m_subscribers[i];
+				const cv::Rect& roi = subscriber.part;
+				const int x0 = static_cast<int>(std::lround((roi.x - area.x) * sx));
+				const int y0 = static_cast<int>(std::lround((roi.y - area.y) * sy));
+				const int x1 = static_cast<int>(std::lround((roi.br().x - area.x) * sx));
+				const int y1 = static_cast<int>(std::lround((roi.br().y - area.y) * sy));
+				subscriber.output = output;
+				subscriber.part = cv::Rect(x0, y0, std::max(1, x1 - x0), std::max(1, y1 - y0));
+			}
+		}
+	}
+	m_dirty = false;
+}
+
+} // namespace wgc
@@ -0,0 +1,95 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "pch.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+#include "include/WGC/WGC.h"
+#include "FrameGraph.h"
+
+namespace wgc {
+
+/**
+ * @brief 多订阅者的视图分发：把各订阅者要的视图编成一张FrameGraph，每帧执行一次。
+ * @brief 格式相同、不缩放且区域重叠的视图合并为一个输出，各自取其中的一块；相同的视图共用同一块。
+*/
+class ViewFanout final {
+public:
+	ViewFanout();
+
+public:
+	/**
+	 * @brief 一个订阅者本帧的视图。view与其他订阅者共享，只读。
+	*/
+	struct Delivery {
+		cv::Mat view;
+		std::shared_ptr<const ViewCallback> callback;
+	};
+
+	/**
+	 * @brief 检查选项，包括colorConversion能否用于BGRA。
+	*/
+	static bool IsValid(const ViewOptions& options);
+
+	/**
+	 * @brief 添加订阅者，返回其id。参数须已检查。
+	*/
+	int add(const ViewOptions& options, ViewCallback callback);
+	bool remove(int id);
+	bool empty() const;
+	/**
+	 * @brief 计算本帧的所有视图，追加到deliveries。失败时不追加。
+	 * @param fresh: 结果分配新的缓冲，而不是复用上一帧的，以便在本次调用之后使用。
+	*/
+	void process(const cv::Mat& frame, bool fresh, std::vector<Delivery>& deliveries);
+	/**
+	 * @brief 输出和中间结果占用的字节数。
+	*/
+	size_t getBytes();
+
+protected:
+	struct Subscriber {
+		int id;
+		ViewOptions options;
+		std::shared_ptr<const ViewCallback> callback;
+		int output;    // 所在的输出，-1表示本帧没有视图（区域在帧外）。
+		cv::Rect part; // 在输出中的区域。
+	};
+
+	/**
+	 * @brief 按帧尺寸重新编图。
+	*/
+	void Build(cv::Size size);
+
+protected:
+	std::vector<Subscriber> m_subscribers; // 按添加顺序。
+	int m_nextId;
+	bool m_dirty; // 订阅者变了，需要重新编图。
+
+	cv::Size m_size; // 图对应的帧尺寸。
+	std::unique_ptr<FrameGraph> m_graph;
+	std::vector<cv::Mat> m_outputs;
+};
+
+} // namespace wgc
@@ -22,16 +22,21 @@
 #include "include/WGC/WGC.h"
 #include "Factory.h"
 
+#include <chrono>
+
 namespace wgc {
 
-std::shared_ptr<IFactory> IFactory::createInstance(bool winrt_initialized) {
+std::shared_ptr<IFactory> IFactory::createInstance(bool winrt_initialized, FactoryInit init) {
+	const auto start = std::chrono::steady_clock::now();
 	if (!winrt_initialized) {
 		winrt::init_apartment();
 	}
-	return std::make_shared<wgc::Factory>();
+	const double apartmentSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return std::make_shared<wgc::Factory>(init, apartmentSeconds);
 }
 
-std::shared_ptr<IFactory> IFactory::createInstanceNoThrow(bool winrt_initialized) noexcept {
+std::shared_ptr<IFactory> IFactory::createInstanceNoThrow(bool winrt_initialized, FactoryInit init) noexcept {
+	const auto start = std::chrono::steady_clock::now();
 	if (!winrt_initialized) {
 		try {
 			winrt::init_apartment();
@@ -42,8 +47,9 @@ std::shared_ptr<IFactory> IFactory::createInstanceNoThrow(bool winrt_initialized
 			MessageBoxW(NULL, message.c_str(), L"WGC: WinRT init failed", MB_ICONERROR);
 		}
 	}
+	const double apartmentSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 	try {
-		return std::make_shared<wgc::Factory>();
+		return std::make_shared<wgc::Factory>(init, apartmentSeconds);
 	}
 	catch (...) {
 		MessageBoxW(NULL, L"Failed to create instance.", L"WGC: Init failed", MB_ICONERROR);
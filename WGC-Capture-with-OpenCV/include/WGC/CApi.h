@@ -0,0 +1,190 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+/**
+ * @brief Plain C interface of the library, for callers that cannot use the C++ one (C, other languages through FFI,
+ * @brief or C++ built with another compiler or runtime).
+ * @brief Objects are opaque handles and every function returns a wgc_result instead of throwing.
+ * @brief Frames are written by the library directly into memory owned by the caller, converted to the format the
+ * @brief caller asks for, without an intermediate copy.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+
+#ifdef WGCCAPTUREWITHOPENCV_EXPORTS
+#define WGC_CAPI __declspec(dllexport)
+#else
+#define WGC_CAPI __declspec(dllimport)
+#endif
+#define WGC_CALL __cdecl
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct wgc_factory_t* wgc_factory;
+typedef struct wgc_capturer_t* wgc_capturer;
+
+/**
+ * @brief Result of every function. Negative values are errors.
+*/
+typedef int32_t wgc_result;
+
+#define WGC_OK                        0
+#define WGC_ERROR_INVALID_ARGUMENT   -1 /* A handle or pointer is NULL, or a value is out of range. */
+#define WGC_ERROR_FAILED             -2 /* The operation failed, see wgc_get_last_error(). */
+#define WGC_ERROR_NO_FRAME           -3 /* Nothing is captured yet, or the capture stopped. */
+#define WGC_ERROR_TIMEOUT            -4 /* No new frame arrived in time. */
+#define WGC_ERROR_BUFFER_TOO_SMALL   -5 /* The destination is smaller than the frame. The info is still filled. */
+#define WGC_ERROR_OUT_OF_MEMORY      -6
+#define WGC_ERROR_REFUSED            -7 /* The memory budget of the factory refuses new capturers. */
+
+/**
+ * @brief Pixel formats of a destination buffer. Captured frames are BGRA.
+*/
+typedef int32_t wgc_format;
+
+#define WGC_FORMAT_BGRA8 0 /* 4 bytes per pixel, as captured. */
+#define WGC_FORMAT_BGR8  1 /* 3 bytes per pixel, alpha dropped. */
+#define WGC_FORMAT_RGBA8 2 /* 4 bytes per pixel. */
+#define WGC_FORMAT_RGB8  3 /* 3 bytes per pixel. */
+#define WGC_FORMAT_GRAY8 4 /* 1 byte per pixel. */
+
+/**
+ * @brief Information of a frame. See wgc::FrameInfo.
+*/
+typedef struct wgc_frame_info {
+	uint64_t sequence;  /* Index of the frame since capture started. */
+	int64_t  timestamp; /* SystemRelativeTime of the frame, in 100ns units. */
+	int32_t  width;     /* Width of the frame in pixels. */
+	int32_t  height;    /* Height of the frame in pixels. */
+	double   scale;     /* Size of the frame relative to the captured one. */
+} wgc_frame_info;
+
+/**
+ * @brief Memory owned by the caller to receive a frame.
+ * @brief The frame is written at the top-left corner, so 'width' and 'height' only need to be at least the frame size.
+ * @brief A buffer of no capacity ('data' NULL, 'width' and 'height' 0) only gets the information of the frame.
+*/
+typedef struct wgc_buffer {
+	void*      data;   /* First byte of the first row. */
+	int64_t    stride; /* Byte count from one row to the next, at least width * bytes per pixel. */
+	int32_t    width;  /* Capacity in pixels. */
+	int32_t    height; /* Capacity in rows. */
+	wgc_format format; /* WGC_FORMAT_*. */
+} wgc_buffer;
+
+/**
+ * @brief Called on the capture thread for each frame, after wgc_capturer_start_*_callback().
+ * @brief Call wgc_capturer_copy_frame() inside it to get the frame. It must not destroy or restart the capturer.
+*/
+typedef void (WGC_CALL* wgc_frame_callback)(wgc_capturer capturer, const wgc_frame_info* info, void* user);
+
+/**
+ * @brief A static English description of the result.
+*/
+WGC_CAPI const char* WGC_CALL wgc_result_string(wgc_result result);
+/**
+ * @brief The message of the last failed call on this thread. Valid until the next call on this thread.
+ * @return An empty string if nothing failed.
+*/
+WGC_CAPI const char* WGC_CALL wgc_get_last_error(void);
+
+/**
+ * @brief Create a factory. See wgc::IFactory::createInstance().
+ * @param com_initialized: Non-zero if WinRT (COM) is initialized on this thread by the caller.
+ * @param factory: Receives the handle.
+*/
+WGC_CAPI wgc_result WGC_CALL wgc_factory_create(int com_initialized, wgc_factory* factory);
+/**
+ * @brief Destroy a factory. NULL is ignored. Its capturers keep it alive until they are destroyed.
+*/
+WGC_CAPI void WGC_CALL wgc_factory_destroy(wgc_factory factory);
+
+/**
+ * @brief Create a capturer of the factory.
+ * @param capturer: Receives the handle.
+*/
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_create(wgc_factory factory, wgc_capturer* capturer);
+/**
+ * @brief Create a capturer that replays a file of wgc::IRecorder. See wgc::IFactory::createReplayCapturer().
+ * @param path: The recorded file.
+ * @param speed: Multiplier of the recorded pace. 0 means as fast as possible.
+ * @param loop: Non-zero to restart from the first frame at the end.
+ * @param capturer: Receives the handle.
+*/
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_create_replay(wgc_factory factory, const wchar_t* path, double speed, int loop, wgc_capturer* capturer);
+/**
+ * @brief Stop and destroy a capturer. NULL is ignored.
+*/
+WGC_CAPI void WGC_CALL wgc_capturer_destroy(wgc_capturer capturer);
+
+/**
+ * @brief Start capturing a monitor in polling mode. Get frames with wgc_capturer_read().
+ * @param hmonitor: The HMONITOR, or NULL for the primary monitor.
+ * @param free_threaded: Non-zero to get frames on another thread. Otherwise the thread must dispatch messages.
+*/
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_start_monitor(wgc_capturer capturer, void* hmonitor, int free_threaded);
+/**
+ * @brief Start capturing a window in polling mode. Get frames with wgc_capturer_read().
+ * @param hwnd: The HWND.
+ * @param free_threaded: Non-zero to get frames on another thread. Otherwise the thread must dispatch messages.
+*/
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_start_window(wgc_capturer capturer, void* hwnd, int free_threaded);
+/**
+ * @brief Start capturing a monitor in callback mode.
+ * @param hmonitor: The HMONITOR, or NULL for the primary monitor.
+*/
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_start_monitor_callback(wgc_capturer capturer, void* hmonitor, wgc_frame_callback callback, void* user);
+/**
+ * @brief Start capturing a window in callback mode.
+*/
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_start_window_callback(wgc_capturer capturer, void* hwnd, wgc_frame_callback callback, void* user);
+/**
+ * @brief Stop capturing. Nothing happens if it is stopped.
+*/
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_stop(wgc_capturer capturer);
+/**
+ * @return Non-zero if it is capturing.
+*/
+WGC_CAPI int WGC_CALL wgc_capturer_is_capturing(wgc_capturer capturer);
+
+/**
+ * @brief Polling mode: wait for a frame newer than this call, and write it into the buffer.
+ * @param buffer: The destination.
+ * @param timeout_ms: Milliseconds to wait. Negative waits forever.
+ * @param info: Receives the information of the frame. May be NULL.
+*/
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_read(wgc_capturer capturer, const wgc_buffer* buffer, int32_t timeout_ms, wgc_frame_info* info);
+/**
+ * @brief Write the current frame into the buffer, without waiting.
+ * @brief In callback mode, call it inside the callback.
+ * @param buffer: The destination.
+ * @param info: Receives the information of the frame. May be NULL.
+*/
+WGC_CAPI wgc_result WGC_CALL wgc_capturer_copy_frame(wgc_capturer capturer, const wgc_buffer* buffer, wgc_frame_info* info);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
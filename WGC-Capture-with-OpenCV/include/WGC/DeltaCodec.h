@@ -0,0 +1,115 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "WGC.h"
+
+#include <vector>
+
+namespace wgc {
+
+/**
+ * @brief Options of the delta codec.
+*/
+struct DeltaCodecOptions {
+	int tileSize = 64;          // Width and height of tiles. Unchanged tiles cost one bit.
+	int keyframeInterval = 0;   // Force a keyframe every N frames. 0 means only when needed.
+};
+
+/**
+ * @brief Lossless encoder for captured frames.
+ * @brief Each frame is XORed against the previous one, unchanged tiles are skipped,
+ * @brief and every row of tiles (a band) is compressed with a fast LZ coder in parallel.
+ * @brief Frames must be 8-bit (CV_8UC1/3/4). Instances are not thread-safe.
+*/
+class WGCCAPTUREWITHOPENCV_API IDeltaEncoder {
+protected:
+	IDeltaEncoder() = default;
+public:
+	virtual ~IDeltaEncoder() = default;
+
+public:
+	/**
+	 * @brief Create an encoder.
+	 * @return A pointer to the instance. It may be nullptr if the options are invalid.
+	 */
+	static std::shared_ptr<IDeltaEncoder> createInstance(const DeltaCodecOptions& options = {}) noexcept;
+
+public:
+	/**
+	 * @brief Encode one frame.
+	 * @brief A keyframe is written for the first frame, after reset() and when the size or type changes.
+	 * @param frame: The frame.
+	 * @param out: Receives the encoded frame. Its capacity is reused.
+	 * @param forceKeyframe: Encode without reference to the previous frame.
+	 * @return 'true' if succeed.
+	 */
+	virtual bool encode(const cv::Mat& frame, std::vector<uint8_t>& out, bool forceKeyframe = false) = 0;
+
+	/**
+	 * @brief Tiles that changed in the last encoded frame, in pixels.
+	 */
+	virtual const std::vector<cv::Rect>& getChangedTiles() const = 0;
+
+	/**
+	 * @brief Forget the previous frame. The next frame will be a keyframe.
+	 */
+	virtual void reset() = 0;
+};
+
+/**
+ * @brief Decoder of IDeltaEncoder. Malformed input is rejected, never trusted.
+ * @brief Instances are not thread-safe.
+*/
+class WGCCAPTUREWITHOPENCV_API IDeltaDecoder {
+protected:
+	IDeltaDecoder() = default;
+public:
+	virtual ~IDeltaDecoder() = default;
+
+public:
+	/**
+	 * @brief Create a decoder.
+	 */
+	static std::shared_ptr<IDeltaDecoder> createInstance() noexcept;
+
+public:
+	/**
+	 * @brief Decode one frame. Frames must be given in the encoded order, starting from a keyframe.
+	 * @param data: The encoded frame.
+	 * @param size: Byte count of the encoded frame.
+	 * @param frame: Refers to the internal frame. Do not modify it. It changes at the next call.
+	 * @return 'true' if succeed. The internal frame is reset on failure.
+	 */
+	virtual bool decode(const uint8_t* data, size_t size, cv::Mat& frame) = 0;
+
+	/**
+	 * @brief Query if the encoded frame is a keyframe, without decoding it.
+	 */
+	static bool isKeyframe(const uint8_t* data, size_t size) noexcept;
+
+	/**
+	 * @brief Forget the previous frame. The next frame must be a keyframe.
+	 */
+	virtual void reset() = 0;
+};
+
+} // namespace wgc
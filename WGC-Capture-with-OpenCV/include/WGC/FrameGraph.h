@@ -0,0 +1,114 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "WGC.h"
+
+#include <opencv2/imgproc.hpp>
+#include <vector>
+#include <functional>
+
+namespace wgc {
+
+/**
+ * @brief Interface of FrameGraph, a processing pipeline declared once and run on each frame.
+ * @brief Each stage takes the result of an earlier node. Node IFrameGraph::Input is the frame itself.
+ * @brief Chains of crop, resize (nearest or linear), cvtColor and threshold are fused: they run band by band,
+ * @brief so intermediates are only a few rows and stay in cache, and bands run in parallel.
+ * @brief A node used by several stages is computed once into a pooled buffer. Independent branches run in parallel.
+ * @brief Instances are not thread-safe.
+*/
+class WGCCAPTUREWITHOPENCV_API IFrameGraph {
+protected:
+	IFrameGraph() = default;
+public:
+	virtual ~IFrameGraph() = default;
+
+public:
+	/**
+	 * @brief Id of the node of the input frame.
+	 */
+	static constexpr int Input = 0;
+
+	/**
+	 * @brief Create an empty graph.
+	 * @return A pointer to the instance. It may be nullptr if failed.
+	 */
+	static std::shared_ptr<IFrameGraph> createInstance() noexcept;
+	/**
+	 * @brief Create the built-in graph of ICapturer::copyMatTo(): BGRA to BGR.
+	 * @return A pointer to the instance. It may be nullptr if failed.
+	 */
+	static std::shared_ptr<IFrameGraph> createConvertToBGR() noexcept;
+
+public:
+	/**
+	 * @brief Add a stage that takes a part of its input. The rect is clipped to the input on each frame.
+	 * @param input: Id of an existing node.
+	 * @return Id of the new node, or -1 if invalid.
+	 */
+	virtual int crop(int input, const cv::Rect& rect) = 0;
+	/**
+	 * @brief Add a stage like cv::resize(). Only INTER_NEAREST and INTER_LINEAR are fused,
+	 * @brief and the fused results may differ from cv::resize() by rounding.
+	 * @param input: Id of an existing node.
+	 * @param size: Size of the result. If empty, it is computed from fx and fy.
+	 * @return Id of the new node, or -1 if invalid.
+	 */
+	virtual int resize(int input, const cv::Size& size, double fx = 0.0, double fy = 0.0, int interpolation = cv::INTER_LINEAR) = 0;
+	/**
+	 * @brief Add a stage like cv::cvtColor(). The code must keep the size of the image.
+	 * @param input: Id of an existing node.
+	 * @return Id of the new node, or -1 if invalid.
+	 */
+	virtual int cvtColor(int input, int code) = 0;
+	/**
+	 * @brief Add a stage like cv::threshold(). THRESH_OTSU and THRESH_TRIANGLE are not fused.
+	 * @param input: Id of an existing node.
+	 * @return Id of the new node, or -1 if invalid.
+	 */
+	virtual int threshold(int input, double thresh, double maxval, int type) = 0;
+	/**
+	 * @brief Add a stage of your own. It always sees the whole input and is never fused.
+	 * @brief It may run in parallel with other branches.
+	 * @param input: Id of an existing node.
+	 * @param fn: Writes the result of 'src' into 'dst'.
+	 * @return Id of the new node, or -1 if invalid.
+	 */
+	virtual int custom(int input, std::function<void(const cv::Mat& src, cv::Mat& dst)> fn) = 0;
+
+	/**
+	 * @brief Make a node an output of run().
+	 * @param node: Id of an existing node.
+	 * @return Index of the output in run(), or -1 if invalid.
+	 */
+	virtual int addOutput(int node) = 0;
+
+	/**
+	 * @brief Run the graph on one frame.
+	 * @param frame: The frame.
+	 * @param outputs: Results, by the index given by addOutput(). Their buffers are reused if possible.
+	 * @return 'true' if succeed.
+	 */
+	virtual bool run(const cv::Mat& frame, std::vector<cv::Mat>& outputs) = 0;
+};
+
+} // namespace wgc
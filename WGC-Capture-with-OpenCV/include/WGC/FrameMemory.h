@@ -0,0 +1,90 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "WGC.h"
+
+namespace wgc {
+
+/**
+ * @brief Options of IFrameMemory.
+*/
+struct FrameMemoryOptions {
+	size_t alignment = 64;                 // Alignment of the data and of each row, in bytes. A power of 2, at least 16.
+	size_t stridePadding = 0;              // Bytes added to each row before aligning, to break strides that collide in the cache.
+	bool largePages = false;               // Back large frames with large pages. It needs the "Lock pages in memory" right.
+	size_t largePageMinBytes = 4ull << 20; // Smaller frames use normal pages.
+};
+
+/**
+ * @brief Counters of IFrameMemory.
+*/
+struct FrameMemoryStats {
+	size_t buffers;           // Frames alive.
+	size_t bytes;             // Bytes of them, including padding.
+	size_t largePageBuffers;  // Frames alive on large pages.
+	size_t largePageBytes;    // Bytes of them, rounded up to whole large pages.
+	size_t largePageFailures; // Times large pages were wanted but normal pages were used.
+};
+
+/**
+ * @brief Interface of FrameMemory.
+ * @brief It allocates frames whose data and rows start at aligned addresses, optionally on large pages.
+ * @brief The frames are ordinary cv::Mat. Each of them keeps the instance alive until it is released.
+ * @brief Give it to ICapturer::setFrameMemory() to use it for copyMatTo() and the pooled buffers of the capturer.
+*/
+class WGCCAPTUREWITHOPENCV_API IFrameMemory {
+protected:
+	IFrameMemory() = default;
+public:
+	virtual ~IFrameMemory() = default;
+
+public:
+	/**
+	 * @brief Create a provider.
+	 * @param options: Options of the provider.
+	 * @return A pointer to the instance. It may be nullptr if failed or the alignment is invalid.
+	 */
+	static std::shared_ptr<IFrameMemory> createInstance(const FrameMemoryOptions& options = {}) noexcept;
+
+public:
+	/**
+	 * @brief Allocate a frame. Its step is getStep(), so it is not continuous if that is larger than a row.
+	 */
+	virtual cv::Mat allocate(cv::Size size, int type) = 0;
+	/**
+	 * @brief Make the mat a frame of this provider with the size and type. Nothing is done if it already is one.
+	 * @brief cv::Mat::create() on it, like copyTo() and cvtColor() do for their output, allocates from this provider again.
+	 */
+	virtual void create(cv::Mat& mat, cv::Size size, int type) = 0;
+	/**
+	 * @brief Byte count of each row of a frame with the width and type.
+	 */
+	virtual size_t getStep(int cols, int type) const = 0;
+
+	/**
+	 * @brief Query if large pages can be used. It is 'false' if they are not wanted, or the right is missing.
+	 */
+	virtual bool isLargePageEnabled() const = 0;
+	virtual FrameMemoryStats getStats() const = 0;
+};
+
+} // namespace wgc
@@ -0,0 +1,81 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "WGC.h"
+
+namespace wgc {
+
+/**
+ * @brief Max count of levels of a pyramid, including the frame itself.
+*/
+constexpr int FramePyramidMaxLevels = 16;
+
+/**
+ * @brief Interface of FramePyramid, halved copies of one frame shared by all its consumers.
+ * @brief Level 0 is the frame itself, and each pixel of level n + 1 is the mean of 2x2 pixels of level n.
+ * @brief The last row and column of an odd level are dropped, so the size of level n is exactly the size of level 0 >> n.
+ * @brief Levels are computed on first request, with SSE2 for BGRA frames, and kept until the pyramid is released.
+ * @brief All functions are thread-safe, and each level is computed at most once however many consumers ask.
+ * @brief Levels are shared read-only: never write into them.
+*/
+class WGCCAPTUREWITHOPENCV_API IFramePyramid {
+protected:
+	IFramePyramid() = default;
+public:
+	virtual ~IFramePyramid() = default;
+
+public:
+	/**
+	 * @brief Create a pyramid of an image of your own.
+	 * @param image: The image. It is referred to, not copied, so it must not change while the pyramid is used.
+	 * @return A pointer to the instance. It may be nullptr if failed.
+	 */
+	static std::shared_ptr<IFramePyramid> createInstance(const cv::Mat& image) noexcept;
+
+public:
+	/**
+	 * @brief Query the count of levels, including level 0. Levels go on while both sides are at least 1 pixel.
+	 */
+	virtual int getLevelCount() const = 0;
+	/**
+	 * @brief Get one level, computing it and the levels above it if not yet.
+	 * @brief Level 0, and levels not computed yet, are only available while the frame is the current one of the capturer:
+	 * @brief in callback mode, inside the callback; in polling mode, until the next frame is updated.
+	 * @param level: From 0 to getLevelCount() - 1.
+	 * @return The level, or an empty cv::Mat if invalid or no longer available.
+	 */
+	virtual cv::Mat getLevel(int level) = 0;
+	/**
+	 * @brief Query whether a level is computed, so getLevel() returns at once.
+	 */
+	virtual bool isComputed(int level) const = 0;
+	/**
+	 * @brief Query whether the frame was replaced. Only levels computed before are still available.
+	 */
+	virtual bool isReleased() const = 0;
+	/**
+	 * @brief Get the information of the frame.
+	 */
+	virtual FrameInfo getInfo() const = 0;
+};
+
+} // namespace wgc
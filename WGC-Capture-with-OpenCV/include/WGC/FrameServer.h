@@ -0,0 +1,166 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "WGC.h"
+
+#include <string>
+#include <vector>
+
+namespace wgc {
+
+/**
+ * @brief Protocol of the frame server, over a local (AF_UNIX) stream socket.
+ * @brief The client sends one StreamRequest after connecting.
+ * @brief Then the server sends [StreamMessageHeader][dataSize bytes of IDeltaEncoder output] for each frame.
+ * @brief The first frame is a keyframe, so the client decodes them in order with an IDeltaDecoder.
+*/
+constexpr char     StreamRequestMagic[4] = { 'W', 'G', 'C', 'S' };
+constexpr char     StreamMessageMagic[4] = { 'W', 'G', 'C', 'M' };
+constexpr uint32_t StreamProtocolVersion = 1;
+
+enum class StreamFormat : uint32_t {
+	BGRA = 0,
+	BGR = 1,
+	Gray = 2
+};
+
+#pragma pack(push, 8)
+
+struct StreamRequest {
+	char     magic[4] = { 'W', 'G', 'C', 'S' };
+	uint32_t version = StreamProtocolVersion;
+	StreamFormat format = StreamFormat::BGRA;
+	float    scale = 1.0f;          // In (0, 1]. Applied after the ROI.
+	int32_t  roiX = 0;              // Region of the frame to send. Clipped to the frame.
+	int32_t  roiY = 0;
+	int32_t  roiWidth = 0;          // 0 means the whole frame.
+	int32_t  roiHeight = 0;
+	uint32_t keyframeInterval = 0;  // Force a keyframe every N frames. 0 means only when needed.
+	uint32_t reserved = 0;
+};
+
+struct StreamMessageHeader {
+	char     magic[4];  // StreamMessageMagic.
+	uint32_t headerSize;
+	uint64_t sequence;  // FrameInfo::sequence.
+	int64_t  timestamp; // FrameInfo::timestamp, in 100ns units.
+	uint64_t dataSize;  // Byte count of the encoded frame after this header.
+	uint64_t skipped;   // Count of frames skipped for this client since the previous message.
+};
+
+#pragma pack(pop)
+
+/**
+ * @brief Options of FrameServer.
+*/
+struct FrameServerOptions {
+	size_t maxSubscribers = 16;
+	int tileSize = 64; // Tile size of the delta encoders.
+};
+
+/**
+ * @brief Statistics of one subscriber of FrameServer.
+*/
+struct SubscriberStats {
+	StreamRequest request;
+	size_t sent;    // Count of frames sent.
+	size_t skipped; // Count of frames skipped because the client was still busy with an older one.
+	uint64_t bytes; // Byte count sent.
+};
+
+/**
+ * @brief Interface of FrameServer.
+ * @brief It serves the pushed frames to clients over a local socket.
+ * @brief Each client is served by its own thread and gets only the latest frame, so a slow client never stalls the others.
+*/
+class WGCCAPTUREWITHOPENCV_API IFrameServer {
+protected:
+	IFrameServer() = default;
+public:
+	virtual ~IFrameServer() = default;
+
+public:
+	/**
+	 * @brief Create a server listening on the specified socket path.
+	 * @brief An existing file at the path is deleted.
+	 * @param path: Path of the socket file.
+	 * @param options: Options of the server.
+	 * @return A pointer to the instance. It may be nullptr if failed.
+	 */
+	static std::shared_ptr<IFrameServer> createInstance(const std::wstring& path, const FrameServerOptions& options = {}) noexcept;
+
+public:
+	/**
+	 * @brief Offer one frame to all clients. The data is copied once, so it can be called in the callback of a capturer.
+	 * @param frame: The frame.
+	 * @param info: Information of the frame.
+	 * @return 'false' if it's dropped because all buffers are in use.
+	 */
+	virtual bool push(const cv::Mat& frame, const FrameInfo& info) = 0;
+
+	/**
+	 * @brief Disconnect all clients and stop listening.
+	 * @brief Nothing will happend if it's closed.
+	 */
+	virtual void close() = 0;
+
+	/**
+	 * @brief Query statistics of the connected clients.
+	 */
+	virtual std::vector<SubscriberStats> getStats() = 0;
+};
+
+/**
+ * @brief Interface of FrameClient.
+ * @brief It subscribes to a FrameServer, possibly in another process, and decodes the frames.
+*/
+class WGCCAPTUREWITHOPENCV_API IFrameClient {
+protected:
+	IFrameClient() = default;
+public:
+	virtual ~IFrameClient() = default;
+
+public:
+	/**
+	 * @brief Connect to a server and subscribe.
+	 * @param path: Path of the socket file.
+	 * @param request: What to receive.
+	 * @return A pointer to the instance. It may be nullptr if failed.
+	 */
+	static std::shared_ptr<IFrameClient> createInstance(const std::wstring& path, const StreamRequest& request = {}) noexcept;
+
+public:
+	/**
+	 * @brief Wait for and decode the next frame.
+	 * @param frame: Refers to the internal frame. Do not modify it. It changes at the next call.
+	 * @param info: Receives information of the frame. Width and height are of the received frame.
+	 * @return 'false' if disconnected or the data is malformed.
+	 */
+	virtual bool receive(cv::Mat& frame, FrameInfo& info) = 0;
+
+	/**
+	 * @brief Query count of frames skipped by the server for this client.
+	 */
+	virtual uint64_t getSkippedCount() = 0;
+};
+
+} // namespace wgc
@@ -0,0 +1,136 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "WGC.h"
+
+namespace wgc {
+
+/**
+ * @brief Layout of a latency stamp: 16 bytes drawn as bits, most significant first, row by row.
+ * @brief [magic 'W' 'L'][counter, 4 bytes][timestamp, 8 bytes][Fletcher-16 of the 14 bytes before], little-endian.
+ * @brief A cell is white for 1 and black for 0, and is read at its centre, so the stamp survives scaling down to
+ * @brief about 2 pixels per cell.
+*/
+constexpr int LatencyStampColumns = 16;
+constexpr int LatencyStampRows = 8;
+
+/**
+ * @brief The content of a latency stamp.
+*/
+struct LatencyStamp {
+	uint32_t counter;  // Index of the stamp, to tell repeated frames apart.
+	int64_t timestamp; // When the source changed, by ILatencyStampCodec::now().
+};
+
+/**
+ * @brief Interface of the latency stamp codec.
+ * @brief Sources draw the stamp with it, and capturers read it back (see ICapturer::setLatencyProbe()).
+*/
+class WGCCAPTUREWITHOPENCV_API ILatencyStampCodec {
+protected:
+	ILatencyStampCodec() = default;
+public:
+	virtual ~ILatencyStampCodec() = default;
+
+public:
+	/**
+	 * @brief Create a codec.
+	 * @param layout: Where the stamp is.
+	 * @return A pointer to the instance. It may be nullptr if the layout is invalid.
+	 */
+	static std::shared_ptr<ILatencyStampCodec> createInstance(const LatencyStampLayout& layout = {}) noexcept;
+
+	/**
+	 * @brief The clock of stamps: QueryPerformanceCounter() in 100ns units, the same as FrameInfo::timestamp.
+	 * @brief It is shared by all processes of the machine.
+	 */
+	static int64_t now() noexcept;
+
+public:
+	/**
+	 * @brief Size of the stamp in pixels.
+	 */
+	virtual cv::Size getSize() = 0;
+
+	/**
+	 * @brief Draw the stamp into a frame.
+	 * @param frame: A BGRA or BGR frame that contains the whole stamp.
+	 * @param stamp: The content.
+	 * @return 'false' if the frame does not contain it.
+	 */
+	virtual bool encode(cv::Mat& frame, const LatencyStamp& stamp) = 0;
+	/**
+	 * @brief Read the stamp from a frame.
+	 * @param frame: A BGRA or BGR frame.
+	 * @param scale: Size of the frame relative to the one the stamp was drawn into, like FrameInfo::scale.
+	 * @param stamp: The content.
+	 * @return 'false' if there is no valid stamp.
+	 */
+	virtual bool decode(const cv::Mat& frame, double scale, LatencyStamp& stamp) = 0;
+};
+
+/**
+ * @brief Options of ILatencyStampWindow.
+*/
+struct LatencyStampWindowOptions {
+	cv::Point position = { 0, 0 }; // Top-left corner of the window on the desktop, in physical pixels.
+	int cellSize = 8;              // Side of each cell of the stamp.
+	int margin = 8;                // Grey border around the stamp. The stamp is at (margin, margin) in the window.
+};
+
+/**
+ * @brief Interface of the latency stamp window.
+ * @brief It is a small topmost window, redrawn with a new stamp after every composition of the desktop,
+ * @brief on its own thread. Capture it, or the monitor it is on, with the latency probe enabled.
+ * @brief The timestamp is taken right before each redraw, so the latency includes drawing and composition.
+*/
+class WGCCAPTUREWITHOPENCV_API ILatencyStampWindow {
+protected:
+	ILatencyStampWindow() = default;
+public:
+	virtual ~ILatencyStampWindow() = default;
+
+public:
+	/**
+	 * @brief Create and show the window.
+	 * @param options: Position and size of the stamp.
+	 * @return A pointer to the instance. It may be nullptr if failed.
+	 */
+	static std::shared_ptr<ILatencyStampWindow> createInstance(const LatencyStampWindowOptions& options = {}) noexcept;
+
+public:
+	/**
+	 * @brief The window, to capture it.
+	 */
+	virtual HWND getWindow() = 0;
+	/**
+	 * @brief The layout of the stamp in a capture of the window, or of its monitor.
+	 * @param monitorCapture: 'true' for the monitor that contains the window.
+	 */
+	virtual LatencyStampLayout getLayout(bool monitorCapture) = 0;
+	/**
+	 * @brief Count of stamps drawn.
+	 */
+	virtual size_t getDrawnCount() = 0;
+};
+
+} // namespace wgc
@@ -0,0 +1,56 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "WGC.h"
+
+namespace wgc {
+
+/**
+ * @brief Layout of the file written by ICapturer::dumpPreroll().
+ * @brief [PrerollFileHeader][PrerollRecord, then 'size' bytes of one frame of IDeltaEncoder] x frameCount
+ * @brief Frames are in capture order and the first one is a keyframe. Decode them in order with one IDeltaDecoder
+ * @brief (see DeltaCodec.h). If the capture evicted frames before they were written, the file skips to the next
+ * @brief keyframe, so it still decodes.
+*/
+constexpr char     PrerollFileMagic[8] = { 'W', 'G', 'C', 'P', 'R', 'E', '\0', '\1' };
+constexpr uint32_t PrerollFileVersion = 1;
+
+#pragma pack(push, 8)
+
+struct PrerollFileHeader {
+	char     magic[8];    // PrerollFileMagic.
+	uint32_t version;     // PrerollFileVersion.
+	uint32_t headerSize;  // sizeof(PrerollFileHeader).
+	uint32_t recordSize;  // sizeof(PrerollRecord).
+	uint32_t reserved;
+	uint64_t frameCount;  // Count of records. Written last.
+};
+
+struct PrerollRecord {
+	uint64_t sequence;  // FrameInfo::sequence.
+	int64_t  timestamp; // FrameInfo::timestamp, in 100ns units.
+	uint64_t size;      // Byte count of the encoded frame after this record.
+};
+
+#pragma pack(pop)
+
+} // namespace wgc
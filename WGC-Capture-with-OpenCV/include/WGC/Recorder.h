@@ -0,0 +1,134 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "WGC.h"
+
+#include <string>
+#include <vector>
+
+namespace wgc {
+
+/**
+ * @brief Layout of the recording file.
+ * @brief [RecordFileHeader, padded to one page][RecordIndexEntry x indexCapacity, padded to pages][payloads, each page-aligned]
+ * @brief The file only grows. A reader may map it while it is being written:
+ * @brief entries below 'frameCount' are complete, and 'frameCount' is updated after its entry and payload.
+*/
+constexpr char     RecordFileMagic[8] = { 'W', 'G', 'C', 'R', 'E', 'C', '\0', '\1' };
+constexpr uint32_t RecordFileVersion = 1;
+constexpr uint32_t RecordMaxDirtyRects = 16;
+
+#pragma pack(push, 8)
+
+struct RecordRect {
+	int32_t x;
+	int32_t y;
+	int32_t width;
+	int32_t height;
+};
+
+struct RecordFileHeader {
+	char     magic[8];      // RecordFileMagic.
+	uint32_t version;       // RecordFileVersion.
+	uint32_t headerSize;    // sizeof(RecordFileHeader).
+	uint32_t entrySize;     // sizeof(RecordIndexEntry).
+	uint32_t pageSize;      // Alignment of payloads.
+	uint64_t indexOffset;   // Offset of the first RecordIndexEntry.
+	uint64_t indexCapacity; // Max count of frames in this file.
+	uint64_t dataOffset;    // Offset of the first payload.
+	uint64_t frameCount;    // Count of committed frames.
+	uint64_t finished;      // Non-zero if the writer closed the file normally.
+};
+
+struct RecordIndexEntry {
+	uint64_t   sequence;   // FrameInfo::sequence.
+	int64_t    timestamp;  // FrameInfo::timestamp, in 100ns units.
+	uint64_t   offset;     // Offset of the payload.
+	uint64_t   size;       // Byte count of the payload, without padding.
+	int32_t    width;
+	int32_t    height;
+	int32_t    type;       // cv::Mat type, CV_8UC4 for BGRA.
+	uint32_t   step;       // Byte count of each row in the payload.
+	uint32_t   dirtyCount; // 0 means the whole frame is dirty.
+	uint32_t   reserved;
+	RecordRect dirty[RecordMaxDirtyRects];
+};
+
+#pragma pack(pop)
+
+/**
+ * @brief Options of Recorder.
+*/
+struct RecorderOptions {
+	size_t maxFrames = 65536;                 // Capacity of the index. Frames after it are dropped.
+	size_t queueDepth = 8;                    // Count of frames waiting for the writer. Frames are dropped if full.
+	size_t preallocateBytes = 256ull << 20;   // The file is extended by this step ahead of the writer.
+};
+
+/**
+ * @brief Interface of Recorder.
+ * @brief It writes frames into an append-only file on its own thread.
+*/
+class WGCCAPTUREWITHOPENCV_API IRecorder {
+protected:
+	IRecorder() = default;
+public:
+	virtual ~IRecorder() = default;
+
+public:
+	/**
+	 * @brief Create a recorder that writes into the specified file.
+	 * @brief The file will be overwritten.
+	 * @param path: The file to record into.
+	 * @param options: Options of the recorder.
+	 * @return A pointer to the instance. It may be nullptr if failed.
+	 */
+	static std::shared_ptr<IRecorder> createInstance(const std::wstring& path, const RecorderOptions& options = {}) noexcept;
+
+public:
+	/**
+	 * @brief Queue one frame to be written. The data is copied, so it can be called in the callback of a capturer.
+	 * @brief It never waits for the disk. If the queue is full, the frame is dropped.
+	 * @param frame: The frame.
+	 * @param info: Information of the frame.
+	 * @param dirtyRects: Changed areas from the previous frame. Empty if unknown.
+	 * @return 'true' if queued.
+	 */
+	virtual bool push(const cv::Mat& frame, const FrameInfo& info, const std::vector<cv::Rect>& dirtyRects = {}) = 0;
+
+	/**
+	 * @brief Write all queued frames, trim the file and close it.
+	 * @brief Nothing will happend if it's closed.
+	 */
+	virtual void close() = 0;
+
+	/**
+	 * @brief Query count of frames written into the file.
+	 */
+	virtual size_t getWrittenCount() = 0;
+	/**
+	 * @brief Query count of frames dropped because the queue or the index was full.
+	 */
+	virtual size_t getDroppedCount() = 0;
+};
+
+} // namespace wgc
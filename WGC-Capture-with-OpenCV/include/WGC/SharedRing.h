@@ -0,0 +1,172 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "WGC.h"
+
+#include <string>
+
+namespace wgc {
+
+/**
+ * @brief Layout of the shared-memory frame ring.
+ * @brief [SharedRingHeader][SharedRingSlot x slotCount] in the first page(s), then the payloads, each page-aligned.
+ * @brief Each slot is a seqlock: 'lock' is odd while the publisher writes the slot, and increased again when done.
+ * @brief 'published' is the count of frames published, the latest one is in slot (published - 1) % slotCount.
+ * @brief Two named events, "<name>_0" and "<name>_1", are used to wake readers:
+ * @brief before 'published' becomes N, event (N % 2) is reset; after it, event ((N - 1) % 2) is set.
+ * @brief So a reader that has seen 'published' == N can wait for event (N % 2) without missing frame N.
+*/
+constexpr char     SharedRingMagic[8] = { 'W', 'G', 'C', 'R', 'I', 'N', 'G', '\1' };
+constexpr uint32_t SharedRingVersion = 1;
+constexpr uint32_t SharedRingMaxSlots = 32;
+
+#pragma pack(push, 8)
+
+struct SharedRingHeader {
+	char     magic[8];       // SharedRingMagic. Written last, so readers never see a half initialized header.
+	uint32_t version;        // SharedRingVersion.
+	uint32_t headerSize;     // sizeof(SharedRingHeader).
+	uint32_t slotHeaderSize; // sizeof(SharedRingSlot).
+	uint32_t slotCount;
+	uint64_t slotsOffset;    // Offset of the first SharedRingSlot.
+	uint64_t slotBytes;      // Max byte count of one frame.
+	uint64_t slotStride;     // Distance between two payloads.
+	uint64_t dataOffset;     // Offset of the first payload.
+	uint64_t mappingSize;    // Byte count of the whole mapping.
+	uint64_t published;      // Count of published frames.
+	uint64_t reserved[4];
+};
+
+struct SharedRingSlot {
+	uint64_t lock;      // Odd while being written.
+	uint64_t index;     // Which published frame it holds, 0-based.
+	uint64_t sequence;  // FrameInfo::sequence.
+	int64_t  timestamp; // FrameInfo::timestamp, in 100ns units.
+	int32_t  width;
+	int32_t  height;
+	int32_t  type;      // cv::Mat type.
+	uint32_t step;      // Byte count of each row in the payload.
+	uint64_t reserved[2];
+};
+
+#pragma pack(pop)
+
+/**
+ * @brief Options of the shared-memory frame ring.
+*/
+struct SharedRingOptions {
+	size_t slotCount = 4;                 // Count of frames kept. A reader's view stays valid for about (slotCount - 1) frames.
+	size_t slotBytes = 3840ull * 2160 * 4; // Max byte count of one frame. Larger frames are dropped.
+};
+
+/**
+ * @brief Interface of FramePublisher.
+ * @brief It writes frames into a named shared-memory ring, so other processes can read them without capturing again.
+*/
+class WGCCAPTUREWITHOPENCV_API IFramePublisher {
+protected:
+	IFramePublisher() = default;
+public:
+	virtual ~IFramePublisher() = default;
+
+public:
+	/**
+	 * @brief Create the shared-memory ring.
+	 * @param name: Name of the file mapping, like L"Local\\MyFrames". It must not exist.
+	 * @param options: Options of the ring.
+	 * @return A pointer to the instance. It may be nullptr if failed.
+	 */
+	static std::shared_ptr<IFramePublisher> createInstance(const std::wstring& name, const SharedRingOptions& options = {}) noexcept;
+
+public:
+	/**
+	 * @brief Copy one frame into the ring and wake the readers. It can be called in the callback of a capturer.
+	 * @brief It never waits for readers: the oldest slot is overwritten.
+	 * @param frame: The frame.
+	 * @param info: Information of the frame.
+	 * @return 'true' if published, 'false' if the frame is too large.
+	 */
+	virtual bool push(const cv::Mat& frame, const FrameInfo& info) = 0;
+
+	/**
+	 * @brief Query count of frames published.
+	 */
+	virtual uint64_t getPublishedCount() = 0;
+};
+
+/**
+ * @brief Interface of FrameRingReader.
+ * @brief It reads frames published by an IFramePublisher, possibly in another process.
+ * @brief It does not need an IFactory.
+*/
+class WGCCAPTUREWITHOPENCV_API IFrameRingReader {
+protected:
+	IFrameRingReader() = default;
+public:
+	virtual ~IFrameRingReader() = default;
+
+public:
+	/**
+	 * @brief Open the shared-memory ring.
+	 * @param name: Name used to create the IFramePublisher.
+	 * @return A pointer to the instance. It may be nullptr if the ring does not exist (yet).
+	 */
+	static std::shared_ptr<IFrameRingReader> createInstance(const std::wstring& name) noexcept;
+
+public:
+	/**
+	 * @brief Wait until a frame newer than the last acquired one is published.
+	 * @param timeoutMs: Max time to wait, in milliseconds. INFINITE to wait forever.
+	 * @return 'true' if there is a newer frame.
+	 */
+	virtual bool waitForFrame(uint32_t timeoutMs) = 0;
+
+	/**
+	 * @brief Get the latest frame without copying.
+	 * @brief The view is read-only and points into the ring. It will be overwritten after about (slotCount - 1) frames,
+	 * @brief so check isViewValid() after using it, or use copyLatest() instead.
+	 * @param view: Receives the view.
+	 * @param info: Receives information of the frame.
+	 * @return 'false' if nothing is published.
+	 */
+	virtual bool acquireLatest(cv::Mat& view, FrameInfo& info) = 0;
+
+	/**
+	 * @brief Check whether the view of the last acquireLatest() has not been overwritten.
+	 */
+	virtual bool isViewValid() = 0;
+
+	/**
+	 * @brief Copy the latest frame. The copy is guaranteed to be consistent.
+	 * @param target: Receives the frame.
+	 * @param info: Receives information of the frame.
+	 * @return 'false' if nothing is published.
+	 */
+	virtual bool copyLatest(cv::Mat& target, FrameInfo& info) = 0;
+
+	/**
+	 * @brief Query count of frames published but never acquired by this reader.
+	 */
+	virtual uint64_t getSkippedCount() = 0;
+};
+
+} // namespace wgc
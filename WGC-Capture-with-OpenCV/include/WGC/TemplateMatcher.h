@@ -0,0 +1,118 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "WGC.h"
+
+#include <vector>
+
+namespace wgc {
+
+/**
+ * @brief Options of TemplateMatcher.
+*/
+struct TemplateMatcherOptions {
+	int    pyramidLevels = 2;   // Max count of halvings for the coarse search. 0 searches at full resolution only.
+	double threshold = 0.9;     // Min TM_CCOEFF_NORMED score of a match.
+	double coarseSlack = 0.15;  // Candidates at coarse levels only need (threshold - coarseSlack).
+	int    searchMargin = 16;   // Pixels around the previous match searched first when it's no longer valid.
+	int    tileSize = 32;       // Granularity of the change detection, in pixels.
+	bool   grayscale = true;    // Match on grayscale images, about 3 times faster than color.
+};
+
+/**
+ * @brief Result of one template.
+*/
+struct MatchResult {
+	int      id = -1;       // Returned by addTemplate().
+	bool     found = false; // 'true' if the score reaches the threshold.
+	cv::Rect rect;          // Location of the best match, valid if found.
+	double   score = 0.0;   // Score of the best match.
+	bool     reused = false; // 'true' if the area did not change, so the previous result was kept without searching.
+};
+
+/**
+ * @brief Interface of TemplateMatcher.
+ * @brief It locates templates in a sequence of frames, much cheaper than cv::matchTemplate over each full frame:
+ * @brief results in unchanged areas are reused, lost templates are searched around the previous location first,
+ * @brief other searches are limited to changed areas and go from a coarse pyramid level to the full resolution,
+ * @brief and templates are matched in parallel.
+ * @brief Instances are not thread-safe.
+*/
+class WGCCAPTUREWITHOPENCV_API ITemplateMatcher {
+protected:
+	ITemplateMatcher() = default;
+public:
+	virtual ~ITemplateMatcher() = default;
+
+public:
+	/**
+	 * @brief Create a matcher.
+	 * @return A pointer to the instance. It may be nullptr if the options are invalid.
+	 */
+	static std::shared_ptr<ITemplateMatcher> createInstance(const TemplateMatcherOptions& options = {}) noexcept;
+
+public:
+	/**
+	 * @brief Add a template.
+	 * @param image: The template, BGR, BGRA or grayscale, 8-bit.
+	 * @param mask: Pixels with non-zero mask are compared. If empty, the alpha channel of a BGRA image is used, if any.
+	 * @return Id of the template, or -1 if it's invalid.
+	 */
+	virtual int addTemplate(const cv::Mat& image, const cv::Mat& mask = cv::Mat()) = 0;
+
+	/**
+	 * @brief Remove a template.
+	 * @return 'false' if the id is unknown.
+	 */
+	virtual bool removeTemplate(int id) = 0;
+
+	/**
+	 * @brief Match all templates in the frame. Changed areas are found by comparing with the previous frame.
+	 * @param frame: The frame, BGRA, BGR or grayscale, 8-bit.
+	 * @return Results of all templates, in the order they were added. It changes at the next call.
+	 */
+	virtual const std::vector<MatchResult>& match(const cv::Mat& frame) = 0;
+
+	/**
+	 * @brief Match all templates in the frame, with changed areas known by the caller,
+	 * @brief for example from IDeltaEncoder::getChangedTiles() or a recorded file.
+	 * @param frame: The frame, BGRA, BGR or grayscale, 8-bit.
+	 * @param dirtyRects: Areas changed from the previous frame.
+	 * @return Results of all templates, in the order they were added. It changes at the next call.
+	 */
+	virtual const std::vector<MatchResult>& match(const cv::Mat& frame, const std::vector<cv::Rect>& dirtyRects) = 0;
+
+	/**
+	 * @brief Match all templates in the latest frame of a capturer.
+	 * @brief It does not ask the capturer for refresh.
+	 * @param capturer: The capturer.
+	 * @return Results of all templates, in the order they were added. It changes at the next call.
+	 */
+	virtual const std::vector<MatchResult>& matchLatest(ICapturer& capturer) = 0;
+
+	/**
+	 * @brief Forget the previous frame and results. The next frame is searched fully.
+	 */
+	virtual void reset() = 0;
+};
+
+} // namespace wgc
@@ -0,0 +1,111 @@
+﻿/*
+*    WGC-Capture-with-OpenCV
+*
+*     Copyright 2023-2025  Tyler Parret True
+*
+*    Licensed under the Apache License, Version 2.0 (the "License");
+*    you may not use this file except in compliance with the License.
+*    You may obtain a copy of the License at
+*
+*        http://www.apache.org/licenses/LICENSE-2.0
+*
+*    Unless required by applicable law or agreed to in writing, software
+*    distributed under the License is distributed on an "AS IS" BASIS,
+*    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*    See the License for the specific language governing permissions and
+*    limitations under the License.
+*
+* @Authors
+*    Tyler Parret True <mysteryworldgod@outlook.com><https://github.com/OwlHowlinMornSky>
+*/
+#pragma once
+
+#include "WGC.h"
+
+#include <vector>
+#include <functional>
+
+namespace wgc {
+
+/**
+ * @brief Interface of TilePool, a work-stealing thread pool for processing frames tile by tile,
+ * @brief for example inside the callback of a capturer.
+ * @brief Tiles are numbered row by row and split into contiguous chunks, one chunk per worker, so each worker walks
+ * @brief neighbouring memory. A worker that runs out steals half of the rest of another chunk, from workers on the
+ * @brief same NUMA node first. Workers are kept on their NUMA node if there are several.
+ * @brief The calling thread works as well. Calls from several threads run one after another.
+*/
+class WGCCAPTUREWITHOPENCV_API ITilePool {
+protected:
+	ITilePool() = default;
+public:
+	virtual ~ITilePool() = default;
+
+public:
+	using TileFunction = std::function<void(const cv::Mat& tile, const cv::Rect& rect)>;
+	using IndexedTileFunction = std::function<void(const cv::Mat& tile, const cv::Rect& rect, size_t index)>;
+
+	/**
+	 * @brief Create a pool.
+	 * @param threads: Count of workers, including the calling thread. 0 means one per logical processor.
+	 * @return A pointer to the instance. It may be nullptr if failed.
+	 */
+	static std::shared_ptr<ITilePool> createInstance(int threads = 0) noexcept;
+
+public:
+	/**
+	 * @brief Count of workers, including the calling thread.
+	 */
+	virtual int getThreadCount() const = 0;
+	/**
+	 * @brief The tile size used when an empty size is given: about a quarter of the L2 cache of one core.
+	 * @param elemSize: Byte count of one pixel, cv::Mat::elemSize().
+	 */
+	virtual cv::Size getDefaultTileSize(size_t elemSize) const = 0;
+	/**
+	 * @brief Count of tiles of a frame. Tiles at the right and bottom edges may be smaller.
+	 */
+	virtual size_t getTileCount(const cv::Mat& frame, cv::Size tileSize) const = 0;
+
+	/**
+	 * @brief Call fn on every tile of the frame in parallel, and return when all are done.
+	 * @brief If fn throws, the rest of the tiles are still processed, and the first exception is rethrown here.
+	 * @param frame: The frame. Tiles are views of it, so fn may write into its own tile.
+	 * @param tileSize: Size of each tile. Empty means getDefaultTileSize().
+	 * @param fn: Called with each tile and its area in the frame.
+	 * @param maxThreads: Use at most this many workers. 0 means all.
+	 */
+	virtual void forEachTile(const cv::Mat& frame, cv::Size tileSize, const TileFunction& fn, int maxThreads = 0) = 0;
+	/**
+	 * @brief Same as forEachTile(), and fn also gets the index of the tile, in [0, getTileCount()).
+	 */
+	virtual void forEachTileIndexed(const cv::Mat& frame, cv::Size tileSize, const IndexedTileFunction& fn, int maxThreads = 0) = 0;
+
+	/**
+	 * @brief Map every tile to a value in parallel, and combine the values in the order of tiles,
+	 * @brief so the result does not depend on the scheduling.
+	 * @param map: T(const cv::Mat& tile, const cv::Rect& rect).
+	 * @param combine: T(const T& a, const T& b).
+	 * @return combine(...combine(combine(identity, value_0), value_1)..., value_n-1).
+	 */
+	template<class T, class Map, class Combine>
+	T parallelReduce(const cv::Mat& frame, cv::Size tileSize, const T& identity, Map map, Combine combine, int maxThreads = 0) {
+		struct Slot {
+			T value; // Not std::vector<bool>, whose elements can not be written in parallel.
+		};
+		std::vector<Slot> values(getTileCount(frame, tileSize), Slot{ identity });
+		forEachTileIndexed(
+			frame, tileSize,
+			[&values, &map](const cv::Mat& tile, const cv::Rect& rect, size_t index) -> void {
+				values[index].value = map(tile, rect);
+			},
+			maxThreads
+		);
+		T result = identity;
+		for (const Slot& slot : values)
+			result = combine(result, slot.value);
+		return result;
+	}
+};
+
+} // namespace wgc
@@ -30,12 +30,341 @@
 #include <Windows.h>
 #include <opencv2/core/mat.hpp>
 #include <memory>
+#include <cstdint>
+#include <string>
+#include <vector>
 
 #include <functional>
+#include <future>
 
 namespace wgc {
 
 class ICapturer;
+class IFrameGraph;
+class IFrameMemory;
+class IFramePyramid;
+
+/**
+ * @brief Information of one captured frame.
+*/
+struct FrameInfo {
+	uint64_t sequence;  // Index of the frame since capture started. Skipped numbers mean dropped frames.
+	int64_t timestamp;  // SystemRelativeTime of the frame, in 100ns units.
+	int width;          // Width of the frame in pixels.
+	int height;         // Height of the frame in pixels.
+	double scale = 1.0; // Size of the frame relative to the captured one. Below 1 if reduced by the adaptive scale or the memory budget.
+};
+
+/**
+ * @brief Image file formats for saving frames.
+*/
+enum class ImageFormat {
+	PNG,
+	JPEG,
+	WebP
+};
+
+/**
+ * @brief Options of saving frames.
+*/
+struct SaveOptions {
+	bool convertToBGR = false; // Save as BGR, or keep BGRA (JPEG is always BGR).
+	int quality = 95;          // JPEG and WebP quality, 1 ~ 100. WebP is lossless above 100.
+	int pngCompression = 1;    // PNG compression level, 0 ~ 9. Higher is smaller and slower.
+};
+
+/**
+ * @brief Progress of a burst save.
+*/
+struct BurstStatus {
+	bool running;        // Still taking frames.
+	size_t accepted;     // Frames taken since the burst started.
+	size_t saved;        // Frames written to disk.
+	size_t failed;       // Frames failed to encode or write.
+	size_t pending;      // Frames waiting for the encoders now.
+	size_t stalls;       // Times the capture thread waited because the encoders were full.
+	double stallSeconds; // Total time of those waits.
+};
+
+/**
+ * @brief Where a latency stamp is in a frame. See LatencyProbe.h.
+ * @brief The stamp is a grid of LatencyStampColumns x LatencyStampRows black or white square cells.
+*/
+struct LatencyStampLayout {
+	cv::Point origin = { 0, 0 }; // Top-left corner, in pixels of the captured (unscaled) frame.
+	int cellSize = 8;            // Side of each cell in pixels, at least 2.
+};
+
+/**
+ * @brief Options of a capturer that replays a recorded file.
+*/
+struct ReplayOptions {
+	double speed = 1.0; // Multiplier of the recorded pace. 0 means as fast as possible.
+	bool loop = false;  // Restart from the first frame at the end, or stop.
+};
+
+/**
+ * @brief Options of a capturer that generates frames itself, stamped for the latency probe. See IFactory::createSyntheticCapturer().
+*/
+struct SyntheticOptions {
+	int width = 1920;
+	int height = 1080;
+	double fps = 60.0;          // Frames generated per second. 0 means as fast as they are taken.
+	bool stamp = true;          // Draw a latency stamp (see LatencyProbe.h) into each frame when it is generated.
+	LatencyStampLayout layout;  // Where the stamp is drawn.
+};
+
+/**
+ * @brief Options of the adaptive output scale. See ICapturer::setAdaptiveScale().
+ * @brief A frame lags if the callback takes longer than the budget, or too many frames wait for the delivery thread.
+ * @brief A frame has headroom if the callback takes less than the budget * headroomRatio, and none is waiting.
+*/
+struct AdaptiveScaleOptions {
+	bool enabled = false;
+	double callbackBudget = 1.0 / 60.0; // Seconds the callback may take for each frame.
+	size_t maxQueuedFrames = 1;         // Frames that may wait for the delivery thread.
+	double headroomRatio = 0.5;
+	int stepDownFrames = 3;             // Lagging frames in a row to step down: 1.0, 0.5, 0.25.
+	int stepUpFrames = 60;              // Frames with headroom in a row to step back up.
+	double minScale = 0.25;             // Never step below this.
+};
+
+/**
+ * @brief Options of the pre-roll buffer. See ICapturer::setPreroll().
+*/
+struct PrerollOptions {
+	bool enabled = false;
+	double seconds = 60.0;             // Keep frames of at most this duration. 0 keeps as many as the arena holds.
+	size_t arenaBytes = 512ull << 20;  // Fixed memory for the compressed frames, at least 1 MiB. The oldest are evicted first.
+	int keyframeInterval = 120;        // A keyframe every N frames. Frames are evicted a group of N at a time.
+	int tileSize = 64;                 // DeltaCodecOptions::tileSize.
+};
+
+/**
+ * @brief State of the pre-roll buffer. See ICapturer::getPrerollStatus().
+*/
+struct PrerollStatus {
+	size_t frames;       // Frames in the buffer.
+	size_t usedBytes;    // Bytes of them in the arena.
+	size_t arenaBytes;   // PrerollOptions::arenaBytes.
+	double seconds;      // From the oldest frame to the newest.
+	size_t dropped;      // Frames not kept, because they failed to encode or their group did not fit the arena.
+	size_t pendingDumps; // Dumps queued or being written.
+};
+
+/**
+ * @brief How the frame reached the user, for the latency probe. See ICapturer::setLatencyProbe().
+*/
+enum class LatencyMode : int {
+	Polling = 0, // copyMatTo(), runGraph() or acquireFrame() in the polling mode.
+	Callback,    // The callback, called on the capture thread.
+	Queued       // The callback, called on the delivery thread of the threading policy.
+};
+
+/**
+ * @brief Options of the latency probe. See ICapturer::setLatencyProbe().
+*/
+struct LatencyProbeOptions {
+	bool enabled = false;
+	std::string preset;        // Label of the configuration under test. Results are kept per preset and mode.
+	LatencyStampLayout layout; // Where the stamp is in the captured frame.
+	size_t maxSamples = 65536; // Latest samples kept for each preset and mode.
+};
+
+/**
+ * @brief Distribution of source-to-consumer latency of one preset in one mode, in milliseconds. See ICapturer::getLatencyStats().
+*/
+struct LatencyStats {
+	std::string preset;
+	LatencyMode mode;
+	size_t count;      // Decoded frames, including ones no longer kept in 'samples'.
+	size_t undecoded;  // Frames given to the user without a valid stamp.
+	double minMs;
+	double meanMs;
+	double p50Ms;
+	double p90Ms;
+	double p99Ms;
+	double maxMs;
+	std::vector<float> samples; // The kept samples in arrival order.
+};
+
+/**
+ * @brief Time spent starting a capturer, in seconds. See ICapturer::getStartTimes().
+*/
+struct CaptureStartTimes {
+	double waitSeconds;       // Waiting inside the start function for the factory to be ready.
+	double startSeconds;      // The whole start function, including the wait.
+	double firstFrameSeconds; // From calling the start function to the first frame given to the user. Negative before it.
+};
+
+/**
+ * @brief Options of the motion map. See ICapturer::setMotionMap().
+*/
+struct MotionOptions {
+	bool enabled = false;
+	int blockSize = 16;  // Side of each block in pixels. A multiple of 4, from 4 to 64.
+	int searchRange = 0; // Search motion vectors within +-searchRange pixels, up to 32. 0 computes SAD only.
+};
+
+/**
+ * @brief Difference of each block from the previous frame. See ICapturer::getMotionMap().
+ * @brief Block (bx, by) covers the pixels from (bx, by) * blockSize; the last row and column of blocks may be smaller.
+*/
+struct MotionMap {
+	bool valid;       // There was a previous frame of the same size. The maps are empty if not.
+	int blockSize;    // MotionOptions::blockSize.
+	cv::Mat sad;      // CV_32SC1, one per block. Sum of absolute differences of all channels at the same place.
+	cv::Mat vectors;  // CV_8SC2 (dx, dy): the block matches the previous frame best at its place + (dx, dy),
+	                  // so its content moved by (-dx, -dy). Empty if not searching.
+	cv::Mat residual; // CV_32SC1, the SAD at 'vectors'. Empty if not searching.
+};
+
+/**
+ * @brief Latest value of one probe. See ICapturer::addProbe().
+*/
+struct ProbeValue {
+	int id;          // Returned by ICapturer::addProbe().
+	cv::Rect rect;   // Area of the probe in the frame.
+	cv::Vec4b color; // Mean color of the area, in BGRA.
+	bool valid;      // The area is inside the frame. If not, 'color' keeps the last valid value.
+	bool changed;    // 'color' or 'valid' differs from the previous frame, or the probe is new.
+};
+
+/**
+ * @brief Callback of probes. It is called on the capture thread.
+*/
+using ProbeCallback = std::function<void(const std::vector<ProbeValue>& values, const FrameInfo& info)>;
+
+/**
+ * @brief A change of one watched region. See ICapturer::watchRegion().
+*/
+struct RegionChange {
+	int id;        // Returned by ICapturer::watchRegion().
+	cv::Rect rect; // The region in the frame, clipped to it.
+	double change; // Sum of absolute differences of all channels from the previous frame, per pixel of the region.
+};
+
+/**
+ * @brief Callback of a watched region. It is called on the capture thread, or on the delivery thread if any.
+*/
+using RegionCallback = std::function<void(const RegionChange& change, const FrameInfo& info)>;
+
+/**
+ * @brief A view of the frame wanted by one subscriber. See ICapturer::subscribeView().
+*/
+struct ViewOptions {
+	cv::Rect roi;             // Area of the captured frame (in the client area if clipping). Empty for the whole frame.
+	double scale = 1.0;       // Size of the view relative to the area, in (0, 1]. Resized linearly to lround(size * scale), at least 1.
+	int colorConversion = -1; // A cv::ColorConversionCodes from BGRA, like COLOR_BGRA2GRAY. -1 keeps BGRA.
+};
+
+/**
+ * @brief Callback of a view. It is called on the capture thread, or on the delivery thread if any.
+ * @brief The view may be shared with other subscribers: never write into it, and clone it to keep it after the call.
+*/
+using ViewCallback = std::function<void(const cv::Mat& view, const FrameInfo& info)>;
+
+/**
+ * @brief Statistics of one region of a frame. See ICapturer::addStatRegion().
+*/
+struct RegionStats {
+	int id;                     // Returned by ICapturer::addStatRegion().
+	cv::Rect rect;              // The region in the frame.
+	bool valid;                 // The region is inside the frame. Other fields are zero if not.
+	cv::Scalar mean;            // Mean of each channel, in BGRA.
+	cv::Vec4b min;              // Minimum of each channel, in BGRA.
+	cv::Vec4b max;              // Maximum of each channel, in BGRA.
+	uint32_t histogram[3][32];  // Histograms of B, G and R. Bin i counts values in [8i, 8i + 8).
+};
+
+/**
+ * @brief Threads of capturers. See IFactory::setThreadingPolicy() and ICapturer::setThreadingPolicy().
+ * @brief The capture thread reads frames back from the GPU. With free threading, it is a worker of the system.
+ * @brief The delivery thread belongs to the capturer and runs user callbacks, if it is dedicated.
+*/
+struct ThreadingPolicy {
+	bool dedicatedDelivery = false;                // Run the frame and probe callbacks on the delivery thread, not on the capture thread.
+	size_t deliveryQueueDepth = 2;                 // Frames waiting for the delivery thread. The oldest is dropped if full.
+	uint64_t captureAffinity = 0;                  // CPU mask of the capture thread. 0 keeps it unchanged.
+	int capturePriority = THREAD_PRIORITY_NORMAL;  // Priority of the capture thread, like THREAD_PRIORITY_HIGHEST.
+	uint64_t deliveryAffinity = 0;                 // CPU mask of the delivery thread. 0 keeps it unchanged.
+	int deliveryPriority = THREAD_PRIORITY_NORMAL; // Priority of the delivery thread.
+};
+
+/**
+ * @brief Role of a thread in ThreadTimes.
+*/
+enum class ThreadRole {
+	Capture,
+	Delivery
+};
+
+/**
+ * @brief CPU time of one thread used by a capturer. See ICapturer::getThreadTimes().
+*/
+struct ThreadTimes {
+	ThreadRole role;
+	DWORD threadId;
+	double userSeconds;   // User mode time since the capturer first used the thread.
+	double kernelSeconds; // Kernel mode time since the capturer first used the thread.
+	uint64_t frames;      // Frames handled on this thread.
+	uint64_t dropped;     // Frames dropped because the delivery queue was full. Always 0 for capture threads.
+};
+
+/**
+ * @brief Memory budget of all capturers of a factory, and what to do while they use more. See IFactory::setMemoryBudget().
+*/
+struct MemoryBudget {
+	size_t bytes = 0;                // The budget. 0 means no limit.
+	double resumeRatio = 0.9;        // The policies are lifted when the usage falls below bytes * resumeRatio.
+	bool reduceQueueDepth = true;    // Keep fewer pooled buffers, and queue only one frame for the delivery thread.
+	bool downscaleOutputs = false;   // Give frames to copyMatTo() and the callback at half the size.
+	bool evictCaches = true;         // Release pooled buffers that are not in use.
+	bool refuseNewCapturers = true;  // createCapturer() and createReplayCapturer() give an empty pointer.
+};
+
+/**
+ * @brief Memory used by one capturer. See ICapturer::getMemoryUsage().
+*/
+struct CapturerMemory {
+	size_t id;           // ICapturer::getId().
+	size_t stagingBytes; // Textures the frames are read back through.
+	size_t bufferBytes;  // Pooled buffers in use, like frames waiting to be saved or delivered.
+	size_t cacheBytes;   // Pooled buffers kept for reuse, released by MemoryBudget::evictCaches.
+	size_t totalBytes;   // Sum of the above.
+	bool degraded;       // The policies of the budget are applied to this capturer now.
+};
+
+/**
+ * @brief Memory used by all capturers of a factory. See IFactory::getMemoryUsage().
+*/
+struct MemoryUsage {
+	size_t budgetBytes;                   // MemoryBudget::bytes.
+	size_t totalBytes;                    // Sum of all capturers.
+	bool overBudget;                      // The policies are in force.
+	std::vector<CapturerMemory> capturers;
+};
+
+/**
+ * @brief When a factory creates the graphics device shared by its capturers. See IFactory::createInstance().
+*/
+enum class FactoryInit : int {
+	Immediate = 0, // In createInstance(), which throws if it fails.
+	Background,    // On a thread started by createInstance(), which returns at once.
+	Lazy           // When a capturer starts for the first time, or whenReady() is called. Replay never needs it.
+};
+
+/**
+ * @brief Time spent creating a factory, in seconds. See IFactory::getStartupTimes().
+*/
+struct StartupTimes {
+	double apartmentSeconds; // winrt::init_apartment() on the calling thread. 0 if COM was initialized.
+	double deviceSeconds;    // D3D11CreateDevice(), including the fallback to WARP.
+	double interopSeconds;   // The WinRT device and the activation factory of capture items, cached for all starts.
+	double readySeconds;     // From createInstance() until the device is ready. 0 while not ready.
+	bool ready;              // The device is created.
+	bool failed;             // Creating the device failed. Capturers then fail to start, but replay still works.
+};
 
 /**
  * @brief Interface of Capture Factory.
@@ -52,26 +381,81 @@ public:
 	 * @brief Create an instance of Capture Factory.
 	 * @brief This function may throws.
 	 * @param com_initialized: Set true if COM is initialized. 
+	 * @param init: When to create the graphics device. Short jobs can start other work while it is created.
 	 * @return A pointer to the instance.
 	 */
-	static std::shared_ptr<IFactory> createInstance(bool com_initialized);
+	static std::shared_ptr<IFactory> createInstance(bool com_initialized, FactoryInit init = FactoryInit::Immediate);
 
 	/**
 	 * @brief Create an instance of Capture Factory.
 	 * @param com_initialized: Set true if COM is initialized. 
+	 * @param init: When to create the graphics device.
 	 * @return A pointer to the instance. It may be nullptr if failed.
 	 */
-	static std::shared_ptr<IFactory> createInstanceNoThrow(bool com_initialized) noexcept;
+	static std::shared_ptr<IFactory> createInstanceNoThrow(bool com_initialized, FactoryInit init = FactoryInit::Immediate) noexcept;
 
 public:
 	/**
 	 * @brief This function may throws.
+	 * @return The capturer. It is empty if refused by the memory budget.
 	 */
 	virtual std::weak_ptr<ICapturer> createCapturer() = 0;
 	/**
+	 * @brief Create a capturer that replays a file written by IRecorder (see Recorder.h).
+	 * @brief Frames are paced by their recorded timestamps and are not copied out of the mapped file.
+	 * @brief Its start functions ignore the target and start replaying with the same delivery mode.
+	 * @brief This function may throws.
+	 * @param path: The recorded file.
+	 * @param options: Speed and looping of the replay.
+	 * @return The capturer. It is empty if refused by the memory budget.
+	 */
+	virtual std::weak_ptr<ICapturer> createReplayCapturer(const std::wstring& path, const ReplayOptions& options = {}) = 0;
+	/**
+	 * @brief Create a capturer that generates frames on its own thread instead of capturing, to measure the library
+	 * @brief without a display. Its start functions ignore the target and start generating with the same delivery mode.
+	 * @brief This function may throws.
+	 * @param options: Size, rate and stamp of the frames.
+	 * @return The capturer. It is empty if refused by the memory budget.
+	 */
+	virtual std::weak_ptr<ICapturer> createSyntheticCapturer(const SyntheticOptions& options = {}) = 0;
+	/**
+	 * @brief Must not be called from a callback of the same capturer, whose thread would return into the destroyed capturer.
+	 * @brief Stop it from the callback instead, and destroy it from another thread.
 	 * @brief This function may throws.
 	 */
 	virtual void destroyCapturer(std::weak_ptr<ICapturer> instance) = 0;
+
+	/**
+	 * @brief Set the threading policy of all capturers of this factory, including the ones created later.
+	 * @brief See ICapturer::setThreadingPolicy().
+	 * @param policy: The policy.
+	 * @param priorityClass: Priority class of the whole process, like HIGH_PRIORITY_CLASS. 0 keeps it unchanged.
+	 * @return 'true' if succeed. 'false' if any mask is outside the CPUs of the process, or any priority is invalid.
+	 */
+	virtual bool setThreadingPolicy(const ThreadingPolicy& policy, DWORD priorityClass = 0) = 0;
+
+	/**
+	 * @brief Bound the memory of all capturers of this factory.
+	 * @brief Each capturer reports its usage after every frame. Once the total goes over the budget, the policies
+	 * @brief are applied to all capturers until it falls below the resume ratio.
+	 * @param budget: The budget and its policies.
+	 */
+	virtual void setMemoryBudget(const MemoryBudget& budget) = 0;
+	/**
+	 * @brief Query the memory used by each capturer and in total. It can be called at any time.
+	 */
+	virtual MemoryUsage getMemoryUsage() = 0;
+
+	/**
+	 * @brief Get a future that becomes ready with the graphics device. It starts creating it if FactoryInit::Lazy.
+	 * @brief Starting a capturer before it is ready waits for it inside the start function.
+	 * @return The future. Its value is 'false' if creating the device failed.
+	 */
+	virtual std::shared_future<bool> whenReady() = 0;
+	/**
+	 * @brief Query how long each step of creating this factory took.
+	 */
+	virtual StartupTimes getStartupTimes() = 0;
 };
 
 /**
@@ -162,6 +546,8 @@ public:
 	/**
 	 * @brief Require one new frame into the internal cv::Mat.
 	 * @brief Frames will be discarded if this function is not called or a frame already arrived before.
+	 * @brief The internal cv::Mat keeps the previous frame until a new frame arrives, and then it is replaced at once.
+	 * @brief Features that need every frame (bursts, pre-roll, watchers, views) never write into it.
 	*/
 	virtual void askForRefresh() = 0;
 	/**
@@ -177,6 +563,250 @@ public:
 	 * @return 'true' if success.
 	*/
 	virtual void copyMatTo(cv::Mat& target, bool convertToBGR = false) = 0;
+	/**
+	 * @brief Run a processing graph on the internal cv::Mat, without copying it first. See FrameGraph.h.
+	 * @brief copyMatTo() with convertToBGR runs the graph of IFrameGraph::createConvertToBGR().
+	 * @param graph: The graph. It is run while the internal cv::Mat is locked.
+	 * @param outputs: Results of the graph.
+	 * @return 'true' if succeed. 'false' if no frame is captured or the graph failed.
+	*/
+	virtual bool runGraph(IFrameGraph& graph, std::vector<cv::Mat>& outputs) = 0;
+	/**
+	 * @brief Get the information of the frame in the internal cv::Mat.
+	 * @brief In callback mode, it describes the frame passed to the callback and should be called inside it.
+	 * @return The information of the frame.
+	*/
+	virtual FrameInfo getFrameInfo() = 0;
+	/**
+	 * @brief Get a copy of the internal cv::Mat in a pooled buffer, which can be kept and passed to other threads.
+	 * @brief The buffer goes back to the pool when its last reference is released, so nothing is allocated per frame.
+	 * @brief In callback mode, like getFrameInfo(), it should be called inside the callback.
+	 * @param frame: Refers to the pooled buffer.
+	 * @param info: Receives the information of the frame. Can be nullptr.
+	 * @param convertToBGR: Convert the mat to BGR or it will keep as BGRA.
+	 * @return 'false' if no frame is captured, or all pooled buffers are still referred to.
+	*/
+	virtual bool acquireFrame(cv::Mat& frame, FrameInfo* info = nullptr, bool convertToBGR = false) = 0;
+
+	/**
+	 * @brief Save the frame in the internal cv::Mat on background encoder threads.
+	 * @brief The frame is copied into a pooled buffer, so capture is not blocked by encoding.
+	 * @param path: The file to write.
+	 * @param format: Format of the file.
+	 * @param options: Options of encoding.
+	 * @return Becomes 'true' when the file is written. It is 'false' at once if no frame is captured or the encoders are full.
+	*/
+	virtual std::future<bool> saveFrameAsync(const std::wstring& path, ImageFormat format, const SaveOptions& options = {}) = 0;
+	/**
+	 * @brief Save every captured frame for a while, without dropping any.
+	 * @brief If the encoders fall behind, the capture thread waits for them. See getBurstStatus().
+	 * @brief If a burst is running, it is stopped first.
+	 * @param directory: Where to write. Files are named by FrameInfo::sequence.
+	 * @param seconds: How long to take frames.
+	 * @param format: Format of the files.
+	 * @param options: Options of encoding.
+	 * @return 'true' if started.
+	*/
+	virtual bool startBurstSave(const std::wstring& directory, double seconds, ImageFormat format, const SaveOptions& options = {}) = 0;
+	/**
+	 * @brief Stop taking frames for the burst. Frames already taken are still saved.
+	*/
+	virtual void stopBurstSave() = 0;
+	/**
+	 * @brief Query the progress of the last burst.
+	*/
+	virtual BurstStatus getBurstStatus() = 0;
+
+	/**
+	 * @brief Watch the color of one pixel on every frame.
+	 * @brief While no frame is requested, only the probed areas are read back from the GPU.
+	 * @param point: Position of the pixel in the frame (in the client area if clipping).
+	 * @return Id of the probe, or -1 if invalid.
+	*/
+	virtual int addProbe(const cv::Point& point) = 0;
+	/**
+	 * @brief Watch the mean color of a small area on every frame.
+	 * @brief While no frame is requested, only the probed areas are read back from the GPU.
+	 * @param rect: The area in the frame (in the client area if clipping). At most 64x64 pixels.
+	 * @return Id of the probe, or -1 if invalid.
+	*/
+	virtual int addProbe(const cv::Rect& rect) = 0;
+	/**
+	 * @brief Stop watching one probe.
+	 * @return 'true' if the probe existed.
+	*/
+	virtual bool removeProbe(int id) = 0;
+	/**
+	 * @brief Set the function called with probe values after each frame.
+	 * @param cb: The callback. Give nullptr to remove it.
+	 * @param changedOnly: Pass only changed values, and skip frames without change.
+	*/
+	virtual void setProbeCallback(ProbeCallback cb, bool changedOnly = true) = 0;
+	/**
+	 * @brief Query the latest values of all probes, in the order they were added.
+	*/
+	virtual std::vector<ProbeValue> getProbeValues() = 0;
+
+	/**
+	 * @brief Compute statistics of a region on each frame given by copyMatTo() or the callback.
+	 * @brief They are accumulated in the same pass as copyMatTo(), so the frame is not read again.
+	 * @param rect: The region in the frame (in the client area if clipping).
+	 * @return Id of the region, or -1 if invalid.
+	*/
+	virtual int addStatRegion(const cv::Rect& rect) = 0;
+	/**
+	 * @brief Stop computing statistics of one region.
+	 * @return 'true' if the region existed.
+	*/
+	virtual bool removeStatRegion(int id) = 0;
+	/**
+	 * @brief Get the statistics of the frame in the internal cv::Mat, in the order regions were added.
+	 * @brief If copyMatTo() was not called for this frame, the regions are read once here.
+	 * @brief In callback mode, like getFrameInfo(), it should be called inside the callback.
+	 * @return The statistics, which match getFrameInfo().
+	*/
+	virtual std::vector<RegionStats> getRegionStats() = 0;
+
+	/**
+	 * @brief Set the affinity and priority of the capture thread, and whether callbacks run on a dedicated delivery thread.
+	 * @brief The capture thread is changed on its next frame, but only if it is a worker of the system (free threaded or replaying).
+	 * @brief The delivery thread is created or changed at the next start.
+	 * @brief With a dedicated delivery thread, each frame is copied once into a pooled buffer before it is passed to the callback.
+	 * @param policy: The policy.
+	 * @return 'true' if succeed. 'false' if any mask is outside the CPUs of the process, or any priority is invalid.
+	*/
+	virtual bool setThreadingPolicy(const ThreadingPolicy& policy) = 0;
+	/**
+	 * @brief Query the CPU time of the threads used by this capturer, so the isolation can be verified.
+	 * @return Capture threads in the order they were first used, and then the delivery thread if any.
+	*/
+	virtual std::vector<ThreadTimes> getThreadTimes() = 0;
+
+	/**
+	 * @brief Allocate the targets of copyMatTo() and the pooled buffers (saveFrameAsync(), bursts, the delivery thread)
+	 * @brief from a provider of aligned, padded and large-page frames. See FrameMemory.h.
+	 * @brief The frame of the polling mode still refers to the mapped texture, whose rows are aligned by the driver.
+	 * @param memory: The provider. Give nullptr to use the default of OpenCV again.
+	*/
+	virtual void setFrameMemory(std::shared_ptr<IFrameMemory> memory) = 0;
+	/**
+	 * @brief Query the memory used by this capturer. See IFactory::setMemoryBudget().
+	*/
+	virtual CapturerMemory getMemoryUsage() = 0;
+
+	/**
+	 * @brief Scale the frames given to the callback down while it falls behind, and back up when it catches up.
+	 * @brief The scale of each frame is in FrameInfo::scale. The frame is reduced on the GPU and only the reduced one
+	 * @brief is read back, unless probes, bursts, watchers, views, the pre-roll or the motion map need the full size.
+	 * @brief Only the callback mode is watched: polling consumers have frames read back only when they ask for one,
+	 * @brief so they never pay for frames they drop.
+	 * @param options: The options. The scale goes back to 1 if disabled.
+	*/
+	virtual void setAdaptiveScale(const AdaptiveScaleOptions& options) = 0;
+
+	/**
+	 * @brief Compare each frame given by copyMatTo() or the callback with the previous one, block by block.
+	 * @brief It is done in one vectorized pass over the read-back frame, which also keeps it for the next comparison,
+	 * @brief instead of cv::absdiff() and a resize. In the polling mode, the previous frame is the previously updated one.
+	 * @brief The map is in pixels of the captured frame, even if the output is scaled.
+	 * @param options: The options. Disabling it releases the previous frame.
+	 * @return 'false' if the options are invalid.
+	*/
+	virtual bool setMotionMap(const MotionOptions& options) = 0;
+	/**
+	 * @brief Get the motion map of the frame in the internal cv::Mat.
+	 * @brief In callback mode, like getFrameInfo(), it should be called inside the callback.
+	 * @return The map, which matches getFrameInfo(). Invalid if disabled or for the first frame.
+	*/
+	virtual MotionMap getMotionMap() = 0;
+
+	/**
+	 * @brief Keep the recent frames in memory, losslessly compressed with the delta codec (see DeltaCodec.h),
+	 * @brief so the moments before an event can be saved with dumpPreroll().
+	 * @brief Every frame is read back and encoded on the capture thread while it is enabled, like a burst.
+	 * @param options: The options. Disabling it releases the arena and fails dumps not written yet.
+	 * @return 'false' if the options are invalid or the arena cannot be allocated.
+	*/
+	virtual bool setPreroll(const PrerollOptions& options) = 0;
+	/**
+	 * @brief Write the frames in the pre-roll buffer into a file on a background thread. See Preroll.h for the format.
+	 * @brief The capture goes on meanwhile. Frames are copied out one at a time, and frames captured after the call
+	 * @brief are not written.
+	 * @param path: The file. It will be overwritten.
+	 * @return A future of 'true' if written. 'false' if disabled, empty, or failed.
+	*/
+	virtual std::future<bool> dumpPreroll(const std::wstring& path) = 0;
+	/**
+	 * @brief Query the state of the pre-roll buffer. All zero if disabled.
+	*/
+	virtual PrerollStatus getPrerollStatus() = 0;
+
+	/**
+	 * @brief Query how long the last start took, up to the first frame given to the user.
+	 * @brief Together with IFactory::getStartupTimes() it measures the time to the first frame of a capture job.
+	 */
+	virtual CaptureStartTimes getStartTimes() = 0;
+
+	/**
+	 * @brief Measure the latency from the source to the user with frames that carry a stamp (see LatencyProbe.h),
+	 * @brief drawn by ILatencyStampWindow or a synthetic capturer. The stamp is decoded when the frame reaches the
+	 * @brief user: the first copyMatTo(), runGraph() or acquireFrame() of a polled frame, or before the callback.
+	 * @param options: The options. Changing the preset keeps the results of the previous one.
+	 * @return 'false' if the layout is invalid.
+	*/
+	virtual bool setLatencyProbe(const LatencyProbeOptions& options) = 0;
+	/**
+	 * @brief Get the latency distributions measured so far, for each preset and mode seen.
+	*/
+	virtual std::vector<LatencyStats> getLatencyStats() = 0;
+	/**
+	 * @brief Forget all latency results.
+	*/
+	virtual void resetLatencyStats() = 0;
+
+	/**
+	 * @brief Call a function when a region of the frame changes. Every frame is read back while any region is watched.
+	 * @brief Watched regions are kept in a grid of tiles: each frame is compared with the previous one only in tiles
+	 * @brief covered by some region, and each changed tile is measured only against the regions over it.
+	 * @brief The first frame after a region is added, or after the size changes, is only remembered.
+	 * @param rect: The region in the frame (in the client area if clipping).
+	 * @param threshold: The callback is called when RegionChange::change is greater than it. 0 for any change.
+	 * @param callback: The callback.
+	 * @return Id of the watcher, or -1 if invalid.
+	*/
+	virtual int watchRegion(const cv::Rect& rect, double threshold, RegionCallback callback) = 0;
+	/**
+	 * @brief Stop watching one region.
+	 * @return 'true' if the watcher existed.
+	*/
+	virtual bool unwatchRegion(int id) = 0;
+
+	/**
+	 * @brief Get the pyramid of the frame in the internal cv::Mat (see FramePyramid.h). It is created on first request
+	 * @brief and shared by every consumer of this frame, so each level is computed at most once per frame.
+	 * @brief In callback mode, like getFrameInfo(), it should be called inside the callback.
+	 * @brief When the frame is replaced, level 0 is released, and computed levels live as long as the pyramid is held.
+	 * @return The pyramid, or nullptr if no frame is captured.
+	*/
+	virtual std::shared_ptr<IFramePyramid> getPyramid() = 0;
+
+	/**
+	 * @brief Call a function with a view of every frame. Many subscribers can share one capturer.
+	 * @brief All views are compiled into one FrameGraph (see FrameGraph.h) and computed once per frame, in parallel.
+	 * @brief Identical views share one result, and unscaled views of the same format that overlap are computed
+	 * @brief as one area, of which each gets its part. Crops and resizes of the same area are shared across formats.
+	 * @brief A view is the roi clipped to the frame, resized to lround(width * scale) x lround(height * scale) (at least 1),
+	 * @brief the same as computing it alone.
+	 * @param options: The view.
+	 * @param callback: The callback.
+	 * @return Id of the subscriber, or -1 if invalid.
+	*/
+	virtual int subscribeView(const ViewOptions& options, ViewCallback callback) = 0;
+	/**
+	 * @brief Remove one subscriber.
+	 * @return 'true' if the subscriber existed.
+	*/
+	virtual bool unsubscribeView(int id) = 0;
 
 	/**
 	 * @brief Every instance of capturer have an unique id to others.